@@ -0,0 +1,206 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <Wire.h>
+#include <stdarg.h>
+#include <esp_heap_caps.h>
+#include <hal/cpu_hal.h>
+#include "hal_host.h"
+
+static const size_t INTERNAL_HEAP_SIZE  = 320 * 1024;       // Roughly what's free after the Arduino core starts
+static const size_t PSRAM_SIZE          = 8 * 1024 * 1024;
+
+HostSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+SDFS SD;
+TwoWire Wire;
+
+FILE *hostSerialOut = NULL;     // Set by main from --serial
+static size_t internalUsed = 0;
+static size_t psramUsed = 0;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    hal_gpio_mode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    hal_gpio_write(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return hal_gpio_read(pin);
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(hal_now_us() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)hal_now_us();
+}
+
+void delay(uint32_t ms)
+{
+    hal_advance_us((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    hal_advance_us(us);
+}
+
+void yield()
+{
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    hal_advance_us((uint64_t)ticks * 1000);
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)hal_now_us();
+}
+
+uint32_t cpu_hal_get_cycle_count()
+{
+    return (uint32_t)(hal_now_us() * 240);
+}
+
+size_t HostSerial::write(const uint8_t *data, size_t len)
+{
+    if (hostSerialOut)
+        fwrite(data, 1, len, hostSerialOut);
+    return len;
+}
+
+size_t HostSerial::printf(const char *fmt, ...)
+{
+    char text[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    return n > 0 ? write((const uint8_t *)text, strlen(text)) : 0;
+}
+
+void HostSerial::flush()
+{
+    if (hostSerialOut)
+        fflush(hostSerialOut);
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return cpu_hal_get_cycle_count();
+}
+
+static void account(size_t size, uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM)
+        psramUsed += size;
+    else
+        internalUsed += size;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    void *p = malloc(size);
+    if (p)
+        account(size, caps);
+    return p;
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    void *p = calloc(n, size);
+    if (p)
+        account(n * size, caps);
+    return p;
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    void *p = realloc(ptr, size);
+    if (p && ptr == NULL)
+        account(size, caps);
+    return p;
+}
+
+// Frees go through plain free() and aren't seen, so this is a high-water figure
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM)
+        return psramUsed < PSRAM_SIZE ? PSRAM_SIZE - psramUsed : 0;
+    return internalUsed < INTERNAL_HEAP_SIZE ? INTERNAL_HEAP_SIZE - internalUsed : 0;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+    (void)sda;
+    (void)scl;
+    (void)frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+    address = addr;
+    txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (txLen == sizeof(txBuffer))
+        return 0;
+    txBuffer[txLen++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+    size_t n = 0;
+    while (n < len && write(data[n]))
+        n++;
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    hal_i2c_write(address, txBuffer, txLen);
+    txLen = 0;
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len, bool sendStop)
+{
+    (void)sendStop;
+    rxLen = 0;
+    rxPos = 0;
+    while (rxLen < len && rxLen < sizeof(rxBuffer) && hal_i2c_read(addr, &rxBuffer[rxLen]))
+        rxLen++;
+    return (uint8_t)rxLen;
+}
+
+int TwoWire::available()
+{
+    return (int)(rxLen - rxPos);
+}
+
+int TwoWire::read()
+{
+    return rxPos < rxLen ? rxBuffer[rxPos++] : -1;
+}
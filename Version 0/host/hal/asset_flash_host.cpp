@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "storage/asset_atlas.h"
+#include "hal_host.h"
+
+// The "assets" partition: an atlas file read into memory, which stands in for the mapped flash
+static const uint32_t PARTITION_SIZE = 0x100000;    // As in partitions_spectra.csv
+
+static uint8_t *image;
+static size_t imageSize;
+
+bool hal_assets_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    free(image);
+    image = (uint8_t *)malloc(PARTITION_SIZE);
+    imageSize = fread(image, 1, PARTITION_SIZE, f);
+    fclose(f);
+    return imageSize > 0;
+}
+
+bool asset_atlas_mount(AssetAtlas *atlas)
+{
+    if (image == NULL)
+        return false;               // No partition contents, like an unflashed device
+    return asset_atlas_open(atlas, image, imageSize);
+}
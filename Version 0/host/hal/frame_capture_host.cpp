@@ -0,0 +1,10 @@
+#include "display/frame_capture.h"
+
+// The host model has no serial link to stream to; hal_panel_save_ppm() shows the panel directly
+void capture_command(const char *args, void *ctx)
+{
+}
+
+void capture_service_poll()
+{
+}
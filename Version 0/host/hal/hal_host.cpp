@@ -0,0 +1,178 @@
+#include "hal_host.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+struct TraceEvent {
+    uint64_t timeUs;
+    bool i2c;
+    uint8_t target;             // Pin or I2C address
+    uint8_t level;
+    std::vector<uint8_t> bytes;
+};
+
+static uint64_t nowUs = 0;
+static uint8_t levels[64];
+static bool levelKnown[64];
+static std::vector<TraceEvent> events;
+static size_t nextEvent = 0;
+static std::deque<uint8_t> i2cData[128];
+static FILE *recording = NULL;
+
+uint64_t hal_now_us()
+{
+    return nowUs;
+}
+
+void hal_advance_us(uint64_t us)
+{
+    nowUs += us;
+}
+
+// Applies every trace event that is due
+static void replay()
+{
+    while (nextEvent < events.size() && events[nextEvent].timeUs <= nowUs) {
+        const TraceEvent &e = events[nextEvent++];
+        if (e.i2c) {
+            i2cData[e.target & 0x7F].insert(i2cData[e.target & 0x7F].end(), e.bytes.begin(), e.bytes.end());
+        } else if (e.target < 64) {
+            levels[e.target] = e.level;
+            levelKnown[e.target] = true;
+        }
+    }
+}
+
+void hal_gpio_mode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void hal_gpio_write(uint8_t pin, uint8_t level)
+{
+    if (pin >= 64)
+        return;
+    level = level ? 1 : 0;
+    if (recording && (!levelKnown[pin] || levels[pin] != level))
+        hal_trace_out("gpio %u %u", pin, level);
+    levels[pin] = level;
+    levelKnown[pin] = true;
+}
+
+uint8_t hal_gpio_read(uint8_t pin)
+{
+    replay();
+    if (pin >= 64)
+        return 1;
+    return levelKnown[pin] ? levels[pin] : 1;
+}
+
+bool hal_trace_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return false;
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '#' || *p == '\n' || *p == 0)
+            continue;
+
+        TraceEvent e = {};
+        char kind[16];
+        int used = 0;
+        unsigned long long t;
+        if (sscanf(p, "%llu %15s %n", &t, kind, &used) < 2)
+            continue;
+        e.timeUs = t;
+        p += used;
+        if (strcmp(kind, "gpio") == 0) {
+            unsigned pin, level;
+            if (sscanf(p, "%u %u", &pin, &level) != 2)
+                continue;
+            e.target = pin;
+            e.level = level ? 1 : 0;
+        } else if (strcmp(kind, "i2c") == 0) {
+            e.i2c = true;
+            e.target = (uint8_t)strtoul(p, &p, 16);
+            for (;;) {
+                char *end;
+                unsigned long b = strtoul(p, &end, 16);
+                if (end == p)
+                    break;
+                e.bytes.push_back((uint8_t)b);
+                p = end;
+            }
+        } else {
+            continue;           // Recorded output events (spi, pixels) aren't inputs
+        }
+        events.push_back(e);
+    }
+    fclose(f);
+
+    // Stable, so events at the same time keep their order
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent &a, const TraceEvent &b) { return a.timeUs < b.timeUs; });
+    return true;
+}
+
+bool hal_trace_record(const char *path)
+{
+    recording = fopen(path, "w");
+    if (recording)
+        fprintf(recording, "# time_us  event  arguments\n");
+    return recording != NULL;
+}
+
+bool hal_trace_pending()
+{
+    return nextEvent < events.size();
+}
+
+void hal_trace_out(const char *fmt, ...)
+{
+    if (recording == NULL)
+        return;
+    fprintf(recording, "%llu ", (unsigned long long)nowUs);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(recording, fmt, args);
+    va_end(args);
+    fputc('\n', recording);
+}
+
+void hal_trace_close()
+{
+    if (recording)
+        fclose(recording);
+    recording = NULL;
+}
+
+bool hal_i2c_read(uint8_t addr, uint8_t *byte)
+{
+    replay();
+    std::deque<uint8_t> &q = i2cData[addr & 0x7F];
+    if (q.empty())
+        return false;
+    *byte = q.front();
+    q.pop_front();
+    return true;
+}
+
+void hal_i2c_write(uint8_t addr, const uint8_t *data, size_t len)
+{
+    if (recording == NULL)
+        return;
+    char text[3 * 32 + 1] = "";
+    for (size_t i = 0; i < len && i < 32; i++)
+        sprintf(text + 3 * i, " %02x", data[i]);
+    hal_trace_out("i2c-write %02x%s", addr, text);
+}
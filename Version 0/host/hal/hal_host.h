@@ -0,0 +1,81 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "display/panel.h"
+
+/*
+ * Host hardware model
+ *
+ * What the shims in host/shim (Arduino.h, SPI, Wire, spi_master, heap_caps, esp_timer, ...) run
+ * on when the firmware is built for Linux.
+ *
+ * Time is simulated: it only moves when the firmware waits (delay, vTaskDelay) or talks to the
+ * panel, whose transactions take as long as they would on the wire at the configured SPI clock.
+ * CPU work is free, so a run is deterministic and as fast as the machine allows.
+ *
+ * Inputs come from a trace, a text file of timestamped events replayed against the simulated clock:
+ *
+ *   # time_us  event  arguments
+ *   2500000    gpio   11 0            pin 11 reads 0 from here on
+ *   2520000    gpio   11 1
+ *   2500000    i2c    3b 00 01 02     bytes the next reads from I2C address 0x3b return
+ *
+ * Outputs can be recorded in the same format (GPIO level changes, panel commands and pixel writes),
+ * so two builds can be compared by diffing their recordings.
+ *
+ * The panel model decodes the AXS15231B QSPI command stream (CASET/RASET window, RAMWR and
+ * RAMWRC pixel data, VSCRDEF/VSCSAD scrolling) into a framebuffer of the panel's native size
+ * (Panel, 180x640), which can be saved as a landscape PPM of what the screen shows.
+ */
+
+const uint16_t HAL_PANEL_WIDTH          = Panel::NATIVE_WIDTH;  // Native portrait
+const uint16_t HAL_PANEL_HEIGHT         = Panel::NATIVE_HEIGHT;
+const uint32_t HAL_SPI_OVERHEAD_US      = 4;        // Assumed driver cost of one polling transaction
+const uint32_t HAL_SPI_HELD_OVERHEAD_US = 2;        // The same with the bus already acquired by the device
+const uint32_t HAL_SPI_ACQUIRE_US       = 3;        // Assumed cost of spi_device_acquire_bus and its release (lock, ISR and cache setup)
+
+// Simulated clock
+uint64_t hal_now_us();
+void hal_advance_us(uint64_t us);
+
+// GPIO. Unconfigured and pulled-up inputs read high unless the trace says otherwise.
+void hal_gpio_mode(uint8_t pin, uint8_t mode);
+void hal_gpio_write(uint8_t pin, uint8_t level);
+uint8_t hal_gpio_read(uint8_t pin);
+
+// Traces
+bool hal_trace_load(const char *path);
+bool hal_trace_record(const char *path);
+bool hal_trace_pending();                   // Events still to be replayed
+void hal_trace_out(const char *fmt, ...);   // Recording line, prefixed with the time
+void hal_trace_close();
+
+// I2C read data queued by the trace
+bool hal_i2c_read(uint8_t addr, uint8_t *byte);
+void hal_i2c_write(uint8_t addr, const uint8_t *data, size_t len);
+
+// SPI panel model
+struct HalPanelStats {
+    uint32_t transactions;
+    uint32_t commands;          // Register writes (window, MADCTL, brightness, ...)
+    uint64_t pixelBytes;
+    uint64_t busUs;             // Simulated time spent on the bus
+};
+
+void hal_panel_transaction(uint8_t cmd, uint32_t addr, bool hasCommand, const uint8_t *data, size_t bytes,
+                           uint32_t clockHz, bool quad);
+const uint16_t *hal_panel_pixels();         // HAL_PANEL_WIDTH x HAL_PANEL_HEIGHT, native order, RGB565
+uint16_t hal_panel_shown_row(uint16_t row); // Memory row on screen at a native row, after scrolling
+const HalPanelStats &hal_panel_stats();
+bool hal_panel_save_ppm(const char *path);  // Landscape 640x180, as the screen is held
+
+// Flash image for the settings partition; empty (erased) unless loaded from a file
+bool hal_flash_load(const char *path);
+bool hal_flash_save(const char *path);
+
+// Contents of the assets partition (an atlas from tools/asset_pack); none unless loaded
+bool hal_assets_load(const char *path);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * spectra_host - runs the firmware's setup()/loop() on the host hardware model.
+ *
+ * Usage:
+ *   spectra_host [--ms <simulated ms>] [--trace <inputs>] [--record <outputs>] [--frame <out.ppm>]
+ *                [--flash <image>] [--assets <atlas>] [--serial <file>]
+ *
+ * Runs for the given simulated time (default 5000 ms, or until the input trace has been replayed
+ * if that's later), then prints what the panel saw. --flash loads the settings partition from an
+ * image and writes it back at the end, so settings persist across runs like on the device. --assets
+ * puts an atlas from asset_pack in the assets partition.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal_host.h"
+#include "system/metrics.h"
+
+void setup();
+void loop();
+
+extern FILE *hostSerialOut;
+
+static const uint64_t IDLE_STEP_US = 10;   // A loop() pass that doesn't wait still takes a little time
+
+int main(int argc, char **argv)
+{
+    uint64_t runUs = 5000000;
+    const char *frame = NULL;
+    const char *flash = NULL;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char *opt = argv[i], *arg = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (arg == NULL)
+            opt = "";                               // Every option takes a value
+        if (strcmp(opt, "--ms") == 0)
+            runUs = strtoull(arg, NULL, 10) * 1000;
+        else if (strcmp(opt, "--trace") == 0)
+            ok = hal_trace_load(arg);
+        else if (strcmp(opt, "--record") == 0)
+            ok = hal_trace_record(arg);
+        else if (strcmp(opt, "--frame") == 0)
+            frame = arg;
+        else if (strcmp(opt, "--flash") == 0)
+            hal_flash_load(flash = arg);            // A missing image is fine, it starts erased
+        else if (strcmp(opt, "--assets") == 0)
+            ok = hal_assets_load(arg);
+        else if (strcmp(opt, "--serial") == 0)
+            ok = (hostSerialOut = fopen(arg, "wb")) != NULL;
+        else {
+            fprintf(stderr, "usage: spectra_host [--ms <n>] [--trace <file>] [--record <file>] [--frame <ppm>]"
+                            " [--flash <file>] [--assets <file>] [--serial <file>]\n");
+            return 2;
+        }
+        if (!ok) {
+            fprintf(stderr, "can't open %s\n", arg);
+            return 1;
+        }
+    }
+
+    setup();
+    while (hal_now_us() < runUs || hal_trace_pending()) {
+        uint64_t before = hal_now_us();
+        loop();
+        if (hal_now_us() == before)
+            hal_advance_us(IDLE_STEP_US);
+    }
+
+    const HalPanelStats &panel = hal_panel_stats();
+    printf("simulated    %.3f s\n", hal_now_us() / 1e6);
+    printf("frames       %u\n", (unsigned)metrics[METRIC_FRAMES].value);
+    printf("transactions %u (%u commands)\n", panel.transactions, panel.commands);
+    printf("pixel bytes  %llu\n", (unsigned long long)panel.pixelBytes);
+    printf("bus time     %.1f ms (%.1f%%)\n", panel.busUs / 1e3, 100.0 * panel.busUs / hal_now_us());
+
+    hal_trace_close();
+    if (hostSerialOut)
+        fclose(hostSerialOut);
+    if (flash && !hal_flash_save(flash))
+        fprintf(stderr, "can't write %s\n", flash);
+    if (frame && !hal_panel_save_ppm(frame)) {
+        fprintf(stderr, "can't write %s\n", frame);
+        return 1;
+    }
+    return 0;
+}
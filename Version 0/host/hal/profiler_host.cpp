@@ -0,0 +1,11 @@
+#include "system/profiler.h"
+
+// No timer interrupts on the host model, and its CPU time says nothing about the device's anyway
+bool prof_service_begin()
+{
+    return false;
+}
+
+void prof_command(const char *args, void *ctx)
+{
+}
@@ -0,0 +1,17 @@
+#include "storage/serial_xfer.h"
+
+// The host model has no serial input, so there's nothing to receive; tools/xfer_send.cpp --rig
+// runs the receiver over a pseudo-terminal instead
+bool xfer_service_begin()
+{
+    return false;
+}
+
+bool xfer_service_poll()
+{
+    return false;
+}
+
+void xfer_service_feed(const uint8_t *data, size_t len)
+{
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+#include "system/settings.h"
+#include "hal_host.h"
+
+// The "settings" partition as a RAM image with NOR flash rules: writes only clear bits
+static const uint32_t SECTOR_SIZE   = 4096;
+static const uint16_t SECTOR_COUNT  = 16;           // 64K, as in partitions_spectra.csv
+
+static uint8_t image[SECTOR_SIZE * SECTOR_COUNT];
+static bool erased = false;
+
+static void erase_all()
+{
+    if (!erased)
+        memset(image, 0xFF, sizeof(image));
+    erased = true;
+}
+
+static bool flash_read(uint32_t offset, void *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    erase_all();
+    if (offset + len > sizeof(image))
+        return false;
+    memcpy(data, image + offset, len);
+    return true;
+}
+
+static bool flash_write(uint32_t offset, const void *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    erase_all();
+    if (offset + len > sizeof(image))
+        return false;
+    for (size_t i = 0; i < len; i++)
+        image[offset + i] &= ((const uint8_t *)data)[i];
+    hal_trace_out("flash-write %u %u", offset, (unsigned)len);
+    return true;
+}
+
+static bool flash_erase(uint32_t sector, void *ctx)
+{
+    (void)ctx;
+    erase_all();
+    if (sector >= SECTOR_COUNT)
+        return false;
+    memset(image + sector * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+    hal_trace_out("flash-erase %u", sector);
+    return true;
+}
+
+const SettingsFlash *settings_flash_partition()
+{
+    static const SettingsFlash flash = {flash_read, flash_write, flash_erase, SECTOR_SIZE, SECTOR_COUNT, NULL};
+    return &flash;
+}
+
+bool hal_flash_load(const char *path)
+{
+    erase_all();
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    fread(image, 1, sizeof(image), f);
+    fclose(f);
+    return true;
+}
+
+bool hal_flash_save(const char *path)
+{
+    erase_all();
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return false;
+    bool ok = fwrite(image, 1, sizeof(image), f) == sizeof(image);
+    return fclose(f) == 0 && ok;
+}
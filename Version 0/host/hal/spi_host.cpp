@@ -0,0 +1,212 @@
+#include <driver/spi_master.h>
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include "hal_host.h"
+
+// AXS15231B QSPI protocol: a transaction's command byte says how the rest is sent
+static const uint8_t QSPI_WRITE_REG     = 0x02;     // Register in address bits 15..8, data on one line
+static const uint8_t QSPI_WRITE_PIXELS  = 0x32;     // RAMWR/RAMWRC in address bits 15..8, data on four lines
+static const uint8_t REG_CASET          = 0x2A;
+static const uint8_t REG_RASET          = 0x2B;
+static const uint8_t REG_RAMWR          = 0x2C;     // Pixels from the window's start
+static const uint8_t REG_RAMWRC         = 0x3C;     // Pixels carrying on where the last ones stopped
+static const uint8_t REG_VSCRDEF        = 0x33;     // Scroll area: top fixed, scrolling, bottom fixed rows
+static const uint8_t REG_VSCSAD         = 0x37;     // Memory row shown first in the scroll area
+
+struct spi_device_t {
+    spi_device_interface_config_t config;
+    std::deque<spi_transaction_t *> done;
+};
+
+static spi_device_t devices[3];
+static uint16_t framebuffer[HAL_PANEL_WIDTH * HAL_PANEL_HEIGHT];
+static HalPanelStats stats;
+static uint16_t winX1 = 0, winX2 = HAL_PANEL_WIDTH - 1;
+static uint16_t winY1 = 0, winY2 = HAL_PANEL_HEIGHT - 1;
+static uint16_t curX = 0, curY = 0;
+static uint16_t scrollTop = 0, scrollRows = HAL_PANEL_HEIGHT, scrollStart = 0;
+static bool writing = false;
+static uint64_t busNs = 0;      // Bus time not yet added to the clock
+static bool busHeld = false;    // spi_device_acquire_bus in effect
+
+static void write_pixels(const uint8_t *data, size_t bytes)
+{
+    for (size_t i = 0; i + 1 < bytes; i += 2) {
+        if (curY > winY2)
+            break;              // Past the window's end, the controller drops it
+        if (curX < HAL_PANEL_WIDTH && curY < HAL_PANEL_HEIGHT)
+            framebuffer[curY * HAL_PANEL_WIDTH + curX] = (uint16_t)(data[i] << 8 | data[i + 1]);
+        if (++curX > winX2) {
+            curX = winX1;
+            curY++;
+        }
+    }
+}
+
+void hal_panel_transaction(uint8_t cmd, uint32_t addr, bool hasCommand, const uint8_t *data, size_t bytes,
+                           uint32_t clockHz, bool quad)
+{
+    // Command and address go out on one line, pixel data on four
+    uint64_t bits = (hasCommand ? 8 + 24 : 0) + (quad ? bytes * 2 : bytes * 8);
+    busNs += (busHeld ? HAL_SPI_HELD_OVERHEAD_US : HAL_SPI_OVERHEAD_US) * 1000;
+    busNs += clockHz ? bits * 1000000000ull / clockHz : 0;
+    stats.busUs += busNs / 1000;
+    hal_advance_us(busNs / 1000);
+    busNs %= 1000;
+    stats.transactions++;
+
+    uint8_t reg = (uint8_t)(addr >> 8);
+    if (!hasCommand) {
+        if (writing) {
+            write_pixels(data, bytes);
+            stats.pixelBytes += bytes;
+            hal_trace_out("pixels -- %u", (unsigned)(bytes / 2));
+        }
+        return;
+    }
+
+    if (cmd == QSPI_WRITE_PIXELS && (reg == REG_RAMWR || reg == REG_RAMWRC)) {
+        if (reg == REG_RAMWR) {
+            curX = winX1;
+            curY = winY1;
+        }
+        writing = true;
+        write_pixels(data, bytes);
+        stats.pixelBytes += bytes;
+        hal_trace_out("pixels %02x %u", reg, (unsigned)(bytes / 2));
+        return;
+    }
+
+    writing = false;
+    stats.commands++;
+    if (cmd == QSPI_WRITE_REG && bytes >= 6 && reg == REG_VSCRDEF) {
+        scrollTop = (uint16_t)(data[0] << 8 | data[1]);
+        scrollRows = (uint16_t)(data[2] << 8 | data[3]);
+    } else if (cmd == QSPI_WRITE_REG && bytes >= 2 && reg == REG_VSCSAD) {
+        scrollStart = (uint16_t)(data[0] << 8 | data[1]);
+    }
+    if (cmd == QSPI_WRITE_REG && bytes >= 4 && (reg == REG_CASET || reg == REG_RASET)) {
+        uint16_t a = (uint16_t)(data[0] << 8 | data[1]);
+        uint16_t b = (uint16_t)(data[2] << 8 | data[3]);
+        if (reg == REG_CASET) {
+            winX1 = a;
+            winX2 = b;
+        } else {
+            winY1 = a;
+            winY2 = b;
+        }
+    }
+
+    char text[3 * 8 + 1] = "";
+    for (size_t i = 0; i < bytes && i < 8; i++)
+        sprintf(text + 3 * i, " %02x", data[i]);
+    hal_trace_out("spi %02x %02x%s", cmd, reg, text);
+}
+
+const uint16_t *hal_panel_pixels()
+{
+    return framebuffer;
+}
+
+// Scrolling only changes which memory row each row of the scroll area shows
+uint16_t hal_panel_shown_row(uint16_t row)
+{
+    if (row < scrollTop || row >= scrollTop + scrollRows || scrollStart < scrollTop ||
+        scrollStart >= scrollTop + scrollRows)
+        return row;
+    return scrollTop + (row - scrollTop + scrollStart - scrollTop) % scrollRows;
+}
+
+const HalPanelStats &hal_panel_stats()
+{
+    return stats;
+}
+
+bool hal_panel_save_ppm(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return false;
+
+    // Landscape: native column 179 is the top row, native rows (as shown) run left to right
+    fprintf(f, "P6\n%u %u\n255\n", HAL_PANEL_HEIGHT, HAL_PANEL_WIDTH);
+    for (int y = 0; y < HAL_PANEL_WIDTH; y++) {
+        for (int x = 0; x < HAL_PANEL_HEIGHT; x++) {
+            uint16_t c = framebuffer[hal_panel_shown_row(x) * HAL_PANEL_WIDTH + (HAL_PANEL_WIDTH - 1 - y)];
+            uint8_t rgb[3] = {(uint8_t)((c >> 11) * 255 / 31), (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                              (uint8_t)((c & 0x1F) * 255 / 31)};
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma)
+{
+    (void)config;
+    (void)dma;
+    return host <= SPI3_HOST ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle)
+{
+    if (host > SPI3_HOST)
+        return ESP_ERR_INVALID_ARG;
+    devices[host].config = *config;
+    *handle = &devices[host];
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *t)
+{
+    uint8_t commandBits = handle->config.command_bits;
+    if (t->flags & SPI_TRANS_VARIABLE_CMD)
+        commandBits = ((spi_transaction_ext_t *)t)->command_bits;
+
+    const uint8_t *data = (t->flags & SPI_TRANS_USE_TXDATA) ? t->tx_data : (const uint8_t *)t->tx_buffer;
+    size_t bytes = data ? t->length / 8 : 0;
+    hal_panel_transaction((uint8_t)t->cmd, (uint32_t)t->addr, commandBits != 0, data, bytes,
+                          handle->config.clock_speed_hz, (t->flags & SPI_TRANS_MODE_QIO) != 0);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *t)
+{
+    return spi_device_polling_transmit(handle, t);
+}
+
+// Queued transactions complete straight away, in order
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *t, TickType_t wait)
+{
+    (void)wait;
+    spi_device_polling_transmit(handle, t);
+    handle->done.push_back(t);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **t, TickType_t wait)
+{
+    (void)wait;
+    if (handle->done.empty())
+        return ESP_FAIL;
+    *t = handle->done.front();
+    handle->done.pop_front();
+    return ESP_OK;
+}
+
+esp_err_t spi_device_acquire_bus(spi_device_handle_t handle, TickType_t wait)
+{
+    (void)handle;
+    (void)wait;
+    busHeld = true;
+    hal_advance_us(HAL_SPI_ACQUIRE_US);     // CPU time, not bus time
+    return ESP_OK;
+}
+
+void spi_device_release_bus(spi_device_handle_t handle)
+{
+    (void)handle;
+    busHeld = false;
+}
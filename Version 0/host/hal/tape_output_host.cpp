@@ -0,0 +1,41 @@
+#include "tape/tape_output.h"
+#include "hal_host.h"
+
+// Tape playback on the host: nothing is played, the tape just takes as long as it would
+static bool started = false;
+static uint64_t busyUntilUs = 0;
+
+bool tape_output_begin(uint8_t pin)
+{
+    (void)pin;
+    started = true;
+    return true;
+}
+
+bool tape_output_play(const TapePulseBuffer *buf, uint16_t block)
+{
+    if (!started || tape_output_busy())
+        return false;
+
+    TapePulseCursor cursor;
+    tape_cursor_init(&cursor, buf, block);
+    uint64_t tstates = 0;
+    uint8_t level;
+    uint32_t length;
+    while (tape_cursor_next(&cursor, &level, &length))
+        tstates += length;
+
+    busyUntilUs = hal_now_us() + tstates * 1000000 / TAPE_TSTATES_PER_SECOND;
+    hal_trace_out("tape-play %u %llu", block, (unsigned long long)tstates);
+    return true;
+}
+
+bool tape_output_busy()
+{
+    return hal_now_us() < busyUntilUs;
+}
+
+void tape_output_stop()
+{
+    busyUntilUs = 0;
+}
@@ -0,0 +1,6 @@
+#include "emu/tape_screen.h"
+
+// No card on the host model; tools/emu_bench.cpp runs captures from files instead
+void tape_screen_command(const char *args, void *ctx)
+{
+}
@@ -0,0 +1,116 @@
+#include <TFT_eSPI.h>
+#include <stdlib.h>
+
+// Classic 5x7 GLCD font, printable ASCII; one byte per column, bit 0 at the top
+static const uint8_t FONT_5X7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+    {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+    {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+    {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+static inline uint16_t swapped(uint32_t c)
+{
+    return (uint16_t)((c >> 8 & 0xFF) | (c & 0xFF) << 8);
+}
+
+void *TFT_eSprite::createSprite(int16_t width, int16_t height, uint8_t frames)
+{
+    (void)frames;
+    deleteSprite();
+    pixels = (uint16_t *)calloc((size_t)width * height, sizeof(uint16_t));
+    if (pixels) {
+        w = width;
+        h = height;
+    }
+    return pixels;
+}
+
+void TFT_eSprite::deleteSprite()
+{
+    free(pixels);
+    pixels = NULL;
+    w = h = 0;
+}
+
+void TFT_eSprite::fillSprite(uint32_t color)
+{
+    fillRect(0, 0, w, h, color);
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+    if (pixels && x >= 0 && y >= 0 && x < w && y < h)
+        pixels[y * w + x] = swapped(color);
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color)
+{
+    for (int32_t j = y; j < y + rh; j++) {
+        for (int32_t i = x; i < x + rw; i++)
+            drawPixel(i, j, color);
+    }
+}
+
+// With swap bytes set the image holds plain RGB565 values, which get swapped for the bus
+void TFT_eSprite::pushImage(int32_t x, int32_t y, int32_t iw, int32_t ih, const uint16_t *data)
+{
+    if (pixels == NULL)
+        return;
+    for (int32_t j = 0; j < ih; j++) {
+        for (int32_t i = 0; i < iw; i++) {
+            int32_t px = x + i, py = y + j;
+            if (px < 0 || py < 0 || px >= w || py >= h)
+                continue;
+            uint16_t c = data[j * iw + i];
+            pixels[py * w + px] = swapBytes ? swapped(c) : c;
+        }
+    }
+}
+
+int16_t TFT_eSprite::drawString(const char *text, int32_t x, int32_t y)
+{
+    int32_t startX = x;
+    for (const char *p = text; *p; p++, x += 6 * textSize) {
+        uint8_t ch = (uint8_t)*p;
+        const uint8_t *glyph = FONT_5X7[(ch >= 32 && ch < 127 ? ch : '?') - 32];
+        for (int col = 0; col < 6; col++) {
+            uint8_t bits = col < 5 ? glyph[col] : 0;
+            for (int row = 0; row < 8; row++) {
+                bool on = bits >> row & 1;
+                if (!on && !textFill)
+                    continue;
+                fillRect(x + col * textSize, y + row * textSize, textSize, textSize, on ? textFg : textBg);
+            }
+        }
+    }
+    return (int16_t)(x - startX);
+}
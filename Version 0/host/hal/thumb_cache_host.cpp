@@ -0,0 +1,16 @@
+#include "storage/thumb_cache.h"
+
+// No card on the host model; tools/thumb_check.cpp runs the cache on a file instead
+bool thumb_service_begin()
+{
+    return false;
+}
+
+bool thumb_service_work()
+{
+    return false;
+}
+
+void thumb_command(const char *args, void *ctx)
+{
+}
@@ -0,0 +1,69 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Linux stand-in for the Arduino core, on the host hardware model (host/hal/hal_host.h)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PROGMEM
+
+#define LOW             0x0
+#define HIGH            0x1
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+
+#define LSBFIRST        0
+#define MSBFIRST        1
+#define SPI_MODE0       0
+#define SPI_MODE1       1
+#define SPI_MODE2       2
+#define SPI_MODE3       3
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// Output goes to the file given with --serial, or nowhere; there's no input
+class HostSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    int available() { return 0; }   // Nothing comes in
+    size_t read(uint8_t *data, size_t len) { (void)data; (void)len; return 0; }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t len);
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t println(const char *s = "") { return print(s) + print("\r\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+    operator bool() const { return true; }
+};
+extern HostSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <stdint.h>
+#include "SPI.h"
+
+// No card on the host model: the mount fails and setup() leaves the file services off
+class SDFS {
+public:
+    bool begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency, const char *mountpoint)
+    {
+        (void)ssPin;
+        (void)spi;
+        (void)frequency;
+        (void)mountpoint;
+        return false;
+    }
+};
+extern SDFS SD;
+
+#endif
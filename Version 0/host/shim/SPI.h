@@ -0,0 +1,37 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <stdint.h>
+
+// Bit-banged command path of the panel driver; unused with the QSPI driver but it has to compile
+class SPISettings {
+public:
+    SPISettings(uint32_t clock = 1000000, uint8_t bitOrder = 1, uint8_t dataMode = 0)
+    {
+        (void)clock;
+        (void)bitOrder;
+        (void)dataMode;
+    }
+};
+
+#define FSPI 0
+#define HSPI 1
+
+class SPIClass {
+public:
+    SPIClass(uint8_t bus = FSPI) { (void)bus; }
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1)
+    {
+        (void)sck;
+        (void)miso;
+        (void)mosi;
+        (void)ss;
+    }
+    void beginTransaction(SPISettings settings) { (void)settings; }
+    void endTransaction() {}
+    void write(uint8_t data) { (void)data; }
+    uint8_t transfer(uint8_t data) { (void)data; return 0xFF; }
+};
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef HOST_TFT_ESPI_H
+#define HOST_TFT_ESPI_H
+
+// The parts of TFT_eSPI the firmware uses: sprites as off-screen canvases (pushed by the panel
+// driver, never through TFT_eSPI) and the built-in 6x8 font. Like the library, 16-bit sprites
+// keep their pixels byte-swapped, in the order they go out on the bus.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TFT_BLACK       0x0000
+#define TFT_WHITE       0xFFFF
+
+class TFT_eSPI {
+public:
+    TFT_eSPI(int16_t w = 180, int16_t h = 640) { (void)w; (void)h; }
+    void init() {}
+    void begin() {}
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+    explicit TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI() { (void)tft; }
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+    void deleteSprite();
+    bool created() const { return pixels != NULL; }
+    void *getPointer() { return pixels; }
+    int16_t width() const { return w; }
+    int16_t height() const { return h; }
+
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    bool getSwapBytes() const { return swapBytes; }
+
+    void fillSprite(uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+    void setTextFont(uint8_t font) { (void)font; }
+    void setTextSize(uint8_t size) { textSize = size ? size : 1; }
+    void setTextColor(uint16_t fg, uint16_t bg) { textFg = fg; textBg = bg; textFill = true; }
+    void setTextColor(uint16_t fg) { textFg = fg; textFill = false; }
+    int16_t drawString(const char *text, int32_t x, int32_t y);
+
+private:
+    uint16_t *pixels = NULL;
+    int16_t w = 0;
+    int16_t h = 0;
+    bool swapBytes = false;
+    uint8_t textSize = 1;
+    uint16_t textFg = TFT_WHITE;
+    uint16_t textBg = TFT_BLACK;
+    bool textFill = false;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// I2C on the host: writes are recorded, reads return what the trace queued for the address
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t len);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t len, bool sendStop = true);
+    int available();
+    int read();
+
+private:
+    uint8_t address = 0;
+    uint8_t txBuffer[128];
+    size_t txLen = 0;
+    uint8_t rxBuffer[128];
+    size_t rxLen = 0;
+    size_t rxPos = 0;
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// Placement attributes mean nothing on the host
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define __NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif
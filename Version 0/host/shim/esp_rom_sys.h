@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_ROM_SYS_H
+#define HOST_ESP_ROM_SYS_H
+
+#include <stdint.h>
+
+inline uint32_t esp_rom_get_cpu_ticks_per_us() { return 240; }
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Simulated time, see host/hal/hal_host.h
+int64_t esp_timer_get_time();
+
+#endif
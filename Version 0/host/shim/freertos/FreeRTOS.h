@@ -0,0 +1,19 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+
+#endif
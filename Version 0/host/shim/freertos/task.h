@@ -0,0 +1,11 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// There's one thread on the host: waiting just moves the simulated clock
+void vTaskDelay(TickType_t ticks);
+inline void taskYIELD() {}
+inline BaseType_t xPortGetCoreID() { return 1; }
+
+#endif
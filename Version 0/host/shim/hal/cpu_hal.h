@@ -0,0 +1,10 @@
+#ifndef HOST_CPU_HAL_H
+#define HOST_CPU_HAL_H
+
+#include <stdint.h>
+
+// A 240 MHz cycle counter on the simulated clock; everything runs on the loop() core
+uint32_t cpu_hal_get_cycle_count();
+inline uint32_t cpu_hal_get_core_id() { return 1; }
+
+#endif
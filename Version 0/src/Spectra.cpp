@@ -37,17 +37,123 @@
 #include <Arduino.h>
 #include <Wire.h>               // Wire library for I2C communication
 #include <TFT_eSPI.h>           // TFT_eSPI library for handling the display
+#include <SD.h>                 // TF card, mounted at XFER_ROOT
 
 #include "display/AXS15231B.h"  // Custom display driver header
+#include "display/frame_capture.h"
 #include "pins_config.h"        // Pin configurations
 #include "gfx/boot_splash.h"
+#include "tape/tape_output.h"
+#include "gfx/zx_screen.h"
+#include "system/settings.h"
+#include "storage/asset_atlas.h"
+#include "storage/serial_xfer.h"
+#include "system/scheduler.h"
+#include "system/dlog.h"
+#include "system/profiler.h"
+#include "system/serial_cmd.h"
+#include "system/metrics.h"
+#include "gfx/hud.h"
+#include "emu/tape_screen.h"
+#include "storage/thumb_cache.h"
 #include "config.h"
 
 TFT_eSPI tft = TFT_eSPI();      // Initialize the display object
+Scheduler uiScheduler;          // Everything loop() runs, on core 1
+AssetAtlas assets;              // Images in the assets partition, drawn straight from mapped flash
+SerialCmd commands;             // Text commands over USB serial, e.g. "prof start"
+
+// Task priorities on the UI core, higher runs first
+const uint8_t PRIO_INPUT    = 3;
+const uint8_t PRIO_SPLASH   = 2;
+const uint8_t PRIO_HUD      = 1;
+const uint8_t PRIO_SERIAL   = 1;
+const uint8_t PRIO_SETTINGS = 0;
+const uint8_t PRIO_CAPTURE  = 0;
+
+static void serial_writer(const void *data, size_t len, void *ctx)
+{
+    Serial.write((const uint8_t *)data, len);
+}
+
+static void input_task(void *ctx)
+{
+    static bool buttonDown = false;
+
+    if (digitalRead(TOUCH_INT) == LOW)
+        resetSplash();
+
+    bool pressed = digitalRead(PIN_BUTTON_1) == LOW;
+    if (pressed && !buttonDown)
+        hud_toggle();                   // Button 1 shows/hides the performance HUD (button 2's GPIO21 is also QSPI D2)
+    buttonDown = pressed;
+}
+
+static void hud_task(void *ctx)
+{
+    hud_update();
+}
+
+static void splash_task(void *ctx)
+{
+    drawBootSplash();
+}
+
+static bool xferReady = false;
+
+// The USB serial port carries text commands and file transfers (tools/xfer_send.cpp). A transfer
+// under way has it to itself; otherwise what comes in goes to the commands, and to the receiver so
+// it sees a transfer start.
+static void serial_task(void *ctx)
+{
+    if (xferReady && xfer_service_poll())
+        return;
+
+    static uint8_t chunk[512];
+    size_t n = Serial.available();
+    if (n == 0)
+        return;
+    n = Serial.read(chunk, n < sizeof(chunk) ? n : sizeof(chunk));
+    serial_cmd_feed(&commands, chunk, n);
+    if (xferReady)
+        xfer_service_feed(chunk, n);
+}
+
+// Mounts the TF card at XFER_ROOT, where the transfers, previews and tape screens find their files
+static bool sd_begin()
+{
+    static SPIClass sdSpi(HSPI);
+    sdSpi.begin(SD_SCK, SD_MISO, SD_MOSI, SD_CS);
+    if (!SD.begin(SD_CS, sdSpi, SD_FREQUENCY, XFER_ROOT)) {
+        Serial.println("No SD card, file services are off");
+        return false;
+    }
+    return true;
+}
+
+static void capture_task(void *ctx)
+{
+    capture_service_poll();             // Frames to tools/capture_recv.cpp, while "cap start" is on
+}
+
+static void settings_task(void *ctx)
+{
+    settings_tick(millis());            // Writes changed settings once they've settled
+}
 
 void setup()
 {
+    Serial.setRxBufferSize(XFER_SERIAL_RX_BUFFER);
+    Serial.begin(115200);
+    metrics_init();                     // Before anything that publishes to it
+    if (dlog_begin()) {                 // Last run's log survived a reset, send it out for dlog_decode
+        dlog_dump(serial_writer, NULL);
+        Serial.flush();
+        dlog_clear();
+    }
+
     pinMode(TOUCH_INT, INPUT_PULLUP);   // Set the touch interrupt pin as input with pull-up resistor
+    pinMode(PIN_BUTTON_1, INPUT_PULLUP);
 
     // Comment this out if using variable brightness
     pinMode(TFT_BL, OUTPUT);            // Set backlight pin as output
@@ -60,17 +166,43 @@ void setup()
     digitalWrite(TOUCH_RES, HIGH); delay(2);
     Wire.begin(TOUCH_IICSDA, TOUCH_IICSCL);     // Start I2C communication for touch controller
 
+    settings_begin(settings_flash_partition());     // Falls back to the defaults on the stock partition table
+    asset_atlas_mount(&assets);                     // Stays empty if the partition hasn't been flashed
+    splashUseAssets(&assets);                       // Splash artwork from there, or the built-in images
+
     axs15231_init();                    // Initialize display
+    hw_set_brightness(settings.brightness);
 
     lcd_fill(0, 0, LCD_HEIGHT, LCD_WIDTH, COLORS::BLACK);     // Clear the screen to black, initially
+
+    tape_output_begin(TAPE_EAR_OUT);    // Tape playback through the RMT, EAR idles low until something plays
+    zx_screen_init();                   // SCREEN$ lookup tables, panel byte order
+
+    sched_init(&uiScheduler, NULL);
+    sched_set_load_metric(&uiScheduler, METRIC_CORE1_BUSY_US);
+    sched_add(&uiScheduler, "input", input_task, NULL, PRIO_INPUT, 10000);
+    sched_add(&uiScheduler, "splash", splash_task, NULL, PRIO_SPLASH, 16000);   // ~60 fps
+    sched_add(&uiScheduler, "hud", hud_task, NULL, PRIO_HUD, HUD_PERIOD_US);
+    sched_add(&uiScheduler, "settings", settings_task, NULL, PRIO_SETTINGS, 100000);
+    serial_cmd_init(&commands);
+    if (prof_service_begin())           // Sampling profiler, "prof start/stop/dump" (tools/prof_report.cpp)
+        serial_cmd_add(&commands, "prof", prof_command, NULL);
+    serial_cmd_add(&commands, "cap", capture_command, NULL);
+    sched_add(&uiScheduler, "capture", capture_task, NULL, PRIO_CAPTURE, 5000);
+    if (sd_begin()) {                   // Everything below reads or writes the card
+        serial_cmd_add(&commands, "tapescr", tape_screen_command, NULL);    // Loading screen by emulation
+        if (thumb_service_begin())      // Previews cached on the card, made in loop()'s idle time
+            serial_cmd_add(&commands, "thumb", thumb_command, NULL);
+        xferReady = xfer_service_begin();
+    }
+    sched_add(&uiScheduler, "serial", serial_task, NULL, PRIO_SERIAL, 2000);
 }
 
 void loop() 
 {
-    drawBootSplash();
-
-    if (digitalRead(TOUCH_INT) == LOW) 
-    {
-        resetSplash();
-    }    
+    uint32_t wait = sched_run_once(&uiScheduler);
+    if (wait >= THUMB_IDLE_US && thumb_service_work())
+        return;                         // Made a queued preview with the time, see what's due now
+    if (wait >= 1000)
+        delay(wait / 1000);             // Nothing due for a while, let the idle task run
 }
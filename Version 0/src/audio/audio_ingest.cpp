@@ -0,0 +1,88 @@
+#include "audio_ingest.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+static uint64_t now_us()
+{
+#ifdef ARDUINO
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+bool audio_ingest_open(AudioIngest *ing, FILE *file, uint32_t outRate)
+{
+    memset(&ing->stats, 0, sizeof(ing->stats));
+    ing->outRate = outRate;
+    ing->flushed = false;
+
+    if (!wav_open(&ing->wav, file))
+        return false;
+
+    ing->passthrough = ing->wav.info.sampleRate == outRate;
+    if (!ing->passthrough)
+        resampler_init(&ing->resampler, ing->wav.info.sampleRate, outRate);
+    return true;
+}
+
+size_t audio_ingest_fill(AudioIngest *ing, int16_t *out, size_t maxFrames)
+{
+    uint64_t start = now_us();
+    size_t n = 0;
+
+    if (ing->passthrough) {
+        while (n < maxFrames) {
+            size_t got = wav_read_mono(&ing->wav, out + n, maxFrames - n);
+            if (got == 0)
+                break;
+            ing->stats.framesIn += got;
+            n += got;
+        }
+    } else {
+        while (true) {
+            n += resampler_process(&ing->resampler, out + n, maxFrames - n);
+            if (n == maxFrames)
+                break;
+
+            size_t room;
+            int16_t *dest = resampler_input(&ing->resampler, &room);
+            size_t got = wav_read_mono(&ing->wav, dest, room);
+            if (got == 0) {
+                if (ing->flushed)
+                    break;
+                // End of file: run half a filter of silence through so the last samples come out too
+                got = room < (size_t)RESAMPLER_TAPS ? room : RESAMPLER_TAPS;
+                memset(dest, 0, got * sizeof(int16_t));
+                ing->flushed = true;
+            } else {
+                ing->stats.framesIn += got;
+            }
+            resampler_commit(&ing->resampler, got);
+        }
+
+        // The flush produces a few samples past the real end, trim them off
+        const WavInfo &info = ing->wav.info;
+        uint32_t total = (uint32_t)(((uint64_t)info.frames * ing->outRate + info.sampleRate - 1) / info.sampleRate);
+        if (ing->stats.framesOut + n > total)
+            n = total > ing->stats.framesOut ? total - ing->stats.framesOut : 0;
+    }
+
+    ing->stats.framesOut += n;
+    ing->stats.busyUs += now_us() - start;
+    return n;
+}
+
+uint32_t audio_ingest_cpu_us_per_second(const AudioIngest *ing)
+{
+    if (ing->stats.framesOut == 0)
+        return 0;
+    return (uint32_t)(ing->stats.busyUs * ing->outRate / ing->stats.framesOut);
+}
@@ -0,0 +1,38 @@
+#ifndef AUDIO_INGEST_H
+#define AUDIO_INGEST_H
+
+#include "wav_reader.h"
+#include "resampler.h"
+
+/*
+ * WAV tape audio ingestion: storage -> mono mixdown -> resampler -> the caller's buffer.
+ *
+ * The caller hands in the buffer it's going to give the audio output (see audio_output.h) and it
+ * gets filled in place. When the file already runs at the output rate the resampler is skipped and
+ * samples are mixed down straight into that buffer.
+ */
+
+struct AudioIngestStats {
+    uint32_t framesIn;          // Frames read from the file
+    uint32_t framesOut;         // Frames produced at the output rate
+    uint64_t busyUs;            // Time spent reading, converting and resampling
+};
+
+struct AudioIngest {
+    WavReader wav;
+    Resampler resampler;
+    uint32_t outRate;
+    bool passthrough;           // File rate == output rate
+    bool flushed;               // The resampler's tail has been pushed out after the last sample
+    AudioIngestStats stats;
+};
+
+bool audio_ingest_open(AudioIngest *ing, FILE *file, uint32_t outRate);
+
+// Fills up to maxFrames mono frames at the output rate. Returns fewer only at the end of the file.
+size_t audio_ingest_fill(AudioIngest *ing, int16_t *out, size_t maxFrames);
+
+// CPU time spent per second of produced audio, in microseconds (1000000 would mean 100% of a core)
+uint32_t audio_ingest_cpu_us_per_second(const AudioIngest *ing);
+
+#endif
@@ -0,0 +1,68 @@
+#include "audio_output.h"
+#include <Arduino.h>
+#include "driver/i2s.h"             // ESP-IDF I2S driver (PDM TX mode)
+
+static const i2s_port_t AUDIO_I2S_PORT = I2S_NUM_0;    // Only I2S0 can do PDM on the S3
+static const int AUDIO_DMA_BUFFERS      = 4;
+
+static AudioIngest ingest;                  // ~14 KB, kept out of the calling task's stack
+static int16_t wavFrames[AUDIO_OUTPUT_FRAMES];  // What the ingest stage renders into
+static uint32_t lastCpuUs = 0;
+static bool started = false;
+
+bool audio_output_begin(uint8_t pin)
+{
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_PDM);
+    config.sample_rate = AUDIO_OUTPUT_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.dma_buf_count = AUDIO_DMA_BUFFERS;
+    config.dma_buf_len = AUDIO_OUTPUT_FRAMES;
+    config.tx_desc_auto_clear = true;       // Silence rather than a repeated buffer on underrun
+
+    if (i2s_driver_install(AUDIO_I2S_PORT, &config, 0, NULL) != ESP_OK)
+        return false;
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = I2S_PIN_NO_CHANGE;
+    pins.ws_io_num = I2S_PIN_NO_CHANGE;     // PDM clock isn't needed, the filter on the pin does the rest
+    pins.data_out_num = pin;
+    pins.data_in_num = I2S_PIN_NO_CHANGE;
+    if (i2s_set_pin(AUDIO_I2S_PORT, &pins) != ESP_OK) {
+        i2s_driver_uninstall(AUDIO_I2S_PORT);
+        return false;
+    }
+
+    started = true;
+    return true;
+}
+
+void audio_output_write(const int16_t *frames, size_t count)
+{
+    size_t written;
+    i2s_write(AUDIO_I2S_PORT, frames, count * sizeof(int16_t), &written, portMAX_DELAY);
+}
+
+bool audio_output_play_wav(FILE *file)
+{
+    if (!started || !audio_ingest_open(&ingest, file, AUDIO_OUTPUT_RATE))
+        return false;
+
+    size_t frames;
+    do {
+        frames = audio_ingest_fill(&ingest, wavFrames, AUDIO_OUTPUT_FRAMES);
+        if (frames > 0)
+            audio_output_write(wavFrames, frames);
+    } while (frames == AUDIO_OUTPUT_FRAMES);
+
+    lastCpuUs = audio_ingest_cpu_us_per_second(&ingest);
+    return true;
+}
+
+uint32_t audio_output_last_cpu_us_per_second()
+{
+    return lastCpuUs;
+}
@@ -0,0 +1,31 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "audio_ingest.h"
+
+/*
+ * Audio output: mono 16-bit PCM at one fixed rate, sent as PDM through I2S0 and DMA.
+ *
+ * Samples are held twice on their way out: once in a render buffer (the ingest stage writes a WAV's
+ * frames into audio_output.cpp's, AUDIO_OUTPUT_FRAMES long) and once in the I2S driver's DMA ring,
+ * which audio_output_write() copies them into. The legacy driver has no way to lend out its DMA
+ * buffers, so rendering straight into them isn't possible.
+ */
+
+const uint32_t AUDIO_OUTPUT_RATE    = 44100;
+const size_t AUDIO_OUTPUT_FRAMES    = 512;      // Frames per buffer, ~11.6 ms
+
+bool audio_output_begin(uint8_t pin);
+
+// Queues count frames, blocking while the DMA ring is full
+void audio_output_write(const int16_t *frames, size_t count);
+
+// Streams a whole WAV file through the ingestion stage. Blocks, so call it from its own task.
+bool audio_output_play_wav(FILE *file);
+
+// CPU cost of the last WAV played, in microseconds per second of audio
+uint32_t audio_output_last_cpu_us_per_second();
+
+#endif
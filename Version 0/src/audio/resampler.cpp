@@ -0,0 +1,98 @@
+#include "resampler.h"
+#include <math.h>
+#include <string.h>
+
+static const int CENTER_TAP = RESAMPLER_TAPS / 2 - 1;
+static const double PASSBAND = 0.45;        // Cutoff as a fraction of the lower of the two rates
+
+double resampler_reference_tap(uint32_t inRate, uint32_t outRate, int k, double frac)
+{
+    // Cutoff in cycles per input sample: below the lower Nyquist so downsampling doesn't alias
+    double fc = PASSBAND * (outRate < inRate ? (double)outRate / inRate : 1.0);
+    double t = k - CENTER_TAP - frac;
+    double x = (t + RESAMPLER_TAPS / 2) / RESAMPLER_TAPS;               // 0..1 across the window
+    double window = 0.42 - 0.5 * cos(2 * M_PI * x) + 0.08 * cos(4 * M_PI * x);  // Blackman
+    double sinc = (t == 0) ? 1.0 : sin(2 * M_PI * fc * t) / (2 * M_PI * fc * t);
+    return 2 * fc * sinc * window;
+}
+
+void resampler_init(Resampler *rs, uint32_t inRate, uint32_t outRate)
+{
+    for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+        double frac = (double)p / RESAMPLER_PHASES;
+        double taps[RESAMPLER_TAPS];
+        double sum = 0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            taps[k] = resampler_reference_tap(inRate, outRate, k, frac);
+            sum += taps[k];
+        }
+
+        // Normalise every phase to unity gain, then push the rounding error into the biggest tap
+        // so all phases have exactly the same DC gain (otherwise it shows up as a whine)
+        int32_t total = 0;
+        int biggest = 0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            rs->coeffs[p][k] = (int16_t)lround(taps[k] / sum * 32768.0);
+            total += rs->coeffs[p][k];
+            if (rs->coeffs[p][k] > rs->coeffs[p][biggest])
+                biggest = k;
+        }
+        rs->coeffs[p][biggest] += 32768 - total;
+    }
+
+    // Start with half a filter of silence so output sample 0 lines up with input sample 0
+    memset(rs->input, 0, sizeof(rs->input));
+    rs->fill = CENTER_TAP;
+    rs->pos = 0;
+    rs->step = ((uint64_t)inRate << 32) / outRate;
+}
+
+int16_t *resampler_input(Resampler *rs, size_t *room)
+{
+    *room = RESAMPLER_TAPS + RESAMPLER_BLOCK - rs->fill;
+    return rs->input + rs->fill;
+}
+
+void resampler_commit(Resampler *rs, size_t count)
+{
+    rs->fill += count;
+}
+
+size_t resampler_process(Resampler *rs, int16_t *out, size_t maxOut)
+{
+    const int WEIGHT_SHIFT = 32 - RESAMPLER_PHASE_BITS - 15;       // What's left below the phase, as Q15
+    uint64_t pos = rs->pos;
+    size_t n = 0;
+
+    while (n < maxOut) {
+        uint32_t i = (uint32_t)(pos >> 32);
+        if (i + RESAMPLER_TAPS > rs->fill)
+            break;
+
+        uint32_t phase = (uint32_t)(pos >> (32 - RESAMPLER_PHASE_BITS)) & (RESAMPLER_PHASES - 1);
+        int32_t weight = (int32_t)(pos >> WEIGHT_SHIFT) & 0x7FFF;
+        const int16_t *c0 = rs->coeffs[phase], *c1 = rs->coeffs[phase + 1];
+        const int16_t *x = rs->input + i;
+
+        // Each fits in 32 bits: the taps' absolute sum stays well under 2.0 in Q15
+        int32_t acc0 = 0, acc1 = 0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            acc0 += (int32_t)c0[k] * x[k];
+            acc1 += (int32_t)c1[k] * x[k];
+        }
+        int64_t acc = (int64_t)acc0 + (((int64_t)(acc1 - acc0) * weight) >> 15);
+        acc = (acc + (1 << 14)) >> 15;
+        out[n++] = acc > 32767 ? 32767 : (acc < -32768 ? -32768 : (int16_t)acc);
+
+        pos += rs->step;
+    }
+
+    // Drop the input no future output needs any more
+    uint32_t used = (uint32_t)(pos >> 32);
+    if (used > rs->fill)
+        used = rs->fill;
+    memmove(rs->input, rs->input + used, (rs->fill - used) * sizeof(int16_t));
+    rs->fill -= used;
+    rs->pos = pos - ((uint64_t)used << 32);
+    return n;
+}
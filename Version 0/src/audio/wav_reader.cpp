@@ -0,0 +1,97 @@
+#include "wav_reader.h"
+#include <string.h>
+
+static inline uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+bool wav_open(WavReader *wav, FILE *file)
+{
+    memset(&wav->info, 0, sizeof(wav->info));
+    wav->file = file;
+    wav->remaining = 0;
+
+    uint8_t header[12];
+    if (fread(header, 1, 12, file) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+        return false;
+
+    // Walk the chunks: "fmt " has to come before "data", anything else is skipped
+    bool haveFormat = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file) == 8) {
+        uint32_t size = rd32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, 16, file) != 16)
+                return false;
+            uint16_t format = rd16(fmt);
+            wav->info.channels = rd16(fmt + 2);
+            wav->info.sampleRate = rd32(fmt + 4);
+            wav->info.bits = rd16(fmt + 14);
+            haveFormat = (format == 1 || format == 0xFFFE) &&          // PCM or WAVE_FORMAT_EXTENSIBLE
+                         (wav->info.bits == 8 || wav->info.bits == 16) &&
+                         wav->info.channels > 0 && wav->info.sampleRate > 0;
+            size -= 16;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                return false;
+            uint32_t frameBytes = wav->info.channels * (wav->info.bits / 8);
+            wav->info.frames = size / frameBytes;
+            wav->remaining = wav->info.frames * frameBytes;
+            return true;
+        }
+
+        if (fseek(file, size + (size & 1), SEEK_CUR) != 0)      // Chunks are padded to even sizes
+            return false;
+    }
+    return false;
+}
+
+size_t wav_read_mono(WavReader *wav, int16_t *dest, size_t maxFrames)
+{
+    const uint16_t channels = wav->info.channels;
+    const uint32_t frameBytes = channels * (wav->info.bits / 8);
+
+    size_t frames = WAV_READ_BLOCK / frameBytes;
+    if (frames > maxFrames)
+        frames = maxFrames;
+    if (frames > wav->remaining / frameBytes)
+        frames = wav->remaining / frameBytes;
+    if (frames == 0)
+        return 0;
+
+    size_t got = fread(wav->raw, 1, frames * frameBytes, wav->file) / frameBytes;
+    wav->remaining = (got == frames) ? wav->remaining - got * frameBytes : 0;
+
+    // Mono and stereo are the common cases and get their own loops, the rest is averaged generically
+    const uint8_t *p = wav->raw;
+    if (wav->info.bits == 16) {
+        if (channels == 1) {
+            for (size_t i = 0; i < got; i++, p += 2)
+                dest[i] = (int16_t)rd16(p);
+        } else if (channels == 2) {
+            for (size_t i = 0; i < got; i++, p += 4)
+                dest[i] = (int16_t)(((int32_t)(int16_t)rd16(p) + (int16_t)rd16(p + 2)) >> 1);
+        } else {
+            for (size_t i = 0; i < got; i++) {
+                int32_t sum = 0;
+                for (uint16_t c = 0; c < channels; c++, p += 2)
+                    sum += (int16_t)rd16(p);
+                dest[i] = (int16_t)(sum / channels);
+            }
+        }
+    } else {
+        if (channels == 1) {
+            for (size_t i = 0; i < got; i++)
+                dest[i] = (int16_t)((p[i] - 128) << 8);
+        } else {
+            for (size_t i = 0; i < got; i++) {
+                int32_t sum = 0;
+                for (uint16_t c = 0; c < channels; c++)
+                    sum += *p++ - 128;
+                dest[i] = (int16_t)((sum << 8) / channels);
+            }
+        }
+    }
+    return got;
+}
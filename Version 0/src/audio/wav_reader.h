@@ -0,0 +1,36 @@
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Streams PCM WAV files (8-bit unsigned or 16-bit signed, any number of channels) from storage
+ * one block at a time, mixing the channels down to signed 16-bit mono on the way.
+ * Only one small raw block is ever held in memory, whatever the size of the file.
+ */
+
+const size_t WAV_READ_BLOCK = 4096;     // Bytes read from storage at a time
+
+struct WavInfo {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bits;
+    uint32_t frames;            // Frames (one sample per channel) in the data chunk
+};
+
+struct WavReader {
+    FILE *file;
+    WavInfo info;
+    uint32_t remaining;         // Bytes of the data chunk not read yet
+    uint8_t raw[WAV_READ_BLOCK];
+};
+
+// Parses the header and leaves the file at the start of the samples. False if it isn't a PCM WAV we can read.
+bool wav_open(WavReader *wav, FILE *file);
+
+// Reads up to maxFrames frames (at most one storage block) as mono. Returns 0 at the end of the data.
+size_t wav_read_mono(WavReader *wav, int16_t *dest, size_t maxFrames);
+
+#endif
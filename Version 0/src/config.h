@@ -2,14 +2,15 @@
 #define CONFIG_H
 
 #include <Arduino.h>
+#include "display/panel.h"
 
 // Macro for RGB565 color format
 #define RGB565(r, g, b)  ((r & 0x1F) << 11 | (g & 0x3F) << 5 | (b & 0x1F))
 
 // Actually, this display is 180 by 640, but since we're using it horizontaly, we'll abstract
-// and call the constants the other way around.
-const int LCD_WIDTH         = 640;
-const int LCD_HEIGHT        = 180;
+// and call the constants the other way around (Panel, display/panel.h, does the turning).
+const int LCD_WIDTH         = Panel::WIDTH;
+const int LCD_HEIGHT        = Panel::HEIGHT;
 
 const int TOUCH_TIMEOUT     = 30000;    // Timeout for resetting the touch state
 
@@ -2,18 +2,17 @@
 #include "SPI.h"                    // SPI communication library
 #include "Arduino.h"                // Arduino core library
 #include "driver/spi_master.h"      // ESP-IDF SPI driver
+#include "system/metrics.h"          // Pixel bytes sent, for the HUD
 
 /**
- * This requires quite a bit of cleaning/improvement. TODO this gently and gradually in the future.
+ * AXS15231B QSPI panel driver: bus setup, the init sequence and the window and pixel commands.
+ * The pixel paths are the members of Axs15231b<P> (AXS15231B.h), at the end of the file and
+ * instantiated there for the Panel in panel.h; the lcd_* functions before them are the firmware's
+ * interface, built on those members.
  */
 
-// Allocating a buffer in PSRAM (external memory) for matrix rotation (640 * 180 * 2 bytes for RGB565 color)
-uint16_t* qBuffer = (uint16_t*) heap_caps_malloc(230400, MALLOC_CAP_SPIRAM); //psram buffer for matrix rotation (640 * 180 * 2)
-
 // Flag to track the state of SPI DMA (Direct Memory Access) writing to the display
 static volatile bool lcd_spi_dma_write = false;
-uint32_t transfer_num = 0;          // Tracks ongoing SPI transfers
-size_t lcd_PushColors_len = 0;      // Tracks the length of the data being pushed to the display
 
 // Initialization sequence for the AXS15231B display (commands and data to be sent via SPI)
 const static lcd_cmd_t axs15231b_qspi_init[] = {
@@ -32,6 +31,15 @@ bool get_lcd_spi_dma_write(void)
 // SPI device handle, used to communicate with the display
 static spi_device_handle_t spi;
 
+// Window registers as last sent, so blits sharing a row or column range can skip a command
+static uint16_t winX1, winX2, winY1, winY2;
+static bool winKnown = false;
+
+static uint8_t busHeld = 0;         // Nesting depth of bus_take()
+
+static const lcd_tap_t *tap = NULL;
+static uint16_t scrollTop = 0, scrollRows = Panel::NATIVE_HEIGHT, scrollStart = 0;
+
 // Function to send a command to the display over SPI
 static void WriteComm(uint8_t data)
 {
@@ -146,7 +154,7 @@ void axs15231_init(void)
         .sclk_io_num = TFT_QSPI_SCK,        // Clock pin
         .data2_io_num = TFT_QSPI_D2,        // Data line 2 pin
         .data3_io_num = TFT_QSPI_D3,        // Data line 3 pin
-        .max_transfer_sz = (SEND_BUF_SIZE * 16) + 8,        // Maximum transfer size in bytes
+        .max_transfer_sz = (Panel::CHUNK_PIXELS * 16) + 8,        // Maximum transfer size in bytes
         .flags = SPICOMMON_BUSFLAG_MASTER | SPICOMMON_BUSFLAG_GPIO_PINS /* |            // SPI master mode and GPIO pins
                  SPICOMMON_BUSFLAG_QUAD */
         ,
@@ -174,6 +182,8 @@ void axs15231_init(void)
     ESP_ERROR_CHECK(ret);   // Check for errors in adding the SPI device
 
 
+    winKnown = false;       // The reset put the window back to full screen
+
     // Run the initialization sequence for the display: Initialize the screen multiple times to prevent initialization failure
     
     int i = 1;  // Retry loop for display initialization
@@ -216,6 +226,7 @@ void lcd_setRotation(uint8_t r)
     }
     // Send the MADCTL (Memory Access Control) command to set the orientation
     lcd_send_cmd(TFT_MADCTL, &gbr, 1);
+    winKnown = false;
 }
 
 // Function to set the drawing region (window) on the screen
@@ -230,6 +241,11 @@ void lcd_address_set(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
     for (uint32_t i = 0; i < 2; i++) {
         lcd_send_cmd(t[i].cmd, t[i].data, t[i].len);
     }
+    winX1 = x1;
+    winX2 = x2;
+    winY1 = y1;
+    winY2 = y2;
+    winKnown = true;
 }
 
 // Function to fill a rectangular area with a single color
@@ -239,55 +255,19 @@ void lcd_fill(uint16_t xsta,
               uint16_t yend,
               uint16_t color)
 {
-
-    uint16_t w = xend - xsta;   // Calculate width of the rectangle
-    uint16_t h = yend - ysta;   // Calculate height of the rectangle
-    uint16_t *color_p = (uint16_t *)heap_caps_malloc(w * h * 2, MALLOC_CAP_INTERNAL);   // Allocate memory for the color data
-    int i = 0;
-
-    // Fill the buffer with the color value
-    for(i = 0; i < w * h ; i+=1)
-    {
-        color_p[i] = color;
-    }
-
-    // Send the color data to the display
-    lcd_PushColors(xsta, ysta, w, h, color_p);
-    free(color_p);      // Free the allocated memory
+    PanelDriver::fill(xsta, ysta, xend - xsta, yend - ysta, color);
 }
 
 void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
-    // Create a temporary buffer large enough to hold the rectangle's color data
-    static uint16_t colorBuffer[SEND_BUF_SIZE];
-
-    // Fill the color buffer with the specified color
-    for (size_t i = 0; i < SEND_BUF_SIZE; i++) {
-        colorBuffer[i] = color;
-    }
-
-    size_t totalPixels = w * h;
-    size_t pixelsRemaining = totalPixels;
-    uint16_t *bufferPointer = colorBuffer;
-
-    // Loop to send the entire rectangle in chunks if necessary
-    while (pixelsRemaining > 0) {
-        // Determine how many pixels to send in this iteration
-        size_t chunkSize = (pixelsRemaining > SEND_BUF_SIZE) ? SEND_BUF_SIZE : pixelsRemaining;
-
-        // Call lcd_PushColors_rotated_90 with the current buffer
-        lcd_PushColors_rotated_90(x, y, w, chunkSize / w, bufferPointer);
-
-        // Update the remaining pixels count
-        pixelsRemaining -= chunkSize;
-    }
+    PanelDriver::fill_logical(x, y, w, h, color);
 }
 
 // Function to draw a single pixel on the screen
 void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color)
 {
-    lcd_address_set(x, y, x + 1, y + 1);        // Set the address for the pixel
-    lcd_PushColors(&color, 1);                  // Push the pixel color to the display
+    uint16_t pixel = Panel::wire(color);
+    lcd_blit(x, y, 1, 1, &pixel);               // Window set and pixel in one bus acquisition
 }
 
 // Wrapper function to queue an SPI transfer
@@ -297,205 +277,128 @@ void spi_device_queue_trans_fun(spi_device_handle_t handle, spi_transaction_t *t
     ESP_ERROR_CHECK(spi_device_queue_trans(spi, (spi_transaction_t *)trans_desc, portMAX_DELAY));
 }
 
-// Function to send color data to the display using SPI and DMA (when enabled)
-#ifdef LCD_SPI_DMA 
-spi_transaction_ext_t t = {0};              // Extended SPI transaction structure
+// Function to send color data to the display
 void lcd_PushColors(uint16_t x,
-                        uint16_t y,
-                        uint16_t width,
-                        uint16_t high,
-                        uint16_t *data)
-    {
-        static bool first_send = 1;             // Flag to check if it's the first data send
-        static uint16_t *p = (uint16_t *)data;  // Pointer to the color data
-        static uint32_t transfer_num_old = 0;   // Old transfer count
-
-        // If valid data is provided
-        if(data != NULL && (width != 0) && (high != 0))
-        {
-            lcd_PushColors_len = width * high;
-            p = (uint16_t *)data;
-            first_send = 1;
-
-            transfer_num = 0;
-
-            // Set the drawing window
-            lcd_address_set(x, y, x + width - 1, y + high - 1);
-            TFT_CS_L;       // Lower the chip select to start SPI communication
-        }
-
-        // Handle completed transfers
-        for (int x = 0; x < (transfer_num_old - (transfer_num_old-(transfer_num_old-transfer_num))); x++) {
-            spi_transaction_t *rtrans;
-            esp_err_t ret = spi_device_get_trans_result(spi, &rtrans, portMAX_DELAY);
-            if (ret != ESP_OK) {
-            // ESP_LOGW(TAG, "1. transfer_num = %d", transfer_num_old);
-            }
-            assert(ret == ESP_OK);      // Ensure the transfer was successful
-        }
-        transfer_num_old -= (transfer_num_old - (transfer_num_old-(transfer_num_old-transfer_num)));
-
-        // Start sending data chunks
-        do {
-            if(transfer_num >= 3 || ESP.getFreeHeap() <= 70000)
-            {
-                break;
-            }
-            size_t chunk_size = lcd_PushColors_len;
-
-            memset(&t, 0, sizeof(t));
-            if (first_send) {
-                t.base.flags =
-                    SPI_TRANS_MODE_QIO ;// | SPI_TRANS_MODE_DIOQIO_ADDR         // Quad I/O transfer mode
-                t.base.cmd = 0x32 ;// 0x12      // Command to write to memory
-                t.base.addr = 0x002C00;         // Starting address
-                first_send = 0;
-            } else {
-                t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
-                            SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
-                t.command_bits = 0;
-                t.address_bits = 0;
-                t.dummy_bits = 0;
-            }
-            if (chunk_size > SEND_BUF_SIZE) {
-                chunk_size = SEND_BUF_SIZE;         // Limit the chunk size
-            }
-            t.base.tx_buffer = p;                   // Set the data buffer
-            t.base.length = chunk_size * 16;        // Set the data length
-
-            lcd_spi_dma_write = true;               // Mark that DMA is in use
-
-            transfer_num++;
-            transfer_num_old++;
-            lcd_PushColors_len -= chunk_size;
-
-            // Queue the SPI transfer
-            esp_err_t ret;
-
-            ESP_ERROR_CHECK(spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY));
-            assert(ret == ESP_OK);
-
-            p += chunk_size;        // Move to the next chunk of data
-        } while (lcd_PushColors_len > 0);       // Continue until all data is sent
-    }
- 
-#else       // Non-DMA version of the function
-
-    void lcd_PushColors(uint16_t x,
                     uint16_t y,
                     uint16_t width,
                     uint16_t high,
                     uint16_t *data)
-    {
-        size_t len = width * high;          // Total length of the data
-        uint16_t *p = (uint16_t *)data;
-        size_t chunk_size;
-        bool first_send = true;             // Flag to check if it's the first data send
-        int aaa = 0;                        // Dummy variable for delay
-
-        // Set the drawing window
-        lcd_address_set(x, y, x + width - 1, y + high - 1);
-
-        // SPI transaction structure
-        spi_transaction_ext_t t = {0};
-        t.base.flags = SPI_TRANS_MODE_QIO;
-        t.base.cmd = 0x32;  // Command to write to memory
-
-        // Set the first address
-        t.base.addr = 0x002C00;
-
-        // Start sending data in chunks
-        do {
-            TFT_CS_L;  // Lower chip select to start SPI communication
-
-            // Adjust chunk size if necessary
-            chunk_size = (len > SEND_BUF_SIZE) ? SEND_BUF_SIZE : len;
-
-            // Set the data buffer and length
-            t.base.tx_buffer = p;
-            t.base.length = chunk_size * 16;  // Data length in bits (16 bits per pixel)
-
-            // Micro time delays for ensuring proper timing
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            
-            // Transmit the data
-            spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
-
-            // After the first transmission, adjust the address for subsequent transfers
-            if (first_send) {
-                first_send = false;
-                t.base.addr = 0x003C00;  // Update to the new address for subsequent transfers
-            }
-
-            // Micro time delays before toggling chip select
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-
-            TFT_CS_H;  // Raise chip select
-
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-
-            TFT_CS_L;  // Lower chip select for the next transaction
-
-            // Micro time delay
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-            aaa = aaa >> 1;
-
-            // Update remaining length and pointer
-            len -= chunk_size;
-            p += chunk_size;
-
-        } while (len > 0);  // Continue until all data is sent
-
-        TFT_CS_H;  // Raise chip select to end SPI communication
-    }
-#endif
+{
+    lcd_address_set(x, y, x + width - 1, y + high - 1);     // Both registers, every time
+    lcd_PushColors(data, (uint32_t)width * high);
+}
 
 // Function to push color data to the display
 void lcd_PushColors(uint16_t *data, uint32_t len)
 {
-    bool first_send = 1;                // Flag to track the first send
-    uint16_t *p = (uint16_t *)data;     // Pointer to the color data
-    TFT_CS_L;                           // Lower chip select to start SPI communication
-    do {
-        size_t chunk_size = len;        // Set chunk size
-        spi_transaction_ext_t t = {0};  // SPI transaction structure
-        memset(&t, 0, sizeof(t));       // Clear the structure
-        if (first_send) {               // If it's the first transfer
-            t.base.flags =
-                SPI_TRANS_MODE_QIO /* | SPI_TRANS_MODE_DIOQIO_ADDR */;      // Quad I/O transfer mode
-            t.base.cmd = 0x32 /* 0x12 */;       // Command to write to memory
-            t.base.addr = 0x002C00;             // Set address
-            first_send = 0;
-        } else {
-            t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
-                           SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
-            t.command_bits = 0;
-            t.address_bits = 0;
-            t.dummy_bits = 0;
-        }
+    PanelDriver::stream_begin();
+    while (len > 0) {
+        uint32_t chunk_size = len > Panel::CHUNK_PIXELS ? Panel::CHUNK_PIXELS : len;
+        PanelDriver::stream_chunk(data, chunk_size);
+        len -= chunk_size;
+        data += chunk_size;
+    }
+    PanelDriver::stream_end();
+}
 
-        // Adjust chunk size if necessary
-        if (chunk_size > SEND_BUF_SIZE) {
-            chunk_size = SEND_BUF_SIZE;
-        }
-        t.base.tx_buffer = p;               // Set the data buffer
-        t.base.length = chunk_size * 16;    // Set the data length
+// Window register write for the blit path: the four bytes travel in the transaction itself,
+// so there's no buffer to point at and nothing to clear beyond the descriptor
+static void blit_window(uint8_t reg, uint16_t a, uint16_t b)
+{
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));
+    t.flags = SPI_TRANS_MULTILINE_CMD | SPI_TRANS_MULTILINE_ADDR | SPI_TRANS_USE_TXDATA;
+    t.cmd = 0x02;
+    t.addr = reg << 8;
+    t.length = 32;
+    t.tx_data[0] = (uint8_t)(a >> 8);
+    t.tx_data[1] = (uint8_t)a;
+    t.tx_data[2] = (uint8_t)(b >> 8);
+    t.tx_data[3] = (uint8_t)b;
+    TFT_CS_L;
+    spi_device_polling_transmit(spi, &t);
+    TFT_CS_H;
+}
 
-        // Transmit the data
-        spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
-        len -= chunk_size;      // Decrease the remaining length
-        p += chunk_size;        // Move the pointer to the next chunk
-    } while (len > 0);      // Continue until all data is sent
-    TFT_CS_H;   // Raise chip select to end SPI communication
+// Window for a w x h rect at (x, y), sending only the registers that change
+static void set_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    uint16_t x2 = x + w - 1;
+    uint16_t y2 = y + h - 1;
+    if (!winKnown || winX1 != x || winX2 != x2)
+        blit_window(0x2a, x, x2);
+    if (!winKnown || winY1 != y || winY2 != y2)
+        blit_window(0x2b, y, y2);
+    winX1 = x;
+    winX2 = x2;
+    winY1 = y;
+    winY2 = y2;
+    winKnown = true;
+}
+
+// Polling transactions each take and release the bus unless it's already held; holding it across
+// a run of them saves that. Nests, so a batch can hold it around pushes that hold it themselves.
+static void bus_take()
+{
+    if (busHeld++ == 0)
+        spi_device_acquire_bus(spi, portMAX_DELAY);
+}
+
+static void bus_give()
+{
+    if (--busHeld == 0)
+        spi_device_release_bus(spi);
+}
+
+void lcd_blit_batch(const lcd_blit_t *blits, size_t count)
+{
+    bus_take();
+    for (size_t i = 0; i < count; i++)
+        PanelDriver::push(blits[i].x, blits[i].y, blits[i].w, blits[i].h, blits[i].data);
+    bus_give();
+}
+
+void lcd_blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
+{
+    lcd_blit_t b = {x, y, w, h, data};
+    lcd_blit_batch(&b, 1);
+}
+
+// Queued push: one DMA transaction, left running. CS stays low until lcd_push_wait() collects it,
+// and the window cache keeps the next push of the same shape down to the pixels.
+static spi_transaction_ext_t asyncTrans = {
+    .base = { .flags = SPI_TRANS_MODE_QIO, .cmd = 0x32, .addr = 0x002C00 },
+};
+static bool asyncPending = false;
+
+void lcd_push_async(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
+{
+    lcd_push_wait();
+    if (w == 0 || h == 0)
+        return;
+    set_window(x, y, w, h);
+
+    size_t len = (size_t)w * h;
+    if (tap) {
+        tap->window(x, y, w, h, tap->ctx);
+        tap->pixels(data, len, tap->ctx);
+    }
+    metrics_add(METRIC_SPI_BYTES, len * 2);
+    asyncTrans.base.tx_buffer = data;
+    asyncTrans.base.length = len * 16;
+    TFT_CS_L;
+    spi_device_queue_trans(spi, (spi_transaction_t *)&asyncTrans, portMAX_DELAY);
+    asyncPending = true;
+}
+
+void lcd_push_wait()
+{
+    if (!asyncPending)
+        return;
+    spi_transaction_t *done;
+    spi_device_get_trans_result(spi, &done, portMAX_DELAY);
+    TFT_CS_H;
+    asyncPending = false;
 }
 
 // Function to push rotated color data to the display
@@ -506,67 +409,30 @@ void lcd_PushColors_rotated_90(
                     uint16_t high,
                     uint16_t *data)
 {
-    uint16_t  _x = 180 - (y + high);        // Adjust coordinates for 90-degree rotation
-    uint16_t  _y = x;
-    uint16_t  _h = width;
-    uint16_t  _w = high;
-
-    // Set the drawing window with the rotated coordinates
-    lcd_address_set(_x, _y, _x + _w - 1, _y + _h - 1);
-
-    bool first_send = 1;
-    size_t len = width * high;
-    uint16_t *p = (uint16_t *)data;
-    uint16_t *q = (uint16_t *)qBuffer;      // Use buffer for rotation
-    uint32_t index = 0;                     // Index for the buffer
-   
-    // Rotate the data and store it in the buffer
-    for (uint16_t j = 0; j < width; j++)
-    {
-        for (uint16_t i = 0; i < high; i++)
-        {
-            qBuffer[index++] = ((uint16_t)p[width * (high - i - 1) + j]);             
-        }
-    }
-
+    PanelDriver::push_logical(x, y, width, high, data);
+}
 
-    TFT_CS_L;       // Lower chip select to start SPI communication
-    do
-    {
-        size_t chunk_size = len;            // Set chunk size
-        spi_transaction_ext_t t = {0};      // SPI transaction structure
-        memset(&t, 0, sizeof(t));           // Clear the structure
-        if (first_send)
-        {
-            t.base.flags =
-                SPI_TRANS_MODE_QIO; // | SPI_TRANS_MODE_DIOQIO_ADDR ;      // Quad I/O transfer mode
-            t.base.cmd = 0x32; // 0x12 ;       // Command to write to memory
-            t.base.addr = 0x002C00;             // Set address
-            first_send = 0;
-        }
-        else
-        {
-            t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
-                           SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
-            t.command_bits = 0;
-            t.address_bits = 0;
-            t.dummy_bits = 0;
-        }
+// Define the scroll area; the fixed areas above and below make up the rest of the native rows
+void lcd_scroll_area(uint16_t top, uint16_t height)
+{
+    PanelDriver::scroll_area(top, height);
+}
 
-        // Adjust chunk size if necessary
-        if (chunk_size > SEND_BUF_SIZE)
-        {
-            chunk_size = SEND_BUF_SIZE;
-        }
-        t.base.tx_buffer = q;               // Set the data buffer (rotated data)
-        t.base.length = chunk_size * 16;    // Set the data length
+// Set which memory row is shown first in the scroll area
+void lcd_scroll_start(uint16_t line)
+{
+    uint8_t data[] = {(uint8_t)(line >> 8), (uint8_t)line};
+    lcd_send_cmd(0x37, data, 2);    // VSCSAD
+    scrollStart = line;
+    if (tap)
+        tap->scroll(scrollTop, scrollRows, scrollStart, tap->ctx);
+}
 
-        // Transmit the data
-        spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
-        len -= chunk_size;      // Decrease the remaining length
-        q += chunk_size;        // Move the pointer to the next chunk
-    } while (len > 0);      // Continue until all data is sent
-    TFT_CS_H;       // Raise chip select to end SPI communication
+void lcd_set_tap(const lcd_tap_t *t)
+{
+    tap = t;
+    if (tap)
+        tap->scroll(scrollTop, scrollRows, scrollStart, tap->ctx);
 }
 
 // Put the display to sleep
@@ -594,3 +460,141 @@ void hw_clear_screen_black()
     lcd_send_cmd(0x22, NULL, 0);    // Send command to fill the screen with black
 }
 
+
+// The driver template's members (see AXS15231B.h)
+
+// Pixel descriptors are built once: a RAMWR to start at the window's corner, then command-less
+// continuations for the chunks after it
+static spi_transaction_ext_t pixelsFirst = {
+    .base = { .flags = SPI_TRANS_MODE_QIO, .cmd = 0x32, .addr = 0x002C00 },
+};
+static spi_transaction_ext_t pixelsNext = {
+    .base = { .flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD | SPI_TRANS_VARIABLE_ADDR |
+                       SPI_TRANS_VARIABLE_DUMMY },
+};
+static spi_transaction_ext_t *pixels = &pixelsFirst;
+
+template <class P>
+uint16_t Axs15231b<P>::chunk[P::CHUNK_PIXELS];     // Internal RAM, so DMA can read it
+template <class P>
+bool Axs15231b<P>::chunkFilled = false;
+template <class P>
+uint16_t Axs15231b<P>::chunkColour;
+
+template <class P>
+uint16_t *Axs15231b<P>::scratch()
+{
+    chunkFilled = false;
+    return chunk;
+}
+
+template <class P>
+void Axs15231b<P>::stream_begin(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    bus_take();
+    set_window(x, y, w, h);
+    if (tap)
+        tap->window(x, y, w, h, tap->ctx);
+    pixels = &pixelsFirst;
+    TFT_CS_L;
+}
+
+template <class P>
+void Axs15231b<P>::stream_begin()
+{
+    bus_take();
+    if (tap)
+        tap->window(winX1, winY1, winX2 - winX1 + 1, winY2 - winY1 + 1, tap->ctx);
+    pixels = &pixelsFirst;
+    TFT_CS_L;
+}
+
+template <class P>
+void Axs15231b<P>::stream_chunk(const uint16_t *data, uint32_t len)
+{
+    metrics_add(METRIC_SPI_BYTES, len * 2);
+    if (tap)
+        tap->pixels(data, len, tap->ctx);
+    pixels->base.tx_buffer = data;
+    pixels->base.length = len * 16;
+    spi_device_polling_transmit(spi, (spi_transaction_t *)pixels);
+    pixels = &pixelsNext;
+}
+
+template <class P>
+void Axs15231b<P>::stream_end()
+{
+    TFT_CS_H;
+    bus_give();
+}
+
+template <class P>
+void Axs15231b<P>::push(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
+{
+    if (w == 0 || h == 0)
+        return;
+    uint32_t len = (uint32_t)w * h;
+    stream_begin(x, y, w, h);
+    while (len > 0) {
+        uint32_t n = len > P::CHUNK_PIXELS ? P::CHUNK_PIXELS : len;
+        stream_chunk(data, n);
+        len -= n;
+        data += n;
+    }
+    stream_end();
+}
+
+template <class P>
+void Axs15231b<P>::push_logical(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
+{
+    push_turned<0, 0>(x, y, w, h, data);
+}
+
+template <class P>
+void Axs15231b<P>::fill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t rgb565)
+{
+    if (w == 0 || h == 0)
+        return;
+
+    // The scratch chunk is filled once per colour and streamed as often as the rect needs
+    uint16_t pixel = P::wire(rgb565);
+    if (!chunkFilled || chunkColour != pixel) {
+        for (uint32_t i = 0; i < P::CHUNK_PIXELS; i++)
+            chunk[i] = pixel;
+        chunkFilled = true;
+        chunkColour = pixel;
+    }
+
+    uint32_t len = (uint32_t)w * h;
+    stream_begin(x, y, w, h);
+    while (len > 0) {
+        uint32_t n = len > P::CHUNK_PIXELS ? P::CHUNK_PIXELS : len;
+        stream_chunk(chunk, n);
+        len -= n;
+    }
+    stream_end();
+}
+
+template <class P>
+void Axs15231b<P>::fill_logical(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t rgb565)
+{
+    if (P::ORIENTATION == PANEL_LANDSCAPE)
+        fill(P::NATIVE_WIDTH - (y + h), x, h, w, rgb565);
+    else
+        fill(x, y, w, h, rgb565);
+}
+
+template <class P>
+void Axs15231b<P>::scroll_area(uint16_t top, uint16_t height)
+{
+    uint16_t bottom = P::NATIVE_HEIGHT - top - height;
+    uint8_t data[] = {(uint8_t)(top >> 8), (uint8_t)top, (uint8_t)(height >> 8), (uint8_t)height,
+                      (uint8_t)(bottom >> 8), (uint8_t)bottom};
+    lcd_send_cmd(0x33, data, 6);    // VSCRDEF
+    scrollTop = top;
+    scrollRows = height;
+    if (tap)
+        tap->scroll(scrollTop, scrollRows, scrollStart, tap->ctx);
+}
+
+template struct Axs15231b<Panel>;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "stdint.h"
+#include "stddef.h"
 #include "pins_config.h"
+#include "panel.h"
 
 //#define LCD_SPI_DMA
 #define AX15231B
@@ -37,12 +39,21 @@ typedef struct
     uint8_t len;
 } lcd_cmd_t;
 
+// One rectangle of a batched blit, in native panel coordinates
+typedef struct
+{
+    uint16_t x, y, w, h;
+    const uint16_t *data;   // w * h pixels, row by row, in the byte order lcd_PushColors takes
+} lcd_blit_t;
+
 void axs15231_init(void);
 
 void lcd_address_set(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 
 void lcd_setRotation(uint8_t r);
 
+// Colours here are plain RGB565 (COLORS::...); the driver puts them in the panel's byte order.
+// lcd_DrawPoint and lcd_fill take native coordinates, drawRect landscape ones.
 void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color);
 
 void lcd_fill(uint16_t xsta, uint16_t ysta, uint16_t xend, uint16_t yend, uint16_t color);
@@ -51,10 +62,40 @@ void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 
 void lcd_PushColors(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data);
 
-void lcd_PushColors_rotated_90(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data);   
+// A landscape rect, pixels row by row, turned for the panel a chunk at a time
+void lcd_PushColors_rotated_90(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data);
 
 void lcd_PushColors(uint16_t *data, uint32_t len);// use directly after lcd_address_set()
 
+// Small-blit path: all rects go out back to back under one bus acquisition, and a window
+// register already holding the right range (same rows or columns as the last blit) isn't resent
+void lcd_blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+void lcd_blit_batch(const lcd_blit_t *blits, size_t count);
+
+// Pushes one rect (at most SEND_BUF_SIZE pixels) with DMA and returns while it goes out; data must be
+// DMA-capable and left alone until lcd_push_wait(). Another push waits for the one before; other
+// drawing must call lcd_push_wait() first.
+void lcd_push_async(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+void lcd_push_wait();
+
+// Hardware scrolling (VSCRDEF/VSCSAD). The panel scrolls along its native rows (640), which is
+// landscape x; rows outside [top, top + height) stay fixed.
+void lcd_scroll_area(uint16_t top, uint16_t height);
+void lcd_scroll_start(uint16_t line);      // Memory row shown at the top of the scroll area
+
+// A tap sees everything the driver sends to the panel's memory, as it goes: each native window,
+// then its pixels in the panel's byte order in any number of pieces, and each change of scroll
+// (frame capture, display/frame_capture.h). NULL removes it. Called on the drawing task.
+typedef struct
+{
+    void (*window)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, void *ctx);
+    void (*pixels)(const uint16_t *data, uint32_t len, void *ctx);
+    void (*scroll)(uint16_t top, uint16_t rows, uint16_t start, void *ctx);
+    void *ctx;
+} lcd_tap_t;
+
+void lcd_set_tap(const lcd_tap_t *tap);
+
 void lcd_sleep();
 
 bool get_lcd_spi_dma_write(void);
@@ -62,3 +103,89 @@ bool get_lcd_spi_dma_write(void);
 void hw_set_brightness(uint8_t val);
 void hw_colour_fill(uint8_t r, uint8_t g, uint8_t b);
 void hw_clear_screen_black();
+
+/*
+ * The driver proper, built for one PanelConfig (panel.h): geometry, chunk size and pixel format are
+ * constants in every loop it runs. The lcd_* functions above are PanelDriver, Axs15231b<Panel>,
+ * instantiated in AXS15231B.cpp; push_logical<W, H>() compiles a rotation for a sprite whose size
+ * is fixed, like the HUD's.
+ */
+template <class P>
+struct Axs15231b {
+    // A whole native row or column fits one chunk, so turning and fills always make progress
+    static_assert(P::CHUNK_PIXELS >= P::NATIVE_WIDTH && P::CHUNK_PIXELS >= P::NATIVE_HEIGHT,
+                  "a panel chunk must hold a whole native row and column");
+
+    // A native rect, pixels row by row in the panel's byte order
+    static void push(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+
+    // A rect of the logical screen (P::WIDTH x P::HEIGHT), pixels row by row, turned as it goes out
+    static void push_logical(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+    template <uint16_t W, uint16_t H>
+    static void push_logical(uint16_t x, uint16_t y, const uint16_t *data);
+
+    // One RGB565 colour over a native or logical rect
+    static void fill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t rgb565);
+    static void fill_logical(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t rgb565);
+
+    static void scroll_area(uint16_t top, uint16_t height);
+
+    // A pixel stream into a native window (or the window last set): stream_begin(), any number of
+    // stream_chunk()s of at most P::CHUNK_PIXELS, stream_end(). The bus is held in between.
+    static void stream_begin(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    static void stream_begin();
+    static void stream_chunk(const uint16_t *data, uint32_t len);
+    static void stream_end();
+
+    // P::CHUNK_PIXELS of DMA-capable memory to build a chunk in
+    static uint16_t *scratch();
+
+private:
+    // W and H are 0 where the size is only known at run time
+    template <uint16_t W, uint16_t H>
+    static void push_turned(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+
+    static uint16_t chunk[P::CHUNK_PIXELS];
+    static bool chunkFilled;            // chunk holds chunkColour throughout, for fill()
+    static uint16_t chunkColour;
+};
+
+typedef Axs15231b<Panel> PanelDriver;
+
+template <class P>
+template <uint16_t W, uint16_t H>
+void Axs15231b<P>::push_logical(uint16_t x, uint16_t y, const uint16_t *data)
+{
+    push_turned<W, H>(x, y, W, H, data);
+}
+
+template <class P>
+template <uint16_t W, uint16_t H>
+void Axs15231b<P>::push_turned(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
+{
+    const uint16_t cols = W ? W : w;
+    const uint16_t rows = H ? H : h;
+    if (cols == 0 || rows == 0 || rows > P::HEIGHT)       // Taller than the screen: not a column per chunk
+        return;
+    if (P::ORIENTATION == PANEL_PORTRAIT) {
+        push(x, y, cols, rows, data);
+        return;
+    }
+
+    // A logical column is a native row, bottom pixel first. Whole columns are turned into the
+    // scratch chunk and streamed into one window, so the chunks follow on from each other.
+    const uint16_t perChunk = P::CHUNK_PIXELS / rows;
+    uint16_t *chunk = scratch();
+    stream_begin(P::NATIVE_WIDTH - (y + rows), x, rows, cols);
+    for (uint16_t col = 0; col < cols; col += perChunk) {
+        uint16_t n = cols - col < perChunk ? cols - col : perChunk;
+        uint16_t *q = chunk;
+        for (uint16_t c = col; c < col + n; c++) {
+            const uint16_t *p = data + (uint32_t)(rows - 1) * cols + c;
+            for (uint16_t i = 0; i < rows; i++, p -= cols)
+                *q++ = *p;
+        }
+        stream_chunk(chunk, (uint32_t)n * rows);
+    }
+    stream_end();
+}
@@ -0,0 +1,491 @@
+#include "frame_capture.h"
+#include <string.h>
+#include "system/crc32.h"
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+size_t capture_out_size(uint16_t width, uint16_t height)
+{
+    size_t pixels = (size_t)width * height;
+    return CAPTURE_HEADER_SIZE + CAPTURE_MAX_RECTS * CAPTURE_RECT_HEADER_SIZE + pixels * 2 + pixels / 128 +
+           CAPTURE_MAX_RECTS;
+}
+
+void capture_init(FrameCapture *c, uint16_t width, uint16_t height, uint8_t flags, uint16_t *shadow,
+                  uint16_t *sent, uint8_t *out, size_t outSize)
+{
+    memset(c, 0, sizeof(*c));
+    c->width = width;
+    c->height = height;
+    c->flags = flags;
+    c->shadow = shadow;
+    c->sent = sent;
+    c->out = out;
+    c->outSize = outSize;
+    c->scrollRows = height;
+    memset(shadow, 0, (size_t)width * height * 2);
+}
+
+static uint32_t area(const CaptureRect &r)
+{
+    return (uint32_t)r.w * r.h;
+}
+
+static CaptureRect bounds(const CaptureRect &a, const CaptureRect &b)
+{
+    uint16_t x1 = a.x < b.x ? a.x : b.x;
+    uint16_t y1 = a.y < b.y ? a.y : b.y;
+    uint16_t x2 = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+    uint16_t y2 = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+    CaptureRect r = {x1, y1, (uint16_t)(x2 - x1), (uint16_t)(y2 - y1)};
+    return r;
+}
+
+static bool touching(const CaptureRect &a, const CaptureRect &b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+static void add_damage(FrameCapture *c, CaptureRect r)
+{
+    // Anything it touches is folded in, which can make it touch others, so go round again
+    for (uint8_t i = 0; i < c->damageCount;) {
+        if (touching(c->damage[i], r)) {
+            r = bounds(c->damage[i], r);
+            c->damage[i] = c->damage[--c->damageCount];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    if (c->damageCount < CAPTURE_MAX_RECTS) {
+        c->damage[c->damageCount++] = r;
+        return;
+    }
+
+    // Full: into whichever rect grows least, then added again as it may now touch others
+    uint8_t best = 0;
+    uint32_t bestGrowth = UINT32_MAX;
+    for (uint8_t i = 0; i < c->damageCount; i++) {
+        uint32_t growth = area(bounds(c->damage[i], r)) - area(c->damage[i]);
+        if (growth < bestGrowth) {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    r = bounds(c->damage[best], r);
+    c->damage[best] = c->damage[--c->damageCount];
+    add_damage(c, r);
+}
+
+void capture_window(FrameCapture *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    CaptureRect r = {x, y, w, h};
+    c->window = r;
+    c->cursor = 0;
+
+    // Pixels off the panel still move the controller's cursor but land nowhere
+    if (x >= c->width || y >= c->height || w == 0 || h == 0)
+        return;
+    r.w = x + w > c->width ? c->width - x : w;
+    r.h = y + h > c->height ? c->height - y : h;
+    add_damage(c, r);
+}
+
+void capture_pixels(FrameCapture *c, const uint16_t *data, uint32_t len)
+{
+    const CaptureRect &win = c->window;
+    uint32_t total = area(win);
+    while (len > 0 && c->cursor < total) {
+        uint16_t row = c->cursor / win.w;
+        uint16_t col = c->cursor % win.w;
+        uint32_t n = win.w - col;
+        if (n > len)
+            n = len;
+        uint32_t y = (uint32_t)win.y + row;
+        uint32_t x = (uint32_t)win.x + col;
+        if (y < c->height && x < c->width) {
+            uint32_t fit = x + n > c->width ? c->width - x : n;
+            memcpy(&c->shadow[y * c->width + x], data, fit * 2);
+        }
+        c->cursor += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void capture_scroll(FrameCapture *c, uint16_t top, uint16_t rows, uint16_t start)
+{
+    if (top == c->scrollTop && rows == c->scrollRows && start == c->scrollStart)
+        return;
+    c->scrollTop = top;
+    c->scrollRows = rows;
+    c->scrollStart = start;
+    c->scrollChanged = true;
+}
+
+// Run-length coder: a run is held back until it ends, then either coded as a run or, if too
+// short to pay, added to the open literal token
+struct Rle {
+    uint8_t *out;
+    size_t len;
+    size_t literalAt;           // Control byte of the open literal token
+    uint8_t literals;           // Words in it, 0 if none is open
+    uint16_t runWord;
+    uint16_t runLen;
+};
+
+static void rle_close_literal(Rle &r)
+{
+    if (r.literals) {
+        r.out[r.literalAt] = (uint8_t)(r.literals - 1);
+        r.literals = 0;
+    }
+}
+
+static void rle_settle(Rle &r)
+{
+    if (r.runLen >= 3 || (r.runLen >= 2 && r.runWord == 0)) {
+        rle_close_literal(r);
+        uint16_t n = r.runLen - 1;
+        r.out[r.len++] = (uint8_t)((r.runWord == 0 ? 0x80 : 0xC0) | n >> 8);
+        r.out[r.len++] = (uint8_t)n;
+        if (r.runWord != 0) {
+            put16(r.out + r.len, r.runWord);
+            r.len += 2;
+        }
+    } else {
+        for (uint16_t i = 0; i < r.runLen; i++) {
+            if (r.literals == 0)
+                r.literalAt = r.len++;
+            put16(r.out + r.len, r.runWord);
+            r.len += 2;
+            if (++r.literals == 128)
+                rle_close_literal(r);
+        }
+    }
+    r.runLen = 0;
+}
+
+static inline void rle_word(Rle &r, uint16_t w)
+{
+    if (r.runLen && w == r.runWord && r.runLen < 0x4000) {
+        r.runLen++;
+        return;
+    }
+    if (r.runLen)
+        rle_settle(r);
+    r.runWord = w;
+    r.runLen = 1;
+}
+
+// One rect: XOR against what the receiver has, which then becomes what it'll have
+static size_t encode_rect(FrameCapture *c, const CaptureRect &rect, uint8_t *out)
+{
+    Rle r = {out, 0, 0, 0, 0, 0};
+    for (uint16_t y = rect.y; y < rect.y + rect.h; y++) {
+        uint16_t *now = &c->shadow[(uint32_t)y * c->width + rect.x];
+        uint16_t *had = &c->sent[(uint32_t)y * c->width + rect.x];
+        for (uint16_t x = 0; x < rect.w; x++) {
+            rle_word(r, now[x] ^ had[x]);
+            had[x] = now[x];
+        }
+    }
+    if (r.runLen)
+        rle_settle(r);
+    rle_close_literal(r);
+    return r.len;
+}
+
+bool capture_frame(FrameCapture *c, uint32_t timeMs)
+{
+    bool keyframe = c->sinceKeyframe == 0;
+    if (!keyframe && c->damageCount == 0 && !c->scrollChanged)
+        return true;
+    if (c->outSent < c->outLen) {
+        c->stats.dropped++;
+        if (c->droppedSince < UINT16_MAX)
+            c->droppedSince++;
+        if (c->sinceKeyframe > 0)       // Keyframes keep to time on a slow link
+            c->sinceKeyframe = (uint16_t)((c->sinceKeyframe + 1) % CAPTURE_KEYFRAME_EVERY);
+        return false;
+    }
+
+    if (keyframe) {
+        memset(c->sent, 0, (size_t)c->width * c->height * 2);
+        CaptureRect all = {0, 0, c->width, c->height};
+        c->damage[0] = all;
+        c->damageCount = 1;
+        c->stats.keyframes++;
+    }
+
+    size_t len = CAPTURE_HEADER_SIZE;
+    for (uint8_t i = 0; i < c->damageCount; i++) {
+        const CaptureRect &d = c->damage[i];
+        uint8_t *rh = c->out + len;
+        put16(rh, d.x);
+        put16(rh + 2, d.y);
+        put16(rh + 4, d.w);
+        put16(rh + 6, d.h);
+        size_t n = encode_rect(c, d, rh + CAPTURE_RECT_HEADER_SIZE);
+        put32(rh + 8, (uint32_t)n);
+        len += CAPTURE_RECT_HEADER_SIZE + n;
+        c->stats.pixels += area(d);
+    }
+
+    uint8_t *h = c->out;
+    put16(h, CAPTURE_MAGIC);
+    h[2] = CAPTURE_VERSION;
+    h[3] = (uint8_t)(c->flags | (keyframe ? CAPTURE_FLAG_KEYFRAME : 0));
+    put32(h + 4, c->number);
+    put32(h + 8, timeMs);
+    put16(h + 12, c->droppedSince);
+    put16(h + 14, c->damageCount);
+    put16(h + 16, c->width);
+    put16(h + 18, c->height);
+    put16(h + 20, c->scrollTop);
+    put16(h + 22, c->scrollRows);
+    put16(h + 24, c->scrollStart);
+    put32(h + 26, (uint32_t)(len - CAPTURE_HEADER_SIZE));
+    uint32_t crc = crc32_update(0, h, CAPTURE_HEADER_SIZE - 4);
+    crc = crc32_update(crc, h + CAPTURE_HEADER_SIZE, len - CAPTURE_HEADER_SIZE);
+    put32(h + 30, crc);
+
+    c->outLen = len;
+    c->outSent = 0;
+    c->number++;
+    c->droppedSince = 0;
+    c->damageCount = 0;
+    c->scrollChanged = false;
+    c->sinceKeyframe = (uint16_t)((c->sinceKeyframe + 1) % CAPTURE_KEYFRAME_EVERY);
+    c->stats.frames++;
+    c->stats.bytes += len;
+    return true;
+}
+
+size_t capture_pending(const FrameCapture *c, const uint8_t **data)
+{
+    *data = c->out + c->outSent;
+    return c->outLen - c->outSent;
+}
+
+void capture_sent(FrameCapture *c, size_t len)
+{
+    c->outSent += len;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+void capture_decoder_init(CaptureDecoder *d, uint16_t *pixels, uint32_t maxPixels, uint8_t *frame,
+                          size_t frameSize, CaptureFrameFn done, void *ctx)
+{
+    memset(d, 0, sizeof(*d));
+    d->pixels = pixels;
+    d->maxPixels = maxPixels;
+    d->frame = frame;
+    d->frameSize = frameSize;
+    d->done = done;
+    d->doneCtx = ctx;
+}
+
+static void discard(CaptureDecoder *d, size_t n, bool skipped)
+{
+    memmove(d->frame, d->frame + n, d->frameLen - n);
+    d->frameLen -= n;
+    if (skipped)
+        d->skippedBytes += n;
+}
+
+// XORs one rect's RLE data into the panel; false if it doesn't add up
+static bool decode_rect(CaptureDecoder *d, const CaptureRect &r, const uint8_t *p, const uint8_t *end)
+{
+    uint16_t *row = &d->pixels[(uint32_t)r.y * d->width + r.x];
+    uint32_t left = (uint32_t)r.w * r.h;
+    uint16_t x = 0;
+    while (left > 0) {
+        if (p >= end)
+            return false;
+        uint8_t control = *p++;
+        uint32_t n;
+        uint16_t word = 0;
+        bool literal = (control & 0x80) == 0;
+        if (literal) {
+            n = (control & 0x7F) + 1u;
+            if (end - p < (ptrdiff_t)n * 2)
+                return false;
+        } else {
+            if (p >= end)
+                return false;
+            n = ((control & 0x3F) << 8 | *p++) + 1u;
+            if (control & 0x40) {
+                if (end - p < 2)
+                    return false;
+                word = get16(p);
+                p += 2;
+            }
+        }
+        if (n > left)
+            return false;
+        left -= n;
+        for (; n > 0; n--) {
+            if (literal) {
+                word = get16(p);
+                p += 2;
+            }
+            row[x] ^= word;
+            if (++x == r.w) {
+                x = 0;
+                row += d->width;
+            }
+        }
+    }
+    return p == end;
+}
+
+// A frame that passed its CRC: applied if it follows on from what the decoder has
+static void apply(CaptureDecoder *d, const uint8_t *h)
+{
+    uint8_t flags = h[3];
+    uint32_t number = get32(h + 4);
+    uint16_t width = get16(h + 16), height = get16(h + 18);
+    bool keyframe = (flags & CAPTURE_FLAG_KEYFRAME) != 0;
+    if (!keyframe && !(d->synced && number == d->number + 1 && width == d->width && height == d->height)) {
+        d->synced = false;
+        d->missed++;
+        return;
+    }
+
+    d->width = width;
+    d->height = height;
+    if (keyframe)
+        memset(d->pixels, 0, (size_t)width * height * 2);
+    const uint8_t *p = h + CAPTURE_HEADER_SIZE;
+    const uint8_t *end = p + get32(h + 26);
+    for (uint16_t i = 0, rects = get16(h + 14); i < rects; i++) {
+        if (end - p < CAPTURE_RECT_HEADER_SIZE) {
+            d->synced = false;
+            return;
+        }
+        CaptureRect r = {get16(p), get16(p + 2), get16(p + 4), get16(p + 6)};
+        uint32_t len = get32(p + 8);
+        p += CAPTURE_RECT_HEADER_SIZE;
+        if (r.x + r.w > width || r.y + r.h > height || (size_t)(end - p) < len ||
+            !decode_rect(d, r, p, p + len)) {
+            d->synced = false;
+            return;
+        }
+        p += len;
+    }
+
+    d->synced = true;
+    d->number = number;
+    d->timeMs = get32(h + 8);
+    d->dropped = get16(h + 12);
+    d->flags = flags;
+    d->scrollTop = get16(h + 20);
+    d->scrollRows = get16(h + 22);
+    d->scrollStart = get16(h + 24);
+    d->frames++;
+    if (d->done)
+        d->done(d, d->doneCtx);
+}
+
+// Deals with what's at the start of the buffer; false if it needs more bytes to do that
+static bool decoder_step(CaptureDecoder *d)
+{
+    uint8_t *f = d->frame;
+    size_t at = 0;
+    while (at < d->frameLen && f[at] != (uint8_t)CAPTURE_MAGIC)
+        at++;
+    if (at > 0) {
+        discard(d, at, true);
+        return true;
+    }
+
+    // Checked as far as the bytes go, so a stray "C" costs little
+    if ((d->frameLen >= 2 && get16(f) != CAPTURE_MAGIC) || (d->frameLen >= 3 && f[2] != CAPTURE_VERSION)) {
+        discard(d, 1, true);
+        return true;
+    }
+    if (d->frameLen < CAPTURE_HEADER_SIZE)
+        return false;
+    uint32_t pixels = (uint32_t)get16(f + 16) * get16(f + 18);
+    size_t total = CAPTURE_HEADER_SIZE + (size_t)get32(f + 26);
+    if (pixels == 0 || pixels > d->maxPixels || get16(f + 14) > CAPTURE_MAX_RECTS || total > d->frameSize) {
+        discard(d, 1, true);
+        return true;
+    }
+    if (d->frameLen < total)
+        return false;
+
+    uint32_t crc = crc32_update(0, f, CAPTURE_HEADER_SIZE - 4);
+    crc = crc32_update(crc, f + CAPTURE_HEADER_SIZE, total - CAPTURE_HEADER_SIZE);
+    if (crc != get32(f + 30)) {
+        d->crcErrors++;
+        d->synced = false;
+        discard(d, 1, true);
+        return true;
+    }
+    apply(d, f);
+    discard(d, total, false);
+    return true;
+}
+
+void capture_decoder_feed(CaptureDecoder *d, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t n = d->frameSize - d->frameLen;
+        if (n > len)
+            n = len;
+        memcpy(d->frame + d->frameLen, data, n);
+        d->frameLen += n;
+        data += n;
+        len -= n;
+        while (d->frameLen > 0 && decoder_step(d)) {
+        }
+    }
+}
+
+// Memory row on screen at a native row, as the controller scrolls (hal_panel_shown_row)
+static uint16_t shown_row(const CaptureDecoder *d, uint16_t row)
+{
+    uint16_t top = d->scrollTop, rows = d->scrollRows, start = d->scrollStart;
+    if (row < top || row >= top + rows || start < top || start >= top + rows)
+        return row;
+    return top + (row - top + start - top) % rows;
+}
+
+void capture_decoder_render(const CaptureDecoder *d, uint16_t *out, uint16_t *w, uint16_t *h)
+{
+    const uint16_t pw = d->width, ph = d->height;
+    bool landscape = (d->flags & CAPTURE_FLAG_LANDSCAPE) != 0;
+    *w = landscape ? ph : pw;
+    *h = landscape ? pw : ph;
+    for (uint16_t y = 0; y < *h; y++) {
+        for (uint16_t x = 0; x < *w; x++) {
+            // Landscape: native column pw - 1 is the top row, native rows run left to right
+            uint32_t at = landscape ? (uint32_t)shown_row(d, x) * pw + (pw - 1 - y)
+                                    : (uint32_t)shown_row(d, y) * pw + x;
+            uint16_t c = d->pixels[at];
+            *out++ = (uint16_t)(c << 8 | c >> 8);
+        }
+    }
+}
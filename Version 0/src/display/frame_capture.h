@@ -0,0 +1,155 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Frame capture
+ *
+ * Records exactly what the panel shows, for bug reports and demos, as a stream of frames over USB
+ * serial that tools/capture_recv.cpp turns back into pictures.
+ *
+ * The panel driver's tap (lcd_set_tap) hands every window and pixel it sends to capture_window()
+ * and capture_pixels(): the pixels go into a shadow of the panel's memory and the window is added
+ * to the damage. capture_frame(), called at the capture rate, encodes the damaged rects: XOR
+ * against what the receiver already has, so unchanged pixels are zero, then run-length coded.
+ * The panel can't be read back, so the shadow starts black and whatever was on screen before the
+ * capture started appears as it's redrawn.
+ *
+ * Rendering never waits on the link. A frame is only encoded once the one before has gone out
+ * (capture_pending()/capture_sent(), drained as the serial TX buffer has room); if it's still
+ * going, the frame is dropped and counted, and its damage carries over to the next, so what's
+ * lost is time, not pixels.
+ *
+ * Every CAPTURE_KEYFRAME_EVERY frames, dropped ones included, the whole panel goes out against zero, so the receiver can
+ * start mid-stream or pick up again after a frame that failed its CRC (other serial output can land
+ * in the middle of one). The receiving end is CaptureDecoder, below.
+ *
+ * Frame, little-endian:
+ *   magic:16 ("CF") version flags number:32 time_ms:32 dropped:16 rects:16 panel_w:16 panel_h:16
+ *   scroll_top:16 scroll_rows:16 scroll_start:16 payload:32 crc:32
+ * then per rect x:16 y:16 w:16 h:16 (native) length:32 and its RLE data. The CRC (CRC-32, see
+ * system/crc32.h) covers the header up to it and the payload.
+ *
+ * RLE, over the rect's pixels row by row as 16-bit words in panel byte order, XORed with the last
+ * frame. Each token starts with a control byte:
+ *   0nnnnnnn             n + 1 literal words follow
+ *   10nnnnnn nnnnnnnn    n + 1 zero words
+ *   11nnnnnn nnnnnnnn    n + 1 copies of the word that follows
+ */
+
+const uint16_t CAPTURE_MAGIC            = 0x4643;   // "CF"
+const uint8_t CAPTURE_VERSION           = 1;
+const uint8_t CAPTURE_HEADER_SIZE       = 34;
+const uint8_t CAPTURE_RECT_HEADER_SIZE  = 12;
+const uint8_t CAPTURE_MAX_RECTS         = 16;       // Damage is merged down to this many
+const uint16_t CAPTURE_KEYFRAME_EVERY   = 100;
+const uint8_t CAPTURE_DEFAULT_FPS       = 25;
+
+enum CaptureFlags : uint8_t {
+    CAPTURE_FLAG_KEYFRAME   = 0x01,     // Against zero: doesn't need the frames before
+    CAPTURE_FLAG_LANDSCAPE  = 0x02,     // Shown turned, as Panel does (display/panel.h)
+};
+
+struct CaptureRect {
+    uint16_t x, y, w, h;
+};
+
+struct CaptureStats {
+    uint32_t frames;
+    uint32_t keyframes;
+    uint32_t dropped;           // Link still busy with the frame before
+    uint64_t bytes;             // Encoded, headers included
+    uint64_t pixels;            // In the damaged rects sent
+};
+
+struct FrameCapture {
+    uint16_t width, height;     // Native panel size
+    uint8_t flags;              // CAPTURE_FLAG_LANDSCAPE, for the receiver
+    uint16_t *shadow;           // What the panel holds
+    uint16_t *sent;             // What the receiver has
+    uint8_t *out;               // The frame going out
+    size_t outSize, outLen, outSent;
+
+    CaptureRect window;         // Where capture_pixels() goes
+    uint32_t cursor;            // Pixels into the window so far
+
+    CaptureRect damage[CAPTURE_MAX_RECTS];
+    uint8_t damageCount;
+    uint16_t scrollTop, scrollRows, scrollStart;
+    bool scrollChanged;
+
+    uint32_t number;
+    uint16_t droppedSince;      // Frames dropped since the last one encoded
+    uint16_t sinceKeyframe;
+    CaptureStats stats;
+};
+
+struct CaptureDecoder;
+typedef void (*CaptureFrameFn)(const CaptureDecoder *d, void *ctx);
+
+// Size of out that any frame fits in: a keyframe that doesn't compress at all
+size_t capture_out_size(uint16_t width, uint16_t height);
+
+// shadow and sent are width * height pixels; the caller provides them (PSRAM on the device)
+void capture_init(FrameCapture *c, uint16_t width, uint16_t height, uint8_t flags, uint16_t *shadow,
+                  uint16_t *sent, uint8_t *out, size_t outSize);
+
+// From the panel driver's tap: a native window, then its pixels as sent, in any number of pieces
+void capture_window(FrameCapture *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+void capture_pixels(FrameCapture *c, const uint16_t *data, uint32_t len);
+void capture_scroll(FrameCapture *c, uint16_t top, uint16_t rows, uint16_t start);
+
+// Encodes a frame of what changed since the last one. Returns false if it was dropped because the
+// last one is still going out; true otherwise, including when there was nothing to send.
+bool capture_frame(FrameCapture *c, uint32_t timeMs);
+
+// The bytes of the current frame still to go out, and how many of them went
+size_t capture_pending(const FrameCapture *c, const uint8_t **data);
+void capture_sent(FrameCapture *c, size_t len);
+
+/*
+ * Receiving end, for tools/capture_recv.cpp: finds frames in a byte stream that may have other
+ * output around and inside them, checks them and applies them to its copy of the panel. After a
+ * frame it couldn't use (CRC, or one missing from the numbering) it waits for the next keyframe.
+ */
+struct CaptureDecoder {
+    uint16_t *pixels;           // Native panel as the device last sent it, panel byte order
+    uint32_t maxPixels;
+    uint8_t *frame;             // Bytes of the frame being gathered
+    size_t frameSize, frameLen;
+    CaptureFrameFn done;
+    void *doneCtx;
+
+    bool synced;                // Has applied a keyframe and missed nothing since
+    uint32_t number;            // Of the last frame applied
+    uint32_t timeMs;
+    uint16_t dropped;           // By the device, just before this frame
+    uint8_t flags;
+    uint16_t width, height;
+    uint16_t scrollTop, scrollRows, scrollStart;
+
+    uint32_t frames;            // Applied
+    uint32_t crcErrors;
+    uint32_t missed;            // Frames skipped while waiting for a keyframe
+    uint64_t skippedBytes;      // Between frames: other output, or what was left of a bad frame
+};
+
+// pixels holds maxPixels, frame frameSize bytes (capture_out_size() of the largest panel expected).
+// done is called after each frame is applied.
+void capture_decoder_init(CaptureDecoder *d, uint16_t *pixels, uint32_t maxPixels, uint8_t *frame,
+                          size_t frameSize, CaptureFrameFn done, void *ctx);
+void capture_decoder_feed(CaptureDecoder *d, const uint8_t *data, size_t len);
+
+// What the screen shows, in plain RGB565: turned to landscape if the panel is and with the scroll
+// applied. out holds width * height; the shown size is returned in w and h.
+void capture_decoder_render(const CaptureDecoder *d, uint16_t *out, uint16_t *w, uint16_t *h);
+
+// Capture over Serial, with the "cap start [fps]" and "cap stop" commands (system/serial_cmd.h).
+// capture_service_poll() drains and encodes, from a low priority UI task every few ms. Device:
+// frame_capture_service.cpp; host: hal/frame_capture_host.cpp.
+void capture_command(const char *args, void *ctx);
+void capture_service_poll();
+
+#endif
@@ -0,0 +1,127 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_capture.h"
+#include "AXS15231B.h"
+
+// Encoding runs in the UI scheduler (capture_service_poll), on the same core as the drawing the
+// tap sees, so the shadow needs no locking
+static const size_t TX_PER_POLL     = 8192;         // Most bytes handed to Serial in one poll
+
+static FrameCapture capture;
+static uint16_t *shadow = NULL, *sent = NULL;
+static uint8_t *out = NULL;
+static uint32_t frameMs = 1000 / CAPTURE_DEFAULT_FPS;
+static uint32_t lastFrame = 0;
+static bool running = false;
+
+static void tap_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h, void *ctx)
+{
+    capture_window(&capture, x, y, w, h);
+}
+
+static void tap_pixels(const uint16_t *data, uint32_t len, void *ctx)
+{
+    capture_pixels(&capture, data, len);
+}
+
+static void tap_scroll(uint16_t top, uint16_t rows, uint16_t start, void *ctx)
+{
+    capture_scroll(&capture, top, rows, start);
+}
+
+static const lcd_tap_t tap = {tap_window, tap_pixels, tap_scroll, NULL};
+
+static void release()
+{
+    heap_caps_free(shadow);
+    heap_caps_free(sent);
+    heap_caps_free(out);
+    shadow = sent = NULL;
+    out = NULL;
+}
+
+static void stop()
+{
+    lcd_set_tap(NULL);
+    running = false;
+    release();
+}
+
+static bool start(uint32_t fps)
+{
+    stop();
+    size_t pixels = (size_t)Panel::NATIVE_WIDTH * Panel::NATIVE_HEIGHT;
+    size_t outSize = capture_out_size(Panel::NATIVE_WIDTH, Panel::NATIVE_HEIGHT);
+    shadow = (uint16_t *)heap_caps_malloc(pixels * 2, MALLOC_CAP_SPIRAM);
+    sent = (uint16_t *)heap_caps_malloc(pixels * 2, MALLOC_CAP_SPIRAM);
+    out = (uint8_t *)heap_caps_malloc(outSize, MALLOC_CAP_SPIRAM);
+    if (shadow == NULL || sent == NULL || out == NULL) {
+        release();
+        return false;
+    }
+    uint8_t flags = Panel::ORIENTATION == PANEL_LANDSCAPE ? CAPTURE_FLAG_LANDSCAPE : 0;
+    capture_init(&capture, Panel::NATIVE_WIDTH, Panel::NATIVE_HEIGHT, flags, shadow, sent, out, outSize);
+    frameMs = 1000 / fps;
+    lastFrame = millis() - frameMs;
+    lcd_set_tap(&tap);
+    running = true;
+    return true;
+}
+
+void capture_command(const char *args, void *ctx)
+{
+    if (strncmp(args, "start", 5) == 0) {
+        long fps = args[5] == ' ' ? atol(args + 6) : CAPTURE_DEFAULT_FPS;
+        if (fps < 1 || fps > 60) {
+            Serial.println("cap: rate 1..60 fps");
+            return;
+        }
+        if (!start((uint32_t)fps)) {
+            Serial.println("cap: no memory for the shadow");
+            return;
+        }
+        Serial.printf("cap: capturing at %ld fps\n", fps);
+    } else if (strcmp(args, "stop") == 0) {
+        // What's left of the last frame goes first, so the receiver sees it whole
+        if (running) {
+            const uint8_t *data;
+            size_t len = capture_pending(&capture, &data);
+            Serial.write(data, len);
+            Serial.flush();
+        }
+        const CaptureStats &s = capture.stats;
+        stop();
+        Serial.printf("\ncap: stopped, %u frames (%u key), %u dropped, %llu bytes for %llu pixels\n",
+                      (unsigned)s.frames, (unsigned)s.keyframes, (unsigned)s.dropped,
+                      (unsigned long long)s.bytes, (unsigned long long)s.pixels);
+    } else {
+        Serial.println("cap: start [fps] | stop");
+    }
+}
+
+void capture_service_poll()
+{
+    if (!running)
+        return;
+
+    // Only as much as the TX buffer takes without waiting; the rest goes on the next poll
+    const uint8_t *data;
+    size_t len = capture_pending(&capture, &data);
+    size_t room = Serial.availableForWrite();
+    if (len > room)
+        len = room;
+    if (len > TX_PER_POLL)
+        len = TX_PER_POLL;
+    if (len > 0)
+        capture_sent(&capture, Serial.write(data, len));
+
+    uint32_t now = millis();
+    if (now - lastFrame >= frameMs) {
+        lastFrame += frameMs;
+        if (now - lastFrame >= frameMs)
+            lastFrame = now;            // Fell behind, don't try to catch up
+        capture_frame(&capture, now);
+    }
+}
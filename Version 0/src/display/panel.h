@@ -0,0 +1,75 @@
+#ifndef PANEL_H
+#define PANEL_H
+
+#include <stdint.h>
+
+/*
+ * Panel geometry, as compile-time constants
+ *
+ * Everything the driver (AXS15231B.cpp) and the drawing code need to know about the panel comes
+ * from one PanelConfig: its native size, how it's mounted, what its pixels look like on the wire
+ * and how many pixels go out in one SPI transaction. The driver is a template on it, so rotation,
+ * fill and chunking loops are compiled with their bounds known.
+ *
+ * The panel in use is Panel below. Another size is a matter of defining PANEL_NATIVE_WIDTH and
+ * PANEL_NATIVE_HEIGHT when building (build_flags in platformio.ini, or SPECTRA_PANEL_SIZE for the
+ * host build), e.g. to check that code doesn't quietly depend on 640x180.
+ */
+
+enum PanelOrientation : uint8_t {
+    PANEL_PORTRAIT,             // Logical screen is the native one
+    PANEL_LANDSCAPE,            // Turned 90 degrees: logical x runs down the native rows,
+                                // logical y runs right to left across them
+};
+
+enum PanelPixelFormat : uint8_t {
+    PANEL_RGB565_BE,            // RGB565, high byte first on the wire (buffers hold it byte-swapped)
+    PANEL_RGB565_LE,            // RGB565, low byte first (buffers hold it as is)
+};
+
+template <uint16_t NativeW, uint16_t NativeH, PanelOrientation Orientation, PanelPixelFormat Format,
+          uint32_t ChunkPixels>
+struct PanelConfig {
+    static const uint16_t NATIVE_WIDTH          = NativeW;
+    static const uint16_t NATIVE_HEIGHT         = NativeH;
+    static const PanelOrientation ORIENTATION   = Orientation;
+    static const PanelPixelFormat FORMAT        = Format;
+    static const uint32_t CHUNK_PIXELS          = ChunkPixels;  // Most pixels in one SPI transaction
+
+    // The screen the rest of the firmware draws on
+    static const uint16_t WIDTH     = Orientation == PANEL_LANDSCAPE ? NativeH : NativeW;
+    static const uint16_t HEIGHT    = Orientation == PANEL_LANDSCAPE ? NativeW : NativeH;
+
+    // An RGB565 colour as it's stored in a pixel buffer
+    static uint16_t wire(uint16_t rgb565)
+    {
+        return Format == PANEL_RGB565_BE ? (uint16_t)(rgb565 >> 8 | rgb565 << 8) : rgb565;
+    }
+};
+
+#define PANEL_CONFIG_MEMBER(type, name) \
+    template <uint16_t W, uint16_t H, PanelOrientation O, PanelPixelFormat F, uint32_t C> \
+    const type PanelConfig<W, H, O, F, C>::name;
+PANEL_CONFIG_MEMBER(uint16_t, NATIVE_WIDTH)
+PANEL_CONFIG_MEMBER(uint16_t, NATIVE_HEIGHT)
+PANEL_CONFIG_MEMBER(PanelOrientation, ORIENTATION)
+PANEL_CONFIG_MEMBER(PanelPixelFormat, FORMAT)
+PANEL_CONFIG_MEMBER(uint32_t, CHUNK_PIXELS)
+PANEL_CONFIG_MEMBER(uint16_t, WIDTH)
+PANEL_CONFIG_MEMBER(uint16_t, HEIGHT)
+#undef PANEL_CONFIG_MEMBER
+
+#ifndef PANEL_NATIVE_WIDTH
+#define PANEL_NATIVE_WIDTH      180
+#endif
+#ifndef PANEL_NATIVE_HEIGHT
+#define PANEL_NATIVE_HEIGHT     640
+#endif
+
+// The AXS15231B strip, on its side: 640x180
+typedef PanelConfig<PANEL_NATIVE_WIDTH, PANEL_NATIVE_HEIGHT, PANEL_LANDSCAPE, PANEL_RGB565_BE, 14400> Panel;
+
+// Pixels per SPI chunk; also what the drawing code sizes its staging buffers by
+#define SEND_BUF_SIZE           Panel::CHUNK_PIXELS
+
+#endif
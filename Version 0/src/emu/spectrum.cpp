@@ -0,0 +1,261 @@
+#include "spectrum.h"
+#include <string.h>
+
+// Data pulses the trap takes as ROM timings: the ROM's own loader accepts about this much either side
+static const uint16_t TRAP_ZERO_MIN     = TAPE_ZERO_PULSE * 4 / 5;
+static const uint16_t TRAP_ZERO_MAX     = TAPE_ZERO_PULSE * 6 / 5;
+static const uint16_t TRAP_ONE_MIN      = TAPE_ONE_PULSE * 4 / 5;
+static const uint16_t TRAP_ONE_MAX      = TAPE_ONE_PULSE * 6 / 5;
+static const uint16_t TRAP_PILOT_MIN    = 256;      // A run this long at the start of a block is its pilot
+static const uint8_t LD_BYTES_FIRST     = 0x14;     // INC D, the first instruction of LD-BYTES
+
+static const uint64_t NEVER             = ~0ull;
+
+static inline void poke(Z80 *z, uint16_t addr, uint8_t v)
+{
+    if (addr >= 0x4000)
+        z->page[addr >> 14][addr & 0x3FFF] = v;
+}
+
+static inline uint8_t peek(const Z80 *z, uint16_t addr)
+{
+    return z->page[addr >> 14][addr & 0x3FFF];
+}
+
+// The tape's level now, moving it on to the current segment
+static uint8_t tape_ear(Spectrum *s)
+{
+    uint64_t now = s->clock + s->cpu.t;
+    while (now >= s->segmentEnd) {
+        uint8_t level;
+        uint32_t tstates;
+        if (!tape_cursor_next(&s->cursor, &level, &tstates)) {
+            s->ear = 0;
+            s->segmentEnd = NEVER;
+            s->tapeEnded = true;
+            break;
+        }
+        s->ear = level;
+        s->segmentEnd += tstates;
+    }
+    return s->ear;
+}
+
+static uint8_t port_in(uint16_t port, void *ctx)
+{
+    Spectrum *s = (Spectrum *)ctx;
+    if (!(port & 1)) {
+        uint8_t v = 0x1F;
+        for (uint8_t row = 0; row < 8; row++) {
+            if (!(port & (0x100 << row)))
+                v &= s->keys[row];
+        }
+        return (uint8_t)(v | 0xA0 | (tape_ear(s) ? 0x40 : 0));
+    }
+    if ((port & 0xFF) == 0x1F)
+        return 0x00;                            // Kempston joystick, nothing pressed
+    return 0xFF;                                // Idle bus
+}
+
+static void page_128k(Spectrum *s, uint8_t v)
+{
+    s->port7ffd = v;
+    s->cpu.page[0] = (uint8_t *)s->rom[(v >> 4) & 1];  // Never written: writes below 0x4000 are dropped
+    s->cpu.page[3] = s->ram + (v & 7) * SPECTRUM_BANK_SIZE;
+}
+
+static void port_out(uint16_t port, uint8_t value, void *ctx)
+{
+    Spectrum *s = (Spectrum *)ctx;
+    if (!(port & 1))
+        s->border = value & 7;
+    if (s->model == SPECTRUM_128K && !(port & 0x8002) && !(s->port7ffd & 0x20))
+        page_128k(s, value);                    // Bit 5 locks the paging until reset
+}
+
+// Block the ROM would pick up now: the one playing, if it's still in its pilot, else the next
+static uint16_t trap_block(const Spectrum *s)
+{
+    const TapePulseBuffer *buf = s->tape;
+    uint32_t run = s->cursor.run;
+    uint16_t b = 0;
+    while (b + 1 < buf->blockCount && buf->blockStart[b + 1] <= run)
+        b++;
+    if (b < buf->blockCount && run > buf->blockStart[b])
+        b++;
+    return b;
+}
+
+static bool standard_pulse(uint16_t length)
+{
+    return (length >= TRAP_ZERO_MIN && length <= TRAP_ZERO_MAX) ||
+           (length >= TRAP_ONE_MIN && length <= TRAP_ONE_MAX);
+}
+
+/*
+ * LD-BYTES: A the flag byte wanted, IX where to, DE how many, carry set to load (clear to verify).
+ * Returns with carry set if the block matched and its checksum was right; IX and DE are left where
+ * the loading got to. Runs in place of the whole routine, RET included.
+ */
+static bool ld_bytes_trap(Z80 *z, void *ctx)
+{
+    Spectrum *s = (Spectrum *)ctx;
+    if (!s->traps || s->tape == NULL || s->basicRom == NULL || z->page[0] != s->basicRom)
+        return false;
+    const TapePulseBuffer *buf = s->tape;
+    uint16_t b = trap_block(s);
+    if (b >= buf->blockCount)
+        return false;                           // Nothing left: the ROM waits for a tape that never comes
+    uint32_t i = buf->blockStart[b];
+    uint32_t end = b + 1 < buf->blockCount ? buf->blockStart[b + 1] : buf->count;
+    const TapePulse *runs = buf->runs;
+
+    // Past the pilot and syncs, if there are any; the data has to be at ROM speed
+    if (i < end && runs[i].length != 0 && runs[i].repeat >= TRAP_PILOT_MIN) {
+        uint16_t pilot = runs[i].length;
+        while (i < end && runs[i].length == pilot)
+            i++;
+    }
+    for (int n = 0; n < 2 && i < end && runs[i].repeat == 1; n++)
+        i++;
+    if (i >= end || !standard_pulse(runs[i].length))
+        return false;
+
+    uint8_t flag = z->af.b.h;
+    bool load = z->af.b.l & Z80_FLAG_C;
+    uint16_t addr = z->ix.w, want = z->de.w, loaded = 0;
+    uint8_t byte = 0, bits = 0, parity = 0;
+    bool first = true, done = false, ok = false;
+    for (; i < end && !done; i++) {
+        const TapePulse &r = runs[i];
+        if (r.length == 0 || (r.repeat & 1) || !standard_pulse(r.length))
+            break;                              // Pause, or the data's over one way or another
+        uint8_t bit = r.length >= TRAP_ONE_MIN;
+        for (uint16_t n = r.repeat / 2; n > 0 && !done; n--) {
+            byte = (uint8_t)(byte << 1 | bit);
+            if (++bits < 8)
+                continue;
+            bits = 0;
+            parity ^= byte;
+            if (first) {
+                first = false;
+                done = byte != flag;
+            } else if (loaded < want) {
+                if (load)
+                    poke(z, addr, byte);
+                else
+                    done = peek(z, addr) != byte;
+                if (!done) {
+                    addr++;
+                    loaded++;
+                }
+            } else {
+                ok = parity == 0;               // That was the checksum
+                done = true;
+            }
+        }
+    }
+
+    s->trapped.count++;
+    s->trapped.start = z->ix.w;
+    s->trapped.length = loaded;
+    if (s->onTrap)
+        s->onTrap(s->trapped, s->onTrapCtx);
+    z->ix.w = addr;
+    z->de.w = (uint16_t)(want - loaded);
+    z->af.b.h = parity;
+    z->af.b.l = ok ? Z80_FLAG_C : 0;
+    z->pc = z80_read16(z, z->sp);
+    z->sp += 2;
+
+    // The tape carries on from the next block, now
+    tape_cursor_init(&s->cursor, buf, (uint16_t)(b + 1));
+    s->ear = 0;
+    s->segmentEnd = s->clock + z->t;
+    s->tapeEnded = b + 1 >= buf->blockCount;
+    return true;
+}
+
+void spectrum_init(Spectrum *s, SpectrumModel model, const uint8_t *rom, uint8_t *ram)
+{
+    memset(s, 0, sizeof(*s));
+    s->model = model;
+    s->rom[0] = rom;
+    s->rom[1] = model == SPECTRUM_128K ? rom + SPECTRUM_ROM_SIZE : rom;
+    s->basicRom = s->rom[1][SPECTRUM_LD_BYTES] == LD_BYTES_FIRST ? s->rom[1] : NULL;
+    s->ram = ram;
+    memset(ram, 0, (size_t)(model == SPECTRUM_128K ? 8 : 3) * SPECTRUM_BANK_SIZE);
+    s->frameT = model == SPECTRUM_128K ? SPECTRUM_128K_FRAME_T : SPECTRUM_48K_FRAME_T;
+    memset(s->keys, 0x1F, sizeof(s->keys));
+    s->segmentEnd = NEVER;
+
+    Z80 *z = &s->cpu;
+    z80_reset(z);
+    z->in = port_in;
+    z->out = port_out;
+    z->ctx = s;
+    z->trapPc = SPECTRUM_LD_BYTES;
+    z->trap = ld_bytes_trap;
+    if (model == SPECTRUM_128K) {
+        z->page[1] = ram + 5 * SPECTRUM_BANK_SIZE;
+        z->page[2] = ram + 2 * SPECTRUM_BANK_SIZE;
+        page_128k(s, 0);
+    } else {
+        z->page[0] = (uint8_t *)rom;
+        z->page[1] = ram;
+        z->page[2] = ram + SPECTRUM_BANK_SIZE;
+        z->page[3] = ram + 2 * SPECTRUM_BANK_SIZE;
+    }
+}
+
+void spectrum_insert_tape(Spectrum *s, const TapePulseBuffer *tape, bool traps)
+{
+    s->tape = tape;
+    s->traps = traps;
+    tape_cursor_init(&s->cursor, tape);
+    s->ear = 0;
+    s->segmentEnd = spectrum_tstates(s);
+    s->tapeEnded = false;
+}
+
+void spectrum_key(Spectrum *s, uint8_t key, bool pressed)
+{
+    uint8_t bit = (uint8_t)(1 << (key % 5));
+    if (pressed)
+        s->keys[key / 5] &= (uint8_t)~bit;
+    else
+        s->keys[key / 5] |= bit;
+}
+
+void spectrum_run_frame(Spectrum *s)
+{
+    Z80 *z = &s->cpu;
+    // The INT line is up for the first 32 T-states: an EI just before still lets it in after one more instruction
+    if (!z80_interrupt(z) && z->iff1) {
+        z80_run(z, z->t + 1);
+        if (z->t < 32)
+            z80_interrupt(z);
+    }
+    z80_run(z, s->frameT);
+    z->t -= s->frameT;
+    s->clock += s->frameT;
+}
+
+const uint8_t *spectrum_screen(const Spectrum *s)
+{
+    if (s->model == SPECTRUM_48K)
+        return s->ram;
+    return s->ram + (s->port7ffd & 0x08 ? 7 : 5) * SPECTRUM_BANK_SIZE;
+}
+
+uint64_t spectrum_tstates(const Spectrum *s)
+{
+    return s->clock + s->cpu.t;
+}
+
+bool spectrum_tape_ended(Spectrum *s)
+{
+    if (s->tape != NULL)
+        tape_ear(s);
+    return s->tapeEnded;
+}
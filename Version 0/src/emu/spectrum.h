@@ -0,0 +1,91 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "z80.h"
+#include "tape/tape_pulses.h"
+
+/*
+ * A minimal 48K / 128K Spectrum around the Z80 core, for running tape loaders
+ *
+ * Memory and paging (0x7FFD on the 128K), the ULA port (keyboard matrix, border, EAR from the
+ * tape) and the 50 Hz frame interrupt. There's no video, sound or contention: frames run flat out
+ * and the screen is just the RAM it lives in, read whenever the owner likes.
+ *
+ * The tape plays from its pulse stream (tape/tape_pulses.h), one segment at a time against the
+ * CPU's T-state clock, so any loader that times edges on port 0xFE loads. When the ROM's own
+ * LD-BYTES (0x0556) is called in the 48K BASIC ROM, the trap instead decodes the next block's
+ * data pulses and puts the bytes in memory directly, as the ROM would have, and the tape moves on
+ * to the block after it. Blocks with non-standard timings are left to the ROM to fail on, as
+ * they would on the real thing.
+ *
+ * RAM is the caller's: 3 banks for a 48K (5, 2 and 0: 0x4000, 0x8000, 0xC000), 8 for a 128K.
+ */
+
+enum SpectrumModel : uint8_t {
+    SPECTRUM_48K,
+    SPECTRUM_128K,
+};
+
+const uint16_t SPECTRUM_ROM_SIZE        = 16384;    // 128K: two, the 128 editor then 48 BASIC
+const uint16_t SPECTRUM_BANK_SIZE       = 16384;
+const uint32_t SPECTRUM_48K_FRAME_T     = 69888;
+const uint32_t SPECTRUM_128K_FRAME_T    = 70908;
+const uint16_t SPECTRUM_LD_BYTES        = 0x0556;   // Where the trap sits
+const uint16_t SPECTRUM_SCREEN_SIZE     = 6912;
+
+struct SpectrumTrap {
+    uint32_t count;             // Blocks loaded by the trap so far
+    uint16_t start;             // Where the last one went
+    uint16_t length;            // Bytes of it that went into memory
+};
+
+// Called after each block the trap loads (several can go in one frame)
+typedef void (*SpectrumTrapFn)(const SpectrumTrap &trap, void *ctx);
+
+struct Spectrum {
+    Z80 cpu;
+    SpectrumModel model;
+    const uint8_t *rom[2];
+    const uint8_t *basicRom;    // The ROM the trap works in, NULL if LD-BYTES isn't where it should be
+    uint8_t *ram;
+    uint8_t port7ffd;
+    uint8_t border;
+    uint8_t keys[8];            // Half-rows as port 0xFE reads them, bit clear = pressed
+    uint32_t frameT;
+    uint64_t clock;             // T-states of the frames before this one
+
+    // Tape
+    const TapePulseBuffer *tape;
+    TapePulseCursor cursor;
+    uint8_t ear;
+    uint64_t segmentEnd;        // Clock time the current tape segment ends
+    bool tapeEnded;
+    bool traps;
+    SpectrumTrap trapped;
+    SpectrumTrapFn onTrap;      // Optional, set after spectrum_init
+    void *onTrapCtx;
+};
+
+// rom is 16K for a 48K, 32K for a 128K. ram as above; it's cleared.
+void spectrum_init(Spectrum *s, SpectrumModel model, const uint8_t *rom, uint8_t *ram);
+
+// Starts the tape from its first block. The buffer has to stay valid while it plays.
+void spectrum_insert_tape(Spectrum *s, const TapePulseBuffer *tape, bool traps);
+
+// Key codes as input/macro.h numbers them (row * 5 + column)
+void spectrum_key(Spectrum *s, uint8_t key, bool pressed);
+
+// One 50 Hz frame: the interrupt, then instructions until the frame's T-states are used up
+void spectrum_run_frame(Spectrum *s);
+
+// The 6912 bytes of the screen the ULA is showing (128K: bank 5, or 7 if the shadow screen's on)
+const uint8_t *spectrum_screen(const Spectrum *s);
+
+uint64_t spectrum_tstates(const Spectrum *s);
+
+// True once the tape has played (or been trapped) to its end
+bool spectrum_tape_ended(Spectrum *s);
+
+#endif
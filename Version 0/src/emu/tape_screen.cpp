@@ -0,0 +1,168 @@
+#include "tape_screen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input/macro.h"
+#include "gfx/zx_screen.h"
+#include "storage/thumb_cache.h"            // thumb_from_screen
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>                  // Tape images are read into PSRAM on the device
+#endif
+
+static const char LOAD_48K[] =
+    "tap J\n"                               // LOAD
+    "type \"\\\"\\\"\"\n"
+    "tap ENTER\n";
+static const char LOAD_128K[] =
+    "tap ENTER\n";                          // Tape Loader, the first item on the menu
+
+static const uint32_t BOOT_FRAMES       = 150;      // The RAM test and the copyright message or menu
+static const size_t MACRO_CODE_MAX      = 64;
+static const uint16_t SCREEN_CELLS      = 768;
+
+static void *tape_screen_alloc(size_t size)
+{
+#ifdef ARDUINO
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+#else
+    return malloc(size);
+#endif
+}
+
+static void on_key(uint8_t key, bool pressed, uint32_t timeUs, void *ctx)
+{
+    spectrum_key((Spectrum *)ctx, key, pressed);
+}
+
+static void on_trap(const SpectrumTrap &trap, void *ctx)
+{
+    if (trap.start <= 0x4000 && trap.start + trap.length >= 0x4000 + ZX_SCREEN_BITMAP_SIZE)
+        *(bool *)ctx = true;
+}
+
+// Bytes that differ, counted up to just past limit
+static uint16_t changed_bytes(const uint8_t *a, const uint8_t *b, uint16_t limit)
+{
+    if (memcmp(a, b, ZX_SCREEN_SIZE) == 0)
+        return 0;
+    uint16_t n = 0;
+    for (int i = 0; i < ZX_SCREEN_SIZE && n <= limit; i++)
+        n += a[i] != b[i];
+    return n;
+}
+
+// Cells with ink on them, or coloured other than the commonest attribute (the background)
+static uint16_t used_cells(const uint8_t *screen)
+{
+    const uint8_t *attrs = screen + ZX_SCREEN_BITMAP_SIZE;
+    uint16_t count[256] = {0};
+    uint8_t common = attrs[0];
+    for (uint16_t i = 0; i < SCREEN_CELLS; i++) {
+        if (++count[attrs[i]] > count[common])
+            common = attrs[i];
+    }
+    uint16_t used = 0;
+    for (uint16_t cell = 0; cell < SCREEN_CELLS; cell++) {
+        uint8_t row = (uint8_t)(cell >> 5), col = cell & 31;
+        bool inked = attrs[cell] != common;
+        for (uint8_t line = 0; line < 8 && !inked; line++)
+            inked = screen[(row & 0x18) << 8 | line << 8 | (row & 7) << 5 | col] != 0;
+        used += inked;
+    }
+    return used;
+}
+
+bool tape_screen_capture(const TapeScreenConfig &config, const uint8_t *image, size_t len, uint8_t *screen,
+                         TapeScreenStats *stats)
+{
+    TapeScreenStats st;
+    memset(&st, 0, sizeof(st));
+    TapePulseBuffer tape;
+    tape_pulses_init(&tape);
+    uint8_t code[MACRO_CODE_MAX];
+    MacroError err;
+    size_t codeLen = macro_compile(config.model == SPECTRUM_128K ? LOAD_128K : LOAD_48K, code, sizeof(code), &err);
+    if (tape_build_pulses(image, len, &tape) != TAPE_OK || tape.blockCount == 0 || codeLen == 0) {
+        tape_pulses_free(&tape);
+        if (stats)
+            *stats = st;
+        return false;
+    }
+
+    Spectrum s;
+    spectrum_init(&s, config.model, config.rom, config.ram);
+    bool screenLoaded = false;
+    s.onTrap = on_trap;
+    s.onTrapCtx = &screenLoaded;
+    MacroVM vm;
+    macro_vm_init(&vm, code, codeLen, on_key, &s);
+    bool typing = true;
+    uint64_t typingFrom = 0;
+    uint32_t nextUs = 0, stable = 0;
+    memset(screen, 0, ZX_SCREEN_SIZE);          // What the screen is being compared with
+
+    while (st.end == TAPE_SCREEN_NONE && st.frames < config.maxFrames) {
+        if (st.frames == BOOT_FRAMES) {
+            // PLAY as the typing starts: it's over well inside even a data block's pilot
+            spectrum_insert_tape(&s, &tape, config.traps);
+            typingFrom = spectrum_tstates(&s);
+        }
+        if (typing && st.frames >= BOOT_FRAMES) {
+            uint32_t nowUs = (uint32_t)((spectrum_tstates(&s) - typingFrom) * 2 / 7);     // 3.5 MHz
+            while (typing && nowUs >= nextUs)
+                typing = macro_vm_step(&vm, &nextUs);
+        }
+        spectrum_run_frame(&s);
+        st.frames++;
+        const uint8_t *shown = spectrum_screen(&s);
+        if (typing)
+            continue;
+
+        if (screenLoaded) {
+            st.end = TAPE_SCREEN_LOADED;
+            break;
+        }
+        if (changed_bytes(shown, screen, TAPE_SCREEN_STABLE_BYTES) > TAPE_SCREEN_STABLE_BYTES) {
+            memcpy(screen, shown, ZX_SCREEN_SIZE);
+            stable = 0;
+            continue;
+        }
+        if (++stable < TAPE_SCREEN_STABLE_FRAMES)
+            continue;
+        uint16_t used = used_cells(shown);
+        if (used >= TAPE_SCREEN_MIN_CELLS)
+            st.end = TAPE_SCREEN_SETTLED;
+        else if (used > 0 && spectrum_tape_ended(&s))
+            st.end = TAPE_SCREEN_TAPE_END;
+    }
+
+    memcpy(screen, spectrum_screen(&s), ZX_SCREEN_SIZE);
+    st.tstates = spectrum_tstates(&s);
+    st.trapped = s.trapped.count;
+    tape_pulses_free(&tape);
+    if (stats)
+        *stats = st;
+    return st.end != TAPE_SCREEN_NONE;
+}
+
+bool tape_screen_thumb(const char *path, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx)
+{
+    const TapeScreenConfig &config = *(const TapeScreenConfig *)ctx;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = size > 0 ? (uint8_t *)tape_screen_alloc((size_t)size) : NULL;
+    uint8_t *screen = (uint8_t *)malloc(ZX_SCREEN_SIZE);
+    bool ok = image && screen && fread(image, 1, (size_t)size, f) == (size_t)size &&
+              tape_screen_capture(config, image, (size_t)size, screen, NULL);
+    fclose(f);
+    if (ok)
+        thumb_from_screen(screen, pixels, w, h);
+    free(image);
+    free(screen);
+    return ok;
+}
@@ -0,0 +1,68 @@
+#ifndef TAPE_SCREEN_H
+#define TAPE_SCREEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "spectrum.h"
+
+/*
+ * Loading screens of tapes, by running them
+ *
+ * Plenty of TAP/TZX files have no SCREEN$ block to lift out (the picture comes in through a
+ * custom loader, or is part of a bigger block), so the preview comes from loading the tape on an
+ * emulated Spectrum: boot the ROM, type LOAD "" (48K) or pick the Tape Loader (128K) with the
+ * keyboard macro VM (input/macro.h) on the emulated clock, and run frames flat out with no pacing.
+ * The tape starts as the typing does, 3 s in; even a headerless block's pilot outlasts the typing.
+ *
+ * The screen is taken when one of these happens first:
+ *   - the ROM trap loads a block that covers the bitmap: that's a LOAD ""SCREEN$, finished
+ *   - the screen has settled: for 1.5 s fewer than 64 bytes of it changed (a loader's counter can
+ *     keep ticking) and at least an eighth of its cells have something in them, so a "Program:"
+ *     line waiting for the next block doesn't count
+ *   - the tape has run out and the screen is settled anyway
+ * Nothing is judged until the macro has finished typing, so the 128K menu isn't taken for a
+ * picture. A tape that gets to none of these in maxFrames has no preview.
+ *
+ * No Arduino dependencies: tools/emu_bench.cpp runs captures on Linux.
+ */
+
+const uint32_t TAPE_SCREEN_MAX_FRAMES   = 9000;     // 3 minutes of tape
+const uint32_t TAPE_SCREEN_STABLE_FRAMES = 75;
+const uint16_t TAPE_SCREEN_STABLE_BYTES = 64;
+const uint16_t TAPE_SCREEN_MIN_CELLS    = 96;       // Of 768
+
+enum TapeScreenEnd : uint8_t {
+    TAPE_SCREEN_NONE,           // Ran out of frames, or the tape isn't one
+    TAPE_SCREEN_LOADED,         // The trap loaded it
+    TAPE_SCREEN_SETTLED,
+    TAPE_SCREEN_TAPE_END,
+};
+
+struct TapeScreenConfig {
+    SpectrumModel model;
+    const uint8_t *rom;         // 16K, 32K for the 128K
+    uint8_t *ram;               // 48K or 128K, used as the machine's RAM
+    bool traps;
+    uint32_t maxFrames;
+};
+
+struct TapeScreenStats {
+    TapeScreenEnd end;
+    uint32_t frames;
+    uint64_t tstates;
+    uint32_t trapped;           // Blocks the ROM trap loaded
+};
+
+// Loads a TAP or TZX image and copies its loading screen (6912 bytes) to screen. False if it
+// didn't come to one.
+bool tape_screen_capture(const TapeScreenConfig &config, const uint8_t *image, size_t len, uint8_t *screen,
+                         TapeScreenStats *stats);
+
+// ThumbGenerator for tapes (storage/thumb_cache.h); ctx is a TapeScreenConfig
+bool tape_screen_thumb(const char *path, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx);
+
+// "tapescr [128] <path>": captures a tape on the SD card, shows the screen and reports the
+// emulated clock rate. Device: emu/tape_screen_service.cpp; host: hal/tape_screen_host.cpp.
+void tape_screen_command(const char *args, void *ctx);
+
+#endif
@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tape_screen.h"
+#include "config.h"
+#include "gfx/zx_screen.h"
+#include "storage/serial_xfer.h"            // XFER_ROOT, where the card is mounted
+
+// The ROMs aren't in the firmware: they go on the card ("xfer" them there, or copy them over)
+static const char ROM_48K[]     = "/roms/48.rom";
+static const char ROM_128K[]    = "/roms/128.rom";   // 128 editor then 48 BASIC, 32K
+
+static uint8_t *load(const char *path, size_t *len, uint32_t caps)
+{
+    char full[128];
+    snprintf(full, sizeof(full), "%s%s", XFER_ROOT, path);
+    FILE *f = fopen(full, "rb");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = size > 0 ? (uint8_t *)heap_caps_malloc((size_t)size, caps) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return data;
+}
+
+static const char *end_name(TapeScreenEnd end)
+{
+    switch (end) {
+    case TAPE_SCREEN_LOADED:    return "loaded";
+    case TAPE_SCREEN_SETTLED:   return "settled";
+    case TAPE_SCREEN_TAPE_END:  return "tape end";
+    default:                    return "none";
+    }
+}
+
+void tape_screen_command(const char *args, void *ctx)
+{
+    bool is128 = strncmp(args, "128 ", 4) == 0;
+    const char *path = is128 ? args + 4 : args;
+    if (*path != '/') {
+        Serial.println("tapescr: [128] /path/on/card.tap");
+        return;
+    }
+
+    // The ROM and RAM are read all the time, so internal RAM if it fits; the tape is only read by
+    // the trap and at each edge, so PSRAM
+    TapeScreenConfig config = {is128 ? SPECTRUM_128K : SPECTRUM_48K, NULL, NULL, true, TAPE_SCREEN_MAX_FRAMES};
+    size_t romLen = 0, tapeLen = 0, ramLen = (size_t)(is128 ? 8 : 3) * SPECTRUM_BANK_SIZE;
+    uint8_t *rom = load(is128 ? ROM_128K : ROM_48K, &romLen, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *ram = (uint8_t *)heap_caps_malloc(ramLen, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (ram == NULL)
+        ram = (uint8_t *)heap_caps_malloc(ramLen, MALLOC_CAP_SPIRAM);
+    uint8_t *tape = load(path, &tapeLen, MALLOC_CAP_SPIRAM);
+    uint8_t *screen = (uint8_t *)malloc(ZX_SCREEN_SIZE);
+    if (rom == NULL || romLen != (size_t)(is128 ? 2 : 1) * SPECTRUM_ROM_SIZE) {
+        Serial.printf("tapescr: no ROM at %s%s\n", XFER_ROOT, is128 ? ROM_128K : ROM_48K);
+    } else if (tape == NULL) {
+        Serial.printf("tapescr: can't read %s%s\n", XFER_ROOT, path);
+    } else if (ram == NULL || screen == NULL) {
+        Serial.println("tapescr: no memory");
+    } else {
+        config.rom = rom;
+        config.ram = ram;
+        TapeScreenStats stats;
+        uint32_t start = micros();
+        bool ok = tape_screen_capture(config, tape, tapeLen, screen, &stats);
+        uint32_t us = micros() - start;
+        Serial.printf("tapescr: %s after %u frames, %u blocks trapped, %llu T-states in %u ms, %.2f MHz emulated\n",
+                      end_name(stats.end), (unsigned)stats.frames, (unsigned)stats.trapped,
+                      (unsigned long long)stats.tstates, (unsigned)(us / 1000),
+                      us ? (double)stats.tstates / us : 0.0);
+        if (ok) {
+            ZxScreenView view = zx_screen_view_fit(LCD_WIDTH, LCD_HEIGHT);
+            zx_screen_draw(screen, view, false, (LCD_WIDTH - view.dstW) / 2, (LCD_HEIGHT - view.dstH) / 2);
+        }
+    }
+    free(rom);
+    free(ram);
+    free(tape);
+    free(screen);
+}
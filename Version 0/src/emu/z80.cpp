@@ -0,0 +1,753 @@
+#include "z80.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>               // The interpreter loop runs from IRAM, clear of flash cache misses
+#else
+#define IRAM_ATTR
+#endif
+
+/*
+ * Flags come from lookup tables in the usual way: sign, zero and bits 3/5 of a result (with parity
+ * for the logical ops), and half carry and overflow for add/subtract from bits 3 and 7 of the two
+ * operands and the result.
+ */
+
+static const uint8_t FC = Z80_FLAG_C, FN = Z80_FLAG_N, FPV = Z80_FLAG_PV, F3 = Z80_FLAG_3;
+static const uint8_t FH = Z80_FLAG_H, F5 = Z80_FLAG_5, FZ = Z80_FLAG_Z, FS = Z80_FLAG_S;
+
+static const uint8_t HALFCARRY_ADD[8] = {0, FH, FH, FH, 0, 0, 0, FH};
+static const uint8_t HALFCARRY_SUB[8] = {0, 0, FH, 0, FH, 0, FH, FH};
+static const uint8_t OVERFLOW_ADD[8]  = {0, 0, 0, FPV, FPV, 0, 0, 0};
+static const uint8_t OVERFLOW_SUB[8]  = {0, FPV, 0, 0, 0, 0, FPV, 0};
+
+static uint8_t sz53[256], sz53p[256], parity[256];
+
+// Offsets of the 8-bit registers in operand order (B C D E H L (HL) A), with H and L standing for
+// IXh/IXl or IYh/IYl under a DD or FD prefix
+#define REG_OFFSETS(xy) {offsetof(Z80, bc) + 1, offsetof(Z80, bc), offsetof(Z80, de) + 1, offsetof(Z80, de), \
+                         offsetof(Z80, xy) + 1, offsetof(Z80, xy), 0, offsetof(Z80, af) + 1}
+static const uint8_t REG_OFFSET[3][8] = {REG_OFFSETS(hl), REG_OFFSETS(ix), REG_OFFSETS(iy)};
+
+#define A       z->af.b.h
+#define F       z->af.b.l
+#define B       z->bc.b.h
+#define C       z->bc.b.l
+#define D       z->de.b.h
+#define E       z->de.b.l
+#define H       z->hl.b.h
+#define L       z->hl.b.l
+#define AF      z->af.w
+#define BC      z->bc.w
+#define DE      z->de.w
+#define HL      z->hl.w
+#define SP      z->sp
+#define PC      z->pc
+
+// HL, IX or IY as the prefix says
+#define XY      (X == 0 ? z->hl : X == 1 ? z->ix : z->iy)
+
+static inline uint8_t &reg(Z80 *z, uint8_t x, uint8_t index)
+{
+    return ((uint8_t *)z)[REG_OFFSET[x][index]];
+}
+
+static inline uint8_t rd(const Z80 *z, uint16_t addr)
+{
+    return z->page[addr >> 14][addr & 0x3FFF];
+}
+
+static inline void wr(Z80 *z, uint16_t addr, uint8_t v)
+{
+    if (addr >= 0x4000)
+        z->page[addr >> 14][addr & 0x3FFF] = v;
+}
+
+static inline uint16_t rd16(const Z80 *z, uint16_t addr)
+{
+    return (uint16_t)(rd(z, addr) | rd(z, (uint16_t)(addr + 1)) << 8);
+}
+
+static inline void wr16(Z80 *z, uint16_t addr, uint16_t v)
+{
+    wr(z, addr, (uint8_t)v);
+    wr(z, (uint16_t)(addr + 1), (uint8_t)(v >> 8));
+}
+
+static inline uint8_t fetch(Z80 *z)
+{
+    return rd(z, PC++);
+}
+
+static inline uint16_t fetch16(Z80 *z)
+{
+    uint16_t v = rd16(z, PC);
+    PC += 2;
+    return v;
+}
+
+static inline void push(Z80 *z, uint16_t v)
+{
+    SP -= 2;
+    wr16(z, SP, v);
+}
+
+static inline uint16_t pop(Z80 *z)
+{
+    uint16_t v = rd16(z, SP);
+    SP += 2;
+    return v;
+}
+
+// NZ Z NC C PO PE P M
+static inline bool condition(const Z80 *z, uint8_t cc)
+{
+    static const uint8_t FLAG[4] = {FZ, FC, FPV, FS};
+    return ((F & FLAG[cc >> 1]) != 0) == (cc & 1);
+}
+
+// ADD ADC SUB SBC AND XOR OR CP
+static inline void alu(Z80 *z, uint8_t op, uint8_t v)
+{
+    uint16_t r;
+    uint8_t k;
+    switch (op) {
+    case 0:
+    case 1:
+        r = (uint16_t)(A + v + (op == 1 ? (F & FC) : 0));
+        k = (uint8_t)(((A & 0x88) >> 3) | ((v & 0x88) >> 2) | ((r & 0x88) >> 1));
+        A = (uint8_t)r;
+        F = (uint8_t)((r & 0x100 ? FC : 0) | HALFCARRY_ADD[k & 7] | OVERFLOW_ADD[k >> 4] | sz53[A]);
+        break;
+    case 2:
+    case 3:
+        r = (uint16_t)(A - v - (op == 3 ? (F & FC) : 0));
+        k = (uint8_t)(((A & 0x88) >> 3) | ((v & 0x88) >> 2) | ((r & 0x88) >> 1));
+        A = (uint8_t)r;
+        F = (uint8_t)((r & 0x100 ? FC : 0) | FN | HALFCARRY_SUB[k & 7] | OVERFLOW_SUB[k >> 4] | sz53[A]);
+        break;
+    case 4:
+        A &= v;
+        F = FH | sz53p[A];
+        break;
+    case 5:
+        A ^= v;
+        F = sz53p[A];
+        break;
+    case 6:
+        A |= v;
+        F = sz53p[A];
+        break;
+    default:
+        r = (uint16_t)(A - v);
+        k = (uint8_t)(((A & 0x88) >> 3) | ((v & 0x88) >> 2) | ((r & 0x88) >> 1));
+        F = (uint8_t)((r & 0x100 ? FC : (r ? 0 : FZ)) | FN | HALFCARRY_SUB[k & 7] | OVERFLOW_SUB[k >> 4] |
+                      (v & (F3 | F5)) | (r & FS));
+        break;
+    }
+}
+
+static inline uint8_t inc8(Z80 *z, uint8_t v)
+{
+    v++;
+    F = (uint8_t)((F & FC) | (v == 0x80 ? FPV : 0) | (v & 0x0F ? 0 : FH) | sz53[v]);
+    return v;
+}
+
+static inline uint8_t dec8(Z80 *z, uint8_t v)
+{
+    F = (uint8_t)((F & FC) | (v & 0x0F ? 0 : FH) | FN);
+    v--;
+    F |= (uint8_t)((v == 0x7F ? FPV : 0) | sz53[v]);
+    return v;
+}
+
+static inline uint16_t add16(Z80 *z, uint16_t a, uint16_t b)
+{
+    uint32_t r = (uint32_t)a + b;
+    uint8_t k = (uint8_t)(((a & 0x0800) >> 11) | ((b & 0x0800) >> 10) | ((r & 0x0800) >> 9));
+    F = (uint8_t)((F & (FPV | FZ | FS)) | (r & 0x10000 ? FC : 0) | ((r >> 8) & (F3 | F5)) | HALFCARRY_ADD[k]);
+    return (uint16_t)r;
+}
+
+static inline void adc16(Z80 *z, uint16_t v)
+{
+    uint32_t r = (uint32_t)HL + v + (F & FC);
+    uint8_t k = (uint8_t)(((HL & 0x8800) >> 11) | ((v & 0x8800) >> 10) | ((r & 0x8800) >> 9));
+    HL = (uint16_t)r;
+    F = (uint8_t)((r & 0x10000 ? FC : 0) | OVERFLOW_ADD[k >> 4] | (H & (F3 | F5 | FS)) | HALFCARRY_ADD[k & 7] |
+                  (HL ? 0 : FZ));
+}
+
+static inline void sbc16(Z80 *z, uint16_t v)
+{
+    uint32_t r = (uint32_t)HL - v - (F & FC);
+    uint8_t k = (uint8_t)(((HL & 0x8800) >> 11) | ((v & 0x8800) >> 10) | ((r & 0x8800) >> 9));
+    HL = (uint16_t)r;
+    F = (uint8_t)((r & 0x10000 ? FC : 0) | FN | OVERFLOW_SUB[k >> 4] | (H & (F3 | F5 | FS)) |
+                  HALFCARRY_SUB[k & 7] | (HL ? 0 : FZ));
+}
+
+// CB group: rotates and shifts, BIT, RES, SET. flags35 is what BIT shows in bits 3 and 5.
+static inline uint8_t cb_op(Z80 *z, uint8_t op, uint8_t v, uint8_t flags35)
+{
+    uint8_t bit = (op >> 3) & 7, c;
+    switch (op >> 6) {
+    case 0:
+        switch (bit) {
+        case 0: c = v >> 7; v = (uint8_t)(v << 1 | c); break;                  // RLC
+        case 1: c = v & 1; v = (uint8_t)(v >> 1 | c << 7); break;              // RRC
+        case 2: c = v >> 7; v = (uint8_t)(v << 1 | (F & FC)); break;           // RL
+        case 3: c = v & 1; v = (uint8_t)(v >> 1 | (F & FC) << 7); break;       // RR
+        case 4: c = v >> 7; v = (uint8_t)(v << 1); break;                      // SLA
+        case 5: c = v & 1; v = (uint8_t)((v & 0x80) | v >> 1); break;          // SRA
+        case 6: c = v >> 7; v = (uint8_t)(v << 1 | 1); break;                  // SLL
+        default: c = v & 1; v = (uint8_t)(v >> 1); break;                      // SRL
+        }
+        F = (uint8_t)(c | sz53p[v]);
+        return v;
+    case 1:
+        F = (uint8_t)((F & FC) | FH | (flags35 & (F3 | F5)));
+        if (!(v & (1 << bit)))
+            F |= FPV | FZ;
+        else if (bit == 7)
+            F |= FS;
+        return v;
+    case 2:
+        return (uint8_t)(v & ~(1 << bit));
+    default:
+        return (uint8_t)(v | (1 << bit));
+    }
+}
+
+static void exec_cb(Z80 *z)
+{
+    uint8_t op = fetch(z);
+    z->r++;
+    z->t += 4;
+    uint8_t index = op & 7;
+    if (index != 6) {
+        uint8_t &r = reg(z, 0, index);
+        r = cb_op(z, op, r, r);
+        return;
+    }
+    uint8_t v = cb_op(z, op, rd(z, HL), H);
+    if ((op >> 6) == 1) {
+        z->t += 4;                              // BIT n,(HL): 12
+    } else {
+        wr(z, HL, v);
+        z->t += 7;                              // 15
+    }
+}
+
+// DDCB d op / FDCB d op: always on (IX+d), the result also copied into a register if one is named
+static void exec_xy_cb(Z80 *z, uint16_t xy)
+{
+    uint16_t addr = (uint16_t)(xy + (int8_t)fetch(z));
+    uint8_t op = fetch(z);                      // Not an opcode fetch: R doesn't count it
+    uint8_t v = cb_op(z, op, rd(z, addr), (uint8_t)(addr >> 8));
+    if ((op >> 6) == 1) {
+        z->t += 12;                             // 20
+        return;
+    }
+    wr(z, addr, v);
+    if ((op & 7) != 6)
+        reg(z, 0, op & 7) = v;
+    z->t += 15;                                 // 23
+}
+
+static void exec_ed(Z80 *z)
+{
+    static const uint8_t IM_MODE[8] = {0, 0, 1, 2, 0, 0, 1, 2};
+    uint8_t op = fetch(z);
+    z->r++;
+    z->t += 4;
+    uint8_t y = (op >> 3) & 7;
+    uint16_t *pair[4] = {&BC, &DE, &HL, &SP};
+
+    if ((op & 0xC0) == 0x40) {
+        switch (op & 7) {
+        case 0: {                               // IN r,(C); IN F,(C) just sets the flags
+            uint8_t v = z->in(BC, z->ctx);
+            F = (uint8_t)((F & FC) | sz53p[v]);
+            if (y != 6)
+                reg(z, 0, y) = v;
+            z->t += 4;
+            return;
+        }
+        case 1:                                 // OUT (C),r; OUT (C),0
+            z->out(BC, y == 6 ? 0 : reg(z, 0, y), z->ctx);
+            z->t += 4;
+            return;
+        case 2:
+            if (y & 1)
+                adc16(z, *pair[y >> 1]);
+            else
+                sbc16(z, *pair[y >> 1]);
+            z->t += 7;
+            return;
+        case 3: {
+            uint16_t addr = fetch16(z);
+            if (y & 1)
+                *pair[y >> 1] = rd16(z, addr);
+            else
+                wr16(z, addr, *pair[y >> 1]);
+            z->t += 12;
+            return;
+        }
+        case 4: {                               // NEG
+            uint8_t v = A;
+            A = 0;
+            alu(z, 2, v);
+            return;
+        }
+        case 5:                                 // RETN, RETI
+            z->iff1 = z->iff2;
+            PC = pop(z);
+            z->t += 6;
+            return;
+        case 6:
+            z->im = IM_MODE[y];
+            return;
+        default:
+            break;
+        }
+        switch (y) {
+        case 0: z->i = A; z->t++; break;                                        // LD I,A
+        case 1: z->r = A; z->r7 = A & 0x80; z->t++; break;                     // LD R,A
+        case 2:                                                                 // LD A,I
+        case 3:                                                                 // LD A,R
+            A = y == 2 ? z->i : (uint8_t)((z->r & 0x7F) | z->r7);
+            F = (uint8_t)((F & FC) | sz53[A] | (z->iff2 ? FPV : 0));
+            z->t++;
+            break;
+        case 4: {                                                               // RRD
+            uint8_t v = rd(z, HL);
+            wr(z, HL, (uint8_t)(A << 4 | v >> 4));
+            A = (uint8_t)((A & 0xF0) | (v & 0x0F));
+            F = (uint8_t)((F & FC) | sz53p[A]);
+            z->t += 10;
+            break;
+        }
+        case 5: {                                                               // RLD
+            uint8_t v = rd(z, HL);
+            wr(z, HL, (uint8_t)(v << 4 | (A & 0x0F)));
+            A = (uint8_t)((A & 0xF0) | v >> 4);
+            F = (uint8_t)((F & FC) | sz53p[A]);
+            z->t += 10;
+            break;
+        }
+        default:
+            break;
+        }
+        return;
+    }
+
+    if ((op & 0xE4) != 0xA0)
+        return;                                 // Everything else is an 8 T-state NOP
+    // Block instructions: op bit 3 decrements instead, bit 4 repeats
+    int8_t step = op & 0x08 ? -1 : 1;
+    bool repeat = op & 0x10;
+    switch (op & 3) {
+    case 0: {                                   // LDI LDD LDIR LDDR
+        uint8_t v = rd(z, HL);
+        wr(z, DE, v);
+        HL += step;
+        DE += step;
+        BC--;
+        v += A;
+        F = (uint8_t)((F & (FC | FZ | FS)) | (BC ? FPV : 0) | (v & F3) | (v & 0x02 ? F5 : 0));
+        z->t += 8;
+        if (repeat && BC) {
+            PC -= 2;
+            z->t += 5;
+        }
+        break;
+    }
+    case 1: {                                   // CPI CPD CPIR CPDR
+        uint8_t v = rd(z, HL);
+        uint8_t r = (uint8_t)(A - v);
+        uint8_t k = (uint8_t)(((A & 0x08) >> 3) | ((v & 0x08) >> 2) | ((r & 0x08) >> 1));
+        HL += step;
+        BC--;
+        F = (uint8_t)((F & FC) | (BC ? FPV | FN : FN) | HALFCARRY_SUB[k] | (r ? 0 : FZ) | (r & FS));
+        if (F & FH)
+            r--;
+        F |= (uint8_t)((r & F3) | (r & 0x02 ? F5 : 0));
+        z->t += 8;
+        if (repeat && BC && !(F & FZ)) {
+            PC -= 2;
+            z->t += 5;
+        }
+        break;
+    }
+    case 2: {                                   // INI IND INIR INDR
+        uint8_t v = z->in(BC, z->ctx);
+        wr(z, HL, v);
+        B--;
+        HL += step;
+        uint8_t k = (uint8_t)(v + C + step);
+        F = (uint8_t)((v & 0x80 ? FN : 0) | (k < v ? FH | FC : 0) | parity[(k & 7) ^ B] | sz53[B]);
+        z->t += 8;
+        if (repeat && B) {
+            PC -= 2;
+            z->t += 5;
+        }
+        break;
+    }
+    default: {                                  // OUTI OUTD OTIR OTDR
+        uint8_t v = rd(z, HL);
+        B--;
+        HL += step;
+        z->out(BC, v, z->ctx);
+        uint8_t k = (uint8_t)(v + L);
+        F = (uint8_t)((v & 0x80 ? FN : 0) | (k < v ? FH | FC : 0) | parity[(k & 7) ^ B] | sz53[B]);
+        z->t += 8;
+        if (repeat && B) {
+            PC -= 2;
+            z->t += 5;
+        }
+        break;
+    }
+    }
+}
+
+// Address of the (HL) operand: (IX+d) under a prefix, which costs 8 more T-states
+template <int X>
+static inline uint16_t operand_addr(Z80 *z)
+{
+    if (X == 0)
+        return HL;
+    z->t += 8;
+    return (uint16_t)(XY.w + (int8_t)fetch(z));
+}
+
+// One instruction, its opcode already fetched. X: 0 unprefixed, 1 after DD, 2 after FD.
+template <int X>
+static void exec(Z80 *z, uint8_t op)
+{
+    switch (op) {
+    case 0x00: break;                                                           // NOP
+    case 0x02: wr(z, BC, A); z->t += 3; break;                                  // LD (BC),A
+    case 0x07:                                                                  // RLCA
+        A = (uint8_t)(A << 1 | A >> 7);
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (A & (FC | F3 | F5)));
+        break;
+    case 0x08: {                                                                // EX AF,AF'
+        uint16_t t = AF;
+        AF = z->af2.w;
+        z->af2.w = t;
+        break;
+    }
+    case 0x0A: A = rd(z, BC); z->t += 3; break;                                 // LD A,(BC)
+    case 0x0F:                                                                  // RRCA
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (A & FC));
+        A = (uint8_t)(A >> 1 | A << 7);
+        F |= A & (F3 | F5);
+        break;
+    case 0x10: {                                                                // DJNZ
+        int8_t d = (int8_t)fetch(z);
+        z->t += 4;
+        if (--B) {
+            PC += d;
+            z->t += 5;
+        }
+        break;
+    }
+    case 0x12: wr(z, DE, A); z->t += 3; break;                                  // LD (DE),A
+    case 0x17: {                                                                // RLA
+        uint8_t old = A;
+        A = (uint8_t)(A << 1 | (F & FC));
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (A & (F3 | F5)) | old >> 7);
+        break;
+    }
+    case 0x18: PC += (int8_t)fetch(z); z->t += 8; break;                        // JR
+    case 0x1A: A = rd(z, DE); z->t += 3; break;                                 // LD A,(DE)
+    case 0x1F: {                                                                // RRA
+        uint8_t old = A;
+        A = (uint8_t)(A >> 1 | F << 7);
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (A & (F3 | F5)) | (old & FC));
+        break;
+    }
+    case 0x20: case 0x28: case 0x30: case 0x38: {                               // JR cc
+        int8_t d = (int8_t)fetch(z);
+        z->t += 3;
+        if (condition(z, (op >> 3) & 3)) {
+            PC += d;
+            z->t += 5;
+        }
+        break;
+    }
+    case 0x22: wr16(z, fetch16(z), XY.w); z->t += 12; break;                    // LD (nn),HL
+    case 0x27: {                                                                // DAA
+        uint8_t add = 0, carry = F & FC;
+        if ((F & FH) || (A & 0x0F) > 9)
+            add = 6;
+        if (carry || A > 0x99)
+            add |= 0x60;
+        if (A > 0x99)
+            carry = FC;
+        alu(z, F & FN ? 2 : 0, add);
+        F = (uint8_t)((F & ~(FC | FPV)) | carry | parity[A]);
+        break;
+    }
+    case 0x2A: XY.w = rd16(z, fetch16(z)); z->t += 12; break;                   // LD HL,(nn)
+    case 0x2F:                                                                  // CPL
+        A ^= 0xFF;
+        F = (uint8_t)((F & (FC | FPV | FZ | FS)) | (A & (F3 | F5)) | FN | FH);
+        break;
+    case 0x32: wr(z, fetch16(z), A); z->t += 9; break;                          // LD (nn),A
+    case 0x34: {                                                                // INC (HL)
+        uint16_t addr = operand_addr<X>(z);
+        wr(z, addr, inc8(z, rd(z, addr)));
+        z->t += 7;
+        break;
+    }
+    case 0x35: {                                                                // DEC (HL)
+        uint16_t addr = operand_addr<X>(z);
+        wr(z, addr, dec8(z, rd(z, addr)));
+        z->t += 7;
+        break;
+    }
+    case 0x36: {                                                                // LD (HL),n
+        uint16_t addr = operand_addr<X>(z);
+        wr(z, addr, fetch(z));
+        z->t += X ? 3 : 6;
+        break;
+    }
+    case 0x37:                                                                  // SCF
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (A & (F3 | F5)) | FC);
+        break;
+    case 0x3A: A = rd(z, fetch16(z)); z->t += 9; break;                         // LD A,(nn)
+    case 0x3F:                                                                  // CCF
+        F = (uint8_t)((F & (FPV | FZ | FS)) | (F & FC ? FH : FC) | (A & (F3 | F5)));
+        break;
+    case 0x76: z->halted = true; break;                                         // HALT
+    case 0xC3: PC = fetch16(z); z->t += 6; break;                               // JP nn
+    case 0xC6: alu(z, 0, fetch(z)); z->t += 3; break;                           // ADD A,n
+    case 0xC9: PC = pop(z); z->t += 6; break;                                   // RET
+    case 0xCB:
+        if (X == 0)
+            exec_cb(z);
+        else
+            exec_xy_cb(z, XY.w);
+        break;
+    case 0xCD: {                                                                // CALL nn
+        uint16_t addr = fetch16(z);
+        push(z, PC);
+        PC = addr;
+        z->t += 13;
+        break;
+    }
+    case 0xCE: alu(z, 1, fetch(z)); z->t += 3; break;                           // ADC A,n
+    case 0xD3: z->out((uint16_t)(A << 8 | fetch(z)), A, z->ctx); z->t += 7; break;  // OUT (n),A
+    case 0xD6: alu(z, 2, fetch(z)); z->t += 3; break;                           // SUB n
+    case 0xD9: {                                                                // EXX
+        uint16_t t = BC; BC = z->bc2.w; z->bc2.w = t;
+        t = DE; DE = z->de2.w; z->de2.w = t;
+        t = HL; HL = z->hl2.w; z->hl2.w = t;
+        break;
+    }
+    case 0xDB: A = z->in((uint16_t)(A << 8 | fetch(z)), z->ctx); z->t += 7; break;  // IN A,(n)
+    case 0xDD: {
+        uint8_t next = fetch(z);
+        z->r++;
+        z->t += 4;
+        exec<1>(z, next);
+        break;
+    }
+    case 0xDE: alu(z, 3, fetch(z)); z->t += 3; break;                           // SBC A,n
+    case 0xE3: {                                                                // EX (SP),HL
+        uint16_t t = rd16(z, SP);
+        wr16(z, SP, XY.w);
+        XY.w = t;
+        z->t += 15;
+        break;
+    }
+    case 0xE6: alu(z, 4, fetch(z)); z->t += 3; break;                           // AND n
+    case 0xE9: PC = XY.w; break;                                                // JP (HL)
+    case 0xEB: {                                                                // EX DE,HL, never IX
+        uint16_t t = DE;
+        DE = HL;
+        HL = t;
+        break;
+    }
+    case 0xED: exec_ed(z); break;
+    case 0xEE: alu(z, 5, fetch(z)); z->t += 3; break;                           // XOR n
+    case 0xF3: z->iff1 = z->iff2 = 0; break;                                    // DI
+    case 0xF6: alu(z, 6, fetch(z)); z->t += 3; break;                           // OR n
+    case 0xF9: SP = XY.w; z->t += 2; break;                                     // LD SP,HL
+    case 0xFB: z->iff1 = z->iff2 = 1; z->afterEi = true; break;                 // EI
+    case 0xFD: {
+        uint8_t next = fetch(z);
+        z->r++;
+        z->t += 4;
+        exec<2>(z, next);
+        break;
+    }
+    case 0xFE: alu(z, 7, fetch(z)); z->t += 3; break;                           // CP n
+
+    default: {
+        uint8_t y = (op >> 3) & 7, x = op & 7, p = y >> 1;
+        uint16_t *pair[4] = {&BC, &DE, &XY.w, &SP};
+        switch (op >> 6) {
+        case 0:
+            switch (x) {
+            case 1:
+                if (y & 1) {                                                    // ADD HL,rr
+                    XY.w = add16(z, XY.w, *pair[p]);
+                    z->t += 7;
+                } else {                                                        // LD rr,nn
+                    *pair[p] = fetch16(z);
+                    z->t += 6;
+                }
+                break;
+            case 3:                                                             // INC rr, DEC rr
+                *pair[p] += y & 1 ? -1 : 1;
+                z->t += 2;
+                break;
+            case 4: reg(z, X, y) = inc8(z, reg(z, X, y)); break;                // INC r
+            case 5: reg(z, X, y) = dec8(z, reg(z, X, y)); break;                // DEC r
+            case 6: reg(z, X, y) = fetch(z); z->t += 3; break;                  // LD r,n
+            }
+            break;
+        case 1:                                                                 // LD r,r'
+            if (x == 6) {
+                uint16_t addr = operand_addr<X>(z);
+                reg(z, 0, y) = rd(z, addr);                                     // LD H,(IX+d) is still H
+                z->t += 3;
+            } else if (y == 6) {
+                uint16_t addr = operand_addr<X>(z);
+                wr(z, addr, reg(z, 0, x));
+                z->t += 3;
+            } else {
+                reg(z, X, y) = reg(z, X, x);
+            }
+            break;
+        case 2:                                                                 // ALU A,r
+            if (x == 6) {
+                alu(z, y, rd(z, operand_addr<X>(z)));
+                z->t += 3;
+            } else {
+                alu(z, y, reg(z, X, x));
+            }
+            break;
+        default:
+            switch (x) {
+            case 0:                                                             // RET cc
+                z->t++;
+                if (condition(z, y)) {
+                    PC = pop(z);
+                    z->t += 6;
+                }
+                break;
+            case 1:                                                             // POP rr
+                if (p == 3)
+                    AF = pop(z);
+                else
+                    *pair[p] = pop(z);
+                z->t += 6;
+                break;
+            case 2: {                                                           // JP cc,nn
+                uint16_t addr = fetch16(z);
+                if (condition(z, y))
+                    PC = addr;
+                z->t += 6;
+                break;
+            }
+            case 4: {                                                           // CALL cc,nn
+                uint16_t addr = fetch16(z);
+                z->t += 6;
+                if (condition(z, y)) {
+                    push(z, PC);
+                    PC = addr;
+                    z->t += 7;
+                }
+                break;
+            }
+            case 5:                                                             // PUSH rr
+                push(z, p == 3 ? AF : *pair[p]);
+                z->t += 7;
+                break;
+            case 7:                                                             // RST
+                push(z, PC);
+                PC = (uint16_t)(y * 8);
+                z->t += 7;
+                break;
+            }
+            break;
+        }
+        break;
+    }
+    }
+}
+
+static void build_tables()
+{
+    for (int i = 0; i < 256; i++) {
+        uint8_t bits = 0;
+        for (int b = 0; b < 8; b++)
+            bits += (i >> b) & 1;
+        parity[i] = bits & 1 ? 0 : FPV;
+        sz53[i] = (uint8_t)(i & (FS | F3 | F5)) | (i ? 0 : FZ);
+        sz53p[i] = sz53[i] | parity[i];
+    }
+}
+
+void z80_reset(Z80 *z)
+{
+    if (sz53[0] == 0)
+        build_tables();
+    z->af.w = z->sp = 0xFFFF;
+    z->bc.w = z->de.w = z->hl.w = 0;
+    z->af2.w = z->bc2.w = z->de2.w = z->hl2.w = 0;
+    z->ix.w = z->iy.w = 0;
+    z->pc = 0;
+    z->i = z->r = z->r7 = 0;
+    z->iff1 = z->iff2 = z->im = 0;
+    z->halted = z->afterEi = false;
+}
+
+void IRAM_ATTR z80_run(Z80 *z, uint32_t until)
+{
+    while (z->t < until) {
+        if (z->halted) {
+            // NOPs until the interrupt; R still counts them
+            uint32_t n = (until - z->t + 3) / 4;
+            z->t += n * 4;
+            z->r += (uint8_t)n;
+            return;
+        }
+        z->afterEi = false;
+        if (PC == z->trapPc && z->trap(z, z->ctx))
+            continue;
+        uint8_t op = fetch(z);
+        z->r++;
+        z->t += 4;
+        exec<0>(z, op);
+    }
+}
+
+bool z80_interrupt(Z80 *z)
+{
+    if (!z->iff1 || z->afterEi)
+        return false;
+    z->halted = false;
+    z->iff1 = z->iff2 = 0;
+    z->r++;
+    push(z, PC);
+    if (z->im == 2) {
+        PC = rd16(z, (uint16_t)(z->i << 8 | 0xFF));
+        z->t += 19;
+    } else {
+        PC = 0x0038;                            // IM 0 reads RST 38 off the idle bus, as IM 1 does
+        z->t += 13;
+    }
+    return true;
+}
+
+uint16_t z80_read16(const Z80 *z, uint16_t addr)
+{
+    return rd16(z, addr);
+}
@@ -0,0 +1,89 @@
+#ifndef Z80_H
+#define Z80_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Z80 interpreter
+ *
+ * Just enough of a CPU to run a tape through a Spectrum loader as fast as the host goes: every
+ * documented instruction with its flags, the undocumented ones loaders are known to use (IXh/IXl,
+ * SLL, the DDCB register copies, OUT (C),0), R counted per opcode fetch (Speedlock decrypts with
+ * it), IM 0/1/2 and HALT. Timings are the uncontended T-state counts; memory contention and
+ * MEMPTR aren't modelled, which only shifts edge timings by a few percent and a loader's
+ * thresholds are far wider than that.
+ *
+ * Memory is four 16K pages read straight through pointers; writes below 0x4000 are dropped (ROM),
+ * which is all paging needs for a 48K or 128K. Ports go to callbacks.
+ *
+ * The unprefixed, DD and FD opcodes share one switch, a template on the index register, so
+ * (IX+d) costs nothing extra to decode. One PC can be trapped: the trap runs instead of the
+ * instruction there (the ROM tape loader, see emu/spectrum.h).
+ *
+ * No Arduino dependencies: tools/emu_bench.cpp runs the same core on Linux.
+ */
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Z80 register pairs assume a little-endian host"
+#endif
+
+const uint8_t Z80_FLAG_C    = 0x01;
+const uint8_t Z80_FLAG_N    = 0x02;
+const uint8_t Z80_FLAG_PV   = 0x04;
+const uint8_t Z80_FLAG_3    = 0x08;
+const uint8_t Z80_FLAG_H    = 0x10;
+const uint8_t Z80_FLAG_5    = 0x20;
+const uint8_t Z80_FLAG_Z    = 0x40;
+const uint8_t Z80_FLAG_S    = 0x80;
+
+union Z80Pair {
+    uint16_t w;
+    struct {
+        uint8_t l, h;
+    } b;
+};
+
+struct Z80;
+
+typedef uint8_t (*Z80InFn)(uint16_t port, void *ctx);
+typedef void (*Z80OutFn)(uint16_t port, uint8_t value, void *ctx);
+
+// Runs in place of the instruction at the trapped PC. False to run the instruction after all.
+typedef bool (*Z80TrapFn)(Z80 *z, void *ctx);
+
+struct Z80 {
+    Z80Pair af, bc, de, hl;
+    Z80Pair af2, bc2, de2, hl2;
+    Z80Pair ix, iy;
+    uint16_t sp, pc;
+    uint8_t i;
+    uint8_t r;                  // Low 7 bits count fetches; bit 7 is r7's
+    uint8_t r7;
+    uint8_t iff1, iff2, im;
+    bool halted;
+    bool afterEi;               // No interrupt straight after EI
+
+    uint32_t t;                 // T-states, counted from wherever the owner last set it
+
+    uint8_t *page[4];           // 0x0000, 0x4000, 0x8000, 0xC000
+    Z80InFn in;
+    Z80OutFn out;
+    void *ctx;
+    uint32_t trapPc;            // > 0xFFFF: no trap
+    Z80TrapFn trap;
+};
+
+// Power-on state. Pages, ports and the trap are left as they are.
+void z80_reset(Z80 *z);
+
+// Runs whole instructions while t is below until, so it ends up to one instruction past it. A
+// halted CPU skips straight there.
+void z80_run(Z80 *z, uint32_t until);
+
+// Takes a maskable interrupt if it's enabled, with 0xFF on the data bus. False if not taken.
+bool z80_interrupt(Z80 *z);
+
+uint16_t z80_read16(const Z80 *z, uint16_t addr);
+
+#endif
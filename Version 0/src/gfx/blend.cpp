@@ -0,0 +1,142 @@
+#include "blend.h"
+
+// Channel groups with five spare bits above each channel. GROUP_A is green of the high pixel with
+// red and blue of the low one; GROUP_B (taken after a shift right by 5) is the other three.
+static const uint32_t GROUP_A = 0x07E0F81F;
+static const uint32_t GROUP_B = 0x07C0F83F;
+
+// Mask nibble to alpha, rounded: 15 * BLEND_ALPHA_MAX / 15 exactly at the top
+static const uint8_t MASK_ALPHA[16] = {0, 2, 4, 6, 9, 11, 13, 15, 17, 19, 21, 23, 26, 28, 30, 32};
+
+static inline uint16_t swap16(uint16_t p)
+{
+    return (uint16_t)(p >> 8 | p << 8);
+}
+
+// Byte swap of both pixels in a word
+static inline uint32_t swap_pair(uint32_t w)
+{
+    return ((w >> 8) & 0x00FF00FF) | ((w & 0x00FF00FF) << 8);
+}
+
+// One pixel: green in the high half, red and blue in the low half
+static inline uint16_t mix_one(uint16_t a, uint16_t b, uint32_t alpha)
+{
+    uint32_t x = swap16(a), y = swap16(b);
+    x = (x | x << 16) & GROUP_A;
+    y = (y | y << 16) & GROUP_A;
+    uint32_t r = ((x * alpha + y * (BLEND_ALPHA_MAX - alpha)) >> 5) & GROUP_A;
+    return swap16((uint16_t)(r | r >> 16));
+}
+
+static inline uint32_t mix_pair(uint32_t a, uint32_t b, uint32_t alpha, uint32_t beta)
+{
+    a = swap_pair(a);
+    b = swap_pair(b);
+    uint32_t ra = (((a & GROUP_A) * alpha + (b & GROUP_A) * beta) >> 5) & GROUP_A;
+    uint32_t rb = ((((a >> 5) & GROUP_B) * alpha + ((b >> 5) & GROUP_B) * beta) >> 5) & GROUP_B;
+    return swap_pair(ra | rb << 5);
+}
+
+// True if the word path can be used, after at most one leading pixel
+static inline bool same_alignment(const void *p, const void *q)
+{
+    return (((uintptr_t)p ^ (uintptr_t)q) & 3) == 0;
+}
+
+uint8_t blend_mask_alpha(uint8_t m)
+{
+    return MASK_ALPHA[m & 15];
+}
+
+void blend_mix(uint16_t *dst, const uint16_t *a, const uint16_t *b, size_t n, uint8_t alpha)
+{
+    if (alpha > BLEND_ALPHA_MAX)
+        alpha = BLEND_ALPHA_MAX;
+    uint32_t beta = BLEND_ALPHA_MAX - alpha;
+
+    if (!same_alignment(dst, a) || !same_alignment(dst, b)) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = mix_one(a[i], b[i], alpha);
+        return;
+    }
+    if (n && ((uintptr_t)dst & 3)) {
+        *dst++ = mix_one(*a++, *b++, alpha);
+        n--;
+    }
+
+    uint32_t *d = (uint32_t *)dst;
+    const uint32_t *wa = (const uint32_t *)a, *wb = (const uint32_t *)b;
+    for (size_t i = 0; i < n / 2; i++)
+        d[i] = mix_pair(wa[i], wb[i], alpha, beta);
+    if (n & 1)
+        dst[n - 1] = mix_one(a[n - 1], b[n - 1], alpha);
+}
+
+void blend_fill(uint16_t *dst, size_t n, uint16_t colour, uint8_t alpha)
+{
+    if (alpha > BLEND_ALPHA_MAX)
+        alpha = BLEND_ALPHA_MAX;
+    uint32_t beta = BLEND_ALPHA_MAX - alpha;
+
+    if (n && ((uintptr_t)dst & 3)) {
+        *dst = mix_one(colour, *dst, alpha);
+        dst++;
+        n--;
+    }
+
+    // The colour's share is the same for every word, so it's worked out once
+    uint32_t c = swap_pair((uint32_t)colour | (uint32_t)colour << 16);
+    uint32_t ka = (c & GROUP_A) * alpha;
+    uint32_t kb = ((c >> 5) & GROUP_B) * alpha;
+    uint32_t *d = (uint32_t *)dst;
+    for (size_t i = 0; i < n / 2; i++) {
+        uint32_t w = swap_pair(d[i]);
+        uint32_t ra = (((w & GROUP_A) * beta + ka) >> 5) & GROUP_A;
+        uint32_t rb = ((((w >> 5) & GROUP_B) * beta + kb) >> 5) & GROUP_B;
+        d[i] = swap_pair(ra | rb << 5);
+    }
+    if (n & 1)
+        dst[n - 1] = mix_one(colour, dst[n - 1], alpha);
+}
+
+void blend_mask4(uint16_t *dst, const uint16_t *src, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        uint8_t m = mask[i / 2];
+        if (m == 0x00)
+            continue;                   // Both clear
+        if (m == 0xFF) {
+            dst[i] = src[i];            // Both opaque
+            dst[i + 1] = src[i + 1];
+            continue;
+        }
+        dst[i] = mix_one(src[i], dst[i], MASK_ALPHA[m & 15]);
+        dst[i + 1] = mix_one(src[i + 1], dst[i + 1], MASK_ALPHA[m >> 4]);
+    }
+    if (n & 1)
+        dst[n - 1] = mix_one(src[n - 1], dst[n - 1], MASK_ALPHA[mask[n / 2] & 15]);
+}
+
+static uint16_t mix_scalar(uint16_t a, uint16_t b, uint32_t alpha)
+{
+    a = swap16(a);
+    b = swap16(b);
+    uint32_t beta = BLEND_ALPHA_MAX - alpha;
+    uint32_t r = ((a >> 11) * alpha + (b >> 11) * beta) >> 5;
+    uint32_t g = (((a >> 5) & 0x3F) * alpha + ((b >> 5) & 0x3F) * beta) >> 5;
+    uint32_t bl = ((a & 0x1F) * alpha + (b & 0x1F) * beta) >> 5;
+    return swap16((uint16_t)(r << 11 | g << 5 | bl));
+}
+
+void blend_mix_scalar(uint16_t *dst, const uint16_t *a, const uint16_t *b, size_t n, uint8_t alpha)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = mix_scalar(a[i], b[i], alpha);
+}
+
+void blend_mask4_scalar(uint16_t *dst, const uint16_t *src, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = mix_scalar(src[i], dst[i], MASK_ALPHA[(mask[i / 2] >> (i & 1) * 4) & 15]);
+}
@@ -0,0 +1,45 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * RGB565 blending
+ *
+ * Pixels are in panel byte order (big-endian), as sprites with swap bytes set and the SCREEN$
+ * decoder produce them. Alpha runs 0..BLEND_ALPHA_MAX, the amount of the first image.
+ *
+ * The kernels are SWAR: a 32-bit word holds two pixels, and its channels are split into two groups
+ * (green of one pixel with red and blue of the other, and the reverse) that each leave five spare
+ * bits above every channel. One multiply then scales three channels at once without carries
+ * crossing between them, so two pixels cost four multiplies instead of twelve, with no per-channel
+ * unpacking. Results are exact: every channel is floor((a * alpha + b * (32 - alpha)) / 32).
+ *
+ * Per-pixel masks can't share a multiply between pixels, so they use the one-pixel form of the
+ * same trick (channels spread over a word, two multiplies a pixel), and skip mask bytes that are
+ * fully clear or fully set.
+ *
+ * Buffers need the same alignment (word-aligned or all off by one pixel) for the word path;
+ * otherwise everything goes a pixel at a time.
+ */
+
+const uint8_t BLEND_ALPHA_MAX = 32;
+
+// dst = a * alpha + b * (32 - alpha). dst may be a or b (constant alpha over, crossfade).
+void blend_mix(uint16_t *dst, const uint16_t *a, const uint16_t *b, size_t n, uint8_t alpha);
+
+// dst = colour * alpha + dst * (32 - alpha), colour in panel byte order (fades to and from a colour)
+void blend_fill(uint16_t *dst, size_t n, uint16_t colour, uint8_t alpha);
+
+// dst = src over dst with a 4-bit alpha per pixel, two per mask byte, even pixels in the low nibble
+void blend_mask4(uint16_t *dst, const uint16_t *src, const uint8_t *mask, size_t n);
+
+// Reference versions, a channel at a time, for checking and benchmarking the kernels
+void blend_mix_scalar(uint16_t *dst, const uint16_t *a, const uint16_t *b, size_t n, uint8_t alpha);
+void blend_mask4_scalar(uint16_t *dst, const uint16_t *src, const uint8_t *mask, size_t n);
+
+// 4-bit mask value to alpha (0 -> 0, 15 -> BLEND_ALPHA_MAX)
+uint8_t blend_mask_alpha(uint8_t m);
+
+#endif
@@ -4,6 +4,8 @@
 #include "display/AXS15231B.h"
 #include "zxSpectrumDesignation.h"
 #include "display/tft_display.h"
+#include "system/metrics.h"
+#include "timeline.h"
 
 /*
  * Sinclair Logo Boot Animation
@@ -12,24 +14,26 @@
  * on the TFT display using the Arduino framework and the TFT_eSPI library. The animation 
  * consists of drawing individual letters of the word "Sinclair" with timed sequences, 
  * followed by colored flag stripes. It also manages drawing a designation name, and 
- * resetting or clearing the display at appropriate intervals. A lot of magic numbers, sorry.
+ * resetting or clearing the display at appropriate intervals.
  * 
  * Key Components:
  * - Initializes a TFT_eSprite for off-screen rendering.
- * - Draws individual letters (S, I, N, C, L, A, I, R) progressively based on a global 
- *   animation index (`animIndex`).
- * - Renders a multi-colored flag underneath the letters and displays a designation name.
- * - Manages sprite memory and handles animation flow control, including resetting and 
- *   clearing the logo when necessary.
+ * - The letters (S, I, N, C, L, A, I, R) are strokes of an 11x11 pen, each a keyframed path in a
+ *   timeline (timeline.h); the flag stripes are 27x1 pens going down at a slant, and the
+ *   designation name slides up into place.
+ * - Each frame the timeline says what changed since the last one; only that is drawn into the
+ *   sprite and only those rects are pushed, turned to the panel's native order on the way.
  * 
  * Usage:
- * - Call `drawBootSplash(int index, TFT_eSPI& tft)` in a loop to continuously animate the logo.
- * - The animation progresses over time, driven by the `animIndex`, which increments each frame.
+ * - Call `drawBootSplash()` in a loop to continuously animate the logo; it runs on wall-clock
+ *   time, so a late call just catches up.
  * 
  * Dependencies:
  * - Arduino framework
  * - TFT_eSPI library
  * - AXS15231B.h and DesignationName.h for additional display and naming functionality.
+ * - The asset atlas (storage/asset_atlas.h): the designation is drawn from its "ZXSpectrumDesignation"
+ *   image when the assets partition has one, and from the compiled-in array when it doesn't.
  * 
  * Notes:
  * - Ensure proper initialization of the TFT display before invoking the animation.
@@ -43,15 +47,135 @@
 
 TFT_eSprite sinclairLogoSprite = TFT_eSprite(&tft);
 bool spriteInitialized = false; // Flag to ensure sprite is initialized only once
-int animIndex = 0;              // Animation frame counter
 
 const int LOGO_X = 48;
 const int LOGO_Y = 40;          // Must absolutely be a multiple of 4, see below why
 const int LOGO_WIDTH = 560;
 const int LOGO_HEIGHT = 96;     // This too, multiple of 4
 
+// The animation was first written one pixel per frame, drawn as fast as the loop went: a frame was
+// the whole 560x96 push (~6.7 ms on the bus at 32 MHz) and the drawing, about 8 ms. Keys are still
+// placed on that grid but in ms, so the speed doesn't depend on how often the splash task runs.
+const uint16_t FRAME_MS = 8;
+static constexpr uint16_t frames(int n) { return (uint16_t)(n * FRAME_MS); }
+
+TimelinePlayer splashPlayer;
+TimelineFrame splashFrame;
+bool splashFullFlush = true;    // The whole logo area, after a reset
+
+const char DESIGNATION_ASSET[] = "ZXSpectrumDesignation";
+const uint16_t DESIGNATION_W = 281;
+const uint16_t DESIGNATION_H = 23;
+
+static const AssetAtlas *splashAtlas = NULL;
+static const AssetEntry *designationAsset = NULL;      // NULL: the compiled-in array
+
 const int VERTICAL_OFFSET = 14;
-const float DEFAULT_SPEED_RATIO = 3.0;  // Used to control the drawing speed of some letters that will finish drawing too fast otherwise
+const int LETTER_DELAY = 10;    // Frames between one letter starting and the next
+const uint16_t PEN = 11;        // Letters are drawn with an 11x11 square
+
+#define TRACK(keys) {keys, sizeof(keys) / sizeof(keys[0])}
+#define NO_TRACK {NULL, 0}
+
+// Pen paths of the letters, from the letter's left edge and the top of the logo. A step key ends a
+// stroke; the next one starts elsewhere.
+static const TimelineKey PATH_S[] = {
+    {frames(0),   57, VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(57),  0,  VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(71),  0,  VERTICAL_OFFSET + 14, TIMELINE_STEP},
+    {frames(72),  0,  VERTICAL_OFFSET + 16, TIMELINE_LINEAR},
+    {frames(129), 57, VERTICAL_OFFSET + 16, TIMELINE_LINEAR},
+    {frames(143), 57, VERTICAL_OFFSET + 30, TIMELINE_STEP},
+    {frames(144), 57, VERTICAL_OFFSET + 32, TIMELINE_LINEAR},
+    {frames(201), 0,  VERTICAL_OFFSET + 32, TIMELINE_STEP},
+};
+
+// Stem at a third of the speed, then the dot
+static const TimelineKey PATH_I[] = {
+    {frames(0),   0, VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(96),  0, VERTICAL_OFFSET + 32, TIMELINE_STEP},
+    {frames(99),  0, 0,                    TIMELINE_STEP},
+    {frames(119), 0, 0,                    TIMELINE_STEP},
+};
+
+static const TimelineKey PATH_N[] = {
+    {frames(0),   0,  VERTICAL_OFFSET + 32, TIMELINE_LINEAR},
+    {frames(32),  0,  VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(87),  55, VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(119), 55, VERTICAL_OFFSET + 32, TIMELINE_STEP},
+};
+
+static const TimelineKey PATH_C[] = {
+    {frames(0),   57, VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(57),  0,  VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(89),  0,  VERTICAL_OFFSET + 32, TIMELINE_STEP},
+    {frames(90),  2,  VERTICAL_OFFSET + 32, TIMELINE_LINEAR},
+    {frames(144), 56, VERTICAL_OFFSET + 32, TIMELINE_STEP},
+};
+
+// Full height, at a third of the speed
+static const TimelineKey PATH_L[] = {
+    {frames(0),   0, 0,  TIMELINE_LINEAR},
+    {frames(138), 0, 46, TIMELINE_STEP},
+    {frames(140), 0, 46, TIMELINE_STEP},
+};
+
+static const TimelineKey PATH_A[] = {
+    {frames(0),   0,  VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(57),  57, VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(89),  57, VERTICAL_OFFSET + 32, TIMELINE_STEP},
+    {frames(90),  57, VERTICAL_OFFSET + 32, TIMELINE_LINEAR},
+    {frames(146), 1,  VERTICAL_OFFSET + 32, TIMELINE_STEP},
+    {frames(147), 0,  VERTICAL_OFFSET + 31, TIMELINE_LINEAR},
+    {frames(162), 0,  VERTICAL_OFFSET + 16, TIMELINE_LINEAR},
+    {frames(219), 57, VERTICAL_OFFSET + 16, TIMELINE_STEP},
+};
+
+static const TimelineKey PATH_R[] = {
+    {frames(0),  0,  VERTICAL_OFFSET + 32, TIMELINE_LINEAR},
+    {frames(32), 0,  VERTICAL_OFFSET,      TIMELINE_LINEAR},
+    {frames(86), 54, VERTICAL_OFFSET,      TIMELINE_STEP},
+};
+
+// A stripe goes down one row a frame and left one pixel every two; the last row is off the sprite
+static const TimelineKey PATH_STRIPE[] = {
+    {frames(0),  96, 0,  TIMELINE_LINEAR},
+    {frames(96), 48, 96, TIMELINE_STEP},
+};
+
+// The designation slides up from below the logo and stays
+static const TimelineKey PATH_NAME[] = {
+    {frames(0),  0, 93, TIMELINE_LINEAR},
+    {frames(22), 0, 71, TIMELINE_STEP},
+};
+static const TimelineKey ALWAYS[] = {
+    {0, 1, 0, TIMELINE_STEP},
+};
+
+#define LETTER(x, n, path) \
+    {x, 0, frames(LETTER_DELAY * (n)), PEN, PEN, COLORS::WHITE, NULL, TIMELINE_TRAIL, TRACK(path), NO_TRACK, NO_TRACK}
+#define STRIPE(n, colour) \
+    {352 + 27 * (n), 0, frames(96 + 32 * (n)), 27, 1, colour, NULL, TIMELINE_TRAIL, TRACK(PATH_STRIPE), NO_TRACK, NO_TRACK}
+
+static const TimelineElement SPLASH_ELEMENTS[] = {
+    LETTER(0,   0, PATH_S),
+    LETTER(73,  1, PATH_I),
+    LETTER(89,  2, PATH_N),
+    LETTER(160, 3, PATH_C),
+    LETTER(232, 4, PATH_L),
+    LETTER(248, 5, PATH_A),
+    LETTER(321, 6, PATH_I),
+    LETTER(337, 7, PATH_R),
+    STRIPE(0, COLORS::RED),
+    STRIPE(1, COLORS::YELLOW),
+    STRIPE(2, COLORS::GREEN),
+    STRIPE(3, COLORS::CYAN),
+    {0, 0, frames(230), DESIGNATION_W, DESIGNATION_H, COLORS::BLACK, ZXSpectrumDesignation, 0, TRACK(PATH_NAME), NO_TRACK, TRACK(ALWAYS)},
+};
+
+static const Timeline SPLASH_TIMELINE = {
+    SPLASH_ELEMENTS, sizeof(SPLASH_ELEMENTS) / sizeof(SPLASH_ELEMENTS[0]), LOGO_WIDTH, LOGO_HEIGHT, COLORS::BLACK,
+};
 
 void InitSpriteOnce() {
     if (spriteInitialized)
@@ -70,186 +194,102 @@ void InitSpriteOnce() {
     spriteInitialized = true;
 }
 
-void drawLetterPart(int x, int y) {
-    sinclairLogoSprite.fillRect(x, y, 11, 11, COLORS::WHITE);
-}
-
-void drawFlagPart(int x, int y, uint16_t color) {
-    sinclairLogoSprite.fillRect(x, y, 27, 1, color);
-}
-
-// Draw the letter 'S' with animation, using a delay
-void drawLetterS(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;     // Skip if animation hasn't reached this point
-
-    // Draw each part of the letter based on the animation index
-    if (correctedAnimIndex < 57) {
-        drawLetterPart(x + 57 - correctedAnimIndex, VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 72) {
-        drawLetterPart(x + 0, correctedAnimIndex - 57 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 129) {
-        drawLetterPart(x + correctedAnimIndex - 72, 16 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 144) {
-        drawLetterPart(x + 57, 16 + correctedAnimIndex - 129 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 202) {
-        drawLetterPart(x + 57 - (correctedAnimIndex - 144), 32 + VERTICAL_OFFSET);
-    }
-}
-
-// Draw the letter 'I' with animation, adjusting speed using the default speed ratio
-void drawLetterI(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 33 * DEFAULT_SPEED_RATIO) {
-        drawLetterPart(x, VERTICAL_OFFSET + correctedAnimIndex/DEFAULT_SPEED_RATIO);
-    } else if (correctedAnimIndex < 33 * DEFAULT_SPEED_RATIO + 11 + 10) {
-        drawLetterPart(x, 0);
-    }
-}
-
-// Draw the letter 'N' with animation and delay
-void drawLetterN(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 32) {
-        drawLetterPart(x, VERTICAL_OFFSET + 32 - correctedAnimIndex);
-    } else if (correctedAnimIndex < 32 + 55) {
-        drawLetterPart(x + correctedAnimIndex - 32, VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 32 + 55 + 33) {
-        drawLetterPart(x + 55, VERTICAL_OFFSET + correctedAnimIndex - (32 + 55));
+// An atlas image into the sprite at (x, y), clipped to it. Atlas pixels are native rows, bottom
+// first, already in the byte order the sprite keeps.
+static void drawAsset(const AssetEntry *e, int x, int y) {
+    uint16_t *sprite = (uint16_t *)sinclairLogoSprite.getPointer();
+    const uint16_t *src = asset_pixels(splashAtlas, e);
+    for (int c = 0; c < DESIGNATION_W && x + c < LOGO_WIDTH; c++) {
+        const uint16_t *column = src + (size_t)c * e->h + e->h - 1;     // Top of the image
+        for (int r = 0; r < DESIGNATION_H && y + r < LOGO_HEIGHT; r++)
+            sprite[(y + r) * LOGO_WIDTH + x + c] = column[-r];
     }
 }
 
-// Draw the letter 'C' with animation and delay
-void drawLetterC(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 57) {               // Draw top part : 67 x 11 pixels
-        drawLetterPart(x + 57 - correctedAnimIndex, VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 90) {
-        drawLetterPart(x + 0, correctedAnimIndex - 57 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 145) {
-        drawLetterPart(x + 57 + (correctedAnimIndex - 145), 32 + VERTICAL_OFFSET);
-    }
+static void drawOp(const TimelineOp &op, const TimelineRect &r, void *ctx) {
+    if (op.image == ZXSpectrumDesignation && designationAsset)
+        drawAsset(designationAsset, r.x, r.y);
+    else if (op.image)
+        sinclairLogoSprite.pushImage(r.x, r.y, r.w, r.h, op.image);
+    else
+        sinclairLogoSprite.fillRect(r.x, r.y, r.w, r.h, op.colour);
 }
 
-// Draw the letter 'L' with animation and delay
-void drawLetterL(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 47 * DEFAULT_SPEED_RATIO) {
-        drawLetterPart(x, correctedAnimIndex/DEFAULT_SPEED_RATIO);
+// Pushes sprite rects turned to native order, batched like console_flush. Rows are widened to
+// multiples of 4 (see InitSpriteOnce).
+static void flushRects(const TimelineRect *rects, uint8_t count) {
+    static uint16_t chunk[SEND_BUF_SIZE];
+    static lcd_blit_t blits[TIMELINE_MAX_ELEMENTS];
+    const uint16_t *sprite = (const uint16_t *)sinclairLogoSprite.getPointer();
+
+    size_t used = 0, n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t top = rects[i].y & ~3;
+        uint16_t rows = ((rects[i].y + rects[i].h + 3) & ~3) - top;
+        uint16_t perChunk = SEND_BUF_SIZE / rows;          // At least 1: a chunk holds a native row (AXS15231B.h)
+
+        for (uint16_t x = rects[i].x; x < rects[i].x + rects[i].w; ) {
+            uint16_t cols = rects[i].x + rects[i].w - x;
+            if (cols > perChunk)
+                cols = perChunk;
+            if (used + (size_t)cols * rows > SEND_BUF_SIZE || n == TIMELINE_MAX_ELEMENTS) {
+                lcd_blit_batch(blits, n);
+                used = n = 0;
+            }
+
+            // Each landscape column is a native row, bottom of the logo first
+            uint16_t *dst = chunk + used;
+            for (uint16_t c = 0; c < cols; c++) {
+                for (int r = top + rows - 1; r >= top; r--)
+                    *dst++ = sprite[r * LOGO_WIDTH + x + c];
+            }
+            lcd_blit_t b = {(uint16_t)(LCD_HEIGHT - (LOGO_Y + top + rows)), (uint16_t)(LOGO_X + x), rows, cols,
+                            chunk + used};
+            blits[n++] = b;
+            used += (size_t)cols * rows;
+            x += cols;
+        }
     }
+    lcd_blit_batch(blits, n);
 }
 
-// Draw the letter 'A' with animation and delay
-void drawLetterA(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 57) {
-        drawLetterPart(x + correctedAnimIndex, VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 90) {
-        drawLetterPart(x + 57, correctedAnimIndex - 57 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 147) {
-        drawLetterPart(x + 147 - correctedAnimIndex, 32 + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 162) {
-        drawLetterPart(x, 16 + 162 - correctedAnimIndex + VERTICAL_OFFSET);
-    } else if (correctedAnimIndex < 220) {
-        drawLetterPart(x + (correctedAnimIndex - 162), 16 + VERTICAL_OFFSET);
-    }
-}
-
-// Draw the letter 'R' with animation and delay
-void drawLetterR(int x, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 32) {
-        drawLetterPart(x, VERTICAL_OFFSET + 32 - correctedAnimIndex);
-    } else if (correctedAnimIndex < 32 + 55) {
-        drawLetterPart(x + correctedAnimIndex - 32, VERTICAL_OFFSET);
-    }
-}
-
-void drawFlagStripe(int x, uint16_t color, int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
-
-    if (correctedAnimIndex < 96) {
-        drawFlagPart(x + 96 - correctedAnimIndex / 2, correctedAnimIndex, color);
-    }
-}
-
-void drawControlLine() {
-    if (animIndex < 50) {
-        drawLetterPart(animIndex * 10, 58);
-    }
-}
-
-// Draw the "ZX Spectrum +3 Elite" name for the Sinclair logo with animation delay
-void drawModelName(int delay = 0) {
-    int correctedAnimIndex = animIndex - delay;
-
-    if (correctedAnimIndex < 0)
-        return;
+void drawBootSplash() {
+    InitSpriteOnce();
 
-    if (correctedAnimIndex < 23) {
-        sinclairLogoSprite.pushImage(0, 70 + (23 - correctedAnimIndex), 281, 23, ZXSpectrumDesignation);
-    }
+    uint32_t now = micros();
+    uint32_t renderStart = micros();
+    bool more;
+    uint32_t flushUs = 0;
+    do {
+        more = timeline_update(&splashPlayer, now, &splashFrame);
+        for (uint8_t i = 0; i < splashFrame.opCount; i++)
+            timeline_op_rects(splashFrame.ops[i], drawOp, NULL);
+
+        uint32_t flushStart = micros();
+        if (splashFullFlush) {
+            TimelineRect all = {0, 0, LOGO_WIDTH, LOGO_HEIGHT};
+            flushRects(&all, 1);
+            splashFullFlush = false;
+        } else {
+            flushRects(splashFrame.dirty, splashFrame.dirtyCount);
+        }
+        flushUs += micros() - flushStart;
+    } while (more);
+
+    metrics_set(METRIC_RENDER_US, micros() - renderStart - flushUs);
+    metrics_set(METRIC_FLUSH_US, flushUs);
+    metrics_add(METRIC_FRAMES, 1);
 }
 
-void drawBootSplash() {
-    InitSpriteOnce();
-    int charactersDelay = 10;
-
-    // Draw each letter of "SINCLAIR" with individual delays for animation
-    drawLetterS(0);
-    drawLetterI(73, charactersDelay);
-    drawLetterN(89, charactersDelay * 2);
-    drawLetterC(160, charactersDelay * 3);
-    drawLetterL(232, charactersDelay * 4);
-    drawLetterA(248, charactersDelay * 5);
-    drawLetterI(321, charactersDelay * 6);
-    drawLetterR(337, charactersDelay * 7);
-
-    // Draw the flag stripes next to the letters
-    drawFlagStripe(352, COLORS::RED, 96);
-    drawFlagStripe(352 + 27, COLORS::YELLOW, 128);
-    drawFlagStripe(352 + 27 * 2, COLORS::GREEN, 160);
-    drawFlagStripe(352 + 27 * 3, COLORS::CYAN, 192);
-
-    drawModelName(230);
-    //drawControlLine();    // For tests
-
-    animIndex += 1;
-
-    // Push the sprite to the display
-    lcd_PushColors_rotated_90(LOGO_X, LOGO_Y, LOGO_WIDTH, LOGO_HEIGHT, (uint16_t*)sinclairLogoSprite.getPointer());
+void splashUseAssets(const AssetAtlas *atlas) {
+    splashAtlas = atlas;
+    const AssetEntry *e = asset_find(atlas, DESIGNATION_ASSET);
+    // The timeline places it by its size, so only a same-sized image will do (rows padded to fours)
+    designationAsset = e && e->w == DESIGNATION_W && e->h == ((DESIGNATION_H + 3) & ~3) ? e : NULL;
 }
 
 void resetSplash() {
     sinclairLogoSprite.fillSprite(COLORS::BLACK);
-    animIndex = 0;
+    timeline_start(&splashPlayer, &SPLASH_TIMELINE);
+    splashFullFlush = true;
 }
@@ -2,9 +2,13 @@
 #define BOOT_SPLASH_H
 
 #include <TFT_eSPI.h>
+#include "storage/asset_atlas.h"
 
 void drawBootSplash();
 
 void resetSplash();
 
+// Takes the artwork from the atlas where it has it, the compiled-in images otherwise
+void splashUseAssets(const AssetAtlas *atlas);
+
 #endif
@@ -0,0 +1,223 @@
+#include "console.h"
+#include "console_font.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Spectrum colours: black, blue, red, magenta, green, cyan, yellow, white, normal then BRIGHT
+static uint16_t default_colour(uint8_t i)
+{
+    uint8_t v = i & 8 ? 0xFF : 0xD7;
+    uint8_t r = i & 2 ? v : 0, g = i & 4 ? v : 0, b = i & 1 ? v : 0;
+    return (uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+}
+
+static inline bool same_cell(const ConsoleCell &a, const ConsoleCell &b)
+{
+    return a.ch == b.ch && a.ink == b.ink && a.paper == b.paper && a.attr == b.attr;
+}
+
+static void mark(Console *c, uint8_t row, uint8_t from, uint8_t to)
+{
+    if (from < c->dirtyFrom[row])
+        c->dirtyFrom[row] = from;
+    if (to > c->dirtyTo[row])
+        c->dirtyTo[row] = to;
+}
+
+static void mark_all(Console *c)
+{
+    for (uint8_t row = 0; row < c->rows; row++)
+        mark(c, row, 0, c->cols);
+}
+
+static void blank_row(Console *c, uint8_t row)
+{
+    for (uint8_t col = 0; col < c->cols; col++) {
+        c->cells[row][col] = c->pen;
+        c->cells[row][col].ch = ' ';
+    }
+}
+
+void console_init(Console *c, uint16_t x, uint16_t y, uint8_t cols, uint8_t rows)
+{
+    c->x = x;
+    c->y = y;
+    c->cols = cols < CONSOLE_MAX_COLS ? cols : CONSOLE_MAX_COLS;
+    c->rows = rows < CONSOLE_MAX_ROWS ? rows : CONSOLE_MAX_ROWS;
+    c->cursorCol = c->cursorRow = 0;
+
+    // Nothing is known to be on the panel, so every cell differs from "shown"
+    memset(c->shown, 0, sizeof(c->shown));
+    memset(c->dirtyFrom, 0xFF, sizeof(c->dirtyFrom));
+    memset(c->dirtyTo, 0, sizeof(c->dirtyTo));
+    for (uint8_t i = 0; i < CONSOLE_PALETTE_SIZE; i++)
+        console_set_palette(c, i, default_colour(i));
+    console_set_pen(c, 15, 0);
+    for (uint8_t row = 0; row < c->rows; row++)
+        blank_row(c, row);
+    mark_all(c);
+}
+
+void console_set_pen(Console *c, uint8_t ink, uint8_t paper, uint8_t attr)
+{
+    c->pen.ch = ' ';
+    c->pen.ink = ink % CONSOLE_PALETTE_SIZE;
+    c->pen.paper = paper % CONSOLE_PALETTE_SIZE;
+    c->pen.attr = attr;
+}
+
+void console_set_palette(Console *c, uint8_t index, uint16_t rgb565)
+{
+    if (index >= CONSOLE_PALETTE_SIZE)
+        return;
+    c->palette[index] = (uint16_t)(rgb565 >> 8 | rgb565 << 8);
+    // Cells in this colour look different now, whatever their contents
+    for (uint8_t row = 0; row < c->rows; row++) {
+        for (uint8_t col = 0; col < c->cols; col++) {
+            if (c->shown[row][col].ink == index || c->shown[row][col].paper == index) {
+                c->shown[row][col].ch = 0;
+                mark(c, row, col, col + 1);
+            }
+        }
+    }
+}
+
+void console_move(Console *c, uint8_t col, uint8_t row)
+{
+    c->cursorCol = col < c->cols ? col : c->cols - 1;
+    c->cursorRow = row < c->rows ? row : c->rows - 1;
+}
+
+void console_clear(Console *c)
+{
+    for (uint8_t row = 0; row < c->rows; row++)
+        blank_row(c, row);
+    mark_all(c);
+    c->cursorCol = c->cursorRow = 0;
+}
+
+void console_put(Console *c, uint8_t col, uint8_t row, char ch)
+{
+    if (col >= c->cols || row >= c->rows)
+        return;
+    ConsoleCell cell = c->pen;
+    cell.ch = ch;
+    if (same_cell(cell, c->cells[row][col]))
+        return;
+    c->cells[row][col] = cell;
+    mark(c, row, col, col + 1);
+}
+
+static void new_line(Console *c)
+{
+    c->cursorCol = 0;
+    if (c->cursorRow + 1 < c->rows) {
+        c->cursorRow++;
+        return;
+    }
+    console_scroll(c, 1);
+}
+
+void console_print(Console *c, const char *text)
+{
+    for (const char *p = text; *p; p++) {
+        if (*p == '\n') {
+            new_line(c);
+        } else if (*p == '\r') {
+            c->cursorCol = 0;
+        } else {
+            if (c->cursorCol >= c->cols)
+                new_line(c);
+            console_put(c, c->cursorCol++, c->cursorRow, *p);
+        }
+    }
+}
+
+void console_printf(Console *c, const char *fmt, ...)
+{
+    char text[CONSOLE_MAX_COLS * 2 + 1];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    console_print(c, text);
+}
+
+void console_scroll(Console *c, uint8_t lines)
+{
+    if (lines > c->rows)
+        lines = c->rows;
+    memmove(c->cells[0], c->cells[lines], sizeof(c->cells[0]) * (c->rows - lines));
+    for (uint8_t row = c->rows - lines; row < c->rows; row++)
+        blank_row(c, row);
+    mark_all(c);
+}
+
+size_t console_collect(Console *c, ConsoleSpan *spans, size_t max)
+{
+    size_t n = 0;
+    for (uint8_t row = 0; row < c->rows; row++) {
+        uint8_t col = c->dirtyFrom[row], end = c->dirtyTo[row];
+        while (col < end) {
+            if (same_cell(c->cells[row][col], c->shown[row][col])) {
+                col++;
+                continue;
+            }
+            if (n == max) {
+                c->dirtyFrom[row] = col;        // Pick up from here next time
+                return n;
+            }
+
+            // Extend over changed cells and short gaps of unchanged ones
+            uint8_t last = col;
+            for (uint8_t k = col + 1; k < end && k <= last + CONSOLE_SPAN_GAP + 1; k++) {
+                if (!same_cell(c->cells[row][k], c->shown[row][k]))
+                    last = k;
+            }
+            ConsoleSpan &s = spans[n++];
+            s.row = row;
+            s.col = col;
+            s.len = last - col + 1;
+            memcpy(&c->shown[row][col], &c->cells[row][col], s.len * sizeof(ConsoleCell));
+            col = last + 1;
+        }
+        c->dirtyFrom[row] = 0xFF;
+        c->dirtyTo[row] = 0;
+    }
+    return n;
+}
+
+void console_render_span(const Console *c, const ConsoleSpan &span, uint16_t *dst)
+{
+    for (uint8_t k = 0; k < span.len; k++) {
+        const ConsoleCell &cell = c->cells[span.row][span.col + k];
+        uint16_t ink = c->palette[cell.ink], paper = c->palette[cell.paper];
+        if (cell.attr & CONSOLE_INVERSE) {
+            uint16_t t = ink;
+            ink = paper;
+            paper = t;
+        }
+
+        uint8_t ch = (uint8_t)cell.ch;
+        if (ch < CONSOLE_FONT_FIRST || ch >= CONSOLE_FONT_FIRST + CONSOLE_FONT_GLYPHS)
+            ch = ch ? '?' : ' ';
+        const uint8_t *glyph = CONSOLE_FONT[ch - CONSOLE_FONT_FIRST];
+
+        // Cell column i shows glyph column i - 1; bold smears each column one to the right
+        uint8_t prev = 0;
+        for (uint8_t i = 0; i < CONSOLE_CELL; i++) {
+            uint8_t bits = i >= 1 && i <= CONSOLE_FONT_COLUMNS ? glyph[i - 1] : 0;
+            uint8_t shown = bits;
+            if (cell.attr & CONSOLE_BOLD)
+                shown |= prev;
+            if (cell.attr & CONSOLE_UNDERLINE)
+                shown |= 0x80;
+            prev = bits;
+
+            // One native row, bottom of the cell (bit 7) first
+            for (uint8_t p = 0; p < CONSOLE_CELL; p++)
+                *dst++ = (shown >> (CONSOLE_CELL - 1 - p)) & 1 ? ink : paper;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Text console
+ *
+ * A grid of 8x8 character cells (up to 80x22 on the 640x180 screen) for logs, file listings and
+ * program listings. Every cell holds a character, ink and paper (palette indices, the Spectrum's
+ * eight colours and their BRIGHT versions by default) and attribute bits.
+ *
+ * Writing only touches the cells written: each row keeps the column range written since the last
+ * flush, and a flush compares just that range against what is on the panel. Cells that really
+ * changed are coalesced into row spans (bridging short runs of unchanged cells, which cost less
+ * than another window set), rasterised straight into panel-native order, the font being stored a
+ * column at a time, and sent as one batched blit. Printing a line costs its length.
+ *
+ * Scrolling moves the text of every row, so it marks everything for comparison; only cells whose
+ * contents differ from what's shown are redrawn, which for ragged log lines is still well short of
+ * the whole grid.
+ */
+
+const uint8_t CONSOLE_MAX_COLS      = 80;
+const uint8_t CONSOLE_MAX_ROWS      = 22;
+const uint8_t CONSOLE_CELL          = 8;        // Pixels, both ways
+const uint8_t CONSOLE_SPAN_GAP      = 2;        // Unchanged cells bridged between two changed ones
+const uint8_t CONSOLE_PALETTE_SIZE  = 16;
+
+// Attribute bits
+const uint8_t CONSOLE_INVERSE       = 0x01;
+const uint8_t CONSOLE_UNDERLINE     = 0x02;
+const uint8_t CONSOLE_BOLD          = 0x04;
+
+struct ConsoleCell {
+    char ch;
+    uint8_t ink, paper;         // Palette indices
+    uint8_t attr;
+};
+
+// A run of cells to redraw
+struct ConsoleSpan {
+    uint8_t row, col, len;
+};
+
+struct Console {
+    uint16_t x, y;              // Landscape position; y should be a multiple of 4 (see boot_splash.cpp)
+    uint8_t cols, rows;
+    uint8_t cursorCol, cursorRow;
+    ConsoleCell pen;            // Colours and attributes new text gets (ch unused)
+    uint16_t palette[CONSOLE_PALETTE_SIZE];     // Panel byte order
+    ConsoleCell cells[CONSOLE_MAX_ROWS][CONSOLE_MAX_COLS];
+    ConsoleCell shown[CONSOLE_MAX_ROWS][CONSOLE_MAX_COLS];     // What the panel has
+    uint8_t dirtyFrom[CONSOLE_MAX_ROWS], dirtyTo[CONSOLE_MAX_ROWS];   // Columns to compare, [from, to)
+};
+
+// Blank console, everything marked for drawing. Ink white, paper black, Spectrum palette.
+void console_init(Console *c, uint16_t x, uint16_t y, uint8_t cols, uint8_t rows);
+
+void console_set_pen(Console *c, uint8_t ink, uint8_t paper, uint8_t attr = 0);
+void console_set_palette(Console *c, uint8_t index, uint16_t rgb565);
+void console_move(Console *c, uint8_t col, uint8_t row);
+void console_clear(Console *c);
+
+// One cell, with the pen's colours; the cursor doesn't move
+void console_put(Console *c, uint8_t col, uint8_t row, char ch);
+
+// Text at the cursor: \n starts a new line, \r goes back to its start, long lines wrap and the
+// console scrolls up when the cursor goes past the last row
+void console_print(Console *c, const char *text);
+void console_printf(Console *c, const char *fmt, ...);
+void console_scroll(Console *c, uint8_t lines);
+
+// Changed cells as spans, marking them shown; returns how many were written (at most max, the
+// rest stay pending for the next call)
+size_t console_collect(Console *c, ConsoleSpan *spans, size_t max);
+
+// A span's pixels, panel-native as lcd_PushColors() takes them: CONSOLE_CELL * len native rows of
+// CONSOLE_CELL pixels, bottom of the cell first
+void console_render_span(const Console *c, const ConsoleSpan &span, uint16_t *dst);
+
+// Collects, renders and sends everything that changed. Device only (console_draw.cpp).
+void console_flush(Console *c);
+
+#endif
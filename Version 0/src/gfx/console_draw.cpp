@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include "config.h"
+#include "console.h"
+#include "display/AXS15231B.h"
+
+void console_flush(Console *c)
+{
+    // Spans are rendered one after another into the chunk and go out as one batch when it's full
+    static uint16_t chunk[SEND_BUF_SIZE];
+    static ConsoleSpan spans[64];
+    static lcd_blit_t blits[64];
+    const size_t cellPixels = CONSOLE_CELL * CONSOLE_CELL;
+
+    size_t n;
+    while ((n = console_collect(c, spans, 64)) > 0) {
+        size_t used = 0, count = 0;
+        for (size_t i = 0; i < n; i++) {
+            size_t pixels = spans[i].len * cellPixels;
+            if (used + pixels > SEND_BUF_SIZE) {
+                lcd_blit_batch(blits, count);
+                used = count = 0;
+            }
+            console_render_span(c, spans[i], chunk + used);
+
+            // Landscape (x, y) to native, as in zx_screen_draw: cell columns are native rows
+            uint16_t x = c->x + spans[i].col * CONSOLE_CELL;
+            uint16_t y = c->y + spans[i].row * CONSOLE_CELL;
+            lcd_blit_t b = {(uint16_t)(LCD_HEIGHT - (y + CONSOLE_CELL)), x, CONSOLE_CELL,
+                            (uint16_t)(spans[i].len * CONSOLE_CELL), chunk + used};
+            blits[count++] = b;
+            used += pixels;
+        }
+        lcd_blit_batch(blits, count);
+    }
+}
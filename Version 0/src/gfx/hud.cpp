@@ -0,0 +1,27 @@
+#include "hud.h"
+#include <stdio.h>
+#include "system/metrics.h"
+
+// Keeps a field to its width, so a line never runs past HUD_COLUMNS
+static unsigned clamp_field(uint32_t v, unsigned max)
+{
+    return v < max ? (unsigned)v : max;
+}
+
+void hud_format(char lines[HUD_LINES][HUD_COLUMNS + 1])
+{
+    const Metric *m = metrics;
+    uint32_t frames = m[METRIC_FRAMES].delta;
+    uint32_t bytes = m[METRIC_SPI_BYTES].delta - m[METRIC_HUD_SPI_BYTES].delta;
+    float kbPerFrame = frames ? bytes / 1024.0f / frames : 0;
+
+    snprintf(lines[0], HUD_COLUMNS + 1, "%4.1ffps r%5.1f f%5.1fms %5.1fK/f",
+             m[METRIC_FRAMES].rate, m[METRIC_RENDER_US].value / 1000.0f,
+             m[METRIC_FLUSH_US].value / 1000.0f, kbPerFrame);
+
+    // Busy microseconds per second / 10000 = percent
+    snprintf(lines[1], HUD_COLUMNS + 1, "ram%4uK ps%5uK c0%3u%% c1%3u%%",
+             clamp_field(m[METRIC_HEAP_INTERNAL].value / 1024, 9999), clamp_field(m[METRIC_HEAP_PSRAM].value / 1024, 99999),
+             clamp_field((uint32_t)(m[METRIC_CORE0_BUSY_US].rate / 10000), 100),
+             clamp_field((uint32_t)(m[METRIC_CORE1_BUSY_US].rate / 10000), 100));
+}
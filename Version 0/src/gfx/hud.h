@@ -0,0 +1,39 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdint.h>
+
+/*
+ * Performance HUD
+ *
+ * A two-line stats strip in the top-right corner of the screen:
+ *
+ *   60.0fps r  1.2 f  8.9ms  45.2K/f
+ *   ram 212K ps 7812K c0  4% c1 63%
+ *
+ * frame rate, render and flush time of the last frame, pixel bytes sent per frame, free internal
+ * RAM and PSRAM, and per-core load: time spent in scheduler tasks, the card writes on core 0 and
+ * the UI on core 1. Everything comes from the metrics registry (system/metrics.h).
+ *
+ * It only redraws its own small sprite, a couple of times a second, and keeps its bytes out of
+ * the per-frame figure, so it costs next to nothing next to what it measures.
+ */
+
+const uint8_t HUD_LINES                 = 2;
+const uint8_t HUD_COLUMNS               = 32;
+const uint16_t HUD_WIDTH                = HUD_COLUMNS * 6;  // 6x8 font
+const uint16_t HUD_HEIGHT               = 20;               // Multiple of 4, see boot_splash.cpp
+const uint32_t HUD_PERIOD_US            = 500000;
+
+// Text of the strip, from the last metrics_sample()
+void hud_format(char lines[HUD_LINES][HUD_COLUMNS + 1]);
+
+// Device only (hud_draw.cpp)
+void hud_set_visible(bool visible);
+bool hud_visible();
+void hud_toggle();
+
+// Samples the heap and the metrics and redraws the strip if it's visible. Run every HUD_PERIOD_US.
+void hud_update();
+
+#endif
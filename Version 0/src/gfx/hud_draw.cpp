@@ -0,0 +1,70 @@
+#include <Arduino.h>
+#include <config.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "hud.h"
+#include "display/AXS15231B.h"
+#include "display/tft_display.h"
+#include "system/metrics.h"
+
+static const int HUD_X = LCD_WIDTH - HUD_WIDTH;
+static const int HUD_Y = 0;
+
+static TFT_eSprite hudSprite = TFT_eSprite(&tft);
+static bool visible = false;
+
+static void push()
+{
+    // Fixed size, so the rotation is compiled for it
+    PanelDriver::push_logical<HUD_WIDTH, HUD_HEIGHT>(HUD_X, HUD_Y, (const uint16_t *)hudSprite.getPointer());
+    metrics_add(METRIC_HUD_SPI_BYTES, HUD_WIDTH * HUD_HEIGHT * 2);
+}
+
+void hud_set_visible(bool on)
+{
+    if (on == visible)
+        return;
+
+    if (!hudSprite.created()) {
+        if (hudSprite.createSprite(HUD_WIDTH, HUD_HEIGHT) == NULL)
+            return;
+        hudSprite.setTextFont(1);
+        hudSprite.setTextColor(COLORS::WHITE, COLORS::BLACK);
+    }
+
+    visible = on;
+    if (!visible) {
+        hudSprite.fillSprite(COLORS::BLACK);    // Leave the corner as the screen background
+        push();
+    } else {
+        hud_update();
+    }
+}
+
+bool hud_visible()
+{
+    return visible;
+}
+
+void hud_toggle()
+{
+    hud_set_visible(!visible);
+}
+
+void hud_update()
+{
+    if (!visible)
+        return;
+
+    metrics_set(METRIC_HEAP_INTERNAL, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    metrics_set(METRIC_HEAP_PSRAM, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    metrics_sample(esp_timer_get_time());
+
+    char lines[HUD_LINES][HUD_COLUMNS + 1];
+    hud_format(lines);
+
+    hudSprite.fillSprite(COLORS::BLACK);
+    for (uint8_t i = 0; i < HUD_LINES; i++)
+        hudSprite.drawString(lines[i], 0, 2 + i * 9);
+    push();
+}
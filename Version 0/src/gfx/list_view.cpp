@@ -0,0 +1,267 @@
+#include "list_view.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>      // Item bitmaps live in PSRAM on the device
+#endif
+
+static void *list_alloc(size_t size)
+{
+#ifdef ARDUINO
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+#else
+    return malloc(size);
+#endif
+}
+
+static uint32_t columns(const ListView *lv)
+{
+    return (lv->count + lv->rows - 1) / lv->rows;
+}
+
+int32_t list_view_max_position(const ListView *lv)
+{
+    int64_t max = (int64_t)columns(lv) * lv->itemW - lv->width;
+    return max > 0 ? (int32_t)max : 0;
+}
+
+// Keeps the position in range; true if it had to
+static bool clamp(ListView *lv)
+{
+    int64_t max = (int64_t)list_view_max_position(lv) << 8;
+    if (lv->position < 0) {
+        lv->position = 0;
+        return true;
+    }
+    if (lv->position > max) {
+        lv->position = max;
+        return true;
+    }
+    return false;
+}
+
+static void drop_cache(ListView *lv)
+{
+    for (uint16_t i = 0; i < lv->cacheSlots; i++)
+        lv->slots[i].index = LIST_NONE;
+}
+
+uint16_t list_view_cache_slots(uint16_t width, uint16_t itemW, uint16_t itemH, uint16_t height)
+{
+    if (itemW == 0 || itemH == 0 || itemH > height)
+        return 0;
+    uint32_t rows = height / itemH;
+    uint32_t want = ((uint32_t)width / itemW + 2 + 2) * rows;   // Partly shown at both edges, and one more each side
+    if (want > LIST_MAX_CACHE_SLOTS)
+        return 0;
+    uint32_t slots = 1;
+    while (slots < want)
+        slots <<= 1;
+    return (uint16_t)slots;
+}
+
+void list_view_init(ListView *lv, uint32_t count, uint16_t itemW, uint16_t itemH, uint16_t width, uint16_t height,
+                    ListItemFn render, void *ctx, uint16_t *pixels, ListCacheSlot *slots, uint16_t cacheSlots)
+{
+    memset(lv, 0, sizeof(*lv));
+    lv->count = count;
+    lv->itemW = itemW;
+    lv->itemH = itemH;
+    lv->rows = height / itemH;
+    lv->width = width;
+    lv->height = height;
+    lv->render = render;
+    lv->ctx = ctx;
+    lv->pixels = pixels;
+    lv->slots = slots;
+    lv->cacheSlots = cacheSlots;
+    drop_cache(lv);
+}
+
+bool list_view_create(ListView *lv, uint32_t count, uint16_t itemW, uint16_t itemH, uint16_t width, uint16_t height,
+                      ListItemFn render, void *ctx)
+{
+    uint16_t n = list_view_cache_slots(width, itemW, itemH, height);
+    if (n == 0) {
+        memset(lv, 0, sizeof(*lv));
+        return false;
+    }
+    uint16_t *pixels = (uint16_t *)list_alloc((size_t)n * itemW * itemH * sizeof(uint16_t));
+    ListCacheSlot *slots = (ListCacheSlot *)malloc(n * sizeof(ListCacheSlot));
+    if (pixels == NULL || slots == NULL) {
+        free(pixels);
+        free(slots);
+        memset(lv, 0, sizeof(*lv));
+        return false;
+    }
+    list_view_init(lv, count, itemW, itemH, width, height, render, ctx, pixels, slots, n);
+    return true;
+}
+
+void list_view_free(ListView *lv)
+{
+    free(lv->pixels);
+    free(lv->slots);
+    lv->pixels = NULL;
+    lv->slots = NULL;
+    lv->cacheSlots = 0;
+}
+
+void list_view_set_count(ListView *lv, uint32_t count)
+{
+    lv->count = count;
+    drop_cache(lv);
+    if (clamp(lv))
+        lv->velocity = 0;
+}
+
+void list_view_invalidate(ListView *lv, uint32_t index)
+{
+    ListCacheSlot &slot = lv->slots[index & (lv->cacheSlots - 1)];
+    if (slot.index == index)
+        slot.index = LIST_NONE;
+}
+
+// ---- Motion ----
+
+void list_view_touch(ListView *lv, bool down, int32_t x, uint32_t nowMs)
+{
+    if (!down) {
+        if (!lv->dragging)
+            return;
+        lv->dragging = false;
+        lv->lastMs = nowMs;
+
+        // Velocity over the drag's last LIST_FLING_WINDOW_MS; a finger that stopped before letting go doesn't fling
+        const ListTouchSample &last = lv->samples[(lv->sampleNext + LIST_TOUCH_SAMPLES - 1) % LIST_TOUCH_SAMPLES];
+        if (nowMs - last.ms > LIST_FLING_WINDOW_MS)
+            return;
+        const ListTouchSample *first = &last;
+        for (uint8_t i = 2; i <= lv->sampleCount; i++) {
+            const ListTouchSample &s = lv->samples[(lv->sampleNext + LIST_TOUCH_SAMPLES - i) % LIST_TOUCH_SAMPLES];
+            if (last.ms - s.ms > LIST_FLING_WINDOW_MS)
+                break;
+            first = &s;
+        }
+        uint32_t ms = last.ms - first->ms;
+        if (ms == 0)
+            return;
+        int32_t v = (int32_t)((int64_t)(first->x - last.x) * 256 / (int32_t)ms);
+        lv->velocity = v > LIST_MAX_VELOCITY ? LIST_MAX_VELOCITY : v < -LIST_MAX_VELOCITY ? -LIST_MAX_VELOCITY : v;
+        return;
+    }
+
+    if (!lv->dragging) {
+        lv->dragging = true;                    // Catches a fling too
+        lv->velocity = 0;
+        lv->grabX = x;
+        lv->grabPosition = lv->position;
+        lv->sampleCount = 0;
+    }
+    lv->position = lv->grabPosition + (int64_t)(lv->grabX - x) * 256;
+    clamp(lv);
+    lv->samples[lv->sampleNext] = {x, nowMs};
+    lv->sampleNext = (uint8_t)((lv->sampleNext + 1) % LIST_TOUCH_SAMPLES);
+    if (lv->sampleCount < LIST_TOUCH_SAMPLES)
+        lv->sampleCount++;
+    lv->lastMs = nowMs;
+}
+
+int32_t list_view_update(ListView *lv, uint32_t nowMs)
+{
+    uint32_t ms = nowMs - lv->lastMs;
+    lv->lastMs = nowMs;
+    if (!lv->dragging && lv->velocity != 0) {
+        if (ms > 1000)
+            ms = 1000;                          // After a long stall the fling is over anyway
+        // A millisecond at a time: friction is per ms, and it's a few dozen steps a frame
+        int32_t v = lv->velocity < 0 ? -lv->velocity : lv->velocity;
+        int32_t sign = lv->velocity < 0 ? -1 : 1;
+        for (; ms > 0; ms--) {
+            lv->position += sign * v;
+            v = (int32_t)((int64_t)v * LIST_FRICTION_Q16 >> 16);
+            if (v < LIST_MIN_VELOCITY || clamp(lv)) {
+                v = 0;
+                break;
+            }
+        }
+        lv->velocity = sign * v;
+    }
+    return (int32_t)(lv->position >> 8);
+}
+
+bool list_view_moving(const ListView *lv)
+{
+    return lv->dragging || lv->velocity != 0;
+}
+
+void list_view_scroll_to(ListView *lv, int32_t position)
+{
+    lv->position = (int64_t)position << 8;
+    lv->velocity = 0;
+    lv->dragging = false;
+    clamp(lv);
+}
+
+uint32_t list_view_index_at(const ListView *lv, uint16_t x, uint16_t y)
+{
+    uint32_t row = y / lv->itemH;
+    if (x >= lv->width || row >= lv->rows)
+        return LIST_NONE;
+    uint32_t index = (uint32_t)(((lv->position >> 8) + x) / lv->itemW) * lv->rows + row;
+    return index < lv->count ? index : LIST_NONE;
+}
+
+int32_t list_view_item_x(const ListView *lv, uint32_t index)
+{
+    return (int32_t)(index / lv->rows * lv->itemW);
+}
+
+// ---- Rendering ----
+
+// The item's bitmap, from the data source if it isn't cached
+static const uint16_t *item(ListView *lv, uint32_t index)
+{
+    uint16_t slot = (uint16_t)(index & (lv->cacheSlots - 1));
+    uint16_t *pixels = lv->pixels + (size_t)slot * lv->itemW * lv->itemH;
+    if (lv->slots[slot].index != index) {
+        lv->render(index, pixels, lv->itemW, lv->itemH, lv->ctx);
+        lv->slots[slot].index = index;
+        lv->stats.rendered++;
+    } else {
+        lv->stats.hits++;
+    }
+    return pixels;
+}
+
+static void fill(uint16_t *dst, uint16_t n, uint16_t colour)
+{
+    for (uint16_t i = 0; i < n; i++)
+        dst[i] = colour;
+}
+
+void list_view_render(int32_t contentX, uint16_t cols, uint16_t *dst, void *ctx)
+{
+    ListView *lv = (ListView *)ctx;
+    const uint16_t h = lv->itemH, below = (uint16_t)(lv->height - lv->rows * h);
+    for (uint16_t c = 0; c < cols; c++, dst += lv->height) {
+        int32_t cx = contentX + c;
+        if (cx < 0) {
+            fill(dst, lv->height, lv->background);
+            continue;
+        }
+        // Native rows are bottom first: what's below the last row, then the rows from the bottom up
+        fill(dst, below, lv->background);
+        uint32_t first = (uint32_t)(cx / lv->itemW) * lv->rows;
+        uint16_t col = (uint16_t)(cx % lv->itemW);
+        for (uint16_t r = 0; r < lv->rows; r++) {
+            uint16_t *out = dst + lv->height - (r + 1) * h;
+            if (first + r < lv->count)
+                memcpy(out, item(lv, first + r) + (size_t)col * h, h * sizeof(uint16_t));
+            else
+                fill(out, h, lv->background);
+        }
+    }
+    lv->stats.columns += cols;
+}
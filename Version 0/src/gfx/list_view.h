@@ -0,0 +1,138 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "scroll_region.h"
+
+/*
+ * Virtualised list with kinetic scrolling
+ *
+ * A list of any length (a folder of thousands of files) shown in a hardware-scrolled strip
+ * (gfx/scroll_region.h). The panel scrolls sideways, so items are laid out in columns: rows of
+ * itemH pixels stacked down the strip's height, then on to the next column, itemW wide. Item i is
+ * at column i / rows, row i % rows, and the content is as wide as the columns the count needs.
+ *
+ * Nothing about an item exists until it comes into view: the list asks the data source to render
+ * it (panel-native, see ListItemFn) when one of its columns is first exposed, and keeps the result
+ * in a cache of item bitmaps, direct-mapped on the index. A frame renders only the columns the
+ * scroll exposed, copying from cached items, so its cost depends on how far the list moved and
+ * never on how long it is. The cache wants at least the items of one strip and a column each side
+ * (list_view_cache_slots), so scrolling back over what was just shown doesn't render again.
+ *
+ * Scrolling follows the finger while it's down; let go and the list flings on at the velocity of
+ * the last 100 ms of the drag, slowing with exponential friction, and stops dead at either end.
+ * Motion is integer (1/256 pixel, per millisecond steps) against wall-clock time, so a late frame
+ * lands where it should.
+ *
+ * No Arduino dependencies: tools/list_bench.cpp runs it on the host panel model.
+ */
+
+const uint32_t LIST_NONE            = 0xFFFFFFFF;
+const uint16_t LIST_FRICTION_Q16    = 65405;    // Velocity kept per ms: 0.998, a time constant of half a second
+const int32_t LIST_MAX_VELOCITY     = 8 * 256;  // 8 px/ms, 1/256 px per ms
+const int32_t LIST_MIN_VELOCITY     = 5;        // Below about 20 px/s a fling has stopped
+const uint16_t LIST_FLING_WINDOW_MS = 100;      // Drag samples older than this don't count to the fling
+const uint8_t LIST_TOUCH_SAMPLES    = 8;
+const uint32_t LIST_MAX_CACHE_SLOTS = 32768;    // Slot numbers are 16 bit; items too small for this aren't a list
+
+// Renders item index into pixels: itemW native rows of itemH pixels, bottom of the item first
+// (the layout zx_screen_render_native() and the scroll region use), in panel byte order
+typedef void (*ListItemFn)(uint32_t index, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx);
+
+struct ListCacheSlot {
+    uint32_t index;             // LIST_NONE: empty
+};
+
+struct ListTouchSample {
+    int32_t x;
+    uint32_t ms;
+};
+
+struct ListViewStats {
+    uint32_t frames;
+    uint32_t rendered;          // Items the data source was asked for
+    uint32_t hits;              // Item columns copied from the cache
+    uint32_t columns;           // Columns rendered into the strip
+};
+
+struct ListView {
+    uint32_t count;
+    uint16_t itemW, itemH, rows;
+    uint16_t width, height;     // Of the strip
+    uint16_t background;        // Panel byte order, below the last row and past the last item
+    ListItemFn render;
+    void *ctx;
+
+    // Item bitmaps
+    uint16_t *pixels;           // cacheSlots * itemW * itemH
+    ListCacheSlot *slots;
+    uint16_t cacheSlots;        // Power of two
+
+    // Motion
+    int64_t position;           // 1/256 px, content x of the strip's first column
+    int32_t velocity;           // 1/256 px per ms, positive moves the content left
+    bool dragging;
+    int32_t grabX;              // Finger x when it went down
+    int64_t grabPosition;
+    ListTouchSample samples[LIST_TOUCH_SAMPLES];
+    uint8_t sampleCount, sampleNext;
+    uint32_t lastMs;
+
+    ListViewStats stats;
+};
+
+// Slots worth caching for a strip: the columns it shows (partly at both edges) and one more each
+// side, rounded up to a power of two; 0 if that's more than LIST_MAX_CACHE_SLOTS, or an item has no
+// size or is taller than the strip
+uint16_t list_view_cache_slots(uint16_t width, uint16_t itemW, uint16_t itemH, uint16_t height);
+
+// The cache is the caller's: slots * itemW * itemH pixels and slots ListCacheSlots, slots a power
+// of two. height is the strip's (LCD_HEIGHT); itemW and itemH must be at least 1 and itemH at most
+// height, as list_view_cache_slots() checks.
+void list_view_init(ListView *lv, uint32_t count, uint16_t itemW, uint16_t itemH, uint16_t width, uint16_t height,
+                    ListItemFn render, void *ctx, uint16_t *pixels, ListCacheSlot *slots, uint16_t cacheSlots);
+
+// Allocates the cache list_view_cache_slots() wants (PSRAM on the device) and inits; false if
+// there's no memory, or the items are too small to cache or too tall for the strip. list_view_free
+// releases it.
+bool list_view_create(ListView *lv, uint32_t count, uint16_t itemW, uint16_t itemH, uint16_t width, uint16_t height,
+                      ListItemFn render, void *ctx);
+void list_view_free(ListView *lv);
+
+// A new count (the folder changed); the cache is dropped and the position kept in range
+void list_view_set_count(ListView *lv, uint32_t count);
+
+// The item changed: its bitmap is rendered again next time it's needed
+void list_view_invalidate(ListView *lv, uint32_t index);
+
+// Touch along the scroll axis, landscape x. down false ends the drag (x is ignored) and starts the fling.
+void list_view_touch(ListView *lv, bool down, int32_t x, uint32_t nowMs);
+
+// Advances the motion to nowMs and returns the whole-pixel position to show
+int32_t list_view_update(ListView *lv, uint32_t nowMs);
+
+// True while the list is being dragged or is still coasting
+bool list_view_moving(const ListView *lv);
+
+int32_t list_view_max_position(const ListView *lv);
+
+// Jumps to a position (clamped), stopping any fling
+void list_view_scroll_to(ListView *lv, int32_t position);
+
+// Item under strip column x, landscape y, at the current position; LIST_NONE if none
+uint32_t list_view_index_at(const ListView *lv, uint16_t x, uint16_t y);
+
+// Content x of the first column of an item's column
+int32_t list_view_item_x(const ListView *lv, uint32_t index);
+
+// ScrollRenderFn for the list; ctx is the ListView
+void list_view_render(int32_t contentX, uint16_t cols, uint16_t *dst, void *ctx);
+
+// Device only (list_view_draw.cpp): the strip at the list's position, a frame of motion, and an
+// item redrawn in place after list_view_invalidate
+void list_view_begin(ListView *lv, ScrollRegion *region, uint16_t x);
+void list_view_frame(ListView *lv, ScrollRegion *region, uint32_t nowMs);
+void list_view_redraw_item(ListView *lv, ScrollRegion *region, uint32_t index);
+
+#endif
@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include "config.h"
+#include "list_view.h"
+#include "display/AXS15231B.h"
+
+void list_view_begin(ListView *lv, ScrollRegion *region, uint16_t x)
+{
+    scroll_region_init(region, x, lv->width, (int32_t)(lv->position >> 8));
+    scroll_region_begin(region, list_view_render, lv);
+}
+
+void list_view_frame(ListView *lv, ScrollRegion *region, uint32_t nowMs)
+{
+    // Only the columns the move exposed are rendered; a still list costs nothing
+    int32_t position = list_view_update(lv, nowMs);
+    scroll_region_move(region, position - region->position, list_view_render, lv);
+    lv->stats.frames++;
+}
+
+void list_view_redraw_item(ListView *lv, ScrollRegion *region, uint32_t index)
+{
+    static uint16_t chunk[SEND_BUF_SIZE];
+    const uint16_t colsPerChunk = SEND_BUF_SIZE / LCD_HEIGHT;
+
+    // The item's columns that are on screen, in runs that don't cross the ring's wrap
+    int32_t from = list_view_item_x(lv, index), to = from + lv->itemW;
+    if (from < region->position)
+        from = region->position;
+    if (to > region->position + region->width)
+        to = region->position + region->width;
+    while (from < to) {
+        int32_t row = scroll_region_memory_x(region, from);
+        int32_t cols = to - from;
+        if (cols > colsPerChunk)
+            cols = colsPerChunk;
+        if (cols > region->width - row)
+            cols = region->width - row;
+        list_view_render(from, (uint16_t)cols, chunk, lv);
+        lcd_PushColors(0, region->x + row, LCD_HEIGHT, cols, chunk);
+        from += cols;
+    }
+}
@@ -0,0 +1,59 @@
+#include "scroll_region.h"
+
+void scroll_region_init(ScrollRegion *r, uint16_t x, uint16_t width, int32_t position)
+{
+    r->x = x;
+    r->width = width;
+    r->position = position;
+    r->offset = 0;
+}
+
+// Exposed content [contentX, contentX + cols) split where the ring wraps
+static int spans_for(const ScrollRegion *r, int32_t contentX, uint16_t cols, ScrollSpan spans[2])
+{
+    uint16_t row = (uint16_t)((r->offset + (contentX - r->position)) % r->width);
+    uint16_t first = r->width - row < cols ? r->width - row : cols;
+    spans[0].contentX = contentX;
+    spans[0].memoryRow = row;
+    spans[0].cols = first;
+    if (first == cols)
+        return 1;
+    spans[1].contentX = contentX + first;
+    spans[1].memoryRow = 0;
+    spans[1].cols = cols - first;
+    return 2;
+}
+
+int scroll_region_scroll(ScrollRegion *r, int32_t dx, ScrollSpan spans[2])
+{
+    if (dx == 0)
+        return 0;
+    r->position += dx;
+    if (dx >= r->width || -dx >= r->width)
+        return scroll_region_redraw(r, spans);
+
+    // The ring turns with the content, so the rows leaving one edge come back in at the other
+    int32_t offset = ((int32_t)r->offset + dx) % r->width;
+    r->offset = (uint16_t)(offset < 0 ? offset + r->width : offset);
+    if (dx > 0)
+        return spans_for(r, r->position + r->width - dx, (uint16_t)dx, spans);
+    return spans_for(r, r->position, (uint16_t)-dx, spans);
+}
+
+int scroll_region_redraw(const ScrollRegion *r, ScrollSpan spans[2])
+{
+    return spans_for(r, r->position, r->width, spans);
+}
+
+int32_t scroll_region_memory_x(const ScrollRegion *r, int32_t contentX)
+{
+    int32_t col = contentX - r->position;
+    if (col < 0 || col >= r->width)
+        return -1;
+    return (r->offset + col) % r->width;
+}
+
+uint16_t scroll_region_start_line(const ScrollRegion *r)
+{
+    return r->x + r->offset;
+}
@@ -0,0 +1,64 @@
+#ifndef SCROLL_REGION_H
+#define SCROLL_REGION_H
+
+#include <stdint.h>
+
+/*
+ * Hardware-scrolled region
+ *
+ * The AXS15231B can scroll a band of its native rows (VSCRDEF/VSCSAD): memory stays put and the
+ * panel starts showing the band from a different row, wrapping round. Native rows are landscape
+ * columns, so on our screen that is sideways scrolling of a full-height strip [x, x + width), e.g.
+ * a carousel of thumbnails or a long text line. Everything outside the strip (HUD included, if it's
+ * left out of the strip) stays fixed.
+ *
+ * The region treats its memory rows as a ring. Scrolling by dx moves the ring's start and only the
+ * |dx| newly exposed columns are rendered, into the rows that just went out of view: a scroll step
+ * costs |dx| * 180 pixels on the bus instead of width * 180 for a redraw, and no rotation pass.
+ *
+ * Content is addressed in "content x", the strip's own coordinate: position is the content x
+ * shown in the strip's first column. Columns are rendered panel-native, as lcd_PushColors() wants
+ * them: one native row of LCD_HEIGHT pixels per column, bottom of the picture first (the layout of
+ * zx_screen_render_native()).
+ *
+ * Only one region can be active; the panel has a single scroll area.
+ */
+
+struct ScrollRegion {
+    uint16_t x, width;          // Landscape columns of the strip
+    int32_t position;           // Content x in the first column
+    uint16_t offset;            // Memory row (from x) holding the first column
+};
+
+// Columns to render: content [contentX, contentX + cols) into memory rows from x + memoryRow
+struct ScrollSpan {
+    int32_t contentX;
+    uint16_t memoryRow;
+    uint16_t cols;
+};
+
+// Renders cols columns of content from contentX, panel-native, into dst
+typedef void (*ScrollRenderFn)(int32_t contentX, uint16_t cols, uint16_t *dst, void *ctx);
+
+void scroll_region_init(ScrollRegion *r, uint16_t x, uint16_t width, int32_t position);
+
+// Moves the region by dx (positive shows content further right). Fills spans with what has to be
+// rendered, in content order, and returns how many there are (0..2). Moves of a whole width or more
+// redraw everything.
+int scroll_region_scroll(ScrollRegion *r, int32_t dx, ScrollSpan spans[2]);
+
+// Spans for redrawing the whole strip at the current position (also what a new region needs)
+int scroll_region_redraw(const ScrollRegion *r, ScrollSpan spans[2]);
+
+// Memory row (from x) of a visible content column, for partial updates; -1 if it isn't on screen
+int32_t scroll_region_memory_x(const ScrollRegion *r, int32_t contentX);
+
+// Memory row the panel should show first, for VSCSAD
+uint16_t scroll_region_start_line(const ScrollRegion *r);
+
+// Device only (scroll_region_draw.cpp)
+void scroll_region_begin(ScrollRegion *r, ScrollRenderFn render, void *ctx);   // Sets the area, draws it all
+void scroll_region_move(ScrollRegion *r, int32_t dx, ScrollRenderFn render, void *ctx);
+void scroll_region_end(ScrollRegion *r);    // Back to a plain screen; the strip needs redrawing after
+
+#endif
@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include "config.h"
+#include "scroll_region.h"
+#include "display/AXS15231B.h"
+
+// Renders and pushes spans a chunk of whole columns at a time. Columns are native rows, so the
+// chunk goes out as it is, no rotation pass.
+static void draw_spans(const ScrollRegion *r, const ScrollSpan *spans, int count, ScrollRenderFn render, void *ctx)
+{
+    static uint16_t chunk[SEND_BUF_SIZE];
+    const uint16_t colsPerChunk = SEND_BUF_SIZE / LCD_HEIGHT;
+
+    for (int i = 0; i < count; i++) {
+        for (uint16_t col = 0; col < spans[i].cols; col += colsPerChunk) {
+            uint16_t cols = spans[i].cols - col < colsPerChunk ? spans[i].cols - col : colsPerChunk;
+            render(spans[i].contentX + col, cols, chunk, ctx);
+            lcd_PushColors(0, r->x + spans[i].memoryRow + col, LCD_HEIGHT, cols, chunk);
+        }
+    }
+}
+
+void scroll_region_begin(ScrollRegion *r, ScrollRenderFn render, void *ctx)
+{
+    ScrollSpan spans[2];
+    int count = scroll_region_redraw(r, spans);
+    draw_spans(r, spans, count, render, ctx);
+    lcd_scroll_area(r->x, r->width);
+    lcd_scroll_start(scroll_region_start_line(r));
+}
+
+void scroll_region_move(ScrollRegion *r, int32_t dx, ScrollRenderFn render, void *ctx)
+{
+    // New columns go into rows that are on their way out, then the start moves in one command
+    ScrollSpan spans[2];
+    int count = scroll_region_scroll(r, dx, spans);
+    if (count == 0)
+        return;
+    draw_spans(r, spans, count, render, ctx);
+    lcd_scroll_start(scroll_region_start_line(r));
+}
+
+void scroll_region_end(ScrollRegion *r)
+{
+    lcd_scroll_area(0, LCD_WIDTH);
+    lcd_scroll_start(0);
+    r->offset = 0;
+}
@@ -0,0 +1,368 @@
+#include "timeline.h"
+#include <string.h>
+
+const uint32_t FRACTION_ONE = 65536;     // Eased progress through a segment, 16 fraction bits
+
+static uint32_t ease(TimelineEase e, uint32_t p)
+{
+    uint32_t q = FRACTION_ONE - p;
+    switch (e) {
+    case TIMELINE_EASE_IN:
+        return (p >> 1) * (p >> 1) >> 14;
+    case TIMELINE_EASE_OUT:
+        return FRACTION_ONE - ((q >> 1) * (q >> 1) >> 14);
+    case TIMELINE_EASE_IN_OUT:
+        return p < FRACTION_ONE / 2 ? p * p >> 15 : FRACTION_ONE - (q * q >> 15);
+    case TIMELINE_STEP:
+        return 0;
+    default:
+        return p;
+    }
+}
+
+static inline int16_t lerp(int16_t from, int16_t to, uint32_t fraction)
+{
+    return (int16_t)(from + (int64_t)(to - from) * fraction / FRACTION_ONE);
+}
+
+// Key segment holding ms: index of its first key, and how far through it (eased)
+static uint8_t segment(const TimelineTrack &track, int32_t ms, uint32_t *fraction)
+{
+    *fraction = 0;
+    if (ms <= track.keys[0].ms)
+        return 0;
+    uint8_t i = 0;
+    while (i + 1 < track.count && track.keys[i + 1].ms <= ms)
+        i++;
+    if (i + 1 == track.count)
+        return i;
+
+    const TimelineKey &k = track.keys[i];
+    uint32_t elapsed = ms - k.ms, length = track.keys[i + 1].ms - k.ms;
+    if (k.ease == TIMELINE_LINEAR)
+        *fraction = (uint32_t)((uint64_t)elapsed * FRACTION_ONE / length);
+    else
+        *fraction = ease(k.ease, (uint32_t)((uint64_t)elapsed * FRACTION_ONE / length));
+    return i;
+}
+
+void timeline_sample(const TimelineTrack &track, uint32_t ms, int16_t *a, int16_t *b)
+{
+    uint32_t fraction;
+    uint8_t i = segment(track, (int32_t)ms, &fraction);
+    const TimelineKey &k = track.keys[i];
+    if (fraction == 0 || i + 1 == track.count) {
+        *a = k.a;
+        *b = k.b;
+        return;
+    }
+    if (k.ease == TIMELINE_LINEAR) {
+        // Exact, rather than through the 16-bit fraction, so whole-pixel steps land on whole frames
+        const TimelineKey &n = track.keys[i + 1];
+        int64_t elapsed = ms - k.ms, length = n.ms - k.ms;
+        *a = (int16_t)(k.a + (n.a - k.a) * elapsed / length);
+        *b = (int16_t)(k.b + (n.b - k.b) * elapsed / length);
+        return;
+    }
+    *a = lerp(k.a, track.keys[i + 1].a, fraction);
+    *b = lerp(k.b, track.keys[i + 1].b, fraction);
+}
+
+// Position just before ms: where a segment ending at ms got to, which differs from the value at ms
+// only after a step
+static void sample_before(const TimelineTrack &track, int32_t ms, int16_t *x, int16_t *y)
+{
+    for (uint8_t i = 1; i < track.count; i++) {
+        if (track.keys[i].ms == ms && track.keys[i - 1].ease == TIMELINE_STEP) {
+            *x = track.keys[i - 1].a;
+            *y = track.keys[i - 1].b;
+            return;
+        }
+    }
+    timeline_sample(track, ms < 0 ? 0 : ms, x, y);
+}
+
+static uint16_t sample_colour(const TimelineElement &e, int32_t ms)
+{
+    if (!e.colours.keys)
+        return e.colour;
+    uint32_t fraction;
+    uint8_t i = segment(e.colours, ms, &fraction);
+    uint16_t from = (uint16_t)e.colours.keys[i].a;
+    if (fraction == 0 || i + 1 == e.colours.count)
+        return from;
+    uint16_t to = (uint16_t)e.colours.keys[i + 1].a;
+    int16_t r = lerp(from >> 11, to >> 11, fraction);
+    int16_t g = lerp(from >> 5 & 0x3F, to >> 5 & 0x3F, fraction);
+    int16_t b = lerp(from & 0x1F, to & 0x1F, fraction);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static bool sample_visible(const TimelineElement &e, int32_t ms)
+{
+    if (e.visible.keys) {
+        if (ms < e.visible.keys[0].ms)
+            return false;
+        uint32_t fraction;
+        return e.visible.keys[segment(e.visible, ms, &fraction)].a != 0;
+    }
+    return ms >= e.position.keys[0].ms && ms <= e.position.keys[e.position.count - 1].ms;
+}
+
+// First key of any of the element's tracks after ms, or limit
+static int32_t next_key(const TimelineElement &e, int32_t ms, int32_t limit)
+{
+    const TimelineTrack *tracks[3] = {&e.position, &e.colours, &e.visible};
+    for (int t = 0; t < 3; t++) {
+        for (uint8_t i = 0; tracks[t]->keys && i < tracks[t]->count; i++) {
+            int32_t k = tracks[t]->keys[i].ms;
+            if (k > ms) {
+                if (k < limit)
+                    limit = k;
+                break;
+            }
+        }
+    }
+    return limit;
+}
+
+// Covers rect with dirty, clipped to the canvas; false if nothing of it is on the canvas
+static bool clip(const Timeline *t, int32_t x1, int32_t y1, int32_t x2, int32_t y2, TimelineRect *r)
+{
+    if (x1 < 0)
+        x1 = 0;
+    if (y1 < 0)
+        y1 = 0;
+    if (x2 > t->width)
+        x2 = t->width;
+    if (y2 > t->height)
+        y2 = t->height;
+    if (x1 >= x2 || y1 >= y2)
+        return false;
+    r->x = (int16_t)x1;
+    r->y = (int16_t)y1;
+    r->w = (uint16_t)(x2 - x1);
+    r->h = (uint16_t)(y2 - y1);
+    return true;
+}
+
+struct Emitter {
+    const Timeline *timeline;
+    TimelineFrame *frame;
+    bool touched;               // Something of the current element was emitted
+    int32_t x1, y1, x2, y2;     // Its bounds so far
+};
+
+static void emit(Emitter &em, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t w, uint16_t h,
+                 uint16_t colour, const uint16_t *image)
+{
+    TimelineOp &op = em.frame->ops[em.frame->opCount++];
+    op.x0 = x0;
+    op.y0 = y0;
+    op.x1 = x1;
+    op.y1 = y1;
+    op.w = w;
+    op.h = h;
+    op.colour = colour;
+    op.image = image;
+
+    int32_t left = x0 < x1 ? x0 : x1, top = y0 < y1 ? y0 : y1;
+    int32_t right = (x0 > x1 ? x0 : x1) + w, bottom = (y0 > y1 ? y0 : y1) + h;
+    if (!em.touched) {
+        em.x1 = left;
+        em.y1 = top;
+        em.x2 = right;
+        em.y2 = bottom;
+        em.touched = true;
+        return;
+    }
+    if (left < em.x1)
+        em.x1 = left;
+    if (top < em.y1)
+        em.y1 = top;
+    if (right > em.x2)
+        em.x2 = right;
+    if (bottom > em.y2)
+        em.y2 = bottom;
+}
+
+// A moving element: only where it is now matters
+static void update_moving(Emitter &em, const TimelineElement &e, TimelineElementState &s, int32_t ms)
+{
+    int16_t x, y;
+    timeline_sample(e.position, ms < 0 ? 0 : ms, &x, &y);
+    x += e.x;
+    y += e.y;
+    uint16_t colour = sample_colour(e, ms);
+    bool visible = sample_visible(e, ms);
+    if (visible == s.shown && (!visible || (x == s.x && y == s.y && colour == s.colour)))
+        return;
+
+    if (s.shown)
+        emit(em, s.x, s.y, s.x, s.y, e.w, e.h, em.timeline->background, NULL);
+    if (visible)
+        emit(em, x, y, x, y, e.w, e.h, colour, e.image);
+    s.x = x;
+    s.y = y;
+    s.colour = colour;
+    s.shown = visible;
+}
+
+// A trail: everything from the last update to this one, key segment by key segment. Returns false
+// if the op list filled up first, with the state left where it got to.
+static bool update_trail(Emitter &em, const TimelineElement &e, TimelineElementState &s, int32_t from, int32_t to)
+{
+    int32_t ms = from;
+    int16_t x, y;
+    timeline_sample(e.position, ms < 0 ? 0 : ms, &x, &y);
+    x += e.x;
+    y += e.y;
+    uint16_t colour = sample_colour(e, ms);
+    bool visible = sample_visible(e, ms);
+    if (visible && !(s.shown && s.x == x && s.y == y && s.colour == colour)) {
+        emit(em, x, y, x, y, e.w, e.h, colour, e.image);
+        s.x = x;
+        s.y = y;
+        s.colour = colour;
+        s.shown = true;
+    }
+
+    while (ms < to) {
+        if (em.frame->opCount + 2 > TIMELINE_MAX_OPS) {
+            s.doneMs = ms + e.delayMs;
+            return false;
+        }
+        int32_t next = next_key(e, ms, to);
+
+        // Along the segment to just before the next key: one op along an axis, or a stamp at each
+        // point the track goes through, which a straight line from end to end wouldn't hit exactly
+        int16_t ex, ey;
+        sample_before(e.position, next, &ex, &ey);
+        ex += e.x;
+        ey += e.y;
+        if (visible && (ex != x || ey != y)) {
+            if (ex != x && ey != y) {
+                for (int32_t t = ms + 1; t < next; t++) {
+                    int16_t px, py;
+                    timeline_sample(e.position, t < 0 ? 0 : t, &px, &py);
+                    px += e.x;
+                    py += e.y;
+                    if (px == s.x && py == s.y)
+                        continue;
+                    if (em.frame->opCount + 2 > TIMELINE_MAX_OPS) {
+                        s.doneMs = t - 1 + e.delayMs;
+                        return false;
+                    }
+                    emit(em, px, py, px, py, e.w, e.h, colour, e.image);
+                    s.x = px;
+                    s.y = py;
+                }
+                x = s.x;
+                y = s.y;
+            }
+            if (ex != x || ey != y)
+                emit(em, x, y, ex, ey, e.w, e.h, colour, e.image);
+            s.x = ex;
+            s.y = ey;
+            s.colour = colour;
+            s.shown = true;
+        }
+
+        // Then whatever the key itself changes
+        ms = next;
+        timeline_sample(e.position, ms < 0 ? 0 : ms, &x, &y);
+        x += e.x;
+        y += e.y;
+        colour = sample_colour(e, ms);
+        visible = sample_visible(e, ms);
+        if (visible && !(s.shown && s.x == x && s.y == y && s.colour == colour)) {
+            emit(em, x, y, x, y, e.w, e.h, colour, e.image);
+            s.x = x;
+            s.y = y;
+            s.colour = colour;
+            s.shown = true;
+        }
+    }
+    return true;
+}
+
+void timeline_start(TimelinePlayer *p, const Timeline *t)
+{
+    memset(p, 0, sizeof(*p));
+    p->timeline = t;
+}
+
+bool timeline_update(TimelinePlayer *p, uint32_t nowUs, TimelineFrame *frame)
+{
+    if (!p->started) {
+        p->startUs = nowUs;
+        p->started = true;
+    }
+    uint32_t nowMs = (nowUs - p->startUs) / 1000;
+    frame->opCount = 0;
+    frame->dirtyCount = 0;
+
+    const Timeline *t = p->timeline;
+    bool more = false;
+    for (uint8_t i = 0; i < t->count && i < TIMELINE_MAX_ELEMENTS; i++) {
+        const TimelineElement &e = t->elements[i];
+        TimelineElementState &s = p->state[i];
+        if (nowMs <= s.doneMs && s.doneMs != 0)
+            continue;
+
+        Emitter em = {t, frame, false, 0, 0, 0, 0};
+        int32_t from = (int32_t)s.doneMs - e.delayMs, to = (int32_t)nowMs - e.delayMs;
+        if (e.flags & TIMELINE_TRAIL) {
+            if (!update_trail(em, e, s, from, to))
+                more = true;
+            else
+                s.doneMs = nowMs;
+        } else if (frame->opCount + 2 <= TIMELINE_MAX_OPS) {
+            update_moving(em, e, s, to);
+            s.doneMs = nowMs;
+        } else {
+            more = true;
+        }
+
+        if (em.touched && clip(t, em.x1, em.y1, em.x2, em.y2, &frame->dirty[frame->dirtyCount]))
+            frame->dirtyCount++;
+        if (more)
+            break;
+    }
+    return more;
+}
+
+uint32_t timeline_duration_ms(const Timeline *t)
+{
+    uint32_t end = 0;
+    for (uint8_t i = 0; i < t->count; i++) {
+        const TimelineElement &e = t->elements[i];
+        const TimelineTrack *tracks[3] = {&e.position, &e.colours, &e.visible};
+        for (int k = 0; k < 3; k++) {
+            if (tracks[k]->keys && tracks[k]->keys[tracks[k]->count - 1].ms + e.delayMs > end)
+                end = tracks[k]->keys[tracks[k]->count - 1].ms + e.delayMs;
+        }
+    }
+    return end;
+}
+
+void timeline_op_rects(const TimelineOp &op, TimelineFillFn fill, void *ctx)
+{
+    int32_t dx = op.x1 - op.x0, dy = op.y1 - op.y0;
+    if (!op.image && (dx == 0 || dy == 0)) {
+        TimelineRect r = {dx < 0 ? op.x1 : op.x0, dy < 0 ? op.y1 : op.y0,
+                          (uint16_t)(op.w + (dx < 0 ? -dx : dx)), (uint16_t)(op.h + (dy < 0 ? -dy : dy))};
+        fill(op, r, ctx);
+        return;
+    }
+
+    // A stamp per pixel along the longer axis
+    int32_t steps = dx < 0 ? -dx : dx;
+    if ((dy < 0 ? -dy : dy) > steps)
+        steps = dy < 0 ? -dy : dy;
+    for (int32_t i = 0; i <= steps; i++) {
+        TimelineRect r = {(int16_t)(op.x0 + (steps ? dx * i / steps : 0)),
+                          (int16_t)(op.y0 + (steps ? dy * i / steps : 0)), op.w, op.h};
+        fill(op, r, ctx);
+    }
+}
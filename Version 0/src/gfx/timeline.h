@@ -0,0 +1,127 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Keyframed animation timelines
+ *
+ * A timeline is a table of elements (filled rects or images) on a canvas, each driven by tracks of
+ * keyframes: position, colour and visibility. Tracks are evaluated against wall-clock time, not a
+ * frame count, with integer easing (16-bit fractions), so a late frame lands where it should and a
+ * slow one doesn't stretch the animation.
+ *
+ * Each update turns the time since the last one into draw ops and the rects they touch, for the
+ * caller to draw into its canvas and push; nothing is drawn or pushed when nothing moved.
+ *
+ * Elements either move (the last position is erased to the background colour first) or leave a
+ * trail, like a brush: every position between the last update and this one is painted, so a
+ * stroke has no gaps however far apart updates are. Within a keyframe segment a trail follows a
+ * straight line; a step key jumps without painting the gap.
+ *
+ * All tables are const and can be shared: an element adds its own origin and start delay to the
+ * tracks it uses (the two I's of the splash share one).
+ */
+
+const uint8_t TIMELINE_MAX_ELEMENTS = 16;
+const uint8_t TIMELINE_MAX_OPS      = 48;
+
+enum TimelineEase : uint8_t {
+    TIMELINE_LINEAR,
+    TIMELINE_EASE_IN,           // Quadratic
+    TIMELINE_EASE_OUT,
+    TIMELINE_EASE_IN_OUT,
+    TIMELINE_STEP,              // Holds this key's value until the next key
+};
+
+// One keyframe. Position: (a, b) = (x, y) from the element's origin; colour: a = RGB565;
+// visibility: a = 0 or 1 (always a step). The ease is for the segment up to the next key.
+struct TimelineKey {
+    uint16_t ms;
+    int16_t a, b;
+    TimelineEase ease;
+};
+
+struct TimelineTrack {
+    const TimelineKey *keys;    // By time; NULL for none
+    uint8_t count;
+};
+
+enum TimelineFlags : uint8_t {
+    TIMELINE_TRAIL = 0x01,      // Paint every position passed through and never erase
+};
+
+struct TimelineElement {
+    int16_t x, y;               // Origin of the position track
+    uint16_t delayMs;           // The element's tracks start this long after the timeline
+    uint16_t w, h;
+    uint16_t colour;            // RGB565, unless there's a colour track
+    const uint16_t *image;      // w x h, drawn instead of a filled rect if set
+    uint8_t flags;
+    TimelineTrack position;     // Required
+    TimelineTrack colours;
+    TimelineTrack visible;      // Without one: from the first position key to the last
+};
+
+struct Timeline {
+    const TimelineElement *elements;
+    uint8_t count;
+    uint16_t width, height;     // Canvas; ops and dirty rects are clipped to it
+    uint16_t background;        // RGB565, for erasing moved elements
+};
+
+struct TimelineRect {
+    int16_t x, y;
+    uint16_t w, h;
+};
+
+// A brush (rect or image) stamped at every point on the line from (x0, y0) to (x1, y1); usually
+// a single point, or a line along one axis, which is a plain rect fill
+struct TimelineOp {
+    int16_t x0, y0, x1, y1;
+    uint16_t w, h;
+    uint16_t colour;            // RGB565
+    const uint16_t *image;      // NULL for a fill
+};
+
+// Where each element was last drawn
+struct TimelineElementState {
+    uint32_t doneMs;            // Ops emitted up to here (from the timeline's start)
+    int16_t x, y;
+    uint16_t colour;
+    bool shown;                 // Something of it is on the canvas at (x, y)
+};
+
+struct TimelinePlayer {
+    const Timeline *timeline;
+    uint32_t startUs;
+    bool started;
+    TimelineElementState state[TIMELINE_MAX_ELEMENTS];
+};
+
+// What an update produced: ops in drawing order, and per element the rect they cover
+struct TimelineFrame {
+    TimelineOp ops[TIMELINE_MAX_OPS];
+    uint8_t opCount;
+    TimelineRect dirty[TIMELINE_MAX_ELEMENTS];
+    uint8_t dirtyCount;
+};
+
+void timeline_start(TimelinePlayer *p, const Timeline *t);
+
+// Ops and dirty rects for everything that changed up to nowUs; the clock starts at the first call.
+// Returns true if there's more to catch up on (the op list filled up): draw and call again.
+bool timeline_update(TimelinePlayer *p, uint32_t nowUs, TimelineFrame *frame);
+
+// Time of the last key of any track, from the timeline's start
+uint32_t timeline_duration_ms(const Timeline *t);
+
+// Value of a position or visibility track at ms (from the element's start), eased between keys
+void timeline_sample(const TimelineTrack &track, uint32_t ms, int16_t *a, int16_t *b);
+
+// Splits an op into the rects its brush stamps cover, merging stamps along one axis into one rect
+typedef void (*TimelineFillFn)(const TimelineOp &op, const TimelineRect &rect, void *ctx);
+void timeline_op_rects(const TimelineOp &op, TimelineFillFn fill, void *ctx);
+
+#endif
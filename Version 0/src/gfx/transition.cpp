@@ -0,0 +1,49 @@
+#include "transition.h"
+#include <string.h>
+
+void transition_start(Transition *t, TransitionKind kind, const uint16_t *from, const uint16_t *to,
+                      uint16_t colour, uint16_t width, uint16_t height, uint32_t durationUs, uint32_t nowUs)
+{
+    t->kind = kind;
+    t->from = from;
+    t->to = to;
+    t->colour = (uint16_t)(colour >> 8 | colour << 8);
+    t->width = width;
+    t->height = height;
+    t->startUs = nowUs;
+    t->durationUs = durationUs;
+    t->drawnAlpha = -1;
+}
+
+uint8_t transition_alpha(const Transition *t, uint32_t nowUs)
+{
+    uint32_t elapsed = nowUs - t->startUs;
+    if (t->durationUs == 0 || elapsed >= t->durationUs)
+        return BLEND_ALPHA_MAX;
+    return (uint8_t)((uint64_t)elapsed * BLEND_ALPHA_MAX / t->durationUs);
+}
+
+bool transition_done(const Transition *t, uint32_t nowUs)
+{
+    return transition_alpha(t, nowUs) == BLEND_ALPHA_MAX;
+}
+
+void transition_render(const Transition *t, uint8_t alpha, uint16_t *dst, uint16_t firstRow, uint16_t rows)
+{
+    size_t offset = (size_t)firstRow * t->width;
+    size_t n = (size_t)rows * t->width;
+
+    switch (t->kind) {
+    case TRANSITION_FADE_OUT:
+        memcpy(dst, t->from + offset, n * sizeof(uint16_t));
+        blend_fill(dst, n, t->colour, alpha);
+        break;
+    case TRANSITION_FADE_IN:
+        memcpy(dst, t->to + offset, n * sizeof(uint16_t));
+        blend_fill(dst, n, t->colour, BLEND_ALPHA_MAX - alpha);
+        break;
+    case TRANSITION_CROSSFADE:
+        blend_mix(dst, t->to + offset, t->from + offset, n, alpha);
+        break;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include <stdint.h>
+#include "blend.h"
+
+/*
+ * Screen transitions
+ *
+ * Fades and crossfades between landscape canvases (sprites, panel byte order) of one size, timed
+ * in microseconds. Each frame is blended a band of rows at a time with the kernels in blend.h, so
+ * nothing bigger than the push chunk is needed on top of the canvases themselves.
+ *
+ * Alpha moves in BLEND_ALPHA_MAX + 1 steps; a frame whose alpha is the same as the last one drawn
+ * isn't sent again, so a slow fade doesn't cost a full-area push every frame.
+ */
+
+enum TransitionKind : uint8_t {
+    TRANSITION_FADE_OUT,        // from -> colour
+    TRANSITION_FADE_IN,         // colour -> to
+    TRANSITION_CROSSFADE,       // from -> to
+};
+
+struct Transition {
+    TransitionKind kind;
+    const uint16_t *from;
+    const uint16_t *to;
+    uint16_t colour;            // Panel byte order
+    uint16_t width, height;
+    uint32_t startUs;
+    uint32_t durationUs;
+    int16_t drawnAlpha;         // Last alpha sent to the panel, -1 before the first frame
+};
+
+// colour is plain RGB565, like the COLORS constants; whichever canvas the kind doesn't use may be NULL
+void transition_start(Transition *t, TransitionKind kind, const uint16_t *from, const uint16_t *to,
+                      uint16_t colour, uint16_t width, uint16_t height, uint32_t durationUs, uint32_t nowUs);
+
+// How far along, 0 (all "from") to BLEND_ALPHA_MAX (all "to"), linear in time
+uint8_t transition_alpha(const Transition *t, uint32_t nowUs);
+bool transition_done(const Transition *t, uint32_t nowUs);
+
+// Rows [firstRow, firstRow + rows) of the frame at the given alpha, width pixels each, into dst
+void transition_render(const Transition *t, uint8_t alpha, uint16_t *dst, uint16_t firstRow, uint16_t rows);
+
+// Draws the current frame at landscape (x, y) if it changed since the last one; y and the height
+// should be multiples of 4 (see boot_splash.cpp). Returns false once the last frame has been drawn.
+// Device only (transition_draw.cpp).
+bool transition_draw(Transition *t, uint32_t nowUs, uint16_t x, uint16_t y);
+
+#endif
@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include "config.h"
+#include "transition.h"
+#include "display/AXS15231B.h"
+#include "system/metrics.h"
+
+bool transition_draw(Transition *t, uint32_t nowUs, uint16_t x, uint16_t y)
+{
+    // Bands of whole rows, a multiple of 4 tall, as many as fit in one SPI chunk
+    static uint16_t chunk[SEND_BUF_SIZE];
+    uint16_t bandRows = (SEND_BUF_SIZE / t->width) & ~3;
+
+    uint8_t alpha = transition_alpha(t, nowUs);
+    if (alpha == t->drawnAlpha)
+        return alpha != BLEND_ALPHA_MAX;
+
+    uint32_t renderUs = 0, flushUs = 0;
+    for (uint16_t row = 0; row < t->height; row += bandRows) {
+        uint16_t rows = t->height - row < bandRows ? t->height - row : bandRows;
+        uint32_t start = micros();
+        transition_render(t, alpha, chunk, row, rows);
+        uint32_t rendered = micros();
+        lcd_PushColors_rotated_90(x, y + row, t->width, rows, chunk);
+        renderUs += rendered - start;
+        flushUs += micros() - rendered;
+    }
+    t->drawnAlpha = alpha;
+
+    metrics_set(METRIC_RENDER_US, renderUs);
+    metrics_set(METRIC_FLUSH_US, flushUs);
+    metrics_add(METRIC_FRAMES, 1);
+    return alpha != BLEND_ALPHA_MAX;
+}
@@ -0,0 +1,217 @@
+#include "zx_screen.h"
+
+// Spectrum palette: black, blue, red, magenta, green, cyan, yellow, white. Normal colours use 0xD7
+// per channel, BRIGHT ones 0xFF.
+#define ZX_RGB565(r, g, b)  ((uint16_t)((((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3)))
+#define ZX_COLOUR(i, v)     ZX_RGB565(((i) & 2) ? (v) : 0, ((i) & 4) ? (v) : 0, ((i) & 1) ? (v) : 0)
+
+static uint16_t attrColours[2][256][2];     // [flash phase][attribute] = {paper, ink}
+static uint32_t attrPairs[2][256][4];       // Two adjacent pixels per word, indexed by their two bits
+static uint16_t rowOffset[ZX_SCREEN_HEIGHT];
+
+void zx_screen_init(bool swapBytes)
+{
+    for (int phase = 0; phase < 2; phase++) {
+        for (int attr = 0; attr < 256; attr++) {
+            uint8_t level = (attr & 0x40) ? 0xFF : 0xD7;
+            uint16_t ink = ZX_COLOUR(attr & 7, level);
+            uint16_t paper = ZX_COLOUR((attr >> 3) & 7, level);
+            if (swapBytes) {
+                ink = (ink >> 8) | (ink << 8);
+                paper = (paper >> 8) | (paper << 8);
+            }
+            if ((attr & 0x80) && phase) {
+                uint16_t t = ink;
+                ink = paper;
+                paper = t;
+            }
+
+            attrColours[phase][attr][0] = paper;
+            attrColours[phase][attr][1] = ink;
+            // Little-endian: the left pixel is the low half of the word
+            for (int k = 0; k < 4; k++)
+                attrPairs[phase][attr][k] = (uint32_t)((k & 2) ? ink : paper) | ((uint32_t)((k & 1) ? ink : paper) << 16);
+        }
+    }
+
+    // Bitmap row y lives at 010T TSSS LLLC CCCC: third, scanline within the character, character row
+    for (int y = 0; y < ZX_SCREEN_HEIGHT; y++)
+        rowOffset[y] = ((y & 0xC0) << 5) | ((y & 0x07) << 8) | ((y & 0x38) << 2);
+}
+
+ZxScreenView zx_screen_view_fit(uint16_t maxW, uint16_t maxH)
+{
+    ZxScreenView v;
+    v.srcW = v.dstW = maxW < ZX_SCREEN_WIDTH ? (maxW & ~7) : ZX_SCREEN_WIDTH;
+    v.srcH = v.dstH = maxH < ZX_SCREEN_HEIGHT ? maxH : ZX_SCREEN_HEIGHT;
+    v.srcX = ((ZX_SCREEN_WIDTH - v.srcW) / 2) & ~7;
+    v.srcY = (ZX_SCREEN_HEIGHT - v.srcH) / 2;
+    return v;
+}
+
+ZxScreenView zx_screen_view_scaled(uint16_t dstW, uint16_t dstH)
+{
+    ZxScreenView v = {0, 0, ZX_SCREEN_WIDTH, ZX_SCREEN_HEIGHT, dstW, dstH};
+    return v;
+}
+
+bool zx_screen_has_flash(const uint8_t *screen)
+{
+    const uint8_t *attrs = screen + ZX_SCREEN_BITMAP_SIZE;
+    for (int i = 0; i < ZX_SCREEN_SIZE - ZX_SCREEN_BITMAP_SIZE; i++) {
+        if (attrs[i] & 0x80)
+            return true;
+    }
+    return false;
+}
+
+static inline int source_row(const ZxScreenView &view, int r)
+{
+    return view.srcY + (r * view.srcH) / view.dstH;
+}
+
+void zx_screen_render(const uint8_t *screen, const ZxScreenView &view, bool flashPhase,
+                      uint16_t *dst, int stride)
+{
+    const int phase = flashPhase ? 1 : 0;
+    const bool aligned = ((view.srcX | view.srcW) & 7) == 0 && (((uintptr_t)dst | (uintptr_t)stride) & 1) == 0;
+    const int scale = (aligned && view.dstW == view.srcW) ? 1 : ((aligned && view.dstW == view.srcW * 2) ? 2 : 0);
+    const int firstCell = view.srcX >> 3;
+    const int cells = view.srcW >> 3;
+
+    for (int r = 0; r < view.dstH; r++) {
+        int sy = source_row(view, r);
+        const uint8_t *bits = screen + rowOffset[sy];
+        const uint8_t *attrs = screen + ZX_SCREEN_BITMAP_SIZE + (sy >> 3) * 32;
+        uint16_t *row = dst + r * stride;
+
+        if (scale == 1) {
+            uint32_t *out = (uint32_t *)row;
+            for (int cell = firstCell; cell < firstCell + cells; cell++) {
+                const uint32_t *pairs = attrPairs[phase][attrs[cell]];
+                uint8_t b = bits[cell];
+                out[0] = pairs[b >> 6];
+                out[1] = pairs[(b >> 4) & 3];
+                out[2] = pairs[(b >> 2) & 3];
+                out[3] = pairs[b & 3];
+                out += 4;
+            }
+        } else if (scale == 2) {
+            uint32_t *out = (uint32_t *)row;
+            for (int cell = firstCell; cell < firstCell + cells; cell++) {
+                const uint32_t *pairs = attrPairs[phase][attrs[cell]];
+                uint32_t paper = pairs[0], ink = pairs[3];      // A doubled pixel is a whole word
+                uint8_t b = bits[cell];
+                for (int i = 0; i < 8; i++, b <<= 1)
+                    *out++ = (b & 0x80) ? ink : paper;
+            }
+        } else {
+            // Nearest neighbour, stepping through the source with an integer DDA (no division per pixel)
+            int sx = view.srcX, rem = 0;
+            for (int c = 0; c < view.dstW; c++) {
+                const uint16_t *colours = attrColours[phase][attrs[sx >> 3]];
+                row[c] = colours[(bits[sx >> 3] >> (7 - (sx & 7))) & 1];
+                rem += view.srcW;
+                while (rem >= view.dstW) {
+                    rem -= view.dstW;
+                    sx++;
+                }
+            }
+        }
+    }
+}
+
+// A bitmap byte's 8 pixels, each k native rows long: out steps a native row (stride pixels) per copy
+static inline void native_byte(uint16_t *out, uint8_t b, const uint16_t *colours, int k, int stride)
+{
+    const uint16_t px[8] = {colours[b >> 7], colours[(b >> 6) & 1], colours[(b >> 5) & 1], colours[(b >> 4) & 1],
+                            colours[(b >> 3) & 1], colours[(b >> 2) & 1], colours[(b >> 1) & 1], colours[b & 1]};
+    if (k == 1) {
+        for (int i = 0; i < 8; i++, out += stride)
+            *out = px[i];
+        return;
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < k; j++, out += stride)
+            *out = px[i];
+    }
+}
+
+void zx_screen_render_native(const uint8_t *screen, const ZxScreenView &view, bool flashPhase,
+                             uint16_t *dst, int firstCol, int cols)
+{
+    const int phase = flashPhase ? 1 : 0;
+    const int stride = view.dstH;
+    const int k = view.dstW % view.srcW == 0 ? view.dstW / view.srcW : 0;     // Whole-number scale, or 0
+
+    // Source column of firstCol, and the DDA remainder that goes with it
+    uint32_t start = (uint32_t)firstCol * view.srcW;
+    const int startX = view.srcX + start / view.dstW;
+    const int startRem = start % view.dstW;
+
+    if (k) {
+        // A cell at a time down every row, so each of its native rows fills in order. Whole bytes go
+        // through the attribute's colours; a cell cut by the chunk's edges goes a pixel at a time.
+        int sx = startX, copies = k - firstCol % k;     // Copies of sx still to go
+        for (int c = 0; c < cols; ) {
+            int cell = sx >> 3;
+            bool whole = (sx & 7) == 0 && copies == k && cols - c >= 8 * k;
+            uint16_t *out = dst + c * stride + view.dstH - 1;
+            int sy = view.srcY, rem = 0;                // source_row() as a DDA, no division per row
+            for (int r = 0; r < view.dstH; r++, out--) {
+                uint8_t b = screen[rowOffset[sy] + cell];
+                const uint16_t *colours = attrColours[phase][screen[ZX_SCREEN_BITMAP_SIZE + (sy >> 3) * 32 + cell]];
+                if (whole)
+                    native_byte(out, b, colours, k, stride);
+                else
+                    *out = colours[(b >> (7 - (sx & 7))) & 1];
+                rem += view.srcH;
+                while (rem >= view.dstH) {
+                    rem -= view.dstH;
+                    sy++;
+                }
+            }
+            if (whole) {
+                c += 8 * k;
+                sx += 8;
+            } else {
+                c++;
+                if (--copies == 0) {
+                    sx++;
+                    copies = k;
+                }
+            }
+        }
+        return;
+    }
+
+    // Fractional scales: nearest neighbour with an integer DDA, a pixel at a time
+    for (int r = 0; r < view.dstH; r++) {
+        int sy = source_row(view, r);
+        const uint8_t *bits = screen + rowOffset[sy];
+        const uint8_t *attrs = screen + ZX_SCREEN_BITMAP_SIZE + (sy >> 3) * 32;
+        uint16_t *out = dst + (view.dstH - 1 - r);      // Bottom of the picture is the start of a native row
+
+        int sx = startX, rem = startRem;
+        int lastCell = -1;
+        uint8_t b = 0;
+        const uint16_t *colours = NULL;
+
+        for (int c = 0; c < cols; c++) {
+            int cell = sx >> 3;
+            if (cell != lastCell) {
+                b = bits[cell];
+                colours = attrColours[phase][attrs[cell]];
+                lastCell = cell;
+            }
+            *out = colours[(b >> (7 - (sx & 7))) & 1];
+            out += stride;
+
+            rem += view.srcW;
+            while (rem >= view.dstW) {
+                rem -= view.dstW;
+                sx++;
+            }
+        }
+    }
+}
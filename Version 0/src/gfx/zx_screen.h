@@ -0,0 +1,60 @@
+#ifndef ZX_SCREEN_H
+#define ZX_SCREEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * SCREEN$ decoder
+ *
+ * Converts a 6912-byte Spectrum screen (256x192 interleaved bitmap + 32x24 attributes) to RGB565.
+ *
+ * Decoding goes a whole bitmap byte (8 pixels) at a time: every attribute has a precomputed set of
+ * four 32-bit words, one per combination of two adjacent pixels (paper/paper, paper/ink, ...), so a
+ * byte turns into four word stores. FLASH is handled by keeping a second set of words with ink and
+ * paper swapped for flashing attributes: switching the flash phase is just picking the other table.
+ *
+ * Output is either landscape (row-major, e.g. a TFT_eSprite canvas that gets rotated on push) or
+ * panel-native (portrait, as lcd_PushColors() wants it), rendered a few columns at a time straight
+ * into the chunk buffer that gets sent.
+ */
+
+const int ZX_SCREEN_WIDTH       = 256;
+const int ZX_SCREEN_HEIGHT      = 192;
+const int ZX_SCREEN_BITMAP_SIZE = 6144;
+const int ZX_SCREEN_SIZE        = 6912;     // Bitmap + attributes
+
+// Which part of the Spectrum screen to show and how big. Landscape output takes the fast path at
+// horizontal scales of exactly 1x or 2x with srcX a multiple of 8, panel-native output at any
+// whole-number scale; anything else is sampled pixel by pixel (nearest).
+struct ZxScreenView {
+    uint16_t srcX, srcY, srcW, srcH;    // Crop, in Spectrum pixels
+    uint16_t dstW, dstH;                // Output size
+};
+
+// Builds the lookup tables. swapBytes gives big-endian pixels as the panel and sprites store them.
+void zx_screen_init(bool swapBytes = true);
+
+// Largest 1:1 view that fits, cropped around the centre (e.g. 256x180 on our 180 pixel tall panel)
+ZxScreenView zx_screen_view_fit(uint16_t maxW, uint16_t maxH);
+
+// Whole screen scaled to an arbitrary size (thumbnails)
+ZxScreenView zx_screen_view_scaled(uint16_t dstW, uint16_t dstH);
+
+// True if any attribute has FLASH set, i.e. the screen needs redrawing every 16 frames
+bool zx_screen_has_flash(const uint8_t *screen);
+
+// Landscape output: dstH rows of dstW pixels, "stride" pixels apart
+void zx_screen_render(const uint8_t *screen, const ZxScreenView &view, bool flashPhase,
+                      uint16_t *dst, int stride);
+
+// Panel-native output of output columns [firstCol, firstCol + cols): each column becomes one native
+// row of dstH pixels, bottom of the picture first, matching lcd_PushColors_rotated_90's layout.
+void zx_screen_render_native(const uint8_t *screen, const ZxScreenView &view, bool flashPhase,
+                             uint16_t *dst, int firstCol, int cols);
+
+// Draws the screen at landscape (x, y) on the panel through a SEND_BUF_SIZE chunk buffer, no
+// full-frame buffer or rotation pass involved. Device only (zx_screen_draw.cpp).
+void zx_screen_draw(const uint8_t *screen, const ZxScreenView &view, bool flashPhase, uint16_t x, uint16_t y);
+
+#endif
@@ -0,0 +1,21 @@
+#include <Arduino.h>
+#include "config.h"
+#include "zx_screen.h"
+#include "display/AXS15231B.h"
+
+void zx_screen_draw(const uint8_t *screen, const ZxScreenView &view, bool flashPhase, uint16_t x, uint16_t y)
+{
+    // As many whole native rows (landscape columns) as fit in one SPI chunk
+    static uint16_t chunk[SEND_BUF_SIZE];
+    const int colsPerChunk = SEND_BUF_SIZE / view.dstH;
+
+    // Same mapping as lcd_PushColors_rotated_90: landscape x runs down the panel, y runs right to left.
+    // The usual alignment rule applies, y and dstH should be multiples of 4.
+    uint16_t nativeX = LCD_HEIGHT - (y + view.dstH);
+
+    for (int col = 0; col < view.dstW; col += colsPerChunk) {
+        int cols = view.dstW - col < colsPerChunk ? view.dstW - col : colsPerChunk;
+        zx_screen_render_native(screen, view, flashPhase, chunk, col, cols);
+        lcd_PushColors(nativeX, x + col, view.dstH, cols, chunk);
+    }
+}
@@ -0,0 +1,85 @@
+#include "image.h"
+#include "jpeg_decoder.h"
+#include "png_decoder.h"
+#include <string.h>
+
+void image_input_file(ImageInput *in, FILE *file)
+{
+    in->file = file;
+    in->data = NULL;
+    in->size = 0;
+    in->pos = in->len = 0;
+    in->eof = false;
+}
+
+void image_input_memory(ImageInput *in, const uint8_t *data, size_t size)
+{
+    in->file = NULL;
+    in->data = data;
+    in->size = size;
+    in->pos = 0;
+    in->len = size;
+    in->eof = true;             // Nothing to refill from
+}
+
+bool image_input_refill(ImageInput *in)
+{
+    if (in->eof || !in->file)
+        return false;
+    in->len = fread(in->buf, 1, IMAGE_INPUT_SIZE, in->file);
+    in->pos = 0;
+    if (in->len < IMAGE_INPUT_SIZE)
+        in->eof = true;
+    return in->len > 0;
+}
+
+bool image_skip(ImageInput *in, uint32_t bytes)
+{
+    while (bytes > 0) {
+        if (in->pos == in->len && !image_input_refill(in))
+            return false;
+        size_t n = in->len - in->pos;
+        if (n > bytes)
+            n = bytes;
+        in->pos += n;
+        bytes -= (uint32_t)n;
+    }
+    return true;
+}
+
+ImageFormat image_sniff(const uint8_t *head, size_t len)
+{
+    static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (len >= 3 && head[0] == 0xFF && head[1] == 0xD8 && head[2] == 0xFF)
+        return IMAGE_JPEG;
+    if (len >= 8 && memcmp(head, PNG_SIGNATURE, 8) == 0)
+        return IMAGE_PNG;
+    return IMAGE_UNKNOWN;
+}
+
+// Format of what's next in the input, without consuming it
+static ImageFormat peek_format(ImageInput *in)
+{
+    if (in->pos == in->len && !image_input_refill(in))
+        return IMAGE_UNKNOWN;
+    const uint8_t *head = (in->file ? in->buf : in->data) + in->pos;
+    return image_sniff(head, in->len - in->pos);
+}
+
+bool image_size(ImageInput *in, uint16_t *width, uint16_t *height)
+{
+    switch (peek_format(in)) {
+    case IMAGE_JPEG:    return jpeg_size(in, width, height);
+    case IMAGE_PNG:     return png_size(in, width, height);
+    default:            return false;
+    }
+}
+
+ImageResult image_decode(ImageInput *in, const ImageTarget &target)
+{
+    switch (peek_format(in)) {
+    case IMAGE_JPEG:    return jpeg_decode(in, target);
+    case IMAGE_PNG:     return png_decode(in, target);
+    default:            return IMAGE_UNSUPPORTED;
+    }
+}
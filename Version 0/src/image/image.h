@@ -0,0 +1,104 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Image loading (JPEG and PNG from storage)
+ *
+ * Images decode a little at a time into small tiles that are already in panel order: converted
+ * to RGB565 in the panel's byte order and rotated, one native row per landscape column (the layout
+ * of zx_screen_render_native()). Each finished tile goes to a flush callback, which hands back the
+ * buffer for the next one, so the device can push a tile with DMA while the next decodes.
+ *
+ * JPEG tiles are a few MCUs side by side (an MCU row is decoded block by block anyway), PNG tiles
+ * are bands of whole scanlines. Either way a tile is at most IMAGE_TILE_PIXELS, so memory stays at
+ * a few KB plus, for PNG, two scanlines and the 32 KB inflate window, whatever the size of the
+ * image. Parts of the image outside the target area are cropped, not scaled.
+ *
+ * Supported: baseline JPEG (Huffman, 8-bit, greyscale or YCbCr with 1x1, 2x1 and 2x2 luma
+ * sampling over 1x1 chroma, restart markers) and non-interlaced PNG (every colour type and bit
+ * depth; alpha is blended over black). Progressive JPEG and interlaced PNG are rejected.
+ */
+
+const size_t IMAGE_TILE_PIXELS  = 2560;     // A band of 4 full-width rows
+const size_t IMAGE_INPUT_SIZE   = 1024;     // Read from storage at a time
+
+enum ImageFormat : uint8_t {
+    IMAGE_UNKNOWN,
+    IMAGE_JPEG,
+    IMAGE_PNG,
+};
+
+enum ImageResult : uint8_t {
+    IMAGE_OK,
+    IMAGE_UNSUPPORTED,          // Valid but uses something we don't decode (progressive, interlaced, ...)
+    IMAGE_CORRUPT,
+    IMAGE_NO_MEMORY,
+};
+
+// A decoded tile: landscape rect on screen, pixels w native rows of h, bottom of the tile first
+struct ImageTile {
+    uint16_t x, y, w, h;
+    uint16_t *pixels;
+};
+
+// Takes a finished tile and returns the buffer (IMAGE_TILE_PIXELS) to decode the next one into
+typedef uint16_t *(*ImageFlushFn)(const ImageTile &tile, void *ctx);
+
+// Where a decode goes: image pixel (0, 0) lands at landscape (x, y), anything beyond w x h is cropped
+struct ImageTarget {
+    uint16_t x, y, w, h;
+    uint16_t *buffer;           // First tile buffer, IMAGE_TILE_PIXELS
+    ImageFlushFn flush;
+    void *ctx;
+};
+
+// Buffered byte input from a file or memory
+struct ImageInput {
+    FILE *file;
+    const uint8_t *data;
+    size_t size;
+    size_t pos, len;            // Into buf (or data)
+    bool eof;
+    uint8_t buf[IMAGE_INPUT_SIZE];
+};
+
+void image_input_file(ImageInput *in, FILE *file);
+void image_input_memory(ImageInput *in, const uint8_t *data, size_t size);
+bool image_input_refill(ImageInput *in);
+
+// Next byte, or -1 at the end
+static inline int image_getc(ImageInput *in)
+{
+    if (in->pos == in->len && !image_input_refill(in))
+        return -1;
+    return (in->file ? in->buf : in->data)[in->pos++];
+}
+
+bool image_skip(ImageInput *in, uint32_t bytes);
+
+// Format from the first bytes (at least 8)
+ImageFormat image_sniff(const uint8_t *head, size_t len);
+
+// Size of the image without decoding it
+bool image_size(ImageInput *in, uint16_t *width, uint16_t *height);
+
+// Decodes the whole image into the target
+ImageResult image_decode(ImageInput *in, const ImageTarget &target);
+
+// RGB888 to RGB565 in panel byte order
+static inline uint16_t image_rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+    uint16_t c = (uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+    return (uint16_t)(c >> 8 | c << 8);
+}
+
+// Draws an image file at landscape (x, y), cropped to the screen, flushing tiles with DMA while the
+// next one decodes. y should be a multiple of 4; rows are drawn in fours, so up to 3 at the bottom
+// are dropped. Device only (image_draw.cpp).
+ImageResult image_draw_file(const char *path, uint16_t x, uint16_t y);
+
+#endif
@@ -0,0 +1,56 @@
+#include <Arduino.h>
+#include "config.h"
+#include "image.h"
+#include "display/AXS15231B.h"
+
+// Two tile buffers: one going out over DMA while the decoder fills the other
+static uint16_t *tiles[2];
+static uint8_t nextTile;
+
+static uint16_t *flush_tile(const ImageTile &tile, void *ctx)
+{
+    (void)ctx;
+    // Landscape to native, as in zx_screen_draw: the tile's columns are native rows
+    lcd_push_async(LCD_HEIGHT - (tile.y + tile.h), tile.x, tile.h, tile.w, tile.pixels);
+    uint16_t *next = tiles[nextTile];
+    nextTile ^= 1;
+    return next;
+}
+
+ImageResult image_draw_file(const char *path, uint16_t x, uint16_t y)
+{
+    if (x >= LCD_WIDTH || y >= LCD_HEIGHT)
+        return IMAGE_OK;
+    if (!tiles[0]) {
+        tiles[0] = (uint16_t *)heap_caps_malloc(IMAGE_TILE_PIXELS * 2, MALLOC_CAP_DMA);
+        tiles[1] = (uint16_t *)heap_caps_malloc(IMAGE_TILE_PIXELS * 2, MALLOC_CAP_DMA);
+        if (!tiles[0] || !tiles[1]) {
+            heap_caps_free(tiles[0]);
+            heap_caps_free(tiles[1]);
+            tiles[0] = tiles[1] = NULL;
+            return IMAGE_NO_MEMORY;
+        }
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return IMAGE_CORRUPT;
+    static ImageInput in;
+    image_input_file(&in, f);
+    uint16_t width, height;
+    if (!image_size(&in, &width, &height)) {
+        fclose(f);
+        return IMAGE_UNSUPPORTED;
+    }
+    rewind(f);
+    image_input_file(&in, f);
+
+    // The panel takes native columns in fours, so the drawn rows are cut to a multiple of 4
+    uint16_t rows = height < LCD_HEIGHT - y ? height : LCD_HEIGHT - y;
+    ImageTarget target = {x, y, (uint16_t)(LCD_WIDTH - x), (uint16_t)(rows & ~3), tiles[0], flush_tile, NULL};
+    nextTile = 1;
+    ImageResult result = image_decode(&in, target);
+    lcd_push_wait();
+    fclose(f);
+    return result;
+}
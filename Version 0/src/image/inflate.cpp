@@ -0,0 +1,295 @@
+#include "inflate.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                       513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                       8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static const uint8_t MAX_PAD_BYTES = 8;     // Zero bytes fed past the end of the input before giving up
+
+static InflateTable fixedLengths, fixedDistances;
+static bool fixedBuilt = false;
+
+// Canonical code from code lengths. Incomplete codes are allowed (deflate uses them for single codes).
+static bool build(InflateTable *t, const uint8_t *lengths, int n)
+{
+    memset(t->count, 0, sizeof(t->count));
+    for (int i = 0; i < n; i++)
+        t->count[lengths[i]]++;
+    t->count[0] = 0;
+
+    int left = 1;
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - t->count[len];
+        if (left < 0)
+            return false;       // Over-subscribed
+        if (len < 15)
+            offsets[len + 1] = offsets[len] + t->count[len];
+    }
+    for (int sym = 0; sym < n; sym++) {
+        if (lengths[sym])
+            t->symbol[offsets[lengths[sym]]++] = (uint16_t)sym;
+    }
+
+    // Short codes go in the lookup table, bit-reversed since deflate sends codes MSB first but
+    // everything else LSB first, at every index that starts with them
+    memset(t->fast, 0, sizeof(t->fast));
+    uint32_t code = 0;
+    int index = 0;
+    for (int len = 1; len <= INFLATE_FAST_BITS; len++) {
+        for (int k = 0; k < t->count[len]; k++, code++, index++) {
+            uint32_t rev = 0;
+            for (int b = 0; b < len; b++)
+                rev |= ((code >> b) & 1) << (len - 1 - b);
+            for (uint32_t fill = rev; fill < (1u << INFLATE_FAST_BITS); fill += 1u << len)
+                t->fast[fill] = (uint16_t)(len << 9 | t->symbol[index]);
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+static void build_fixed()
+{
+    uint8_t lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    build(&fixedLengths, lengths, 288);
+    memset(lengths, 5, 30);
+    build(&fixedDistances, lengths, 30);
+    fixedBuilt = true;
+}
+
+static inline void need(Inflate *z, uint8_t n)
+{
+    while (z->bitCount < n) {
+        int b = z->next(z->ctx);
+        if (b < 0) {
+            // Past the end: zeros, so a final code can still be looked up, but not for long
+            if (++z->padBytes > MAX_PAD_BYTES)
+                z->error = true;
+            b = 0;
+        }
+        z->bits |= (uint32_t)b << z->bitCount;
+        z->bitCount += 8;
+    }
+}
+
+static inline uint32_t get_bits(Inflate *z, uint8_t n)
+{
+    if (n == 0)
+        return 0;
+    need(z, n);
+    uint32_t v = z->bits & ((1u << n) - 1);
+    z->bits >>= n;
+    z->bitCount -= n;
+    return v;
+}
+
+static int decode(Inflate *z, const InflateTable *t)
+{
+    need(z, 15);
+    uint16_t f = t->fast[z->bits & ((1u << INFLATE_FAST_BITS) - 1)];
+    if (f) {
+        z->bits >>= f >> 9;
+        z->bitCount -= f >> 9;
+        return f & 0x1FF;
+    }
+
+    // Longer code: walk the canonical code one bit at a time
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++) {
+        code |= (z->bits >> (len - 1)) & 1;
+        int count = t->count[len];
+        if (code - count < first) {
+            z->bits >>= len;
+            z->bitCount -= len;
+            return t->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    z->error = true;
+    return -1;
+}
+
+static bool dynamic_tables(Inflate *z)
+{
+    int lengthCodes = get_bits(z, 5) + 257;
+    int distCodes = get_bits(z, 5) + 1;
+    int codeLengthCodes = get_bits(z, 4) + 4;
+    if (lengthCodes > 286 || distCodes > 30)
+        return false;
+
+    uint8_t lengths[286 + 30];
+    memset(lengths, 0, 19);
+    for (int i = 0; i < codeLengthCodes; i++)
+        lengths[CODE_LENGTH_ORDER[i]] = (uint8_t)get_bits(z, 3);
+    if (!build(&z->distances, lengths, 19))      // Borrowed for the code length code
+        return false;
+
+    int index = 0;
+    while (index < lengthCodes + distCodes) {
+        int sym = decode(z, &z->distances);
+        if (sym < 0)
+            return false;
+        if (sym < 16) {
+            lengths[index++] = (uint8_t)sym;
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (sym == 16) {
+            if (index == 0)
+                return false;
+            value = lengths[index - 1];
+            repeat = 3 + get_bits(z, 2);
+        } else if (sym == 17) {
+            repeat = 3 + get_bits(z, 3);
+        } else {
+            repeat = 11 + get_bits(z, 7);
+        }
+        if (index + repeat > lengthCodes + distCodes)
+            return false;
+        memset(lengths + index, value, repeat);
+        index += repeat;
+    }
+    if (lengths[256] == 0)
+        return false;           // No end-of-block code
+    return build(&z->lengths, lengths, lengthCodes) && build(&z->distances, lengths + lengthCodes, distCodes);
+}
+
+static bool start_block(Inflate *z)
+{
+    uint32_t header = get_bits(z, 3);
+    z->lastBlock = header & 1;
+    z->stored = false;
+    switch (header >> 1) {
+    case 0: {
+        get_bits(z, z->bitCount & 7);       // To a byte boundary
+        uint32_t len = get_bits(z, 16);
+        uint32_t nlen = get_bits(z, 16);
+        if ((len ^ 0xFFFF) != nlen)
+            return false;
+        z->stored = true;
+        z->storedLeft = len;
+        break;
+    }
+    case 1:
+        if (!fixedBuilt)
+            build_fixed();
+        z->lengths = fixedLengths;
+        z->distances = fixedDistances;
+        break;
+    case 2:
+        if (!dynamic_tables(z))
+            return false;
+        break;
+    default:
+        return false;
+    }
+    z->inBlock = true;
+    return true;
+}
+
+bool inflate_begin(Inflate *z, InflateByteFn next, void *ctx)
+{
+    memset(z, 0, sizeof(*z));
+    z->next = next;
+    z->ctx = ctx;
+
+    int cmf = next(ctx), flg = next(ctx);
+    if (cmf < 0 || flg < 0 || (cmf & 15) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20))
+        return false;           // Not deflate, bad check bits, or a preset dictionary
+    uint32_t windowBits = (cmf >> 4) + 8;
+    if (windowBits > 15)
+        return false;
+    z->windowSize = 1u << windowBits;
+    z->window = (uint8_t *)calloc(z->windowSize, 1);
+    return z->window != NULL;
+}
+
+void inflate_end(Inflate *z)
+{
+    free(z->window);
+    z->window = NULL;
+}
+
+size_t inflate_read(Inflate *z, uint8_t *dst, size_t len)
+{
+    const uint32_t mask = z->windowSize - 1;
+    size_t out = 0;
+
+    while (out < len && !z->done && !z->error) {
+        if (z->copyLeft) {
+            while (z->copyLeft && out < len) {
+                uint8_t b = z->window[(z->windowPos - z->copyDist) & mask];
+                z->window[z->windowPos++ & mask] = b;
+                dst[out++] = b;
+                z->copyLeft--;
+            }
+            continue;
+        }
+        if (!z->inBlock) {
+            if (!start_block(z))
+                z->error = true;
+            continue;
+        }
+
+        if (z->stored) {
+            if (z->storedLeft == 0) {
+                z->inBlock = false;
+                z->done = z->lastBlock;
+                continue;
+            }
+            uint8_t b = (uint8_t)get_bits(z, 8);
+            z->window[z->windowPos++ & mask] = b;
+            dst[out++] = b;
+            z->storedLeft--;
+            continue;
+        }
+
+        int sym = decode(z, &z->lengths);
+        if (sym < 256) {
+            if (sym < 0)
+                break;
+            z->window[z->windowPos++ & mask] = (uint8_t)sym;
+            dst[out++] = (uint8_t)sym;
+        } else if (sym == 256) {
+            z->inBlock = false;
+            z->done = z->lastBlock;
+        } else {
+            sym -= 257;
+            if (sym >= 29) {
+                z->error = true;
+                break;
+            }
+            uint32_t length = LENGTH_BASE[sym] + get_bits(z, LENGTH_EXTRA[sym]);
+            int d = decode(z, &z->distances);
+            if (d < 0 || d >= 30) {
+                z->error = true;
+                break;
+            }
+            uint32_t dist = DIST_BASE[d] + get_bits(z, DIST_EXTRA[d]);
+            if (dist > z->windowSize) {
+                z->error = true;
+                break;
+            }
+            z->copyLeft = length;
+            z->copyDist = dist;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,60 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Streaming zlib/deflate decompressor (RFC 1950/1951), for PNG.
+ *
+ * Output is pulled a few bytes at a time (a PNG scanline) and input is pulled a byte at a time
+ * from a callback, so nothing but the history window is buffered. The window is as big as the
+ * stream's zlib header says it needs (32 KB for most encoders, less for small images written by
+ * careful ones).
+ *
+ * Huffman codes up to INFLATE_FAST_BITS long are decoded with one table lookup; longer ones (rare)
+ * fall back to walking the canonical code a bit at a time.
+ */
+
+const uint8_t INFLATE_FAST_BITS = 9;
+
+// Next compressed byte, or -1 at the end of the input
+typedef int (*InflateByteFn)(void *ctx);
+
+struct InflateTable {
+    uint16_t fast[1 << INFLATE_FAST_BITS];  // (length << 9) | symbol, 0 for codes too long for the table
+    uint16_t count[16];                     // Codes of each length
+    uint16_t symbol[288];                   // Symbols in canonical order
+};
+
+struct Inflate {
+    InflateByteFn next;
+    void *ctx;
+    uint32_t bits;              // LSB first
+    uint8_t bitCount;
+    uint8_t padBytes;           // Zeros fed in past the end of the input
+
+    uint8_t *window;
+    uint32_t windowSize;        // Power of two
+    uint32_t windowPos;
+
+    bool lastBlock;
+    bool inBlock;
+    bool stored;
+    uint32_t storedLeft;
+    uint32_t copyLeft, copyDist;    // A back-reference not finished yet
+    bool done;
+    bool error;
+
+    InflateTable lengths;       // Literal/length codes of the current block
+    InflateTable distances;
+};
+
+// Reads the zlib header and allocates the window. False if it isn't a zlib stream or there's no memory.
+bool inflate_begin(Inflate *z, InflateByteFn next, void *ctx);
+void inflate_end(Inflate *z);
+
+// Up to len bytes of output; fewer only at the end of the stream or on an error
+size_t inflate_read(Inflate *z, uint8_t *dst, size_t len);
+
+#endif
@@ -0,0 +1,573 @@
+#include "jpeg_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t JPEG_FAST_BITS = 9;
+static const uint8_t JPEG_MAX_COMPONENTS = 3;
+
+// Zigzag position to natural (row-major) position in the block
+static const uint8_t ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+enum JpegMarker : uint8_t {
+    MARKER_SOF0 = 0xC0,         // Baseline
+    MARKER_SOF1 = 0xC1,         // Extended sequential, Huffman
+    MARKER_DHT  = 0xC4,
+    MARKER_RST0 = 0xD0,
+    MARKER_SOI  = 0xD8,
+    MARKER_EOI  = 0xD9,
+    MARKER_SOS  = 0xDA,
+    MARKER_DQT  = 0xDB,
+    MARKER_DNL  = 0xDC,
+    MARKER_DRI  = 0xDD,
+};
+
+struct JpegHuffman {
+    uint16_t fast[1 << JPEG_FAST_BITS];     // (length << 8) | symbol, 0 for codes too long for the table
+    uint16_t count[17];                     // Codes of each length
+    uint8_t symbol[256];                    // Symbols in canonical order
+};
+
+struct JpegComponent {
+    uint8_t id;
+    uint8_t h, v;               // Sampling factors
+    uint8_t quant;
+    uint8_t dcTable, acTable;
+    int dcPred;
+    uint8_t offset;             // First of its blocks in the MCU buffer
+};
+
+struct JpegDecoder {
+    ImageInput *in;
+    uint16_t width, height;
+    uint8_t componentCount;
+    JpegComponent components[JPEG_MAX_COMPONENTS];
+    uint8_t hMax, vMax;
+    uint16_t restartInterval;
+
+    uint16_t quant[4][64];      // Zigzag order
+    JpegHuffman dc[2], ac[2];
+    bool dcDefined[2], acDefined[2];
+
+    uint32_t bits;              // MSB first
+    int8_t bitCount;
+    uint8_t marker;             // Marker met in the entropy-coded data, 0 if none yet
+
+    int16_t coef[64];
+    uint8_t samples[6][64];     // One MCU: up to 4 luma blocks and 2 chroma
+};
+
+static int read_be16(ImageInput *in)
+{
+    int hi = image_getc(in), lo = image_getc(in);
+    return hi < 0 || lo < 0 ? -1 : hi << 8 | lo;
+}
+
+// ---- Markers and tables
+
+// Next marker code, skipping anything (fill bytes included) before it
+static int next_marker(ImageInput *in)
+{
+    int b;
+    do {
+        while ((b = image_getc(in)) >= 0 && b != 0xFF) {
+        }
+        while (b == 0xFF)
+            b = image_getc(in);
+    } while (b == 0);
+    return b;
+}
+
+static bool build_huffman(JpegHuffman *t, const uint8_t *counts, const uint8_t *symbols, int n)
+{
+    t->count[0] = 0;
+    for (int len = 1; len <= 16; len++)
+        t->count[len] = counts[len - 1];
+    memcpy(t->symbol, symbols, n);
+
+    memset(t->fast, 0, sizeof(t->fast));
+    uint32_t code = 0;
+    int index = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int k = 0; k < t->count[len]; k++, code++, index++) {
+            if (code >= (1u << len))
+                return false;       // Over-subscribed
+            if (len <= JPEG_FAST_BITS) {
+                uint32_t first = code << (JPEG_FAST_BITS - len);
+                for (uint32_t j = 0; j < (1u << (JPEG_FAST_BITS - len)); j++)
+                    t->fast[first + j] = (uint16_t)(len << 8 | t->symbol[index]);
+            }
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+static ImageResult read_dht(JpegDecoder *d, int len)
+{
+    while (len > 0) {
+        int info = image_getc(d->in);
+        uint8_t counts[16];
+        int n = 0;
+        for (int i = 0; i < 16; i++) {
+            int c = image_getc(d->in);
+            if (c < 0)
+                return IMAGE_CORRUPT;
+            counts[i] = (uint8_t)c;
+            n += c;
+        }
+        if (info < 0 || n > 256 || len < 17 + n)
+            return IMAGE_CORRUPT;
+        uint8_t symbols[256];
+        for (int i = 0; i < n; i++)
+            symbols[i] = (uint8_t)image_getc(d->in);
+        len -= 17 + n;
+
+        uint8_t id = info & 15, isAc = info >> 4;
+        if (id > 1 || isAc > 1)
+            return IMAGE_UNSUPPORTED;       // Tables 2 and 3 only exist beyond baseline
+        JpegHuffman *t = isAc ? &d->ac[id] : &d->dc[id];
+        if (!build_huffman(t, counts, symbols, n))
+            return IMAGE_CORRUPT;
+        (isAc ? d->acDefined : d->dcDefined)[id] = true;
+    }
+    return len == 0 ? IMAGE_OK : IMAGE_CORRUPT;
+}
+
+static ImageResult read_dqt(JpegDecoder *d, int len)
+{
+    while (len > 0) {
+        int info = image_getc(d->in);
+        if (info < 0 || (info & 15) > 3)
+            return IMAGE_CORRUPT;
+        bool wide = info >> 4;
+        for (int i = 0; i < 64; i++)
+            d->quant[info & 15][i] = (uint16_t)(wide ? read_be16(d->in) : image_getc(d->in));
+        len -= 1 + (wide ? 128 : 64);
+    }
+    return len == 0 ? IMAGE_OK : IMAGE_CORRUPT;
+}
+
+static ImageResult read_sof(JpegDecoder *d, int len)
+{
+    int precision = image_getc(d->in);
+    int height = read_be16(d->in), width = read_be16(d->in);
+    int count = image_getc(d->in);
+    if (count < 0 || len != 6 + count * 3)
+        return IMAGE_CORRUPT;
+    if (precision != 8 || height == 0 || (count != 1 && count != 3))
+        return IMAGE_UNSUPPORTED;       // 12-bit, height in a DNL marker, CMYK
+    if (width <= 0)
+        return IMAGE_CORRUPT;
+    d->width = (uint16_t)width;
+    d->height = (uint16_t)height;
+    d->componentCount = (uint8_t)count;
+    d->hMax = d->vMax = 1;
+
+    for (int i = 0; i < count; i++) {
+        JpegComponent &c = d->components[i];
+        c.id = (uint8_t)image_getc(d->in);
+        int sampling = image_getc(d->in);
+        c.h = (uint8_t)(sampling >> 4);
+        c.v = (uint8_t)(sampling & 15);
+        c.quant = (uint8_t)image_getc(d->in);
+        if (c.h < 1 || c.v < 1 || c.quant > 3)
+            return IMAGE_CORRUPT;
+        if (c.h > 2 || c.v > 2)
+            return IMAGE_UNSUPPORTED;
+        if (c.h > d->hMax)
+            d->hMax = c.h;
+        if (c.v > d->vMax)
+            d->vMax = c.v;
+    }
+    if (count == 1)
+        d->hMax = d->vMax = d->components[0].h = d->components[0].v = 1;       // One block per MCU
+    int blocks = 0;
+    for (int i = 0; i < count; i++) {
+        const JpegComponent &c = d->components[i];
+        if (d->hMax % c.h || d->vMax % c.v)
+            return IMAGE_UNSUPPORTED;
+        if (i > 0 && (c.h != 1 || c.v != 1))
+            return IMAGE_UNSUPPORTED;       // Only luma is subsampled: one block of each chroma per MCU
+        blocks += c.h * c.v;
+    }
+    if (blocks > (int)(sizeof(d->samples) / sizeof(d->samples[0])))
+        return IMAGE_UNSUPPORTED;
+    return IMAGE_OK;
+}
+
+static ImageResult read_sos(JpegDecoder *d, int len)
+{
+    int count = image_getc(d->in);
+    if (count < 1 || len != 4 + count * 2)
+        return IMAGE_CORRUPT;
+    if (count != d->componentCount)
+        return IMAGE_UNSUPPORTED;       // One scan per component
+    uint8_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        int id = image_getc(d->in), tables = image_getc(d->in);
+        JpegComponent *c = NULL;
+        for (int k = 0; k < d->componentCount; k++) {
+            if (d->components[k].id == id)
+                c = &d->components[k];
+        }
+        if (!c || tables < 0)
+            return IMAGE_CORRUPT;
+        c->dcTable = (uint8_t)(tables >> 4);
+        c->acTable = (uint8_t)(tables & 15);
+        if (c->dcTable > 1 || c->acTable > 1 || !d->dcDefined[c->dcTable] || !d->acDefined[c->acTable])
+            return IMAGE_CORRUPT;
+        c->dcPred = 0;
+        c->offset = offset;
+        offset += c->h * c->v;
+    }
+    int start = image_getc(d->in), end = image_getc(d->in), approx = image_getc(d->in);
+    if (start != 0 || end != 63 || approx != 0)
+        return IMAGE_UNSUPPORTED;
+    return IMAGE_OK;
+}
+
+// Markers up to the start of the scan (or just past SOF, for the size)
+static ImageResult read_headers(JpegDecoder *d, bool sizeOnly)
+{
+    if (image_getc(d->in) != 0xFF || image_getc(d->in) != MARKER_SOI)
+        return IMAGE_CORRUPT;
+    bool haveFrame = false;
+    for (;;) {
+        int marker = next_marker(d->in);
+        if (marker < 0 || marker == MARKER_EOI)
+            return IMAGE_CORRUPT;
+        if (marker >= MARKER_RST0 && marker < MARKER_RST0 + 8)
+            continue;
+        int len = read_be16(d->in) - 2;
+        if (len < 0)
+            return IMAGE_CORRUPT;
+
+        ImageResult r = IMAGE_OK;
+        if (marker == MARKER_SOF0 || marker == MARKER_SOF1) {
+            r = read_sof(d, len);
+            haveFrame = r == IMAGE_OK;
+            if (sizeOnly)
+                return r;
+        } else if ((marker >= 0xC2 && marker <= 0xCF && marker != MARKER_DHT && marker != 0xC8 && marker != 0xCC)) {
+            return IMAGE_UNSUPPORTED;       // Progressive, lossless, hierarchical, arithmetic
+        } else if (marker == MARKER_DHT) {
+            r = read_dht(d, len);
+        } else if (marker == MARKER_DQT) {
+            r = read_dqt(d, len);
+        } else if (marker == MARKER_DRI) {
+            d->restartInterval = (uint16_t)read_be16(d->in);
+            r = len == 2 ? IMAGE_OK : IMAGE_CORRUPT;
+        } else if (marker == MARKER_SOS) {
+            return haveFrame ? read_sos(d, len) : IMAGE_CORRUPT;
+        } else if (!image_skip(d->in, len)) {
+            r = IMAGE_CORRUPT;
+        }
+        if (r != IMAGE_OK)
+            return r;
+    }
+}
+
+// ---- Entropy-coded data
+
+// Tops the bit buffer up to at least 25 bits. Past a marker it's fed zeros; the marker is kept.
+static inline void fill(JpegDecoder *d)
+{
+    while (d->bitCount <= 24) {
+        int b = 0;
+        if (!d->marker) {
+            b = image_getc(d->in);
+            if (b == 0xFF) {
+                int next = image_getc(d->in);
+                while (next == 0xFF)
+                    next = image_getc(d->in);
+                if (next != 0) {
+                    d->marker = next < 0 ? MARKER_EOI : (uint8_t)next;
+                    b = 0;
+                }
+            } else if (b < 0) {
+                d->marker = MARKER_EOI;
+                b = 0;
+            }
+        }
+        d->bits |= (uint32_t)b << (24 - d->bitCount);
+        d->bitCount += 8;
+    }
+}
+
+static inline int get_bits(JpegDecoder *d, uint8_t n)
+{
+    if (n == 0)
+        return 0;
+    fill(d);
+    int v = (int)(d->bits >> (32 - n));
+    d->bits <<= n;
+    d->bitCount -= n;
+    return v;
+}
+
+// JPEG's sign convention: n bits below 2^(n - 1) are negative
+static inline int extend(int v, uint8_t n)
+{
+    return n && v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+}
+
+static inline int decode(JpegDecoder *d, const JpegHuffman *t)
+{
+    fill(d);
+    uint16_t f = t->fast[d->bits >> (32 - JPEG_FAST_BITS)];
+    if (f) {
+        d->bits <<= f >> 8;
+        d->bitCount -= f >> 8;
+        return f & 0xFF;
+    }
+
+    // Longer code: walk the canonical code a bit at a time (at most 16 bits, and fill left 25)
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= 16; len++) {
+        code |= (d->bits >> (32 - len)) & 1;
+        int count = t->count[len];
+        if (code - count < first) {
+            d->bits <<= len;
+            d->bitCount -= len;
+            return t->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static bool decode_block(JpegDecoder *d, JpegComponent &c)
+{
+    memset(d->coef, 0, sizeof(d->coef));
+    const uint16_t *q = d->quant[c.quant];
+
+    int s = decode(d, &d->dc[c.dcTable]);
+    if (s < 0 || s > 11)
+        return false;
+    c.dcPred += extend(get_bits(d, (uint8_t)s), (uint8_t)s);
+    d->coef[0] = (int16_t)(c.dcPred * q[0]);
+
+    const JpegHuffman *ac = &d->ac[c.acTable];
+    for (int k = 1; k < 64; k++) {
+        int rs = decode(d, ac);
+        if (rs < 0)
+            return false;
+        uint8_t run = rs >> 4, size = rs & 15;
+        if (size == 0) {
+            if (run != 15)
+                break;          // End of block
+            k += 15;
+            continue;
+        }
+        k += run;
+        if (k > 63)
+            return false;
+        d->coef[ZIGZAG[k]] = (int16_t)(extend(get_bits(d, size), size) * q[k]);
+    }
+    return true;
+}
+
+// Past a restart interval: drop the padding bits, expect RSTn and start the predictions over
+static bool restart(JpegDecoder *d)
+{
+    if (!d->marker)
+        d->marker = (uint8_t)next_marker(d->in);
+    if (d->marker < MARKER_RST0 || d->marker >= MARKER_RST0 + 8)
+        return false;
+    d->marker = 0;
+    d->bits = 0;
+    d->bitCount = 0;
+    for (uint8_t i = 0; i < d->componentCount; i++)
+        d->components[i].dcPred = 0;
+    return true;
+}
+
+// ---- IDCT and colour
+
+static inline uint8_t clamp(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+// Fixed point with 12 fraction bits
+#define F2F(x) ((int)((x) * 4096 + 0.5))
+
+// One 8-point IDCT pass (the jidctint factorisation): out[i] and out[7 - i] are even[i] +- odd[i]
+static inline void idct_1d(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7, int even[4], int odd[4])
+{
+    int p1 = (s2 + s6) * F2F(0.5411961);
+    int t2 = p1 + s6 * F2F(-1.847759065);
+    int t3 = p1 + s2 * F2F(0.765366865);
+    int t0 = (s0 + s4) * 4096;
+    int t1 = (s0 - s4) * 4096;
+    even[0] = t0 + t3;
+    even[3] = t0 - t3;
+    even[1] = t1 + t2;
+    even[2] = t1 - t2;
+
+    int q0 = s7, q1 = s5, q2 = s3, q3 = s1;
+    int p3 = q0 + q2, p4 = q1 + q3;
+    p1 = q0 + q3;
+    int p2 = q1 + q2;
+    int p5 = (p3 + p4) * F2F(1.175875602);
+    q0 *= F2F(0.298631336);
+    q1 *= F2F(2.053119869);
+    q2 *= F2F(3.072711026);
+    q3 *= F2F(1.501321110);
+    p1 = p5 + p1 * F2F(-0.899976223);
+    p2 = p5 + p2 * F2F(-2.562915447);
+    p3 *= F2F(-1.961570560);
+    p4 *= F2F(-0.390180644);
+    odd[0] = q3 + p1 + p4;
+    odd[1] = q2 + p2 + p3;
+    odd[2] = q1 + p2 + p4;
+    odd[3] = q0 + p1 + p3;
+}
+
+static void idct_block(const int16_t *in, uint8_t *out)
+{
+    int tmp[64];
+    int even[4], odd[4];
+
+    // Columns, keeping 2 extra bits of precision
+    for (int i = 0; i < 8; i++) {
+        const int16_t *s = in + i;
+        if (!(s[8] | s[16] | s[24] | s[32] | s[40] | s[48] | s[56])) {
+            for (int k = 0; k < 8; k++)
+                tmp[k * 8 + i] = s[0] * 4;
+            continue;
+        }
+        idct_1d(s[0], s[8], s[16], s[24], s[32], s[40], s[48], s[56], even, odd);
+        for (int k = 0; k < 4; k++) {
+            tmp[k * 8 + i] = (even[k] + 512 + odd[k]) >> 10;
+            tmp[(7 - k) * 8 + i] = (even[k] + 512 - odd[k]) >> 10;
+        }
+    }
+
+    // Rows, removing the scaling and adding the 128 level shift
+    for (int i = 0; i < 8; i++) {
+        const int *s = tmp + i * 8;
+        idct_1d(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], even, odd);
+        for (int k = 0; k < 4; k++) {
+            int e = even[k] + 65536 + (128 << 17);
+            out[i * 8 + k] = clamp((e + odd[k]) >> 17);
+            out[i * 8 + 7 - k] = clamp((e - odd[k]) >> 17);
+        }
+    }
+}
+
+// Sample of a component at MCU pixel (px, py), nearest-neighbour upsampled
+static inline uint8_t mcu_sample(const JpegDecoder *d, const JpegComponent &c, uint8_t px, uint8_t py)
+{
+    uint8_t sx = px * c.h / d->hMax, sy = py * c.v / d->vMax;
+    return d->samples[c.offset + (sy >> 3) * c.h + (sx >> 3)][(sy & 7) * 8 + (sx & 7)];
+}
+
+// One MCU into the tile at column col: rows [0, rows) and columns [0, cols) of it
+static void mcu_to_tile(const JpegDecoder *d, uint16_t *tile, uint16_t tileH, uint16_t col, uint8_t cols, uint8_t rows)
+{
+    for (uint8_t px = 0; px < cols; px++) {
+        uint16_t *dst = tile + (size_t)(col + px) * tileH + tileH - 1;
+        for (uint8_t py = 0; py < rows; py++, dst--) {
+            int y = mcu_sample(d, d->components[0], px, py);
+            if (d->componentCount == 1) {
+                *dst = image_rgb565((uint8_t)y, (uint8_t)y, (uint8_t)y);
+                continue;
+            }
+            int cb = mcu_sample(d, d->components[1], px, py) - 128;
+            int cr = mcu_sample(d, d->components[2], px, py) - 128;
+            // BT.601 full range, 16 fraction bits
+            int r = y + ((91881 * cr + 32768) >> 16);
+            int g = y + ((-22554 * cb - 46802 * cr + 32768) >> 16);
+            int b = y + ((116130 * cb + 32768) >> 16);
+            *dst = image_rgb565(clamp(r), clamp(g), clamp(b));
+        }
+    }
+}
+
+static ImageResult decode_scan(JpegDecoder *d, const ImageTarget &target)
+{
+    const uint8_t mcuW = d->hMax * 8, mcuH = d->vMax * 8;
+    const uint16_t mcusX = (d->width + mcuW - 1) / mcuW, mcusY = (d->height + mcuH - 1) / mcuH;
+    const uint16_t visibleW = d->width < target.w ? d->width : target.w;
+    const uint16_t visibleH = d->height < target.h ? d->height : target.h;
+    const uint16_t tileMcus = (uint16_t)(IMAGE_TILE_PIXELS / (mcuW * mcuH));
+    const uint16_t visibleMcusX = (visibleW + mcuW - 1) / mcuW;
+
+    uint16_t *tile = target.buffer;
+    uint32_t untilRestart = d->restartInterval;
+    for (uint16_t my = 0; my < mcusY && my * mcuH < visibleH; my++) {
+        uint16_t top = my * mcuH;
+        uint8_t rows = visibleH - top < mcuH ? (uint8_t)(visibleH - top) : mcuH;
+        uint16_t tileStart = 0;
+
+        for (uint16_t mx = 0; mx < mcusX; mx++) {
+            if (d->restartInterval) {
+                if (untilRestart == 0) {
+                    if (!restart(d))
+                        return IMAGE_CORRUPT;
+                    untilRestart = d->restartInterval;
+                }
+                untilRestart--;
+            }
+
+            bool visible = mx < visibleMcusX;
+            for (uint8_t i = 0; i < d->componentCount; i++) {
+                JpegComponent &c = d->components[i];
+                for (uint8_t b = 0; b < c.h * c.v; b++) {
+                    if (!decode_block(d, c))
+                        return IMAGE_CORRUPT;
+                    if (visible)
+                        idct_block(d->coef, d->samples[c.offset + b]);
+                }
+            }
+            if (!visible)
+                continue;
+
+            // Tile columns so far end at this MCU; flush when the tile is full or the row's visible part ends
+            uint16_t left = mx * mcuW;
+            uint8_t cols = visibleW - left < mcuW ? (uint8_t)(visibleW - left) : mcuW;
+            mcu_to_tile(d, tile, rows, left - tileStart * mcuW, cols, rows);
+            if (mx + 1 - tileStart == tileMcus || mx + 1 == visibleMcusX) {
+                ImageTile t = {(uint16_t)(target.x + tileStart * mcuW), (uint16_t)(target.y + top),
+                               (uint16_t)(left + cols - tileStart * mcuW), rows, tile};
+                tile = target.flush(t, target.ctx);
+                tileStart = mx + 1;
+            }
+        }
+    }
+    return IMAGE_OK;
+}
+
+bool jpeg_size(ImageInput *in, uint16_t *width, uint16_t *height)
+{
+    JpegDecoder *d = (JpegDecoder *)calloc(1, sizeof(JpegDecoder));
+    if (!d)
+        return false;
+    d->in = in;
+    bool ok = read_headers(d, true) == IMAGE_OK;
+    *width = d->width;
+    *height = d->height;
+    free(d);
+    return ok;
+}
+
+ImageResult jpeg_decode(ImageInput *in, const ImageTarget &target)
+{
+    JpegDecoder *d = (JpegDecoder *)calloc(1, sizeof(JpegDecoder));
+    if (!d)
+        return IMAGE_NO_MEMORY;
+    d->in = in;
+    ImageResult result = read_headers(d, false);
+    if (result == IMAGE_OK)
+        result = decode_scan(d, target);
+    free(d);
+    return result;
+}
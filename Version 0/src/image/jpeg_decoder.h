@@ -0,0 +1,19 @@
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include "image.h"
+
+/*
+ * Baseline JPEG by MCU rows. Each MCU is entropy decoded, dequantised, put through an integer
+ * IDCT and colour converted into its place in the tile; a tile is a run of MCUs along one MCU row
+ * (10 MCUs of 16x16 for 4:2:0, 40 of 8x8 for 4:4:4). MCUs right of the target are only entropy
+ * decoded, to keep the bit stream in step; MCU rows below it end the decode.
+ *
+ * Memory: quantisation and Huffman tables (baseline allows two of each kind), one MCU of samples
+ * and one coefficient block, about 6 KB in all.
+ */
+
+bool jpeg_size(ImageInput *in, uint16_t *width, uint16_t *height);
+ImageResult jpeg_decode(ImageInput *in, const ImageTarget &target);
+
+#endif
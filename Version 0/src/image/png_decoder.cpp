@@ -0,0 +1,334 @@
+#include "png_decoder.h"
+#include "inflate.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static constexpr uint32_t chunk_type(char a, char b, char c, char d)
+{
+    return (uint32_t)a << 24 | (uint32_t)b << 16 | (uint32_t)c << 8 | (uint32_t)d;
+}
+
+static const uint32_t CHUNK_IHDR = chunk_type('I', 'H', 'D', 'R');
+static const uint32_t CHUNK_PLTE = chunk_type('P', 'L', 'T', 'E');
+static const uint32_t CHUNK_TRNS = chunk_type('t', 'R', 'N', 'S');
+static const uint32_t CHUNK_IDAT = chunk_type('I', 'D', 'A', 'T');
+static const uint32_t CHUNK_IEND = chunk_type('I', 'E', 'N', 'D');
+
+enum PngColour : uint8_t {
+    PNG_GREY        = 0,
+    PNG_RGB         = 2,
+    PNG_PALETTE     = 3,
+    PNG_GREY_ALPHA  = 4,
+    PNG_RGBA        = 6,
+};
+
+struct PngDecoder {
+    ImageInput *in;
+    uint32_t width, height;
+    uint8_t depth, colour, channels;
+    uint8_t palette[256][4];    // RGBA
+    uint16_t paletteSize;
+    bool hasKey;                // tRNS colour key for grey or RGB
+    uint16_t key[3];
+    uint32_t idatLeft;          // Bytes of the current IDAT chunk not read yet
+    bool idatEnded;
+    Inflate z;
+};
+
+static bool read_be32(ImageInput *in, uint32_t *v)
+{
+    uint32_t x = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = image_getc(in);
+        if (b < 0)
+            return false;
+        x = x << 8 | (uint32_t)b;
+    }
+    *v = x;
+    return true;
+}
+
+// Signature and IHDR, leaving the input after IHDR's CRC
+static ImageResult read_header(PngDecoder *p)
+{
+    for (int i = 0; i < 8; i++) {
+        if (image_getc(p->in) != PNG_SIGNATURE[i])
+            return IMAGE_CORRUPT;
+    }
+    uint32_t len, type;
+    if (!read_be32(p->in, &len) || !read_be32(p->in, &type) || type != CHUNK_IHDR || len != 13)
+        return IMAGE_CORRUPT;
+    if (!read_be32(p->in, &p->width) || !read_be32(p->in, &p->height))
+        return IMAGE_CORRUPT;
+    int depth = image_getc(p->in), colour = image_getc(p->in);
+    int compression = image_getc(p->in), filter = image_getc(p->in), interlace = image_getc(p->in);
+    if (interlace < 0 || !image_skip(p->in, 4))
+        return IMAGE_CORRUPT;
+    p->depth = (uint8_t)depth;
+    p->colour = (uint8_t)colour;
+
+    bool valid;
+    switch (colour) {
+    case PNG_GREY:          p->channels = 1; valid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+    case PNG_PALETTE:       p->channels = 1; valid = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+    case PNG_RGB:           p->channels = 3; valid = depth == 8 || depth == 16; break;
+    case PNG_GREY_ALPHA:    p->channels = 2; valid = depth == 8 || depth == 16; break;
+    case PNG_RGBA:          p->channels = 4; valid = depth == 8 || depth == 16; break;
+    default:                valid = false; break;
+    }
+    if (!valid || compression != 0 || filter != 0 || p->width == 0 || p->height == 0)
+        return IMAGE_CORRUPT;
+    if (interlace != 0 || p->width > 0xFFFF || p->height > 0xFFFF)
+        return IMAGE_UNSUPPORTED;
+    return IMAGE_OK;
+}
+
+// Chunks up to the first IDAT: palette and transparency, anything else skipped
+static ImageResult read_chunks(PngDecoder *p)
+{
+    for (;;) {
+        uint32_t len, type;
+        if (!read_be32(p->in, &len) || !read_be32(p->in, &type))
+            return IMAGE_CORRUPT;
+
+        if (type == CHUNK_IDAT) {
+            p->idatLeft = len;
+            return p->colour == PNG_PALETTE && p->paletteSize == 0 ? IMAGE_CORRUPT : IMAGE_OK;
+        }
+        if (type == CHUNK_IEND)
+            return IMAGE_CORRUPT;
+
+        uint32_t used = 0;
+        if (type == CHUNK_PLTE && len % 3 == 0 && len <= 768) {
+            p->paletteSize = (uint16_t)(len / 3);
+            for (uint16_t i = 0; i < p->paletteSize; i++) {
+                for (int c = 0; c < 3; c++)
+                    p->palette[i][c] = (uint8_t)image_getc(p->in);
+                p->palette[i][3] = 0xFF;
+            }
+            used = len;
+        } else if (type == CHUNK_TRNS && p->colour == PNG_PALETTE && len <= 256) {
+            for (uint32_t i = 0; i < len; i++)
+                p->palette[i][3] = (uint8_t)image_getc(p->in);
+            used = len;
+        } else if (type == CHUNK_TRNS && (p->colour == PNG_GREY || p->colour == PNG_RGB) && len == p->channels * 2u) {
+            for (uint8_t c = 0; c < p->channels; c++) {
+                int hi = image_getc(p->in), lo = image_getc(p->in);
+                p->key[c] = (uint16_t)(hi << 8 | lo);
+            }
+            p->hasKey = true;
+            used = len;
+        }
+        if (!image_skip(p->in, len - used + 4))        // Rest of the chunk and its CRC
+            return IMAGE_CORRUPT;
+    }
+}
+
+// Compressed bytes for inflate, across as many IDAT chunks as there are
+static int idat_next(void *ctx)
+{
+    PngDecoder *p = (PngDecoder *)ctx;
+    while (p->idatLeft == 0) {
+        uint32_t len, type;
+        if (p->idatEnded || !image_skip(p->in, 4) || !read_be32(p->in, &len) || !read_be32(p->in, &type) ||
+            type != CHUNK_IDAT) {
+            p->idatEnded = true;
+            return -1;
+        }
+        p->idatLeft = len;
+    }
+    p->idatLeft--;
+    return image_getc(p->in);
+}
+
+static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+static bool unfilter(uint8_t filter, uint8_t *row, const uint8_t *prev, size_t len, uint8_t bpp)
+{
+    switch (filter) {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = bpp; i < len; i++)
+            row[i] += row[i - bpp];
+        break;
+    case 2:
+        for (size_t i = 0; i < len; i++)
+            row[i] += prev[i];
+        break;
+    case 3:
+        for (size_t i = 0; i < len; i++)
+            row[i] += (uint8_t)(((i >= bpp ? row[i - bpp] : 0) + prev[i]) >> 1);
+        break;
+    case 4:
+        for (size_t i = 0; i < len; i++)
+            row[i] += i >= bpp ? paeth(row[i - bpp], prev[i], prev[i - bpp]) : prev[i];
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Sample i of a row, packed MSB first below 8 bits
+static inline uint16_t sample(const uint8_t *row, uint32_t i, uint8_t depth)
+{
+    if (depth == 8)
+        return row[i];
+    if (depth == 16)
+        return (uint16_t)(row[i * 2] << 8 | row[i * 2 + 1]);
+    uint32_t bit = i * depth;
+    return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+}
+
+static inline uint8_t to8(uint16_t v, uint8_t depth)
+{
+    if (depth == 8)
+        return (uint8_t)v;
+    if (depth == 16)
+        return (uint8_t)(v >> 8);
+    return (uint8_t)(v * 255 / ((1 << depth) - 1));
+}
+
+static inline uint16_t pixel(const PngDecoder *p, const uint8_t *row, uint32_t x)
+{
+    uint8_t r, g, b, a = 0xFF;
+    switch (p->colour) {
+    case PNG_GREY: {
+        uint16_t v = sample(row, x, p->depth);
+        if (p->hasKey && v == p->key[0])
+            a = 0;
+        r = g = b = to8(v, p->depth);
+        break;
+    }
+    case PNG_RGB: {
+        uint16_t sr = sample(row, x * 3, p->depth), sg = sample(row, x * 3 + 1, p->depth),
+                 sb = sample(row, x * 3 + 2, p->depth);
+        if (p->hasKey && sr == p->key[0] && sg == p->key[1] && sb == p->key[2])
+            a = 0;
+        r = to8(sr, p->depth);
+        g = to8(sg, p->depth);
+        b = to8(sb, p->depth);
+        break;
+    }
+    case PNG_PALETTE: {
+        uint16_t i = sample(row, x, p->depth);
+        if (i >= p->paletteSize)
+            return 0;
+        r = p->palette[i][0];
+        g = p->palette[i][1];
+        b = p->palette[i][2];
+        a = p->palette[i][3];
+        break;
+    }
+    case PNG_GREY_ALPHA:
+        r = g = b = to8(sample(row, x * 2, p->depth), p->depth);
+        a = to8(sample(row, x * 2 + 1, p->depth), p->depth);
+        break;
+    default:
+        r = to8(sample(row, x * 4, p->depth), p->depth);
+        g = to8(sample(row, x * 4 + 1, p->depth), p->depth);
+        b = to8(sample(row, x * 4 + 2, p->depth), p->depth);
+        a = to8(sample(row, x * 4 + 3, p->depth), p->depth);
+        break;
+    }
+    if (a != 0xFF) {
+        // Over black
+        r = (uint8_t)((r * a + 127) / 255);
+        g = (uint8_t)((g * a + 127) / 255);
+        b = (uint8_t)((b * a + 127) / 255);
+    }
+    return image_rgb565(r, g, b);
+}
+
+bool png_size(ImageInput *in, uint16_t *width, uint16_t *height)
+{
+    PngDecoder p;
+    p.in = in;
+    if (read_header(&p) != IMAGE_OK)
+        return false;
+    *width = (uint16_t)p.width;
+    *height = (uint16_t)p.height;
+    return true;
+}
+
+static ImageResult decode_rows(PngDecoder *p, const ImageTarget &target, uint8_t *row, uint8_t *prev)
+{
+    const size_t rowBytes = ((size_t)p->width * p->channels * p->depth + 7) / 8;
+    const uint8_t bpp = p->channels * p->depth >= 8 ? p->channels * p->depth / 8 : 1;
+    uint16_t visibleW = p->width < target.w ? (uint16_t)p->width : target.w;
+    uint16_t visibleH = p->height < target.h ? (uint16_t)p->height : target.h;
+    if (visibleW > IMAGE_TILE_PIXELS / 4)
+        visibleW = IMAGE_TILE_PIXELS / 4;
+    const uint16_t bandRows = (uint16_t)((IMAGE_TILE_PIXELS / (visibleW ? visibleW : 1)) & ~3u);
+
+    uint16_t *tile = target.buffer;
+    uint16_t bandStart = 0, bandH = 0;
+    for (uint16_t y = 0; y < visibleH; y++) {
+        uint8_t filter;
+        if (inflate_read(&p->z, &filter, 1) != 1 || inflate_read(&p->z, row, rowBytes) != rowBytes)
+            return IMAGE_CORRUPT;
+        if (!unfilter(filter, row, prev, rowBytes, bpp))
+            return IMAGE_CORRUPT;
+
+        if (y == bandStart)
+            bandH = visibleH - bandStart < bandRows ? visibleH - bandStart : bandRows;
+        // Row i of the band is position bandH - 1 - i in every native row (column)
+        uint16_t *dst = tile + (bandH - 1 - (y - bandStart));
+        for (uint16_t x = 0; x < visibleW; x++, dst += bandH)
+            *dst = pixel(p, row, x);
+
+        if (y - bandStart + 1 == bandH) {
+            ImageTile t = {target.x, (uint16_t)(target.y + bandStart), visibleW, bandH, tile};
+            tile = target.flush(t, target.ctx);
+            bandStart = y + 1;
+        }
+
+        uint8_t *t = prev;
+        prev = row;
+        row = t;
+    }
+    return IMAGE_OK;
+}
+
+ImageResult png_decode(ImageInput *in, const ImageTarget &target)
+{
+    PngDecoder *p = (PngDecoder *)calloc(1, sizeof(PngDecoder));
+    if (!p)
+        return IMAGE_NO_MEMORY;
+    p->in = in;
+
+    ImageResult result = read_header(p);
+    if (result == IMAGE_OK)
+        result = read_chunks(p);
+    if (result != IMAGE_OK) {
+        free(p);
+        return result;
+    }
+    if (!inflate_begin(&p->z, idat_next, p)) {
+        bool noMemory = p->z.windowSize && !p->z.window;
+        free(p);
+        return noMemory ? IMAGE_NO_MEMORY : IMAGE_CORRUPT;
+    }
+
+    const size_t rowBytes = ((size_t)p->width * p->channels * p->depth + 7) / 8;
+    uint8_t *rows = (uint8_t *)calloc(2, rowBytes);
+    if (rows) {
+        result = decode_rows(p, target, rows, rows + rowBytes);
+        free(rows);
+    } else {
+        result = IMAGE_NO_MEMORY;
+    }
+    inflate_end(&p->z);
+    free(p);
+    return result;
+}
@@ -0,0 +1,18 @@
+#ifndef PNG_DECODER_H
+#define PNG_DECODER_H
+
+#include "image.h"
+
+/*
+ * PNG by scanlines. IDAT data is inflated one scanline at a time, unfiltered against the previous
+ * one and converted straight into a band of the tile; a band is as many whole rows as fit in
+ * IMAGE_TILE_PIXELS (a multiple of 4). Rows below the target are never inflated.
+ *
+ * Memory: the inflate window (from the zlib header, 32 KB at most), two raw scanlines and the
+ * palette. Chunk CRCs and the Adler-32 checksum are not checked.
+ */
+
+bool png_size(ImageInput *in, uint16_t *width, uint16_t *height);
+ImageResult png_decode(ImageInput *in, const ImageTarget &target);
+
+#endif
@@ -0,0 +1,352 @@
+#include "macro.h"
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>               // The VM is stepped from the timer interrupt
+#else
+#define IRAM_ATTR
+#endif
+
+// The keyboard matrix, one half-row (5 keys) per line, as the ROM scans it
+static const char *const KEY_NAMES[MACRO_KEY_COUNT] = {
+    "CAPS",  "Z",      "X", "C", "V",       // 0xFEFE
+    "A",     "S",      "D", "F", "G",       // 0xFDFE
+    "Q",     "W",      "E", "R", "T",       // 0xFBFE
+    "1",     "2",      "3", "4", "5",       // 0xF7FE
+    "0",     "9",      "8", "7", "6",       // 0xEFFE
+    "P",     "O",      "I", "U", "Y",       // 0xDFFE
+    "ENTER", "L",      "K", "J", "H",       // 0xBFFE
+    "SPACE", "SYMBOL", "M", "N", "B",       // 0x7FFE
+};
+
+static const uint8_t KEY_CAPS   = 0;
+static const uint8_t KEY_SYMBOL = 36;
+
+// Characters typed with SYMBOL SHIFT, and the key they go with
+static const char SYMBOL_CHARS[] = "!@#$%&'()_<>;\"=+-^:?/*,.";
+static const char SYMBOL_KEYS[]  = "1234567890RTOPLKJHZCVBNM";
+
+uint8_t macro_key_code(const char *name, size_t len)
+{
+    for (uint8_t k = 0; k < MACRO_KEY_COUNT; k++) {
+        if (strlen(KEY_NAMES[k]) == len && strncasecmp(KEY_NAMES[k], name, len) == 0)
+            return k;
+    }
+    return MACRO_KEY_NONE;
+}
+
+const char *macro_key_name(uint8_t key)
+{
+    return key < MACRO_KEY_COUNT ? KEY_NAMES[key] : "?";
+}
+
+// Output buffer with overflow tracking, so every emit doesn't need its own check
+struct Emitter {
+    uint8_t *out;
+    size_t capacity;
+    size_t len;
+    bool overflow;
+};
+
+static void emit(Emitter *e, uint8_t byte)
+{
+    if (e->len < e->capacity)
+        e->out[e->len++] = byte;
+    else
+        e->overflow = true;
+}
+
+static void emit_wait(Emitter *e, uint32_t us)
+{
+    if (us == 0)
+        return;
+    emit(e, MACRO_OP_WAIT);
+    do {
+        uint8_t byte = us & 0x7F;
+        us >>= 7;
+        emit(e, us ? (byte | 0x80) : byte);
+    } while (us);
+}
+
+static void emit_tap(Emitter *e, const uint8_t *keys, int count, uint32_t hold, uint32_t gap)
+{
+    for (int i = 0; i < count; i++)
+        emit(e, MACRO_OP_PRESS | keys[i]);
+    emit_wait(e, hold);
+    for (int i = count - 1; i >= 0; i--)
+        emit(e, MACRO_OP_RELEASE | keys[i]);
+    emit_wait(e, gap);
+}
+
+// Keys needed to type one character: optional shift first, then the key
+static int char_keys(char c, uint8_t *keys)
+{
+    if (c >= 'a' && c <= 'z') {
+        keys[0] = macro_key_code(&c, 1);
+        return 1;
+    }
+    if (c >= 'A' && c <= 'Z') {
+        keys[0] = KEY_CAPS;
+        keys[1] = macro_key_code(&c, 1);
+        return 2;
+    }
+    if (c >= '0' && c <= '9') {
+        keys[0] = macro_key_code(&c, 1);
+        return 1;
+    }
+    if (c == ' ') {
+        keys[0] = macro_key_code("SPACE", 5);
+        return 1;
+    }
+    if (c == '\n') {
+        keys[0] = macro_key_code("ENTER", 5);
+        return 1;
+    }
+    const char *s = strchr(SYMBOL_CHARS, c);
+    if (c != 0 && s != NULL) {
+        keys[0] = KEY_SYMBOL;
+        keys[1] = macro_key_code(&SYMBOL_KEYS[s - SYMBOL_CHARS], 1);
+        return 2;
+    }
+    return 0;
+}
+
+// A key name or one of the shifted combinations. Returns how many keys went into keys[].
+static int parse_key(const char *word, size_t len, uint8_t *keys)
+{
+    static const struct { const char *name; uint8_t key; } COMBOS[] = {
+        {"BREAK", 35}, {"EDIT", 15}, {"DELETE", 20},        // CAPS SHIFT + SPACE / 1 / 0
+    };
+    for (size_t i = 0; i < sizeof(COMBOS) / sizeof(COMBOS[0]); i++) {
+        if (strlen(COMBOS[i].name) == len && strncasecmp(COMBOS[i].name, word, len) == 0) {
+            keys[0] = KEY_CAPS;
+            keys[1] = COMBOS[i].key;
+            return 2;
+        }
+    }
+    keys[0] = macro_key_code(word, len);
+    return keys[0] == MACRO_KEY_NONE ? 0 : 1;
+}
+
+// "<n>us", "<n>ms" or "<n>s". Returns false if it isn't a time.
+static bool parse_time(const char *word, size_t len, uint32_t *us)
+{
+    uint32_t n = 0;
+    size_t i = 0;
+    while (i < len && isdigit((unsigned char)word[i]))
+        n = n * 10 + (word[i++] - '0');
+    if (i == 0)
+        return false;
+
+    const char *unit = word + i;
+    size_t unitLen = len - i;
+    if (unitLen == 2 && strncmp(unit, "us", 2) == 0)
+        *us = n;
+    else if (unitLen == 2 && strncmp(unit, "ms", 2) == 0)
+        *us = n * 1000;
+    else if (unitLen == 1 && unit[0] == 's')
+        *us = n * 1000000;
+    else
+        return false;
+    return true;
+}
+
+// Next whitespace separated word on the line, stops at comments
+static bool next_word(const char **p, const char *end, const char **word, size_t *len)
+{
+    while (*p < end && (**p == ' ' || **p == '\t' || **p == '\r'))
+        (*p)++;
+    if (*p >= end || **p == ';' || **p == '#')
+        return false;
+    *word = *p;
+    while (*p < end && **p != ' ' && **p != '\t' && **p != '\r' && **p != ';')
+        (*p)++;
+    *len = *p - *word;
+    return true;
+}
+
+static bool word_is(const char *word, size_t len, const char *keyword)
+{
+    return strlen(keyword) == len && strncasecmp(word, keyword, len) == 0;
+}
+
+size_t macro_compile(const char *source, uint8_t *out, size_t capacity, MacroError *err)
+{
+    Emitter e = {out, capacity, 0, false};
+    uint32_t hold = MACRO_DEFAULT_HOLD_US;
+    uint32_t gap = MACRO_DEFAULT_GAP_US;
+    err->line = 0;
+    err->message = NULL;
+
+    uint16_t line = 0;
+    const char *p = source;
+    while (*p) {
+        line++;
+        const char *end = strchr(p, '\n');
+        if (end == NULL)
+            end = p + strlen(p);
+
+        const char *w;
+        size_t wl;
+        const char *fail = NULL;
+
+        if (!next_word(&p, end, &w, &wl)) {
+            // Empty line or comment
+        } else if (word_is(w, wl, "hold") || word_is(w, wl, "release")) {
+            bool press = word_is(w, wl, "hold");
+            uint8_t keys[2];
+            int n;
+            if (!next_word(&p, end, &w, &wl))
+                fail = "key expected";
+            else if (!press && word_is(w, wl, "all"))
+                emit(&e, MACRO_OP_RELEASE_ALL);
+            else if ((n = parse_key(w, wl, keys)) == 0)
+                fail = "unknown key";
+            else
+                for (int i = 0; i < n; i++)
+                    emit(&e, (press ? MACRO_OP_PRESS : MACRO_OP_RELEASE) | keys[i]);
+        } else if (word_is(w, wl, "tap")) {
+            uint8_t keys[8];
+            int count = 0;
+            uint32_t tapHold = hold;
+            if (!next_word(&p, end, &w, &wl)) {
+                fail = "key expected";
+            } else {
+                // keys joined with '+'
+                const char *k = w;
+                const char *wend = w + wl;
+                while (k < wend && fail == NULL) {
+                    const char *plus = (const char *)memchr(k, '+', wend - k);
+                    const char *kend = plus ? plus : wend;
+                    int n = (count <= 6) ? parse_key(k, kend - k, keys + count) : 0;
+                    if (n == 0)
+                        fail = count <= 6 ? "unknown key" : "too many keys";
+                    count += n;
+                    k = plus ? plus + 1 : wend;
+                }
+                if (fail == NULL && next_word(&p, end, &w, &wl) && !parse_time(w, wl, &tapHold))
+                    fail = "bad time";
+                if (fail == NULL)
+                    emit_tap(&e, keys, count, tapHold, gap);
+            }
+        } else if (word_is(w, wl, "type")) {
+            while (p < end && *p != '"')
+                p++;
+            if (p >= end)
+                fail = "quoted text expected";
+            for (p++; fail == NULL && p < end && *p != '"'; p++) {
+                char c = *p;
+                if (c == '\\' && p + 1 < end) {
+                    c = *++p;
+                    if (c == 'n')
+                        c = '\n';
+                }
+                uint8_t keys[2];
+                int n = char_keys(c, keys);
+                if (n == 0)
+                    fail = "character can't be typed";
+                else
+                    emit_tap(&e, keys, n, hold, gap);
+            }
+            if (fail == NULL && p >= end)
+                fail = "missing closing quote";
+            p++;
+        } else if (word_is(w, wl, "wait")) {
+            uint32_t us;
+            if (!next_word(&p, end, &w, &wl) || !parse_time(w, wl, &us))
+                fail = "time expected";
+            else
+                emit_wait(&e, us);
+        } else if (word_is(w, wl, "timing")) {
+            while (fail == NULL && next_word(&p, end, &w, &wl)) {
+                uint32_t *target = word_is(w, wl, "hold") ? &hold : (word_is(w, wl, "gap") ? &gap : NULL);
+                if (target == NULL)
+                    fail = "hold or gap expected";
+                else if (!next_word(&p, end, &w, &wl) || !parse_time(w, wl, target))
+                    fail = "time expected";
+            }
+        } else {
+            fail = "unknown statement";
+        }
+
+        if (fail == NULL && p < end && next_word(&p, end, &w, &wl))
+            fail = "unexpected text at end of line";
+        if (fail == NULL && e.overflow)
+            fail = "macro too long";
+        if (fail != NULL) {
+            err->line = line;
+            err->message = fail;
+            return 0;
+        }
+
+        p = *end ? end + 1 : end;
+    }
+
+    emit(&e, MACRO_OP_RELEASE_ALL);         // Never leave a key stuck down
+    emit(&e, MACRO_OP_END);
+    if (e.overflow) {
+        err->line = line;
+        err->message = "macro too long";
+        return 0;
+    }
+    return e.len;
+}
+
+void macro_vm_init(MacroVM *vm, const uint8_t *code, size_t len, MacroKeyHandler handler, void *ctx)
+{
+    vm->code = code;
+    vm->len = len;
+    vm->pc = 0;
+    vm->timeUs = 0;
+    memset(vm->down, 0, sizeof(vm->down));
+    vm->handler = handler;
+    vm->ctx = ctx;
+}
+
+static void IRAM_ATTR set_key(MacroVM *vm, uint8_t key, bool pressed)
+{
+    uint8_t mask = 1 << (key & 7);
+    bool isDown = vm->down[key >> 3] & mask;
+    if (isDown == pressed)
+        return;
+    vm->down[key >> 3] ^= mask;
+    vm->handler(key, pressed, vm->timeUs, vm->ctx);
+}
+
+bool IRAM_ATTR macro_vm_step(MacroVM *vm, uint32_t *nextUs)
+{
+    while (vm->pc < vm->len) {
+        uint8_t op = vm->code[vm->pc++];
+
+        if (op & MACRO_OP_RELEASE) {
+            if ((op & 0x3F) < MACRO_KEY_COUNT)
+                set_key(vm, op & 0x3F, false);
+        } else if (op & MACRO_OP_PRESS) {
+            if ((op & 0x3F) < MACRO_KEY_COUNT)
+                set_key(vm, op & 0x3F, true);
+        } else if (op == MACRO_OP_WAIT) {
+            uint32_t us = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                if (vm->pc >= vm->len || shift > 28)
+                    return false;           // Cut short, or more than the 5 bytes a uint32_t takes
+                byte = vm->code[vm->pc++];
+                us |= (uint32_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            vm->timeUs += us;
+            *nextUs = vm->timeUs;
+            return true;
+        } else if (op == MACRO_OP_RELEASE_ALL) {
+            for (uint8_t k = 0; k < MACRO_KEY_COUNT; k++)
+                set_key(vm, k, false);
+        } else {
+            break;                          // MACRO_OP_END or garbage
+        }
+    }
+    vm->pc = vm->len;
+    return false;
+}
@@ -0,0 +1,86 @@
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Keyboard macros
+ *
+ * Macros are written as short text scripts and compiled into a compact bytecode that a tiny VM
+ * plays back as key matrix press/release events with microsecond timing. Example:
+ *
+ *   ; LOAD "" in 48K BASIC
+ *   timing hold 50ms gap 50ms
+ *   tap J                   ; the LOAD keyword
+ *   type "\"\""             ; SYMBOL SHIFT + P, twice
+ *   tap ENTER
+ *
+ * Statements (one per line, ';' or '#' starts a comment):
+ *   hold <key>              press a key and leave it down
+ *   release <key>|all       release one key or everything
+ *   tap <key>[+<key>...] [<time>]   press keys in order, wait, release in reverse order, wait the gap
+ *   type "<text>"           taps every character, with CAPS/SYMBOL SHIFT where needed
+ *   wait <time>             times are <n>us, <n>ms or <n>s
+ *   timing hold <time> gap <time>   defaults for tap/type from here on
+ *
+ * Keys are A-Z, 0-9, ENTER, SPACE, CAPS, SYMBOL and the combinations BREAK, EDIT and DELETE.
+ * Key codes are row * 5 + column in the Spectrum's 8 x 5 keyboard matrix.
+ *
+ * Bytecode:
+ *   0x00              end
+ *   0x01 <varint>     wait that many microseconds (LEB128)
+ *   0x02              release all keys
+ *   0x40 | key        press
+ *   0x80 | key        release
+ *
+ * No Arduino dependencies, the VM runs against a simulated clock on Linux as well.
+ */
+
+const uint8_t MACRO_KEY_COUNT       = 40;
+const uint8_t MACRO_KEY_NONE        = 0xFF;
+
+const uint8_t MACRO_OP_END          = 0x00;
+const uint8_t MACRO_OP_WAIT         = 0x01;
+const uint8_t MACRO_OP_RELEASE_ALL  = 0x02;
+const uint8_t MACRO_OP_PRESS        = 0x40;
+const uint8_t MACRO_OP_RELEASE      = 0x80;
+
+const uint32_t MACRO_DEFAULT_HOLD_US = 50000;   // 2.5 frames: the ROM scans the keyboard every 20 ms
+const uint32_t MACRO_DEFAULT_GAP_US  = 50000;
+
+struct MacroError {
+    uint16_t line;              // 1-based line of the first error, 0 if none
+    const char *message;
+};
+
+// Compiles a script into out. Returns the bytecode length, or 0 with err filled in.
+size_t macro_compile(const char *source, uint8_t *out, size_t capacity, MacroError *err);
+
+// Key code for a name such as "J", "ENTER" or "SYMBOL", MACRO_KEY_NONE if unknown
+uint8_t macro_key_code(const char *name, size_t len);
+
+// Name of a key code, for logs and the host simulator
+const char *macro_key_name(uint8_t key);
+
+// Called by the VM for every key change. time is the scheduled time of the event.
+typedef void (*MacroKeyHandler)(uint8_t key, bool pressed, uint32_t timeUs, void *ctx);
+
+struct MacroVM {
+    const uint8_t *code;
+    size_t len;
+    size_t pc;
+    uint32_t timeUs;            // Scheduled time of the instruction at pc, since the macro started
+    uint8_t down[MACRO_KEY_COUNT / 8];  // Keys currently pressed, so "release all" knows what to release
+    MacroKeyHandler handler;
+    void *ctx;
+};
+
+void macro_vm_init(MacroVM *vm, const uint8_t *code, size_t len, MacroKeyHandler handler, void *ctx);
+
+// Runs every instruction due at the current scheduled time and returns true with the time (in us
+// since the start) the VM wants to be called again, or false once the macro has ended.
+// Waits are added to the scheduled time, not to "now", so a late call never accumulates drift.
+bool macro_vm_step(MacroVM *vm, uint32_t *nextUs);
+
+#endif
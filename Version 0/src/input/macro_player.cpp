@@ -0,0 +1,94 @@
+#include "macro_player.h"
+#include <Arduino.h>
+
+static const uint8_t MACRO_TIMER        = 0;        // Hardware timer group 0, timer 0
+static const uint16_t MACRO_TIMER_DIV   = 80;       // 80 MHz APB / 80 = 1 us per tick
+
+static hw_timer_t *timer = NULL;
+static MacroVM vm;
+static MacroKeyHandler keyHandler = NULL;
+static void *keyContext = NULL;
+static MacroPlayerStats stats;
+static volatile bool running = false;
+
+static void IRAM_ATTR on_key(uint8_t key, bool pressed, uint32_t timeUs, void *ctx)
+{
+    stats.events++;
+    keyHandler(key, pressed, timeUs, keyContext);
+}
+
+static void IRAM_ATTR on_timer()
+{
+    uint32_t now = (uint32_t)timerRead(timer);
+    if (now > vm.timeUs && now - vm.timeUs > stats.worstLateUs)
+        stats.worstLateUs = now - vm.timeUs;
+
+    uint32_t next;
+    if (macro_vm_step(&vm, &next)) {
+        timerAlarmWrite(timer, next, false);        // Absolute: the counter runs from the macro's start
+        timerAlarmEnable(timer);
+    } else {
+        timerAlarmDisable(timer);
+        running = false;
+    }
+}
+
+bool macro_player_begin(MacroKeyHandler handler, void *ctx)
+{
+    if (timer != NULL)
+        return true;
+
+    keyHandler = handler;
+    keyContext = ctx;
+    timer = timerBegin(MACRO_TIMER, MACRO_TIMER_DIV, true);
+    if (timer == NULL)
+        return false;
+    timerStop(timer);
+    timerAttachInterrupt(timer, on_timer, true);
+    return true;
+}
+
+bool macro_player_run(const uint8_t *code, size_t len)
+{
+    if (timer == NULL || running)
+        return false;
+
+    macro_vm_init(&vm, code, len, on_key, NULL);
+    running = true;
+
+    // Time 0 is "now": run it straight away, then leave the rest to the timer
+    timerStop(timer);
+    timerWrite(timer, 0);
+    timerStart(timer);
+    on_timer();
+    return true;
+}
+
+bool macro_player_busy()
+{
+    return running;
+}
+
+void macro_player_stop()
+{
+    if (timer == NULL)
+        return;
+
+    timerAlarmDisable(timer);
+    if (running) {
+        // Let the VM's own bookkeeping release whatever is still down
+        static const uint8_t releaseAll[] = {MACRO_OP_RELEASE_ALL, MACRO_OP_END};
+        MacroVM cleanup = vm;
+        cleanup.code = releaseAll;
+        cleanup.len = sizeof(releaseAll);
+        cleanup.pc = 0;
+        uint32_t next;
+        macro_vm_step(&cleanup, &next);
+        running = false;
+    }
+}
+
+const MacroPlayerStats &macro_player_stats()
+{
+    return stats;
+}
@@ -0,0 +1,32 @@
+#ifndef MACRO_PLAYER_H
+#define MACRO_PLAYER_H
+
+#include "macro.h"
+
+/*
+ * Plays compiled macros on the real keyboard matrix.
+ *
+ * The VM is stepped from a hardware timer interrupt (1 MHz, counting from the start of the macro)
+ * that is re-armed for the exact time of the next event, so key timing doesn't depend on what
+ * loop() is doing; a display flush in the middle of a LOAD "" doesn't stretch a key press.
+ */
+
+struct MacroPlayerStats {
+    uint32_t events;            // Key changes applied
+    uint32_t worstLateUs;       // Largest delay between an event's scheduled and actual time
+};
+
+// handler is called from the interrupt and has to be IRAM safe (e.g. just sets GPIOs)
+bool macro_player_begin(MacroKeyHandler handler, void *ctx);
+
+// Starts a macro and returns right away. The bytecode has to stay valid until it ends.
+bool macro_player_run(const uint8_t *code, size_t len);
+
+bool macro_player_busy();
+
+// Aborts the running macro and releases every key
+void macro_player_stop();
+
+const MacroPlayerStats &macro_player_stats();
+
+#endif
@@ -34,7 +34,6 @@
 //#endif
 //#define LVGL_LCD_BUF_SIZE     (EXAMPLE_LCD_H_RES * EXAMPLE_LCD_V_RES)
 
-#define SEND_BUF_SIZE         (28800/2) //
 #define TFT_QSPI_CS           12
 #define TFT_QSPI_SCK          17
 #define TFT_QSPI_D0           13
@@ -46,6 +45,24 @@
 #define PIN_BAT_VOLT          8
 #define PIN_BUTTON_1          0
 #define PIN_BUTTON_2          21
+#define TAPE_EAR_OUT          2        // Tape signal to the +3's EAR socket
+#define TAPE_MIC_IN           3        // +3's MIC output (SAVE), must be an ADC1 pin
+#define AUDIO_OUT             40       // PDM audio (WAV tapes), RC filtered into EAR (43/44 are UART0)
+
+// TF card, SPI mode on its own bus (the panel has SPI2). Override with build_flags for another wiring.
+#ifndef SD_CS
+#define SD_CS                 42
+#endif
+#ifndef SD_SCK
+#define SD_SCK                39
+#endif
+#ifndef SD_MOSI
+#define SD_MOSI               38
+#endif
+#ifndef SD_MISO
+#define SD_MISO               41
+#endif
+#define SD_FREQUENCY          20000000
 
 
 #define TOUCH_IICSCL 10
@@ -0,0 +1,470 @@
+#include "snapshot.h"
+#include <string.h>
+#include <strings.h>
+#include "gfx/zx_screen.h"                  // ZX_SCREEN_SIZE
+
+static const uint8_t Z80_V1_HEADER      = 30;
+static const uint8_t SNA_HEADER         = 27;
+static const uint16_t Z80_PAGE_RAW      = 0xFFFF;   // Page length of an uncompressed page
+static const uint8_t ORDER_48K[3]       = {5, 2, 0};
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// Input position and seeking, on top of ImageInput's buffer
+static long input_tell(const ImageInput *in)
+{
+    return in->file ? ftell(in->file) - (long)(in->len - in->pos) : (long)in->pos;
+}
+
+static bool input_seek(ImageInput *in, long pos)
+{
+    if (in->file) {
+        if (fseek(in->file, pos, SEEK_SET) != 0)
+            return false;
+        in->pos = in->len = 0;
+        in->eof = false;
+        return true;
+    }
+    if (pos < 0 || (size_t)pos > in->size)
+        return false;
+    in->pos = (size_t)pos;
+    return true;
+}
+
+// Past what's buffered, a file skips by seeking rather than reading through
+static bool input_skip(ImageInput *in, uint32_t bytes)
+{
+    if (in->file && bytes > in->len - in->pos)
+        return input_seek(in, input_tell(in) + (long)bytes);
+    return image_skip(in, bytes);
+}
+
+static bool input_read(ImageInput *in, uint8_t *dst, size_t len)
+{
+    while (len > 0) {
+        if (in->pos == in->len && !image_input_refill(in))
+            return false;
+        size_t n = in->len - in->pos;
+        if (n > len)
+            n = len;
+        memcpy(dst, (in->file ? in->buf : in->data) + in->pos, n);
+        in->pos += n;
+        dst += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Bytes at an offset from the start of the snapshot, leaving the input where it was
+static bool input_peek(ImageInput *in, long start, long offset, uint8_t *dst, size_t len)
+{
+    long here = input_tell(in);
+    bool ok = input_seek(in, start + offset) && input_read(in, dst, len);
+    return input_seek(in, here) && ok;
+}
+
+SnapshotFormat snapshot_format(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL)
+        return SNAP_UNKNOWN;
+    if (strcasecmp(dot, ".z80") == 0)
+        return SNAP_Z80;
+    if (strcasecmp(dot, ".sna") == 0)
+        return SNAP_SNA;
+    return SNAP_UNKNOWN;
+}
+
+// Bank a .Z80 page holds, or -1 for ROM and pages we don't map
+static int z80_page_bank(const SnapshotInfo &info, uint8_t page)
+{
+    if (info.machine == SNAP_16K || info.machine == SNAP_48K) {
+        switch (page) {
+        case 8: return 5;
+        case 4: return info.machine == SNAP_48K ? 2 : -1;
+        case 5: return info.machine == SNAP_48K ? 0 : -1;
+        default: return -1;
+        }
+    }
+    return page >= 3 && page <= 10 ? page - 3 : -1;
+}
+
+static SnapshotResult open_z80(ImageInput *in, long start, SnapshotInfo *info)
+{
+    uint8_t h[Z80_V1_HEADER];
+    if (!input_read(in, h, sizeof(h)))
+        return SNAP_CORRUPT;
+    uint8_t flags = h[12] == 0xFF ? 1 : h[12];
+    SnapshotRegs &r = info->regs;
+    r.af = (uint16_t)(h[0] << 8 | h[1]);
+    r.bc = get16(h + 2);
+    r.hl = get16(h + 4);
+    r.pc = get16(h + 6);
+    r.sp = get16(h + 8);
+    r.i = h[10];
+    r.r = (uint8_t)((h[11] & 0x7F) | (flags & 1) << 7);
+    r.de = get16(h + 13);
+    r.bc2 = get16(h + 15);
+    r.de2 = get16(h + 17);
+    r.hl2 = get16(h + 19);
+    r.af2 = (uint16_t)(h[21] << 8 | h[22]);
+    r.iy = get16(h + 23);
+    r.ix = get16(h + 25);
+    r.iff1 = h[27] ? 1 : 0;
+    r.iff2 = h[28] ? 1 : 0;
+    r.im = h[29] & 3;
+    info->border = (flags >> 1) & 7;
+
+    if (r.pc != 0) {
+        info->version = 1;
+        info->machine = SNAP_48K;
+        info->compressed = (flags & 0x20) != 0;
+        info->banks = 1 << 5 | 1 << 2 | 1 << 0;
+        info->dataOffset = Z80_V1_HEADER;
+        return SNAP_OK;
+    }
+
+    // Versions 2 and 3: an extra header, then pages
+    uint8_t x[2 + 55];
+    if (!input_read(in, x, 2))
+        return SNAP_CORRUPT;
+    uint16_t extra = get16(x);
+    if (extra != 23 && extra != 54 && extra != 55)
+        return SNAP_CORRUPT;
+    if (!input_read(in, x + 2, extra))
+        return SNAP_CORRUPT;
+    info->version = extra == 23 ? 2 : 3;
+    r.pc = get16(x + 2);
+    uint8_t mode = x[4];
+    bool modified = (x[7] & 0x80) != 0;
+    if (info->version == 2) {
+        if (mode == 0 || mode == 1)
+            info->machine = modified ? SNAP_16K : SNAP_48K;
+        else if (mode == 3 || mode == 4)
+            info->machine = SNAP_128K;
+        else
+            return SNAP_UNSUPPORTED;
+    } else {
+        if (mode == 0 || mode == 1 || mode == 3)
+            info->machine = modified ? SNAP_16K : SNAP_48K;
+        else if (mode == 4 || mode == 5 || mode == 6 || mode == 9 || mode == 12)
+            info->machine = SNAP_128K;                              // 128K, with IF1/MGT, Pentagon, +2
+        else if (mode == 7 || mode == 8 || mode == 13)
+            info->machine = SNAP_PLUS3;                             // +3, +2A
+        else
+            return SNAP_UNSUPPORTED;
+    }
+    info->port7ffd = info->machine >= SNAP_128K ? x[5] : 0;
+    info->port1ffd = extra == 55 ? x[2 + 54] : 0;
+    info->ayUsed = (x[7] & 0x04) != 0;
+    info->ayLast = x[8];
+    memcpy(info->ay, x + 9, 16);
+    info->dataOffset = Z80_V1_HEADER + 2 + extra;
+
+    // Walk the page headers for which banks are there, seeking over the data
+    for (;;) {
+        uint8_t p[3];
+        if (!input_read(in, p, 3))
+            break;
+        uint16_t length = get16(p);
+        int bank = z80_page_bank(*info, p[2]);
+        if (bank >= 0)
+            info->banks |= 1 << bank;
+        if (!input_skip(in, length == Z80_PAGE_RAW ? SNAP_BANK_SIZE : length))
+            return SNAP_CORRUPT;
+    }
+    return input_seek(in, start + (long)info->dataOffset) ? SNAP_OK : SNAP_CORRUPT;
+}
+
+static SnapshotResult open_sna(ImageInput *in, long start, SnapshotInfo *info)
+{
+    bool is128 = info->fileSize == SNAP_SNA_128K_SIZE || info->fileSize == SNAP_SNA_128K_LONG;
+    if (info->fileSize != SNAP_SNA_48K_SIZE && !is128)
+        return SNAP_CORRUPT;
+    uint8_t h[SNA_HEADER];
+    if (!input_read(in, h, sizeof(h)))
+        return SNAP_CORRUPT;
+    SnapshotRegs &r = info->regs;
+    r.i = h[0];
+    r.hl2 = get16(h + 1);
+    r.de2 = get16(h + 3);
+    r.bc2 = get16(h + 5);
+    r.af2 = get16(h + 7);
+    r.hl = get16(h + 9);
+    r.de = get16(h + 11);
+    r.bc = get16(h + 13);
+    r.iy = get16(h + 15);
+    r.ix = get16(h + 17);
+    r.iff1 = r.iff2 = (h[19] & 0x04) ? 1 : 0;
+    r.r = h[20];
+    r.af = get16(h + 21);
+    r.sp = get16(h + 23);
+    r.im = h[25] & 3;
+    info->border = h[26] & 7;
+    info->dataOffset = SNA_HEADER;
+
+    uint8_t pc[2];
+    if (!is128) {
+        // The PC was pushed to save it: it's the word at SP, in the memory dump
+        info->machine = SNAP_48K;
+        info->banks = 1 << 5 | 1 << 2 | 1 << 0;
+        if (r.sp < 0x4000 || r.sp == 0xFFFF || !input_peek(in, start, SNA_HEADER + r.sp - 0x4000, pc, 2))
+            return SNAP_CORRUPT;
+        r.pc = get16(pc);
+        r.sp += 2;
+        return SNAP_OK;
+    }
+
+    // PC and paging come after the first 48K
+    uint8_t tail[4];
+    if (!input_peek(in, start, SNA_HEADER + 3 * SNAP_BANK_SIZE, tail, sizeof(tail)))
+        return SNAP_CORRUPT;
+    uint8_t paged = tail[2] & 7;
+    if ((paged == 2 || paged == 5) != (info->fileSize == SNAP_SNA_128K_LONG))
+        return SNAP_CORRUPT;
+    info->machine = SNAP_128K;
+    info->banks = 0xFF;
+    r.pc = get16(tail);
+    info->port7ffd = tail[2];
+    return SNAP_OK;
+}
+
+SnapshotResult snapshot_open(ImageInput *in, SnapshotFormat format, uint32_t fileSize, SnapshotInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->format = format;
+    info->fileSize = fileSize;
+    long start = input_tell(in);
+    if (format == SNAP_Z80)
+        return open_z80(in, start, info);
+    if (format == SNAP_SNA)
+        return open_sna(in, start, info);
+    return SNAP_UNSUPPORTED;
+}
+
+uint8_t snapshot_screen_bank(const SnapshotInfo &info)
+{
+    return info.machine >= SNAP_128K && (info.port7ffd & 0x08) ? 7 : 5;
+}
+
+// Where decoded bytes go: a run of 16K slices, each a bank, clipped to what the target wants
+struct Emit {
+    const SnapshotTarget *target;
+    const uint8_t *order;       // Bank of each slice
+    uint8_t slices;
+    uint32_t pos;               // Bytes of the run so far
+    uint32_t last;              // Nothing wanted from here on
+};
+
+static void emit_begin(Emit &e, const SnapshotTarget &target, const uint8_t *order, uint8_t slices)
+{
+    e.target = &target;
+    e.order = order;
+    e.slices = slices;
+    e.pos = 0;
+    e.last = 0;
+    for (uint8_t i = 0; i < slices; i++) {
+        if (target.banks & 1 << order[i])
+            e.last = (uint32_t)i * SNAP_BANK_SIZE + target.to;
+    }
+}
+
+// Bytes of the run from e.pos; with data NULL, len copies of fill
+static void emit(Emit &e, const uint8_t *data, uint8_t fill, size_t len)
+{
+    const SnapshotTarget &t = *e.target;
+    while (len > 0) {
+        uint8_t bank = e.order[e.pos / SNAP_BANK_SIZE];
+        uint32_t off = e.pos % SNAP_BANK_SIZE;
+        uint32_t n = SNAP_BANK_SIZE - off;
+        if (n > len)
+            n = (uint32_t)len;
+        uint32_t lo = off > t.from ? off : t.from;
+        uint32_t hi = off + n < t.to ? off + n : t.to;
+        if ((t.banks & 1 << bank) && lo < hi) {
+            if (t.ram) {
+                uint8_t *dst = t.ram + (uint32_t)bank * SNAP_BANK_SIZE + lo;
+                if (data)
+                    memcpy(dst, data + (lo - off), hi - lo);
+                else
+                    memset(dst, fill, hi - lo);
+            } else if (data) {
+                t.sink(bank, (uint16_t)lo, data + (lo - off), hi - lo, t.ctx);
+            } else {
+                uint8_t run[256];
+                memset(run, fill, sizeof(run));
+                for (uint32_t at = lo; at < hi; at += sizeof(run)) {
+                    uint32_t m = hi - at < sizeof(run) ? hi - at : sizeof(run);
+                    t.sink(bank, (uint16_t)at, run, m, t.ctx);
+                }
+            }
+        }
+        e.pos += n;
+        if (data)
+            data += n;
+        len -= n;
+    }
+}
+
+// Uncompressed: len bytes, stopping once nothing more is wanted. Returns the bytes left unread.
+static bool copy(ImageInput *in, uint32_t len, Emit &e, uint32_t *left)
+{
+    uint32_t end = len < e.last ? len : e.last;
+    while (e.pos < end) {
+        if (in->pos == in->len && !image_input_refill(in))
+            return false;
+        size_t n = in->len - in->pos;
+        if (n > end - e.pos)
+            n = end - e.pos;
+        emit(e, (in->file ? in->buf : in->data) + in->pos, 0, n);
+        in->pos += n;
+    }
+    *left = len - e.pos;
+    return true;
+}
+
+// ED ED nn bb compressed: packed input bytes make len output bytes, stopping once nothing more is
+// wanted. packed is brought down by what was read; false if it runs out first.
+static bool unpack(ImageInput *in, uint32_t *packed, uint32_t len, Emit &e)
+{
+    static const uint8_t ED = 0xED;
+    uint32_t end = len < e.last ? len : e.last;
+    while (e.pos < end) {
+        if (*packed == 0 || (in->pos == in->len && !image_input_refill(in)))
+            return false;
+
+        // Literal bytes up to the next ED go out as they are
+        const uint8_t *p = (in->file ? in->buf : in->data) + in->pos;
+        size_t avail = in->len - in->pos;
+        if (avail > *packed)
+            avail = *packed;
+        if (avail > end - e.pos)
+            avail = end - e.pos;
+        const uint8_t *ed = (const uint8_t *)memchr(p, ED, avail);
+        size_t literal = ed ? (size_t)(ed - p) : avail;
+        if (literal > 0) {
+            emit(e, p, 0, literal);
+            in->pos += literal;
+            *packed -= (uint32_t)literal;
+            continue;
+        }
+
+        // An ED: a run if another follows, else a literal ED and the byte after is looked at anew
+        in->pos++;
+        (*packed)--;
+        int next = *packed > 0 ? image_getc(in) : -1;
+        if (next != ED) {
+            emit(e, &ED, 0, 1);
+            if (next >= 0)
+                in->pos--;
+            continue;
+        }
+        if (*packed < 3)
+            return false;
+        int count = image_getc(in);
+        int value = image_getc(in);
+        *packed -= 3;
+        if (value < 0 || (uint32_t)count > len - e.pos)
+            return false;
+        emit(e, NULL, (uint8_t)value, count);
+    }
+    return true;
+}
+
+static SnapshotResult read_z80_pages(ImageInput *in, const SnapshotInfo &info, const SnapshotTarget &target)
+{
+    uint8_t wanted = target.banks & info.banks;
+    while (wanted) {
+        uint8_t p[3];
+        if (!input_read(in, p, 3))
+            return SNAP_CORRUPT;
+        uint16_t length = get16(p);
+        uint32_t packed = length == Z80_PAGE_RAW ? SNAP_BANK_SIZE : length;
+        int bank = z80_page_bank(info, p[2]);
+        if (bank >= 0 && (wanted & 1 << bank)) {
+            uint8_t order = (uint8_t)bank;
+            Emit e;
+            emit_begin(e, target, &order, 1);
+            bool ok = length == Z80_PAGE_RAW ? copy(in, SNAP_BANK_SIZE, e, &packed)
+                                             : unpack(in, &packed, SNAP_BANK_SIZE, e);
+            if (!ok)
+                return SNAP_CORRUPT;
+            wanted &= ~(1 << bank);
+        }
+        if (packed > 0 && wanted && !input_skip(in, packed))
+            return SNAP_CORRUPT;
+    }
+    return SNAP_OK;
+}
+
+static SnapshotResult read_sna_128k(ImageInput *in, const SnapshotInfo &info, const SnapshotTarget &target)
+{
+    uint8_t paged = info.port7ffd & 7;
+    const uint8_t first[3] = {5, 2, paged};
+    Emit e;
+    uint32_t left;
+    emit_begin(e, target, first, 3);
+    if (!copy(in, 3 * SNAP_BANK_SIZE, e, &left) || !input_skip(in, left + 4))
+        return SNAP_CORRUPT;
+
+    // The rest in order, those already given left out
+    for (uint8_t bank = 0; bank < SNAP_BANKS; bank++) {
+        if (bank == 2 || bank == 5 || bank == paged)
+            continue;
+        emit_begin(e, target, &bank, 1);
+        if (!copy(in, SNAP_BANK_SIZE, e, &left))
+            return SNAP_CORRUPT;
+        if (left > 0 && !input_skip(in, left))
+            return SNAP_CORRUPT;
+    }
+    return SNAP_OK;
+}
+
+SnapshotResult snapshot_read(ImageInput *in, const SnapshotInfo &info, const SnapshotTarget &target)
+{
+    if (target.to > SNAP_BANK_SIZE || target.from >= target.to || (!target.ram && !target.sink))
+        return SNAP_UNSUPPORTED;
+    if ((target.banks & info.banks) == 0)
+        return SNAP_OK;
+
+    if (info.format == SNAP_Z80 && info.version >= 2)
+        return read_z80_pages(in, info, target);
+    if (info.format == SNAP_SNA && info.machine == SNAP_128K)
+        return read_sna_128k(in, info, target);
+
+    // 48K as one run: a .SNA, or a version 1 .Z80 (compressed to its end marker, or not at all)
+    Emit e;
+    uint32_t left;
+    emit_begin(e, target, ORDER_48K, 3);
+    bool ok;
+    if (info.format == SNAP_Z80 && info.compressed) {
+        uint32_t packed = info.fileSize > info.dataOffset ? info.fileSize - info.dataOffset : 0;
+        ok = unpack(in, &packed, 3 * SNAP_BANK_SIZE, e);
+    } else {
+        ok = copy(in, 3 * SNAP_BANK_SIZE, e, &left);
+    }
+    return ok ? SNAP_OK : SNAP_CORRUPT;
+}
+
+static void screen_sink(uint8_t bank, uint16_t offset, const uint8_t *data, size_t len, void *ctx)
+{
+    memcpy((uint8_t *)ctx + offset, data, len);
+}
+
+SnapshotResult snapshot_screen(FILE *file, SnapshotFormat format, uint32_t fileSize, uint8_t *screen)
+{
+    ImageInput in;
+    image_input_file(&in, file);
+    SnapshotInfo info;
+    SnapshotResult result = snapshot_open(&in, format, fileSize, &info);
+    if (result != SNAP_OK)
+        return result;
+    uint8_t bank = snapshot_screen_bank(info);
+    if (!(info.banks & 1 << bank))
+        return SNAP_CORRUPT;
+    SnapshotTarget target = {NULL, screen_sink, screen, (uint8_t)(1 << bank), 0, ZX_SCREEN_SIZE};
+    return snapshot_read(&in, info, target);
+}
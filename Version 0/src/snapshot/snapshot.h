@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "image/image.h"                    // ImageInput
+
+/*
+ * Snapshot files (.Z80 versions 1 to 3, .SNA 48K and 128K)
+ *
+ * snapshot_open() reads the header: machine, registers, paging and the AY registers. The memory
+ * image then streams out of snapshot_read() bank by bank, straight into a RAM image (8 banks, in
+ * PSRAM on the device) or to a callback, for only the banks and the byte range asked for: a
+ * preview takes bytes 0..6911 of the screen bank and nothing else is decompressed. Compressed .Z80
+ * pages that aren't wanted, and the rest of one once the range is done, are skipped by their stored
+ * length; only version 1, one compressed run for all 48K, has to be decoded as far as the range.
+ *
+ * Memory is numbered in 128K banks whatever the machine: a 48K's 0x4000, 0x8000 and 0xC000 are
+ * banks 5, 2 and 0, as they are on a 128K after reset. ROM pages in a .Z80 are skipped.
+ *
+ * .Z80 pages are compressed with ED ED nn bb (nn copies of bb; anything else is literal). Literal
+ * spans between ED bytes are found with memchr and copied whole, and runs are filled with memset,
+ * so the work is per run rather than per byte. The input is the image loader's buffered reader
+ * (image/image.h), from a file or memory; .SNA 128K keeps its paging after the first 48K and a
+ * 48K .SNA its PC on the stack, both read ahead of time, so a file input must be seekable.
+ *
+ * No Arduino dependencies: tools/snap_bench.cpp runs the same code on Linux.
+ */
+
+const uint16_t SNAP_BANK_SIZE       = 16384;
+const uint8_t SNAP_BANKS            = 8;
+const uint32_t SNAP_SNA_48K_SIZE    = 27 + 3 * 16384;
+const uint32_t SNAP_SNA_128K_SIZE   = 27 + 3 * 16384 + 4 + 5 * 16384;  // Paged bank not 2 or 5
+const uint32_t SNAP_SNA_128K_LONG   = SNAP_SNA_128K_SIZE + 16384;        // 2 or 5 paged: it's there twice
+
+enum SnapshotFormat : uint8_t {
+    SNAP_UNKNOWN,
+    SNAP_SNA,
+    SNAP_Z80,
+};
+
+enum SnapshotMachine : uint8_t {
+    SNAP_16K,
+    SNAP_48K,
+    SNAP_128K,                  // 128K, +2 and Pentagon 128: same memory and 0x7FFD paging
+    SNAP_PLUS3,                 // +3 and +2A: 0x1FFD paging as well
+};
+
+enum SnapshotResult : uint8_t {
+    SNAP_OK,
+    SNAP_UNSUPPORTED,           // Valid but for a machine we don't have (SamRam, Timex, Scorpion, ...)
+    SNAP_CORRUPT,
+};
+
+struct SnapshotRegs {
+    uint16_t af, bc, de, hl;
+    uint16_t af2, bc2, de2, hl2;
+    uint16_t ix, iy, sp, pc;
+    uint8_t i, r;
+    uint8_t iff1, iff2, im;
+};
+
+struct SnapshotInfo {
+    SnapshotFormat format;
+    uint8_t version;            // .Z80 1, 2 or 3; .SNA 0
+    SnapshotMachine machine;
+    SnapshotRegs regs;          // As the machine should resume (a 48K .SNA's PC already popped)
+    uint8_t border;
+    uint8_t port7ffd, port1ffd; // Paging, 128K and +3
+    bool ayUsed;
+    uint8_t ayLast, ay[16];     // Selected AY register and their values
+    uint8_t banks;              // Bit n: the file holds RAM bank n
+    bool compressed;            // Version 1 only; later versions say per page
+
+    // Where the memory starts and how it's laid out, for snapshot_read()
+    uint32_t dataOffset;
+    uint32_t fileSize;
+};
+
+// Bytes [offset, offset + len) of a RAM bank, as they come
+typedef void (*SnapshotSinkFn)(uint8_t bank, uint16_t offset, const uint8_t *data, size_t len, void *ctx);
+
+struct SnapshotTarget {
+    uint8_t *ram;               // SNAP_BANKS * SNAP_BANK_SIZE, bank n at n * SNAP_BANK_SIZE; or NULL
+    SnapshotSinkFn sink;        // Used if ram is NULL
+    void *ctx;
+    uint8_t banks;              // Bit n: deliver bank n
+    uint16_t from;              // Byte range of each bank delivered
+    uint32_t to;                // Up to SNAP_BANK_SIZE
+};
+
+// Format from the file name's extension
+SnapshotFormat snapshot_format(const char *path);
+
+// Reads the header from the start of the file. in is left at the start of the memory.
+SnapshotResult snapshot_open(ImageInput *in, SnapshotFormat format, uint32_t fileSize, SnapshotInfo *info);
+
+// Streams the memory out to the target. Banks the file doesn't hold are left alone.
+SnapshotResult snapshot_read(ImageInput *in, const SnapshotInfo &info, const SnapshotTarget &target);
+
+// Bank the screen is shown from: 7 if a 128K has its shadow screen on, 5 otherwise
+uint8_t snapshot_screen_bank(const SnapshotInfo &info);
+
+// The 6912-byte SCREEN$ of a snapshot file, for previews (thumb_from_screen(), zx_screen_render())
+SnapshotResult snapshot_screen(FILE *file, SnapshotFormat format, uint32_t fileSize, uint8_t *screen);
+
+#endif
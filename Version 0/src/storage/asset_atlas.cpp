@@ -0,0 +1,54 @@
+#include "asset_atlas.h"
+#include <string.h>
+#include "system/crc32.h"
+
+bool asset_atlas_open(AssetAtlas *atlas, const uint8_t *data, size_t size)
+{
+    memset(atlas, 0, sizeof(*atlas));
+    if (size < sizeof(AssetAtlasHeader))
+        return false;
+
+    AssetAtlasHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (h.magic != ASSET_ATLAS_MAGIC || h.version != ASSET_ATLAS_VERSION)
+        return false;               // Erased flash reads as 0xFF and stops here
+    uint32_t tableEnd = sizeof(h) + (uint32_t)h.count * sizeof(AssetEntry);
+    if (h.size > size || h.size < tableEnd)
+        return false;
+    if (crc32_update(0, data + sizeof(h), h.size - sizeof(h)) != h.crc)
+        return false;
+
+    // Every image has to lie inside the atlas, aligned, for the drawing code to trust it
+    const AssetEntry *entries = (const AssetEntry *)(data + sizeof(h));
+    for (uint16_t i = 0; i < h.count; i++) {
+        const AssetEntry &e = entries[i];
+        uint64_t end = (uint64_t)e.offset + (uint64_t)e.w * e.h * 2;
+        if (e.offset < tableEnd || (e.offset & 3) || end > h.size || (e.h & 3) ||
+            e.name[ASSET_NAME_MAX - 1] != 0)
+            return false;
+        if (i > 0 && strcmp(entries[i - 1].name, e.name) >= 0)
+            return false;           // Not sorted, lookups would miss
+    }
+
+    atlas->base = data;
+    atlas->size = h.size;
+    atlas->entries = entries;
+    atlas->count = h.count;
+    return true;
+}
+
+const AssetEntry *asset_find(const AssetAtlas *atlas, const char *name)
+{
+    int lo = 0, hi = (int)atlas->count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(name, atlas->entries[mid].name);
+        if (c == 0)
+            return &atlas->entries[mid];
+        if (c < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return NULL;
+}
@@ -0,0 +1,73 @@
+#ifndef ASSET_ATLAS_H
+#define ASSET_ATLAS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Asset atlas in its own flash partition
+ *
+ * Images that used to be compiled in as RGB565 arrays live in one packed file, written by
+ * tools/asset_pack.cpp and flashed to the "assets" partition on its own, so they can change
+ * without rebuilding the firmware. At boot the partition is memory-mapped and the atlas is used in
+ * place: nothing is loaded into RAM, lookups return pointers into the mapped flash.
+ *
+ * Pixels are stored the way the panel takes them, like thumb_cache records: RGB565 in the panel's
+ * byte order, one native row per landscape column, bottom pixel first. Drawing is then a straight
+ * copy from flash to the bus, with no conversion or sprite in between.
+ *
+ * Layout (little-endian):
+ *   AssetAtlasHeader
+ *   AssetEntry[count]          sorted by name, for a binary search
+ *   pixels                     each image at a 4-byte aligned offset from the start of the atlas
+ *
+ * The CRC covers everything after the header, so a partition that was half written (or never
+ * written) is refused at mount rather than drawn as garbage.
+ */
+
+const uint32_t ASSET_ATLAS_MAGIC    = 0x41414653;   // "SFAA"
+const uint16_t ASSET_ATLAS_VERSION  = 1;
+const uint8_t ASSET_NAME_MAX        = 24;           // Including the terminator
+
+struct AssetAtlasHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t size;              // Bytes used, header included
+    uint32_t crc;               // Over bytes [sizeof(AssetAtlasHeader), size)
+};
+
+struct AssetEntry {
+    char name[ASSET_NAME_MAX];
+    uint16_t w, h;              // Landscape; h is a multiple of 4 (the panel's column granularity)
+    uint32_t offset;            // Of the pixels, from the start of the atlas
+};
+
+struct AssetAtlas {
+    const uint8_t *base;        // NULL when nothing is mounted
+    uint32_t size;
+    const AssetEntry *entries;
+    uint16_t count;
+};
+
+// Checks an atlas image in memory (or mapped flash) and sets atlas up to use it in place
+bool asset_atlas_open(AssetAtlas *atlas, const uint8_t *data, size_t size);
+
+const AssetEntry *asset_find(const AssetAtlas *atlas, const char *name);
+
+// w native rows of h pixels, panel order
+static inline const uint16_t *asset_pixels(const AssetAtlas *atlas, const AssetEntry *e)
+{
+    return (const uint16_t *)(atlas->base + e->offset);
+}
+
+// Maps the "assets" partition and opens the atlas in it. False if there's no partition or it
+// doesn't hold a valid atlas. Device: asset_flash.cpp; host: hal/asset_flash_host.cpp.
+bool asset_atlas_mount(AssetAtlas *atlas);
+
+// Draws an asset at landscape (x, y), clipped to the screen; y should be a multiple of 4.
+// Returns false if the atlas has no such asset. Device only (asset_atlas_draw.cpp).
+bool asset_draw(const AssetAtlas *atlas, const char *name, uint16_t x, uint16_t y);
+void asset_draw_entry(const AssetAtlas *atlas, const AssetEntry *e, uint16_t x, uint16_t y);
+
+#endif
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include "config.h"
+#include "asset_atlas.h"
+#include "display/AXS15231B.h"
+
+// The S3's GDMA reads internal RAM and PSRAM but not the flash cache, so mapped pixels can't be
+// the DMA source themselves (spi_master would allocate a bounce of the whole rect). Instead they
+// stream through two small internal buffers: one goes out while the next is copied from flash.
+static const size_t BOUNCE_PIXELS = 4096;      // 8 KB each, 22 full-height columns
+static uint16_t *bounce[2];
+
+bool asset_draw(const AssetAtlas *atlas, const char *name, uint16_t x, uint16_t y)
+{
+    const AssetEntry *e = asset_find(atlas, name);
+    if (e == NULL)
+        return false;
+    asset_draw_entry(atlas, e, x, y);
+    return true;
+}
+
+void asset_draw_entry(const AssetAtlas *atlas, const AssetEntry *e, uint16_t x, uint16_t y)
+{
+    if (x >= LCD_WIDTH || y >= LCD_HEIGHT)
+        return;
+    if (!bounce[0]) {
+        bounce[0] = (uint16_t *)heap_caps_malloc(BOUNCE_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        bounce[1] = (uint16_t *)heap_caps_malloc(BOUNCE_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!bounce[0] || !bounce[1]) {
+            heap_caps_free(bounce[0]);
+            heap_caps_free(bounce[1]);
+            bounce[0] = bounce[1] = NULL;
+            return;
+        }
+    }
+
+    // Clipping: columns off the right are dropped, rows off the bottom are the start of each
+    // native row (bottom pixel first), skipped in the copy
+    uint16_t w = e->w < LCD_WIDTH - x ? e->w : LCD_WIDTH - x;
+    uint16_t h = e->h < LCD_HEIGHT - y ? e->h : LCD_HEIGHT - y;
+    uint16_t skip = e->h - h;
+    if (w == 0 || h == 0)
+        return;
+
+    const uint16_t *src = asset_pixels(atlas, e);
+    uint16_t columns = BOUNCE_PIXELS / h;
+    uint8_t next = 0;
+    for (uint16_t col = 0; col < w; col += columns) {
+        uint16_t n = w - col < columns ? w - col : columns;
+        uint16_t *dst = bounce[next];
+        if (skip == 0) {
+            memcpy(dst, src + (size_t)col * e->h, (size_t)n * h * 2);
+        } else {
+            for (uint16_t i = 0; i < n; i++)
+                memcpy(dst + (size_t)i * h, src + (size_t)(col + i) * e->h + skip, (size_t)h * 2);
+        }
+        // Starting a push waits for the one before, so a buffer is free again by its next turn
+        lcd_push_async(LCD_HEIGHT - (y + h), x + col, h, n, dst);
+        next ^= 1;
+    }
+    lcd_push_wait();
+}
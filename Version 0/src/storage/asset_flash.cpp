@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include "esp_partition.h"          // ESP-IDF partition API
+#include "asset_atlas.h"
+
+static const esp_partition_subtype_t ASSETS_SUBTYPE = (esp_partition_subtype_t)0x41;      // Next to the settings' 0x40
+
+bool asset_atlas_mount(AssetAtlas *atlas)
+{
+    static const void *mapped = NULL;
+    static size_t mappedSize = 0;
+
+    if (mapped == NULL) {
+        const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ASSETS_SUBTYPE, "assets");
+        if (part == NULL)
+            return false;               // Flashed with the stock partition table
+
+        // Mapped once for good: reads go through the flash cache, the handle is never released
+        spi_flash_mmap_handle_t handle;
+        if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+            mapped = NULL;
+            return false;
+        }
+        mappedSize = part->size;
+    }
+    return asset_atlas_open(atlas, (const uint8_t *)mapped, mappedSize);
+}
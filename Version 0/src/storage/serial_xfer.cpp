@@ -0,0 +1,379 @@
+#include "serial_xfer.h"
+#include <string.h>
+#include "system/crc32.h"
+
+// Storage requests
+enum : uint8_t {
+    OP_NONE,
+    OP_OPEN,
+    OP_CLOSE,
+    OP_DONE,                    // Answered, result in opOk
+};
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+size_t xfer_encode(uint8_t *out, uint8_t type, uint8_t flags, uint32_t offset, const uint8_t *payload,
+                   uint16_t length)
+{
+    put16(out, XFER_MAGIC);
+    out[2] = type;
+    out[3] = flags;
+    put16(out + 4, length);
+    put32(out + 6, offset);
+    if (length)
+        memcpy(out + XFER_HEADER_SIZE, payload, length);
+    size_t n = XFER_HEADER_SIZE + length;
+    put32(out + n, crc32_update(0, out, n));
+    return n + 4;
+}
+
+void xfer_parser_init(XferParser *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+// Whether what's buffered can still be the start of a frame
+static bool plausible(const XferParser *p)
+{
+    if (p->len >= 1 && p->buf[0] != (uint8_t)XFER_MAGIC)
+        return false;
+    if (p->len >= 2 && p->buf[1] != (uint8_t)(XFER_MAGIC >> 8))
+        return false;
+    return p->len < XFER_HEADER_SIZE || get16(p->buf + 4) <= XFER_MAX_PAYLOAD;
+}
+
+// Drops the first byte and everything up to the next possible start
+static void resync(XferParser *p)
+{
+    uint16_t i = 1;
+    while (i < p->len && p->buf[i] != (uint8_t)XFER_MAGIC)
+        i++;
+    memmove(p->buf, p->buf + i, p->len - i);
+    p->len -= i;
+}
+
+size_t xfer_parse(XferParser *p, const uint8_t *data, size_t len, XferFrame *frame)
+{
+    frame->type = 0;
+    if (p->complete) {
+        p->len = 0;
+        p->complete = false;
+    }
+
+    size_t used = 0;
+    for (;;) {
+        if (!plausible(p)) {
+            resync(p);
+            continue;
+        }
+        size_t need = p->len < XFER_HEADER_SIZE ? XFER_HEADER_SIZE
+                                                : XFER_HEADER_SIZE + get16(p->buf + 4) + 4;
+        if (p->len < need) {
+            if (used == len)
+                return used;
+            size_t n = need - p->len < len - used ? need - p->len : len - used;
+            memcpy(p->buf + p->len, data + used, n);
+            p->len += n;
+            used += n;
+            continue;
+        }
+        size_t body = need - 4;
+        if (crc32_update(0, p->buf, body) != get32(p->buf + body)) {
+            p->crcErrors++;
+            resync(p);
+            continue;
+        }
+        frame->type = p->buf[2];
+        frame->flags = p->buf[3];
+        frame->length = get16(p->buf + 4);
+        frame->offset = get32(p->buf + 6);
+        frame->payload = p->buf + XFER_HEADER_SIZE;
+        p->complete = true;
+        return used;
+    }
+}
+
+static void reply(XferReceiver *r, uint8_t type, uint8_t flags, uint32_t offset, const uint8_t *payload,
+                  uint16_t length)
+{
+    uint8_t frame[XFER_HEADER_SIZE + 8 + 4];
+    r->send(frame, xfer_encode(frame, type, flags, offset, payload, length), r->sendCtx);
+}
+
+static void reply_error(XferReceiver *r, uint8_t error)
+{
+    reply(r, XFER_ERROR, 0, r->expected, &error, 1);
+}
+
+static uint32_t block_free(const XferBlock &b)
+{
+    return __atomic_load_n(&b.full, __ATOMIC_ACQUIRE) ? 0 : XFER_BLOCK_SIZE - b.len;
+}
+
+static uint32_t window(const XferReceiver *r)
+{
+    return block_free(r->blocks[0]) + block_free(r->blocks[1]);
+}
+
+static void reply_ack(XferReceiver *r, uint8_t type, uint8_t flags)
+{
+    uint32_t w = window(r);
+    uint8_t payload[4];
+    put32(payload, w);
+    reply(r, type, flags, r->expected, payload, 4);
+    r->windowEnd = r->expected + w;
+    r->sinceAck = 0;
+}
+
+static void request(XferReceiver *r, uint8_t op)
+{
+    __atomic_store_n(&r->op, op, __ATOMIC_RELEASE);
+    if (r->storage->kick)
+        r->storage->kick(r->storage->ctx);
+}
+
+// Hands the block being filled to storage as it is, so the fill and write order stay in step
+static void flush_block(XferReceiver *r)
+{
+    XferBlock &b = r->blocks[r->fill];
+    if (b.len == 0 || __atomic_load_n(&b.full, __ATOMIC_ACQUIRE))
+        return;
+    __atomic_store_n(&b.full, 1, __ATOMIC_RELEASE);
+    r->fill ^= 1;
+}
+
+static void start_close(XferReceiver *r, XferClose how, XferError error)
+{
+    flush_block(r);
+    r->closeHow = how;
+    r->closeError = error;
+    r->state = XFER_CLOSING;
+    request(r, OP_CLOSE);
+}
+
+static bool valid_name(const char *name, uint16_t len)
+{
+    if (len == 0 || len >= XFER_NAME_MAX || name[0] == '.')
+        return false;
+    for (uint16_t i = 0; i < len; i++) {
+        if (name[i] < 0x20 || name[i] == '/' || name[i] == '\\' || name[i] == ':' || (uint8_t)name[i] >= 0x7F)
+            return false;
+    }
+    return true;
+}
+
+static void start_open(XferReceiver *r, const char *name, uint16_t len, uint32_t size)
+{
+    memcpy(r->name, name, len);
+    r->name[len] = 0;
+    r->size = size;
+    r->writeFailed = false;
+    r->doneValid = false;
+    r->pendingOpen = false;
+    r->state = XFER_OPENING;
+    request(r, OP_OPEN);
+}
+
+static void take_data(XferReceiver *r, const XferFrame &f)
+{
+    r->stats.frames++;
+    if (f.offset != r->expected || f.length > window(r) || f.offset + f.length > r->size) {
+        if (f.length > window(r))
+            r->stats.storageWaits++;
+        r->stats.gaps++;
+        if (r->gapAt != r->expected) {
+            r->gapAt = r->expected;
+            reply_ack(r, XFER_ACK, XFER_FLAG_GAP);
+        }
+        return;
+    }
+
+    const uint8_t *p = f.payload;
+    uint16_t n = f.length;
+    r->crc = crc32_update(r->crc, p, n);
+    r->expected += n;
+    r->stats.bytes += n;
+    while (n > 0) {
+        XferBlock &b = r->blocks[r->fill];
+        uint32_t k = XFER_BLOCK_SIZE - b.len < n ? XFER_BLOCK_SIZE - b.len : n;
+        memcpy(b.data + b.len, p, k);
+        b.len += k;
+        p += k;
+        n -= k;
+        if (b.len == XFER_BLOCK_SIZE) {
+            __atomic_store_n(&b.full, 1, __ATOMIC_RELEASE);
+            r->fill ^= 1;
+            if (r->storage->kick)
+                r->storage->kick(r->storage->ctx);
+        }
+    }
+    if (++r->sinceAck >= XFER_ACK_EVERY || r->expected == r->size)
+        reply_ack(r, XFER_ACK, 0);
+}
+
+static void handle(XferReceiver *r, const XferFrame &f)
+{
+    switch (f.type) {
+    case XFER_OPEN:
+        if (!valid_name((const char *)f.payload, f.length)) {
+            reply_error(r, XFER_ERR_NAME);
+        } else if (r->state == XFER_IDLE) {
+            start_open(r, (const char *)f.payload, f.length, f.offset);
+        } else if (r->state == XFER_RECEIVING || r->state == XFER_CLOSING) {
+            // The sender restarted: keep what arrived and open again once it's closed
+            memcpy(r->pendingName, f.payload, f.length);
+            r->pendingName[f.length] = 0;
+            r->pendingSize = f.offset;
+            r->pendingOpen = true;
+            if (r->state == XFER_RECEIVING)
+                start_close(r, XFER_CLOSE_KEEP, XFER_ERR_NONE);
+        }
+        break;
+
+    case XFER_DATA:
+        if (r->state == XFER_RECEIVING)
+            take_data(r, f);
+        else if (r->state == XFER_IDLE)
+            reply_error(r, XFER_ERR_STATE);
+        break;
+
+    case XFER_CLOSE:
+        if (r->state == XFER_RECEIVING && f.offset == r->size && f.length == 4) {
+            if (r->expected < r->size) {
+                reply_ack(r, XFER_ACK, XFER_FLAG_GAP);
+                break;
+            }
+            r->fileCrc = get32(f.payload);
+            if (r->fileCrc == r->crc)
+                start_close(r, XFER_CLOSE_COMPLETE, XFER_ERR_NONE);
+            else
+                start_close(r, XFER_CLOSE_DISCARD, XFER_ERR_CRC);
+        } else if (r->state == XFER_IDLE) {
+            if (r->doneValid && f.offset == r->doneSize)
+                reply(r, XFER_DONE, 0, r->doneSize, NULL, 0);       // Our DONE was lost
+            else
+                reply_error(r, XFER_ERR_STATE);
+        }
+        break;
+
+    case XFER_ABORT:
+        if (r->state == XFER_RECEIVING)
+            start_close(r, XFER_CLOSE_KEEP, XFER_ERR_NONE);
+        break;
+    }
+}
+
+// Answers from the storage side, and the window opening up as blocks are written
+static void poll_storage(XferReceiver *r)
+{
+    if (__atomic_load_n(&r->op, __ATOMIC_ACQUIRE) == OP_DONE) {
+        __atomic_store_n(&r->op, OP_NONE, __ATOMIC_RELAXED);
+        if (r->state == XFER_OPENING) {
+            if (!r->opOk) {
+                r->state = XFER_IDLE;
+                reply_error(r, XFER_ERR_STORAGE);
+                return;
+            }
+            r->expected = r->resume;
+            r->crc = r->resumeCrc;
+            r->gapAt = ~0u;
+            r->state = XFER_RECEIVING;
+            r->stats.files++;
+            if (r->resume)
+                r->stats.resumed++;
+            reply_ack(r, XFER_READY, 0);
+        } else if (r->state == XFER_CLOSING) {
+            r->state = XFER_IDLE;
+            if (r->closeError != XFER_ERR_NONE)
+                reply_error(r, r->closeError);
+            else if (r->closeHow == XFER_CLOSE_COMPLETE && !r->opOk)
+                reply_error(r, XFER_ERR_STORAGE);
+            else if (r->closeHow == XFER_CLOSE_COMPLETE) {
+                r->doneSize = r->size;
+                r->doneValid = true;
+                reply(r, XFER_DONE, 0, r->size, NULL, 0);
+            }
+            if (r->pendingOpen)
+                start_open(r, r->pendingName, (uint16_t)strlen(r->pendingName), r->pendingSize);
+        }
+    }
+
+    if (r->state == XFER_RECEIVING) {
+        if (__atomic_load_n(&r->writeFailed, __ATOMIC_ACQUIRE))
+            start_close(r, XFER_CLOSE_DISCARD, XFER_ERR_STORAGE);
+        else if (r->expected + window(r) >= r->windowEnd + XFER_BLOCK_SIZE / 2)
+            reply_ack(r, XFER_ACK, 0);
+    }
+}
+
+void xfer_rx_init(XferReceiver *r, const XferStorage *storage, XferSendFn send, void *sendCtx)
+{
+    memset(r, 0, sizeof(*r));
+    xfer_parser_init(&r->parser);
+    r->storage = storage;
+    r->send = send;
+    r->sendCtx = sendCtx;
+}
+
+void xfer_rx_feed(XferReceiver *r, const uint8_t *data, size_t len)
+{
+    poll_storage(r);
+    while (len > 0) {
+        XferFrame frame;
+        size_t used = xfer_parse(&r->parser, data, len, &frame);
+        data += used;
+        len -= used;
+        if (frame.type)
+            handle(r, frame);
+    }
+}
+
+bool xfer_rx_storage_work(XferReceiver *r)
+{
+    const XferStorage *s = r->storage;
+    uint8_t op = __atomic_load_n(&r->op, __ATOMIC_ACQUIRE);
+    if (op == OP_OPEN) {
+        r->resume = r->resumeCrc = 0;
+        r->opOk = s->open(r->name, r->size, &r->resume, &r->resumeCrc, s->ctx);
+        __atomic_store_n(&r->op, OP_DONE, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Blocks go out in the order they filled, and all of them before a close
+    XferBlock &b = r->blocks[r->writing];
+    if (__atomic_load_n(&b.full, __ATOMIC_ACQUIRE)) {
+        if (!r->writeFailed && !s->write(b.data, b.len, s->ctx))
+            __atomic_store_n(&r->writeFailed, true, __ATOMIC_RELEASE);
+        b.len = 0;
+        __atomic_store_n(&b.full, 0, __ATOMIC_RELEASE);
+        r->writing ^= 1;
+        return true;
+    }
+
+    if (op == OP_CLOSE) {
+        r->opOk = s->close((XferClose)r->closeHow, s->ctx);
+        __atomic_store_n(&r->op, OP_DONE, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
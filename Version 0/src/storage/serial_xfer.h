@@ -0,0 +1,207 @@
+#ifndef SERIAL_XFER_H
+#define SERIAL_XFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * File transfer over the USB serial link
+ *
+ * Pushes .dsk/.tap files (or anything else) onto the SD card from a PC, tools/xfer_send.cpp being
+ * the sending side. Everything travels in frames:
+ *
+ *   'S' 'X' type flags length:16 offset:32 payload[length] crc:32      (little-endian)
+ *
+ * with a CRC-32 over header and payload. A frame that fails its CRC is dropped and the parser
+ * resyncs on the next "SX", so line noise or a stray log line costs a retransmit, not the transfer.
+ *
+ * The sender opens a file (OPEN: name and size), streams DATA frames of up to XFER_MAX_PAYLOAD
+ * bytes and ends with CLOSE, which carries the CRC-32 of the whole file. The receiver only takes
+ * data in order and acknowledges with the offset it has up to and a window: how much more it can
+ * buffer. The sender keeps up to a window of frames in flight without waiting, which is what lets
+ * the link run at line rate; on a gap the receiver sends an ACK flagged XFER_FLAG_GAP and the
+ * sender goes back to that offset (go-back-N), and if acknowledgements stop it goes back on a
+ * timeout.
+ *
+ * Data streams into two XFER_BLOCK_SIZE buffers. A full one goes to storage as a single write while
+ * the other fills, and the window is whatever's free in both, so a slow card throttles the sender
+ * rather than dropping frames. Storage work (opening, writing, closing) runs through
+ * xfer_rx_storage_work(), on another task than the one feeding bytes in, so a write that takes a
+ * while doesn't hold up the serial side or the UI.
+ *
+ * Transfers resume: data goes to "<name>.part", which is only renamed to the name once CLOSE's CRC
+ * matches. Opening a name whose .part already exists continues from the last whole block in it,
+ * and READY tells the sender where that is.
+ */
+
+const uint16_t XFER_MAGIC           = 0x5853;       // "SX"
+const uint8_t XFER_HEADER_SIZE      = 10;
+const uint16_t XFER_MAX_PAYLOAD     = 1024;
+const uint16_t XFER_MAX_FRAME       = XFER_HEADER_SIZE + XFER_MAX_PAYLOAD + 4;
+const uint32_t XFER_BLOCK_SIZE      = 16384;        // One storage write
+const uint8_t XFER_NAME_MAX         = 64;           // Including the terminator
+const uint8_t XFER_ACK_EVERY        = 4;            // DATA frames taken per ACK
+
+enum XferType : uint8_t {
+    // Sender to receiver
+    XFER_OPEN = 1,              // offset: file size; payload: name
+    XFER_DATA,                  // offset: where the payload goes in the file
+    XFER_CLOSE,                 // offset: file size; payload: CRC-32 of the file
+    XFER_ABORT,                 // Stops; what arrived is kept for a resume
+
+    // Receiver to sender
+    XFER_READY = 0x81,          // offset: where to start; payload: window
+    XFER_ACK,                   // offset: everything before it has arrived; payload: window
+    XFER_DONE,                  // offset: file size; the file is in place
+    XFER_ERROR,                 // payload: XferError
+};
+
+enum XferFlags : uint8_t {
+    XFER_FLAG_GAP = 0x01,       // ACK: a frame past the offset arrived, resend from the offset
+};
+
+enum XferError : uint8_t {
+    XFER_ERR_NONE,
+    XFER_ERR_STATE,             // Not expecting that (e.g. DATA after a reset): start again with OPEN
+    XFER_ERR_NAME,
+    XFER_ERR_STORAGE,
+    XFER_ERR_CRC,               // CLOSE's CRC didn't match; the partial file is gone
+};
+
+struct XferFrame {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t length;
+    uint32_t offset;
+    const uint8_t *payload;     // Valid until the next xfer_parse()
+};
+
+struct XferParser {
+    uint8_t buf[XFER_MAX_FRAME];
+    uint16_t len;
+    bool complete;              // buf holds the frame last returned
+    uint32_t crcErrors;
+};
+
+// Writes a frame into out (at least XFER_HEADER_SIZE + length + 4 bytes) and returns its size
+size_t xfer_encode(uint8_t *out, uint8_t type, uint8_t flags, uint32_t offset, const uint8_t *payload,
+                   uint16_t length);
+
+void xfer_parser_init(XferParser *p);
+
+// Takes bytes until a frame is complete. Returns how many were used; frame->type is 0 if no frame
+// was completed, otherwise call again with the rest.
+size_t xfer_parse(XferParser *p, const uint8_t *data, size_t len, XferFrame *frame);
+
+enum XferClose : uint8_t {
+    XFER_CLOSE_KEEP,            // Leave the .part for a resume
+    XFER_CLOSE_COMPLETE,        // Checked: put the file in place
+    XFER_CLOSE_DISCARD,         // Bad: remove the .part
+};
+
+// Where received files go. Called from xfer_rx_storage_work(), never from the feeding side.
+struct XferStorage {
+    // Opens name for a file of size bytes. *resume is how much of it an earlier attempt left (0 to
+    // start over), *crc the CRC-32 of those bytes.
+    bool (*open)(const char *name, uint32_t size, uint32_t *resume, uint32_t *crc, void *ctx);
+    bool (*write)(const uint8_t *data, size_t len, void *ctx);
+    bool (*close)(XferClose how, void *ctx);
+    void (*kick)(void *ctx);    // Storage work is waiting; NULL if the caller polls
+    void *ctx;
+};
+
+typedef void (*XferSendFn)(const uint8_t *data, size_t len, void *ctx);
+
+enum XferState : uint8_t {
+    XFER_IDLE,
+    XFER_OPENING,
+    XFER_RECEIVING,
+    XFER_CLOSING,
+};
+
+struct XferBlock {
+    uint8_t data[XFER_BLOCK_SIZE];
+    uint32_t len;
+    uint8_t full;               // Set by the feeding side, cleared by storage once written
+};
+
+struct XferStats {
+    uint32_t files;
+    uint32_t resumed;           // Files picked up from a .part
+    uint64_t bytes;             // Taken in order
+    uint32_t frames;
+    uint32_t gaps;              // Out-of-order or over-window DATA dropped
+    uint32_t storageWaits;      // DATA that found both blocks full
+};
+
+struct XferReceiver {
+    XferParser parser;
+    const XferStorage *storage;
+    XferSendFn send;
+    void *sendCtx;
+
+    XferState state;
+    char name[XFER_NAME_MAX];
+    uint32_t size;
+    uint32_t expected;          // Next byte of the file
+    uint32_t crc;               // Of everything before expected
+    uint32_t fileCrc;           // From CLOSE
+    uint32_t gapAt;             // expected when the last gap was reported, so it's reported once
+    uint32_t windowEnd;         // File offset the last ACK let the sender go up to
+    uint8_t sinceAck;
+    uint8_t fill;               // Block being filled
+    uint32_t doneSize;          // Last file finished, to repeat DONE for a repeated CLOSE
+    bool doneValid;
+    char pendingName[XFER_NAME_MAX];    // OPEN that arrived mid-transfer, started once that's closed
+    uint32_t pendingSize;
+    bool pendingOpen;
+
+    // Requests to the storage side: set here, answered by xfer_rx_storage_work()
+    uint8_t op;
+    bool opOk;
+    uint8_t closeHow;           // XferClose
+    uint8_t closeError;         // XferError to report once closed
+    uint32_t resume, resumeCrc;
+    uint8_t writing;            // Block storage writes next
+    bool writeFailed;
+
+    XferBlock blocks[2];
+    XferStats stats;
+};
+
+void xfer_rx_init(XferReceiver *r, const XferStorage *storage, XferSendFn send, void *sendCtx);
+
+// Bytes from the link; also picks up finished storage work, so call it (with len 0 if nothing
+// arrived) regularly
+void xfer_rx_feed(XferReceiver *r, const uint8_t *data, size_t len);
+
+// One piece of storage work (open, one block write, close). Returns false if there was none.
+bool xfer_rx_storage_work(XferReceiver *r);
+
+// Storage in files under a directory, through stdio with buffering off, so each block is one
+// write into the filesystem
+struct XferFileStorage {
+    char root[32];
+    char path[32 + XFER_NAME_MAX + 6];
+    char name[XFER_NAME_MAX];
+    FILE *file;
+};
+
+void xfer_file_storage(XferStorage *s, XferFileStorage *fs, const char *root);
+
+// Transfers over Serial into the SD card's mount point, once setup() has mounted the card there: the
+// receiver is fed from the UI core and storage work runs on core 0. The port is shared with the text commands (system/serial_cmd.h):
+// whoever reads it while no transfer is under way hands the bytes to xfer_service_feed() as well,
+// and once one has started xfer_service_poll() reads the port itself until it's over.
+// Device: serial_xfer_service.cpp; host: hal/serial_xfer_host.cpp.
+const char XFER_ROOT[]              = "/sd";
+const size_t XFER_SERIAL_RX_BUFFER  = 16384;        // Set before Serial.begin(), so polling every few ms keeps up
+bool xfer_service_begin();
+
+// From the UI scheduler, every couple of ms. True while a transfer has the port (it read it);
+// false when idle, and the caller reads the port
+bool xfer_service_poll();
+void xfer_service_feed(const uint8_t *data, size_t len);
+
+#endif
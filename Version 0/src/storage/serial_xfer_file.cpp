@@ -0,0 +1,84 @@
+#include "serial_xfer.h"
+#include <string.h>
+#include "system/crc32.h"
+
+static void make_path(XferFileStorage *fs, const char *suffix)
+{
+    snprintf(fs->path, sizeof(fs->path), "%s/%s%s", fs->root, fs->name, suffix);
+}
+
+static bool file_open(const char *name, uint32_t size, uint32_t *resume, uint32_t *crc, void *ctx)
+{
+    XferFileStorage *fs = (XferFileStorage *)ctx;
+    strncpy(fs->name, name, sizeof(fs->name) - 1);
+    fs->name[sizeof(fs->name) - 1] = 0;
+    make_path(fs, ".part");
+
+    // Whole blocks of an earlier attempt are kept; a torn last write is simply overwritten
+    fs->file = fopen(fs->path, "r+b");
+    if (fs->file) {
+        fseek(fs->file, 0, SEEK_END);
+        long have = ftell(fs->file);
+        uint32_t keep = have > 0 && (uint32_t)have <= size ? (uint32_t)have / XFER_BLOCK_SIZE * XFER_BLOCK_SIZE : 0;
+        rewind(fs->file);
+        uint8_t buf[512];
+        for (uint32_t done = 0; done < keep; done += sizeof(buf)) {
+            if (fread(buf, 1, sizeof(buf), fs->file) != sizeof(buf)) {
+                keep = 0;
+                *crc = 0;
+                break;
+            }
+            *crc = crc32_update(*crc, buf, sizeof(buf));
+        }
+        *resume = keep;
+        if (keep == 0) {
+            fclose(fs->file);
+            fs->file = NULL;
+        } else {
+            fseek(fs->file, keep, SEEK_SET);
+        }
+    }
+    if (!fs->file)
+        fs->file = fopen(fs->path, "wb");
+    if (!fs->file)
+        return false;
+    setvbuf(fs->file, NULL, _IONBF, 0);     // Blocks go straight to the filesystem, no stdio copy
+    return true;
+}
+
+static bool file_write(const uint8_t *data, size_t len, void *ctx)
+{
+    XferFileStorage *fs = (XferFileStorage *)ctx;
+    return fwrite(data, 1, len, fs->file) == len;
+}
+
+static bool file_close(XferClose how, void *ctx)
+{
+    XferFileStorage *fs = (XferFileStorage *)ctx;
+    bool ok = fs->file && fclose(fs->file) == 0;
+    fs->file = NULL;
+    make_path(fs, ".part");
+    if (how == XFER_CLOSE_DISCARD) {
+        remove(fs->path);
+        return true;
+    }
+    if (how == XFER_CLOSE_COMPLETE && ok) {
+        char part[sizeof(fs->path)];
+        strcpy(part, fs->path);
+        make_path(fs, "");
+        remove(fs->path);                   // rename() won't replace a file on FAT
+        ok = rename(part, fs->path) == 0;
+    }
+    return ok;
+}
+
+void xfer_file_storage(XferStorage *s, XferFileStorage *fs, const char *root)
+{
+    memset(fs, 0, sizeof(*fs));
+    strncpy(fs->root, root, sizeof(fs->root) - 1);
+    s->open = file_open;
+    s->write = file_write;
+    s->close = file_close;
+    s->kick = NULL;
+    s->ctx = fs;
+}
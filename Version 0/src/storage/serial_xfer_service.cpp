@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#include "serial_xfer.h"
+#include "system/metrics.h"
+#include "system/scheduler.h"
+
+// Receiving runs in the UI scheduler (xfer_service_poll, or xfer_service_feed while idle); writes to
+// the card run in a scheduler of their own on core 0, woken whenever a block fills, so a slow card
+// never stalls the UI. Its busy time is core 0's load on the HUD.
+static const size_t RX_CHUNK        = 2048;         // Read from Serial per poll step
+static const size_t RX_PER_POLL     = 16384;        // Most bytes taken in one poll
+
+static XferReceiver receiver;
+static XferStorage storage;
+static XferFileStorage files;
+static Scheduler ioScheduler;
+static int ioTask = -1;
+
+static void serial_send(const uint8_t *data, size_t len, void *ctx)
+{
+    Serial.write(data, len);
+}
+
+static void io_task(void *ctx)
+{
+    // One block write (or open/close) per run; wake again if there's more so others get a turn
+    if (xfer_rx_storage_work(&receiver))
+        sched_wake(&ioScheduler, ioTask);
+}
+
+static void kick(void *ctx)
+{
+    sched_wake(&ioScheduler, ioTask);
+}
+
+bool xfer_service_begin()
+{
+    xfer_file_storage(&storage, &files, XFER_ROOT);
+    storage.kick = kick;
+    xfer_rx_init(&receiver, &storage, serial_send, NULL);
+
+    sched_init(&ioScheduler, NULL);
+    sched_set_load_metric(&ioScheduler, METRIC_CORE0_BUSY_US);
+    ioTask = sched_add(&ioScheduler, "xfer-io", io_task, NULL, 1, 0, 100000);
+    return ioTask >= 0 && sched_start_on_core(&ioScheduler, 0, 6144, 1);
+}
+
+bool xfer_service_poll()
+{
+    if (receiver.state == XFER_IDLE) {
+        xfer_rx_feed(&receiver, NULL, 0);   // The last storage answers still go out
+        return false;
+    }
+
+    static uint8_t chunk[RX_CHUNK];
+    size_t taken = 0;
+    for (;;) {
+        size_t n = Serial.available();
+        if (n == 0 || taken >= RX_PER_POLL)
+            break;
+        n = Serial.read(chunk, n < sizeof(chunk) ? n : sizeof(chunk));
+        xfer_rx_feed(&receiver, chunk, n);
+        taken += n;
+    }
+    if (taken == 0)
+        xfer_rx_feed(&receiver, NULL, 0);   // Storage answers and window updates still go out
+    return true;
+}
+
+void xfer_service_feed(const uint8_t *data, size_t len)
+{
+    xfer_rx_feed(&receiver, data, len);
+}
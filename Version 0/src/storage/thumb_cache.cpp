@@ -0,0 +1,230 @@
+#include "thumb_cache.h"
+#include "gfx/zx_screen.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>      // Index and scratch thumbnail live in PSRAM on the device
+#endif
+
+static const char FILE_MAGIC[8]         = {'S', 'P', 'T', 'H', 'U', 'M', 'B', 1};   // Last byte is the version
+static const uint32_t FILE_HEADER_SIZE  = 12;           // Magic + width + height
+static const uint32_t RECORD_MAGIC      = 0x424D4854;   // "THMB"
+static const uint32_t RECORD_HEADER_SIZE = 16;          // Magic, pixel bytes, key
+static const uint32_t NO_PREVIEW        = 0xFFFFFFFF;   // Index offset of files the generator gave up on
+
+static void *thumb_alloc(size_t size)
+{
+#ifdef ARDUINO
+    return heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM);
+#else
+    return calloc(1, size);
+#endif
+}
+
+uint64_t thumb_key(const char *path, uint32_t size, uint32_t mtime)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;                 // FNV-1a
+    for (const char *p = path; *p; p++)
+        h = (h ^ (uint8_t)*p) * 0x100000001B3ULL;
+    for (int i = 0; i < 4; i++)
+        h = (h ^ (uint8_t)(size >> (8 * i))) * 0x100000001B3ULL;
+    for (int i = 0; i < 4; i++)
+        h = (h ^ (uint8_t)(mtime >> (8 * i))) * 0x100000001B3ULL;
+    return h ? h : 1;                                   // 0 marks an empty index slot
+}
+
+static ThumbIndexEntry *index_find(ThumbCache *cache, uint64_t key)
+{
+    uint32_t mask = cache->indexCapacity - 1;
+    for (uint32_t i = (uint32_t)key & mask;; i = (i + 1) & mask) {
+        ThumbIndexEntry *e = &cache->index[i];
+        if (e->key == key || e->key == 0)
+            return e;
+    }
+}
+
+static bool index_insert(ThumbCache *cache, uint64_t key, uint32_t offset)
+{
+    // Keep the table under 3/4 full so probes stay short
+    if ((cache->stats.records + 1) * 4 > cache->indexCapacity * 3) {
+        ThumbIndexEntry *old = cache->index;
+        uint32_t oldCapacity = cache->indexCapacity;
+        ThumbIndexEntry *bigger = (ThumbIndexEntry *)thumb_alloc(oldCapacity * 2 * sizeof(ThumbIndexEntry));
+        if (bigger == NULL)
+            return false;
+        cache->index = bigger;
+        cache->indexCapacity = oldCapacity * 2;
+        for (uint32_t i = 0; i < oldCapacity; i++) {
+            if (old[i].key)
+                *index_find(cache, old[i].key) = old[i];
+        }
+        free(old);
+    }
+
+    ThumbIndexEntry *e = index_find(cache, key);
+    if (e->key == 0)
+        cache->stats.records++;
+    e->key = key;
+    e->offset = offset;
+    return true;
+}
+
+static bool write_header(ThumbCache *cache)
+{
+    uint8_t header[FILE_HEADER_SIZE];
+    memcpy(header, FILE_MAGIC, 8);
+    memcpy(header + 8, &cache->width, 2);
+    memcpy(header + 10, &cache->height, 2);
+    return fseek(cache->file, 0, SEEK_SET) == 0 && fwrite(header, 1, FILE_HEADER_SIZE, cache->file) == FILE_HEADER_SIZE;
+}
+
+// Walks the records and indexes them. Stops at the first one that's incomplete or damaged; the next
+// append overwrites it. Records the index has no room for are walked past all the same, so the end
+// is never put before a good record.
+static void scan_records(ThumbCache *cache)
+{
+    fseek(cache->file, 0, SEEK_END);
+    long fileSize = ftell(cache->file);
+    uint32_t pos = FILE_HEADER_SIZE;
+
+    while (pos + RECORD_HEADER_SIZE <= (uint32_t)fileSize) {
+        uint32_t header[4];
+        if (fseek(cache->file, pos, SEEK_SET) != 0 || fread(header, 1, RECORD_HEADER_SIZE, cache->file) != RECORD_HEADER_SIZE)
+            break;
+        uint32_t pixelBytes = header[1];
+        uint64_t key;
+        memcpy(&key, &header[2], 8);
+        if (header[0] != RECORD_MAGIC || (pixelBytes != 0 && pixelBytes != cache->width * cache->height * 2u) ||
+            pos + RECORD_HEADER_SIZE + pixelBytes > (uint32_t)fileSize)
+            break;
+        if (!cache->readOnly && !index_insert(cache, key, pixelBytes ? pos + RECORD_HEADER_SIZE : NO_PREVIEW))
+            cache->readOnly = true;
+        pos += RECORD_HEADER_SIZE + pixelBytes;
+    }
+    cache->end = pos;
+}
+
+bool thumb_cache_open(ThumbCache *cache, const char *path, uint16_t width, uint16_t height,
+                      ThumbGenerator generator, void *ctx)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->width = width;
+    cache->height = height;
+    cache->generator = generator;
+    cache->generatorCtx = ctx;
+    cache->indexCapacity = 256;
+    cache->index = (ThumbIndexEntry *)thumb_alloc(cache->indexCapacity * sizeof(ThumbIndexEntry));
+    cache->scratch = (uint16_t *)thumb_alloc(width * height * sizeof(uint16_t));
+    if (cache->index == NULL || cache->scratch == NULL) {
+        thumb_cache_close(cache);
+        return false;
+    }
+
+    // An existing cache is only reused if it has the same version and thumbnail size
+    cache->file = fopen(path, "r+b");
+    if (cache->file != NULL) {
+        uint8_t header[FILE_HEADER_SIZE];
+        if (fread(header, 1, FILE_HEADER_SIZE, cache->file) == FILE_HEADER_SIZE &&
+            memcmp(header, FILE_MAGIC, 8) == 0 && memcmp(header + 8, &width, 2) == 0 && memcmp(header + 10, &height, 2) == 0) {
+            scan_records(cache);
+            return true;
+        }
+        fclose(cache->file);
+    }
+
+    cache->file = fopen(path, "w+b");
+    if (cache->file == NULL || !write_header(cache)) {
+        thumb_cache_close(cache);
+        return false;
+    }
+    cache->end = FILE_HEADER_SIZE;
+    return true;
+}
+
+void thumb_cache_close(ThumbCache *cache)
+{
+    if (cache->file)
+        fclose(cache->file);
+    free(cache->index);
+    free(cache->scratch);
+    cache->file = NULL;
+    cache->index = NULL;
+    cache->scratch = NULL;
+}
+
+static void enqueue(ThumbCache *cache, const char *path, uint32_t size, uint32_t mtime)
+{
+    for (uint8_t i = 0; i < cache->queueCount; i++) {
+        const ThumbRequest &r = cache->queue[(cache->queueHead + i) % THUMB_QUEUE_SIZE];
+        if (r.size == size && r.mtime == mtime && strcmp(r.path, path) == 0)
+            return;
+    }
+    if (cache->queueCount == THUMB_QUEUE_SIZE || strlen(path) >= THUMB_PATH_MAX)
+        return;                 // The browser asks again when the entry is still on screen
+
+    ThumbRequest &r = cache->queue[(cache->queueHead + cache->queueCount) % THUMB_QUEUE_SIZE];
+    strcpy(r.path, path);
+    r.size = size;
+    r.mtime = mtime;
+    cache->queueCount++;
+}
+
+bool thumb_cache_get(ThumbCache *cache, const char *path, uint32_t size, uint32_t mtime, uint16_t *pixels)
+{
+    ThumbIndexEntry *e = index_find(cache, thumb_key(path, size, mtime));
+    if (e->key == 0) {
+        cache->stats.misses++;
+        if (!cache->readOnly)
+            enqueue(cache, path, size, mtime);
+        return false;
+    }
+    if (e->offset == NO_PREVIEW) {
+        cache->stats.noPreview++;
+        return false;
+    }
+
+    cache->stats.hits++;
+
+    size_t count = cache->width * cache->height;
+    return fseek(cache->file, e->offset, SEEK_SET) == 0 &&
+           fread(pixels, sizeof(uint16_t), count, cache->file) == count;
+}
+
+bool thumb_cache_work(ThumbCache *cache)
+{
+    if (cache->queueCount == 0 || cache->generator == NULL || cache->readOnly)
+        return false;
+
+    ThumbRequest r = cache->queue[cache->queueHead];
+    cache->queueHead = (cache->queueHead + 1) % THUMB_QUEUE_SIZE;
+    cache->queueCount--;
+
+    uint64_t key = thumb_key(r.path, r.size, r.mtime);
+    if (index_find(cache, key)->key != 0)
+        return true;            // Asked for twice, already done
+
+    bool ok = cache->generator(r.path, cache->scratch, cache->width, cache->height, cache->generatorCtx);
+    if (ok)
+        cache->stats.generated++;
+    else
+        cache->stats.failed++;
+
+    uint32_t header[4] = {RECORD_MAGIC, ok ? cache->width * cache->height * 2u : 0};
+    memcpy(&header[2], &key, 8);
+    if (fseek(cache->file, cache->end, SEEK_SET) != 0 ||
+        fwrite(header, 1, RECORD_HEADER_SIZE, cache->file) != RECORD_HEADER_SIZE ||
+        (ok && fwrite(cache->scratch, 1, header[1], cache->file) != header[1]))
+        return true;            // Card full or removed; the torn record gets overwritten next time
+    fflush(cache->file);
+
+    if (!index_insert(cache, key, ok ? cache->end + RECORD_HEADER_SIZE : NO_PREVIEW))
+        cache->readOnly = true;
+    cache->end += RECORD_HEADER_SIZE + header[1];
+    return true;
+}
+
+void thumb_from_screen(const uint8_t *screen, uint16_t *pixels, uint16_t w, uint16_t h)
+{
+    zx_screen_render_native(screen, zx_screen_view_scaled(w, h), false, pixels, 0, w);
+}
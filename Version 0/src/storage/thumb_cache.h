@@ -0,0 +1,101 @@
+#ifndef THUMB_CACHE_H
+#define THUMB_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Persistent thumbnail cache
+ *
+ * Previews of disks, tapes and snapshots are kept on the SD card in one packed, append-only file.
+ * Each record holds a thumbnail already scaled and rotated to panel-native order, so showing a
+ * cached preview is one read straight into the push buffer.
+ *
+ * Records are keyed by a 64-bit hash of the file's path, size and modification time; a file that
+ * changes simply gets a new record. The in-memory hash index is rebuilt at open by walking the
+ * record headers, which also drops a record torn by a power cut.
+ *
+ * Misses don't block: the request is queued and thumb_cache_work() generates one pending thumbnail
+ * per call, to be called whenever there's idle time (on the device, loop() does when the UI
+ * scheduler has nothing due; see thumb_service_work).
+ *
+ * If the index can't grow (no memory), records past what it holds are still walked over at open so
+ * they're never overwritten, and the cache stops taking new ones.
+ */
+
+const uint8_t THUMB_QUEUE_SIZE  = 16;
+const uint8_t THUMB_PATH_MAX    = 128;
+
+// Fills a thumbnail for a file (w x h, panel-native). Returns false if the file has no preview.
+typedef bool (*ThumbGenerator)(const char *path, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx);
+
+struct ThumbCacheStats {
+    uint32_t hits;
+    uint32_t noPreview;         // Lookups of files already known to have no preview
+    uint32_t misses;
+    uint32_t generated;
+    uint32_t failed;            // Files the generator couldn't make a preview of
+    uint32_t records;
+};
+
+struct ThumbIndexEntry {
+    uint64_t key;               // 0 = empty slot
+    uint32_t offset;            // Offset of the record's pixels in the file
+};
+
+struct ThumbRequest {
+    char path[THUMB_PATH_MAX];
+    uint32_t size;
+    uint32_t mtime;
+};
+
+struct ThumbCache {
+    FILE *file;
+    uint16_t width, height;
+    uint32_t end;               // Where the next record goes
+    bool readOnly;              // The index is full: nothing more is queued or appended
+    ThumbIndexEntry *index;
+    uint32_t indexCapacity;     // Power of two
+    ThumbRequest queue[THUMB_QUEUE_SIZE];
+    uint8_t queueHead, queueCount;
+    ThumbGenerator generator;
+    void *generatorCtx;
+    uint16_t *scratch;          // One thumbnail, for generation
+    ThumbCacheStats stats;
+};
+
+// Opens (or creates) the cache file. Thumbnails are width x height in landscape terms.
+bool thumb_cache_open(ThumbCache *cache, const char *path, uint16_t width, uint16_t height,
+                      ThumbGenerator generator, void *ctx);
+
+void thumb_cache_close(ThumbCache *cache);
+
+uint64_t thumb_key(const char *path, uint32_t size, uint32_t mtime);
+
+// On a hit reads the thumbnail into pixels (width * height, panel-native) and returns true.
+// On a miss queues the file for generation and returns false; also false for a file with no preview.
+bool thumb_cache_get(ThumbCache *cache, const char *path, uint32_t size, uint32_t mtime, uint16_t *pixels);
+
+// Generates one queued thumbnail. Returns false when there was nothing to do.
+bool thumb_cache_work(ThumbCache *cache);
+
+// Scales a SCREEN$ into a panel-native thumbnail; the usual generator for Spectrum files
+void thumb_from_screen(const uint8_t *screen, uint16_t *pixels, uint16_t w, uint16_t h);
+
+// Draws a cached thumbnail at landscape (x, y). Returns false on a miss. Device only (thumb_cache_draw.cpp).
+bool thumb_cache_draw(ThumbCache *cache, const char *path, uint32_t size, uint32_t mtime, uint16_t x, uint16_t y);
+
+// The card's cache (XFER_ROOT/.thumbs) of SCREEN$ and snapshot previews, opened by
+// thumb_service_begin() once the card is mounted (false without one). thumb_service_work()
+// generates one queued preview, from loop() when the UI scheduler is idle; "thumb <path>" on the
+// serial monitor shows a file's preview (queueing it on a miss) and "thumb" alone the stats.
+// Device: storage/thumb_cache_service.cpp; host: hal/thumb_cache_host.cpp.
+const uint16_t THUMB_WIDTH      = 128;
+const uint16_t THUMB_HEIGHT     = 96;
+const uint32_t THUMB_IDLE_US    = 20000;    // Least idle time worth making a preview in
+bool thumb_service_begin();
+bool thumb_service_work();
+void thumb_command(const char *args, void *ctx);
+
+#endif
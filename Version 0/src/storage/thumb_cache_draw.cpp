@@ -0,0 +1,17 @@
+#include <Arduino.h>
+#include "config.h"
+#include "thumb_cache.h"
+#include "display/AXS15231B.h"
+
+bool thumb_cache_draw(ThumbCache *cache, const char *path, uint32_t size, uint32_t mtime, uint16_t x, uint16_t y)
+{
+    // Thumbnails are stored panel-native, so the read lands directly in what gets pushed
+    static uint16_t chunk[SEND_BUF_SIZE];
+    if ((uint32_t)cache->width * cache->height > SEND_BUF_SIZE)
+        return false;
+    if (!thumb_cache_get(cache, path, size, mtime, chunk))
+        return false;
+
+    lcd_PushColors(LCD_HEIGHT - (y + cache->height), x, cache->height, cache->width, chunk);
+    return true;
+}
@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "thumb_cache.h"
+#include "config.h"
+#include "gfx/zx_screen.h"
+#include "snapshot/snapshot.h"
+#include "storage/serial_xfer.h"            // XFER_ROOT, where the card is mounted
+
+// Previews are made between UI frames, so only the quick kinds: a SCREEN$ as it is, and a
+// snapshot's screen bank (nothing else of it is decompressed). A tape takes seconds of emulation
+// (tapescr) and is recorded as having no preview.
+static ThumbCache thumbs;
+static uint8_t screen[ZX_SCREEN_SIZE];
+
+static bool generate(const char *path, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    SnapshotFormat format = snapshot_format(path);
+    bool ok = format != SNAP_UNKNOWN ? snapshot_screen(f, format, (uint32_t)size, screen) == SNAP_OK
+                                     : size == ZX_SCREEN_SIZE && fread(screen, 1, ZX_SCREEN_SIZE, f) == ZX_SCREEN_SIZE;
+    fclose(f);
+    if (ok)
+        thumb_from_screen(screen, pixels, w, h);
+    return ok;
+}
+
+bool thumb_service_begin()
+{
+    char path[32];
+    snprintf(path, sizeof(path), "%s/.thumbs", XFER_ROOT);
+    return thumb_cache_open(&thumbs, path, THUMB_WIDTH, THUMB_HEIGHT, generate, NULL);
+}
+
+bool thumb_service_work()
+{
+    return thumbs.file != NULL && thumb_cache_work(&thumbs);
+}
+
+void thumb_command(const char *args, void *ctx)
+{
+    const ThumbCacheStats &st = thumbs.stats;
+    if (*args == 0) {
+        Serial.printf("thumb: %u records%s, %u hits, %u without a preview, %u misses, %u generated, %u failed, %u queued\n",
+                      (unsigned)st.records, thumbs.readOnly ? " (index full)" : "", (unsigned)st.hits,
+                      (unsigned)st.noPreview, (unsigned)st.misses, (unsigned)st.generated, (unsigned)st.failed,
+                      (unsigned)thumbs.queueCount);
+        return;
+    }
+    if (*args != '/') {
+        Serial.println("thumb [/path/on/card]");
+        return;
+    }
+
+    char full[THUMB_PATH_MAX];
+    struct stat info;
+    snprintf(full, sizeof(full), "%s%s", XFER_ROOT, args);
+    if (stat(full, &info) != 0) {
+        Serial.printf("thumb: can't read %s\n", full);
+        return;
+    }
+    uint32_t noPreview = st.noPreview;
+    if (thumb_cache_draw(&thumbs, full, (uint32_t)info.st_size, (uint32_t)info.st_mtime,
+                         (LCD_WIDTH - THUMB_WIDTH) / 2, (LCD_HEIGHT - THUMB_HEIGHT) / 2))
+        Serial.println("thumb: cached");
+    else
+        Serial.println(st.noPreview != noPreview ? "thumb: no preview" : "thumb: queued, ask again");
+}
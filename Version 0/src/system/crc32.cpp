@@ -0,0 +1,19 @@
+#include "crc32.h"
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    // Byte at a time: a 1 KB table, but at serial line rate the nibble version would cost a tenth of a core
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
@@ -0,0 +1,15 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * CRC-32 (zlib's polynomial and conditioning), the one checksum everything on file or on the wire
+ * uses: settings records, the asset atlas, transfer frames and files, and capture frames.
+ *
+ * Running: start with 0 and feed it the data in as many pieces as it comes in.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif
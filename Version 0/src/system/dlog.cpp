@@ -0,0 +1,101 @@
+#include "dlog.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>
+#include <esp_rom_sys.h>
+#include <hal/cpu_hal.h>
+#define DLOG_NOINIT __NOINIT_ATTR   // Survives software and watchdog resets
+#define DLOG_IRAM IRAM_ATTR
+#else
+#include <time.h>
+#define DLOG_NOINIT
+#define DLOG_IRAM
+#endif
+
+struct DlogRing {
+    uint32_t head;              // Records ever written; the slot is head % DLOG_SLOTS
+    DlogRecord slots[DLOG_SLOTS];
+};
+
+struct DlogState {
+    uint32_t magic;
+    DlogRing cores[DLOG_CORES];
+};
+
+static DlogState state DLOG_NOINIT;
+static volatile bool enabled = false;
+
+static inline uint32_t ticks()
+{
+#ifdef ARDUINO
+    return cpu_hal_get_cycle_count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#endif
+}
+
+static inline uint32_t ticks_per_us()
+{
+#ifdef ARDUINO
+    return esp_rom_get_cpu_ticks_per_us();
+#else
+    return 1000;
+#endif
+}
+
+static inline uint8_t core_id()
+{
+#ifdef ARDUINO
+    return cpu_hal_get_core_id();
+#else
+    return 0;
+#endif
+}
+
+bool dlog_begin()
+{
+    if (state.magic == DLOG_MAGIC)
+        return true;
+    dlog_clear();
+    return false;
+}
+
+void dlog_clear()
+{
+    enabled = false;
+    memset(state.cores, 0, sizeof(state.cores));
+    state.magic = DLOG_MAGIC;
+    enabled = true;
+}
+
+void dlog_set_enabled(bool on)
+{
+    enabled = on;
+}
+
+void dlog_dump(DlogWriter writer, void *ctx)
+{
+    uint32_t header[6] = {DLOG_MAGIC, DLOG_VERSION, DLOG_CORES, DLOG_SLOTS, DLOG_MAX_ARGS, ticks_per_us()};
+    writer(header, sizeof(header), ctx);
+    for (uint8_t c = 0; c < DLOG_CORES; c++)
+        writer(&state.cores[c], sizeof(DlogRing), ctx);
+}
+
+void DLOG_IRAM dlog_record(const char *fmt, const uint32_t *args, uint8_t count)
+{
+    if (!enabled)
+        return;
+
+    DlogRing &ring = state.cores[core_id()];
+    uint32_t index = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED) & (DLOG_SLOTS - 1);
+    DlogRecord &r = ring.slots[index];
+
+    r.fmt = 0;
+    r.ticks = ticks();
+    for (uint8_t i = 0; i < count; i++)
+        r.args[i] = args[i];
+    __atomic_store_n(&r.fmt, (uint32_t)(uintptr_t)fmt, __ATOMIC_RELEASE);   // Complete from here on
+}
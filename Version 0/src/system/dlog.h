@@ -0,0 +1,82 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Deferred binary logging
+ *
+ *   DLOG("flush %u rows in %u us", rows, us);
+ *
+ * Nothing is formatted on the device. A record is the address of the format string (a literal,
+ * so it lives in the firmware image), a cycle counter timestamp and up to DLOG_MAX_ARGS raw 32 bit
+ * words, written into a fixed-size slot of the current core's ring. Claiming a slot is one atomic
+ * add, so it's safe from tasks and interrupts on either core and costs a few tens of cycles.
+ *
+ * tools/dlog_decode.cpp turns a dump back into text: it reads the format strings (and string
+ * literals passed to %s) out of the firmware's ELF file at the recorded addresses.
+ *
+ * Arguments: integers, pointers and floats (stored as float). %s only works for strings that are
+ * in the image, like literals and task names, not for buffers. No 64 bit values.
+ *
+ * The rings are in memory that isn't cleared on a software or watchdog reset, so after a stall
+ * the previous run's last records are still there at boot: dlog_begin() says so, and they can be
+ * dumped before logging starts again (flight recorder).
+ */
+
+const uint8_t DLOG_MAX_ARGS             = 6;
+const uint16_t DLOG_SLOTS               = 256;      // Per core, power of two
+const uint8_t DLOG_CORES                = 2;
+const uint32_t DLOG_MAGIC               = 0x474F4C44;   // "DLOG"
+const uint32_t DLOG_VERSION             = 1;
+
+struct DlogRecord {
+    uint32_t fmt;               // Format string address, 0 while the slot is being written
+    uint32_t ticks;             // CPU cycles on the device
+    uint32_t args[DLOG_MAX_ARGS];
+};
+
+// Receives the dump in pieces (header, then each core's ring)
+typedef void (*DlogWriter)(const void *data, size_t len, void *ctx);
+
+// Returns true if a previous run's log survived the reset. Logging stays off until it has been
+// dumped and dlog_clear() called, so it isn't overwritten.
+bool dlog_begin();
+
+// Empties the rings and starts logging
+void dlog_clear();
+
+void dlog_set_enabled(bool enabled);
+
+// Header {magic, version, cores, slots, max args, ticks per us}, then per core the write count
+// followed by the slots
+void dlog_dump(DlogWriter writer, void *ctx);
+
+void dlog_record(const char *fmt, const uint32_t *args, uint8_t count);
+
+template <typename T> inline uint32_t dlog_word(T v)
+{
+    static_assert(sizeof(T) <= 4, "dlog arguments are 32 bit at most");
+    return (uint32_t)v;
+}
+template <typename T> inline uint32_t dlog_word(T *p) { return (uint32_t)(uintptr_t)p; }
+inline uint32_t dlog_word(float f) { union { float f; uint32_t u; } v; v.f = f; return v.u; }
+inline uint32_t dlog_word(double d) { return dlog_word((float)d); }
+
+inline void dlog(const char *fmt)
+{
+    dlog_record(fmt, NULL, 0);
+}
+
+template <typename... Args> inline void dlog(const char *fmt, Args... args)
+{
+    static_assert(sizeof...(Args) <= DLOG_MAX_ARGS, "too many dlog arguments");
+    const uint32_t words[] = {dlog_word(args)...};
+    dlog_record(fmt, words, sizeof...(Args));
+}
+
+// The "" makes sure the format is a literal, so its address means something to the decoder
+#define DLOG(fmt, ...) dlog("" fmt, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,75 @@
+#include "metrics.h"
+#include <string.h>
+
+Metric metrics[METRICS_MAX];
+
+static uint8_t count = 0;
+static uint64_t lastSampleUs = 0;
+
+void metrics_init()
+{
+    static const struct {
+        const char *name;
+        MetricKind kind;
+    } builtin[METRIC_BUILTIN_COUNT] = {
+        {"frames", METRIC_COUNTER},
+        {"render us", METRIC_GAUGE},
+        {"flush us", METRIC_GAUGE},
+        {"spi bytes", METRIC_COUNTER},
+        {"hud spi bytes", METRIC_COUNTER},
+        {"heap internal", METRIC_GAUGE},
+        {"heap psram", METRIC_GAUGE},
+        {"core0 busy us", METRIC_COUNTER},
+        {"core1 busy us", METRIC_COUNTER},
+    };
+
+    memset(metrics, 0, sizeof(metrics));
+    count = 0;
+    lastSampleUs = 0;
+    for (uint8_t i = 0; i < METRIC_BUILTIN_COUNT; i++)
+        metrics_register(builtin[i].name, builtin[i].kind);
+}
+
+int metrics_register(const char *name, MetricKind kind)
+{
+    if (count == METRICS_MAX)
+        return -1;
+    Metric &m = metrics[count];
+    m.name = name;
+    m.kind = kind;
+    m.value = 0;
+    m.sampled = 0;
+    m.delta = 0;
+    m.rate = 0;
+    return count++;
+}
+
+int metrics_find(const char *name)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(metrics[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+uint8_t metrics_count()
+{
+    return count;
+}
+
+void metrics_sample(uint64_t nowUs)
+{
+    uint64_t elapsed = lastSampleUs ? nowUs - lastSampleUs : 0;
+    lastSampleUs = nowUs;
+
+    for (uint8_t i = 0; i < count; i++) {
+        Metric &m = metrics[i];
+        if (m.kind != METRIC_COUNTER)
+            continue;
+        uint32_t value = m.value;
+        m.delta = elapsed ? value - m.sampled : 0;     // Unsigned, so a wrap still gives the right increase
+        m.rate = elapsed ? m.delta * 1000000.0f / elapsed : 0;
+        m.sampled = value;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/*
+ * Metrics registry
+ *
+ * A fixed table of named 32 bit values that any subsystem can publish to, and the HUD (or
+ * anything else) can read. Publishing is an index and an atomic add or a plain store, cheap enough
+ * for the display and audio hot paths; names are only looked at by readers.
+ *
+ * Counters only go up (bytes sent, frames drawn, microseconds busy); metrics_sample() turns them
+ * into the increase and rate per second since the previous sample. Gauges hold the latest value
+ * (render time of the last frame, free heap).
+ *
+ * The ones the system itself publishes have fixed ids (MetricId). Others are added with
+ * metrics_register() at start-up, whose id is then kept by the publisher.
+ */
+
+const uint8_t METRICS_MAX               = 32;
+
+enum MetricKind : uint8_t {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+};
+
+enum MetricId : uint8_t {
+    METRIC_FRAMES,              // Counter, frames pushed by whatever owns the screen
+    METRIC_RENDER_US,           // Gauge, drawing time of the last frame
+    METRIC_FLUSH_US,            // Gauge, push time of the last frame
+    METRIC_SPI_BYTES,           // Counter, pixel bytes sent to the panel
+    METRIC_HUD_SPI_BYTES,       // Counter, the part of those the HUD sent itself
+    METRIC_HEAP_INTERNAL,       // Gauge, free internal RAM in bytes
+    METRIC_HEAP_PSRAM,          // Gauge, free PSRAM in bytes
+    METRIC_CORE0_BUSY_US,       // Counter, time spent in scheduler tasks on core 0
+    METRIC_CORE1_BUSY_US,       // Counter, same for core 1
+    METRIC_BUILTIN_COUNT,
+};
+
+struct Metric {
+    const char *name;
+    MetricKind kind;
+    volatile uint32_t value;
+    uint32_t sampled;           // Counter value at the last sample
+    uint32_t delta;             // Increase over the last sample window
+    float rate;                 // delta per second
+};
+
+extern Metric metrics[METRICS_MAX];
+
+// Registers the built-in metrics; called once at start-up
+void metrics_init();
+
+// Returns the new id, or -1 when the table is full
+int metrics_register(const char *name, MetricKind kind);
+
+int metrics_find(const char *name);
+
+uint8_t metrics_count();
+
+inline void metrics_add(int id, uint32_t n)
+{
+    __atomic_fetch_add(&metrics[id].value, n, __ATOMIC_RELAXED);
+}
+
+inline void metrics_set(int id, uint32_t v)
+{
+    metrics[id].value = v;
+}
+
+// Updates delta and rate of every counter for the time since the previous call
+void metrics_sample(uint64_t nowUs);
+
+#endif
@@ -0,0 +1,64 @@
+#include "profiler.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>
+#define PROF_IRAM IRAM_ATTR             // Runs in the timer interrupt
+#else
+#define PROF_IRAM
+#endif
+
+void prof_clear(Profiler *p, uint32_t rateHz)
+{
+    memset(p->cores, 0, sizeof(p->cores));
+    p->rateHz = rateHz;
+}
+
+void PROF_IRAM prof_record(Profiler *p, uint8_t core, uint32_t pc, uint32_t caller)
+{
+    ProfHistogram &h = p->cores[core];
+    __atomic_store_n(&h.samples, h.samples + 1, __ATOMIC_RELAXED);
+    if (pc == 0) {
+        __atomic_store_n(&h.inInterrupt, h.inInterrupt + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint32_t hash = (pc ^ (caller * 0x9E3779B1u)) * 0x85EBCA6Bu;
+    for (uint8_t i = 0; i < PROF_PROBES; i++) {
+        ProfSlot &s = h.slots[((hash >> 16) + i) & (PROF_SLOTS - 1)];
+        if (s.pc == 0) {
+            // A new pair: the count goes in before pc makes the slot visible to a dump
+            s.caller = caller;
+            __atomic_store_n(&s.count, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.pc, pc, __ATOMIC_RELEASE);
+            return;
+        }
+        if (s.pc == pc && s.caller == caller) {
+            __atomic_store_n(&s.count, s.count + 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    __atomic_store_n(&h.dropped, h.dropped + 1, __ATOMIC_RELAXED);
+}
+
+void prof_dump(const Profiler *p, ProfWriter writer, void *ctx)
+{
+    uint32_t header[5] = {PROF_MAGIC, PROF_VERSION, PROF_CORES, PROF_SLOTS, p->rateHz};
+    writer(header, sizeof(header), ctx);
+
+    // A slot at a time, so what goes out is a consistent snapshot of each slot even while sampling
+    for (uint8_t c = 0; c < PROF_CORES; c++) {
+        const ProfHistogram &h = p->cores[c];
+        uint32_t counts[3] = {__atomic_load_n(&h.samples, __ATOMIC_RELAXED),
+                              __atomic_load_n(&h.inInterrupt, __ATOMIC_RELAXED),
+                              __atomic_load_n(&h.dropped, __ATOMIC_RELAXED)};
+        writer(counts, sizeof(counts), ctx);
+        for (uint16_t i = 0; i < PROF_SLOTS; i++) {
+            ProfSlot s;
+            s.pc = __atomic_load_n(&h.slots[i].pc, __ATOMIC_ACQUIRE);
+            s.caller = s.pc ? h.slots[i].caller : 0;
+            s.count = s.pc ? __atomic_load_n(&h.slots[i].count, __ATOMIC_RELAXED) : 0;
+            writer(&s, sizeof(s), ctx);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Sampling profiler
+ *
+ * A hardware timer interrupts each core a few thousand times a second. The handler takes the
+ * address the core was interrupted at and the return address of the function it was in (its
+ * caller), and counts the pair in that core's histogram. Nothing else is done on the device: the
+ * histogram is dumped over serial and tools/prof_report.cpp symbolises it against the firmware's
+ * ELF file into a flat profile and folded stacks for a flame graph.
+ *
+ * Each core's histogram is written only by that core's timer interrupt, which doesn't nest with
+ * itself, so recording takes no lock: find the slot for the pair (open addressing on a hash of
+ * it) and bump its count. A dump reads the counts with atomic loads and can run while sampling.
+ * Pairs that find no free slot within PROF_PROBES are counted as dropped rather than evicting.
+ *
+ * A sample that lands in another interrupt handler has no task to attribute it to; those are
+ * counted per core as in-interrupt.
+ *
+ * Commands over serial (system/serial_cmd.h), answered with a "prof:" line:
+ *
+ *   prof start [hz]     clears the histograms and samples at hz (PROF_DEFAULT_HZ)
+ *   prof stop
+ *   prof dump           the binary dump, for prof_report
+ */
+
+const uint8_t PROF_CORES            = 2;
+const uint16_t PROF_SLOTS           = 512;      // Per core, power of two
+const uint8_t PROF_PROBES           = 16;
+const uint32_t PROF_DEFAULT_HZ      = 4000;
+const uint32_t PROF_MAX_HZ          = 20000;
+const uint32_t PROF_MAGIC           = 0x464F5250;   // "PROF"
+const uint32_t PROF_VERSION         = 1;
+
+struct ProfSlot {
+    uint32_t pc;                // 0: free
+    uint32_t caller;
+    uint32_t count;
+};
+
+struct ProfHistogram {
+    uint32_t samples;
+    uint32_t inInterrupt;
+    uint32_t dropped;
+    ProfSlot slots[PROF_SLOTS];
+};
+
+struct Profiler {
+    ProfHistogram cores[PROF_CORES];
+    uint32_t rateHz;
+};
+
+// Receives the dump in pieces (header, then each core's histogram)
+typedef void (*ProfWriter)(const void *data, size_t len, void *ctx);
+
+void prof_clear(Profiler *p, uint32_t rateHz);
+
+// From core's timer interrupt; pc 0 if it interrupted another interrupt
+void prof_record(Profiler *p, uint8_t core, uint32_t pc, uint32_t caller);
+
+// Header {magic, version, cores, slots, rate}, then per core samples, in-interrupt and dropped
+// counts followed by the slots
+void prof_dump(const Profiler *p, ProfWriter writer, void *ctx);
+
+// The timers and the "prof" command. Device: profiler_service.cpp; host: hal/profiler_host.cpp.
+bool prof_service_begin();
+void prof_command(const char *args, void *ctx);
+
+#endif
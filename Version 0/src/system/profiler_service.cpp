@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profiler.h"
+
+// One timer per core, each with its interrupt allocated on the core it samples. Timer 0 is the
+// macro player's; these are 2 and 3 (group 1).
+static const uint8_t PROF_TIMER_FIRST   = 2;
+static const uint16_t PROF_TIMER_DIV    = 80;       // 80 MHz APB / 80 = 1 us per tick
+
+static Profiler profiler;
+static hw_timer_t *timers[PROF_CORES];
+static bool running = false;
+
+static void IRAM_ATTR on_timer()
+{
+    uint8_t core = xPortGetCoreID();
+    uint32_t pc = 0, caller = 0;
+    if (!xPortInterruptedFromISRContext()) {
+        // On the way in, the port saved the interrupted task's registers (an XtExcFrame) on its
+        // stack and pointed the task's pxTopOfStack, the first field of its TCB, at them
+        const uint32_t *frame = *(const uint32_t *const *)xTaskGetCurrentTaskHandleForCPU(core);
+        pc = frame[1];                                      // XT_STK_PC
+        caller = (frame[3] & 0x3FFFFFFF) | (pc & 0xC0000000);  // XT_STK_A0, less the window size bits
+    }
+    prof_record(&profiler, core, pc, caller);
+}
+
+static void attach(uint8_t core)
+{
+    hw_timer_t *timer = timerBegin(PROF_TIMER_FIRST + core, PROF_TIMER_DIV, true);
+    if (timer != NULL) {
+        timerStop(timer);
+        timerAttachInterrupt(timer, on_timer, true);    // Allocated on the calling core
+    }
+    __atomic_store_n(&timers[core], timer, __ATOMIC_RELEASE);
+}
+
+static void attach_task(void *ctx)
+{
+    attach((uint8_t)(uintptr_t)ctx);
+    vTaskDelete(NULL);
+}
+
+bool prof_service_begin()
+{
+    prof_clear(&profiler, PROF_DEFAULT_HZ);
+    uint8_t here = xPortGetCoreID();
+    for (uint8_t core = 0; core < PROF_CORES; core++) {
+        if (core == here) {
+            attach(core);
+        } else {
+            if (xTaskCreatePinnedToCore(attach_task, "prof", 3072, (void *)(uintptr_t)core, 5, NULL, core) != pdPASS)
+                return false;
+            while (__atomic_load_n(&timers[core], __ATOMIC_ACQUIRE) == NULL)
+                delay(1);
+        }
+        if (timers[core] == NULL)
+            return false;
+    }
+    return true;
+}
+
+static void stop()
+{
+    for (uint8_t core = 0; core < PROF_CORES; core++) {
+        timerAlarmDisable(timers[core]);
+        timerStop(timers[core]);
+    }
+    running = false;
+}
+
+static void start(uint32_t hz)
+{
+    stop();
+    prof_clear(&profiler, hz);
+    for (uint8_t core = 0; core < PROF_CORES; core++) {
+        timerWrite(timers[core], 0);
+        timerAlarmWrite(timers[core], 1000000 / hz, true);
+        timerAlarmEnable(timers[core]);
+    }
+    for (uint8_t core = 0; core < PROF_CORES; core++)
+        timerStart(timers[core]);
+    running = true;
+}
+
+static void serial_writer(const void *data, size_t len, void *ctx)
+{
+    Serial.write((const uint8_t *)data, len);
+}
+
+void prof_command(const char *args, void *ctx)
+{
+    if (timers[0] == NULL) {
+        Serial.println("prof: not available");
+        return;
+    }
+    if (strncmp(args, "start", 5) == 0) {
+        long hz = args[5] == ' ' ? atol(args + 6) : PROF_DEFAULT_HZ;
+        if (hz < 1 || hz > (long)PROF_MAX_HZ) {
+            Serial.printf("prof: rate 1..%u Hz\n", (unsigned)PROF_MAX_HZ);
+            return;
+        }
+        start((uint32_t)hz);
+        Serial.printf("prof: sampling at %ld Hz\n", hz);
+    } else if (strcmp(args, "stop") == 0) {
+        stop();
+        Serial.printf("prof: stopped, %u + %u samples\n", (unsigned)profiler.cores[0].samples,
+                      (unsigned)profiler.cores[1].samples);
+    } else if (strcmp(args, "dump") == 0) {
+        Serial.printf("prof: dump follows%s\n", running ? " (still sampling)" : "");
+        prof_dump(&profiler, serial_writer, NULL);
+        Serial.flush();
+        Serial.println();
+        Serial.println("prof: dump done");
+    } else {
+        Serial.println("prof: start [hz] | stop | dump");
+    }
+}
@@ -0,0 +1,182 @@
+#include "scheduler.h"
+#include "dlog.h"
+#include "metrics.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+static const uint32_t EVENT_DEADLINE_US = 1000;     // Default deadline of event driven tasks
+
+uint64_t sched_now_us()
+{
+#ifdef ARDUINO
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void sched_init(Scheduler *s, SchedClock clock)
+{
+    memset(s, 0, sizeof(*s));
+    s->clock = clock ? clock : sched_now_us;
+    s->startUs = s->clock();
+    s->loadMetric = -1;
+}
+
+int sched_add(Scheduler *s, const char *name, SchedTaskFn fn, void *ctx, uint8_t priority,
+              uint32_t periodUs, uint32_t deadlineUs)
+{
+    if (s->count == SCHED_MAX_TASKS || fn == NULL)
+        return -1;
+
+    SchedTask *t = &s->tasks[s->count];
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->fn = fn;
+    t->ctx = ctx;
+    t->priority = priority;
+    t->enabled = true;
+    t->periodUs = periodUs;
+    t->deadlineUs = deadlineUs ? deadlineUs : periodUs ? periodUs : EVENT_DEADLINE_US;
+    t->release = s->clock();
+    t->stats.bestLatencyUs = UINT32_MAX;
+    return s->count++;
+}
+
+void sched_wake(Scheduler *s, int id)
+{
+    if (id < 0 || id >= s->count)
+        return;
+    SchedTask *t = &s->tasks[id];
+    if (!t->woken) {
+        t->wokenAt = s->clock();
+        t->woken = true;
+    }
+}
+
+void sched_set_enabled(Scheduler *s, int id, bool enabled)
+{
+    if (id < 0 || id >= s->count)
+        return;
+    SchedTask *t = &s->tasks[id];
+    if (enabled && !t->enabled)
+        t->release = s->clock();    // Re-enabled periodic tasks start a fresh period, no catch-up
+    t->enabled = enabled;
+}
+
+// Release time of a task if it's due at `now`, or false
+static bool released(const SchedTask *t, uint64_t now, uint64_t *release)
+{
+    if (!t->enabled)
+        return false;
+    if (t->woken) {
+        *release = t->wokenAt;
+        return true;
+    }
+    if (t->periodUs && t->release <= now) {
+        *release = t->release;
+        return true;
+    }
+    return false;
+}
+
+uint32_t sched_run_once(Scheduler *s)
+{
+    uint64_t now = s->clock();
+    SchedTask *best = NULL;
+    uint64_t bestRelease = 0;
+
+    for (uint8_t i = 0; i < s->count; i++) {
+        SchedTask *t = &s->tasks[i];
+        uint64_t release;
+        if (!released(t, now, &release))
+            continue;
+        if (best == NULL || t->priority > best->priority ||
+            (t->priority == best->priority && release + t->deadlineUs < bestRelease + best->deadlineUs)) {
+            best = t;
+            bestRelease = release;
+        }
+    }
+
+    if (best == NULL) {
+        uint64_t wait = SCHED_MAX_IDLE_US;
+        for (uint8_t i = 0; i < s->count; i++) {
+            const SchedTask *t = &s->tasks[i];
+            if (t->enabled && t->periodUs && t->release - now < wait)
+                wait = t->release - now;
+        }
+        return wait ? (uint32_t)wait : 1;
+    }
+
+    // Clear the wake-up first, so one arriving while the task runs isn't lost
+    bool wasWoken = best->woken;
+    best->woken = false;
+
+    uint64_t start = now;
+    best->fn(best->ctx);
+    uint64_t end = s->clock();
+
+    SchedTaskStats &st = best->stats;
+    uint32_t runUs = (uint32_t)(end - start);
+    uint32_t latency = (uint32_t)(start - bestRelease);
+    st.runs++;
+    st.cpuUs += runUs;
+    s->busyUs += runUs;
+    if (s->loadMetric >= 0)
+        metrics_add(s->loadMetric, runUs);
+    if (runUs > st.worstRunUs)
+        st.worstRunUs = runUs;
+    if (latency > st.worstLatencyUs)
+        st.worstLatencyUs = latency;
+    if (latency < st.bestLatencyUs)
+        st.bestLatencyUs = latency;
+    if (end - bestRelease > best->deadlineUs) {
+        st.deadlineMisses++;
+        DLOG("sched: %s missed its deadline by %u us (ran %u us)", best->name,
+             (uint32_t)(end - bestRelease - best->deadlineUs), runUs);
+    }
+
+    // A periodic task woken early keeps its own rhythm, only the release it actually served moves on
+    if (best->periodUs && (!wasWoken || best->release <= start)) {
+        best->release += best->periodUs;
+        if (best->release + best->periodUs <= end) {
+            uint64_t behind = (end - best->release) / best->periodUs;
+            st.skipped += (uint32_t)behind;
+            best->release += behind * best->periodUs;
+        }
+    }
+    return 0;
+}
+
+const SchedTask *sched_task(const Scheduler *s, int id)
+{
+    return id >= 0 && id < s->count ? &s->tasks[id] : NULL;
+}
+
+uint8_t sched_load_percent(const Scheduler *s)
+{
+    uint64_t elapsed = s->clock() - s->startUs;
+    return elapsed ? (uint8_t)(s->busyUs * 100 / elapsed) : 0;
+}
+
+void sched_reset_stats(Scheduler *s)
+{
+    for (uint8_t i = 0; i < s->count; i++) {
+        memset(&s->tasks[i].stats, 0, sizeof(SchedTaskStats));
+        s->tasks[i].stats.bestLatencyUs = UINT32_MAX;
+    }
+    s->busyUs = 0;
+    s->startUs = s->clock();
+}
+
+void sched_set_load_metric(Scheduler *s, int metricId)
+{
+    s->loadMetric = metricId;
+}
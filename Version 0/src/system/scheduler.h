@@ -0,0 +1,103 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Cooperative task scheduler
+ *
+ * A Scheduler owns a fixed table of run-to-completion tasks and belongs to one core: the UI one is
+ * driven from loop() on core 1, others get their own FreeRTOS task pinned to a core
+ * (sched_start_on_core). A task does a bounded step of work and returns; anything longer (an SD
+ * copy, a big decode) keeps its own state and carries on at its next run.
+ *
+ * Tasks are periodic (released every periodUs, next release counted from the previous one so the
+ * rate doesn't drift) or event driven (periodUs 0, released by sched_wake(), which is ISR safe).
+ * Of the released tasks the highest priority runs first, ties go to the earliest deadline. A task
+ * that falls more than a whole period behind drops the releases it missed instead of running them
+ * back to back.
+ *
+ * Per task the scheduler keeps CPU time, worst run time, release-to-start latency (worst and best,
+ * their difference is the jitter) and deadline misses. The clock is a plain function, so the same
+ * code runs on Linux against a simulated one (tools/sched_sim.cpp).
+ */
+
+const uint8_t SCHED_MAX_TASKS           = 16;
+const uint32_t SCHED_MAX_IDLE_US        = 100000;   // Longest wait sched_run_once reports with nothing due
+
+typedef void (*SchedTaskFn)(void *ctx);
+typedef uint64_t (*SchedClock)();
+
+struct SchedTaskStats {
+    uint32_t runs;
+    uint32_t deadlineMisses;    // Finished later than release + deadline
+    uint32_t skipped;           // Releases dropped because the task was a whole period late
+    uint64_t cpuUs;
+    uint32_t worstRunUs;
+    uint32_t worstLatencyUs;    // Release to start
+    uint32_t bestLatencyUs;
+};
+
+struct SchedTask {
+    const char *name;
+    SchedTaskFn fn;
+    void *ctx;
+    uint8_t priority;           // Higher runs first
+    bool enabled;
+    uint32_t periodUs;          // 0 = only runs when woken
+    uint32_t deadlineUs;        // Relative to the release
+    uint64_t release;           // Next (or current) release time
+    volatile bool woken;
+    volatile uint64_t wokenAt;
+    SchedTaskStats stats;
+};
+
+struct Scheduler {
+    SchedTask tasks[SCHED_MAX_TASKS];
+    uint8_t count;
+    SchedClock clock;
+    uint64_t startUs;
+    uint64_t busyUs;            // Time spent inside tasks
+    int loadMetric;             // Counter metric busy time is added to, -1 for none
+};
+
+// The system's microsecond clock, what a NULL clock means
+uint64_t sched_now_us();
+
+void sched_init(Scheduler *s, SchedClock clock);
+
+// Returns the task id, or -1 when the table is full. deadlineUs 0 means "by the next release"
+// (or 1 ms for event tasks). Periodic tasks are first released straight away.
+int sched_add(Scheduler *s, const char *name, SchedTaskFn fn, void *ctx, uint8_t priority,
+              uint32_t periodUs, uint32_t deadlineUs = 0);
+
+// Releases a task now, periodic or not. Safe from an interrupt.
+void sched_wake(Scheduler *s, int id);
+
+void sched_set_enabled(Scheduler *s, int id, bool enabled);
+
+// Runs the most urgent released task, if any. Returns 0 when one ran (call again), otherwise the
+// microseconds until the next release, which the caller can sleep.
+uint32_t sched_run_once(Scheduler *s);
+
+const SchedTask *sched_task(const Scheduler *s, int id);
+
+inline uint32_t sched_jitter_us(const SchedTask *t)
+{
+    return t->stats.runs ? t->stats.worstLatencyUs - t->stats.bestLatencyUs : 0;
+}
+
+// Share of the time since sched_init spent in tasks, in percent
+uint8_t sched_load_percent(const Scheduler *s);
+
+void sched_reset_stats(Scheduler *s);
+
+// Publishes the time spent in tasks to a counter metric (e.g. METRIC_CORE1_BUSY_US), so its rate
+// is the core's load
+void sched_set_load_metric(Scheduler *s, int metricId);
+
+// Runs the scheduler forever in its own FreeRTOS task pinned to `core`. Device only (scheduler_rtos.cpp).
+bool sched_start_on_core(Scheduler *s, uint8_t core, uint32_t stackBytes, uint8_t rtosPriority);
+
+#endif
@@ -0,0 +1,19 @@
+#include <Arduino.h>
+#include "scheduler.h"
+
+static void scheduler_task(void *arg)
+{
+    Scheduler *s = (Scheduler *)arg;
+    for (;;) {
+        uint32_t wait = sched_run_once(s);
+        if (wait >= 1000)
+            vTaskDelay(pdMS_TO_TICKS(wait / 1000));     // Sleep whole ticks; shorter waits just spin on
+        else if (wait)
+            taskYIELD();
+    }
+}
+
+bool sched_start_on_core(Scheduler *s, uint8_t core, uint32_t stackBytes, uint8_t rtosPriority)
+{
+    return xTaskCreatePinnedToCore(scheduler_task, "sched", stackBytes, s, rtosPriority, NULL, core) == pdPASS;
+}
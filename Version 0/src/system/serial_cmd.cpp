@@ -0,0 +1,59 @@
+#include "serial_cmd.h"
+#include <string.h>
+
+void serial_cmd_init(SerialCmd *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+bool serial_cmd_add(SerialCmd *c, const char *name, SerialCmdFn fn, void *ctx)
+{
+    if (c->count >= SERIAL_CMD_MAX)
+        return false;
+    c->commands[c->count].name = name;
+    c->commands[c->count].fn = fn;
+    c->commands[c->count].ctx = ctx;
+    c->count++;
+    return true;
+}
+
+static bool run_line(SerialCmd *c)
+{
+    char *args = strchr(c->line, ' ');
+    size_t nameLen = args ? (size_t)(args - c->line) : strlen(c->line);
+    if (args) {
+        while (*args == ' ')
+            args++;
+    } else {
+        args = c->line + nameLen;
+    }
+    for (uint8_t i = 0; i < c->count; i++) {
+        const char *name = c->commands[i].name;
+        if (strlen(name) == nameLen && memcmp(name, c->line, nameLen) == 0) {
+            c->commands[i].fn(args, c->commands[i].ctx);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t serial_cmd_feed(SerialCmd *c, const uint8_t *data, size_t len)
+{
+    uint8_t ran = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        if (b == '\n' || b == '\r') {
+            if (!c->discard && c->len > 0) {
+                c->line[c->len] = 0;
+                ran += run_line(c);
+            }
+            c->len = 0;
+            c->discard = false;
+        } else if (b < 0x20 || b > 0x7e || c->len >= SERIAL_CMD_LINE_MAX - 1) {
+            c->discard = true;
+        } else if (!c->discard) {
+            c->line[c->len++] = (char)b;
+        }
+    }
+    return ran;
+}
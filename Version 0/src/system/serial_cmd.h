@@ -0,0 +1,46 @@
+#ifndef SERIAL_CMD_H
+#define SERIAL_CMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Text commands over the USB serial link
+ *
+ *   prof start 4000\n
+ *
+ * A line is a command name, a space and whatever arguments the command takes. Lines are collected
+ * from the bytes the UI's serial task reads (Spectra.cpp), which polls the port whenever no file
+ * transfer has it; anything that isn't printable ASCII throws the line away, so the start of a
+ * transfer frame and line noise never turn into commands. Handlers run on the feeding task and
+ * answer on Serial themselves.
+ */
+
+const uint8_t SERIAL_CMD_MAX        = 8;
+const uint8_t SERIAL_CMD_LINE_MAX   = 64;           // Including the terminator
+
+typedef void (*SerialCmdFn)(const char *args, void *ctx);
+
+struct SerialCmdEntry {
+    const char *name;
+    SerialCmdFn fn;
+    void *ctx;
+};
+
+struct SerialCmd {
+    SerialCmdEntry commands[SERIAL_CMD_MAX];
+    uint8_t count;
+    char line[SERIAL_CMD_LINE_MAX];
+    uint8_t len;
+    bool discard;               // Line got something unprintable or too long; wait for the next one
+};
+
+void serial_cmd_init(SerialCmd *c);
+
+// name must stay valid (a literal). False if the table is full.
+bool serial_cmd_add(SerialCmd *c, const char *name, SerialCmdFn fn, void *ctx);
+
+// Returns how many commands ran
+uint8_t serial_cmd_feed(SerialCmd *c, const uint8_t *data, size_t len);
+
+#endif
@@ -0,0 +1,239 @@
+#include "settings.h"
+#include <string.h>
+#include "crc32.h"
+#include "config.h"
+#include "pins_config.h"
+
+static const uint32_t SECTOR_MAGIC      = 0x54535053;   // "SPST"
+static const uint32_t SECTOR_HEADER     = 16;           // Magic + sequence, padded to the write alignment
+static const uint16_t RECORD_MAGIC      = 0x5354;       // "ST"
+static const uint16_t UNWRITTEN         = 0xFFFF;       // What an erased slot's magic reads as
+static const uint16_t MAX_SECTORS       = 32;           // Sectors used at most, whatever the partition size
+
+struct RecordHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t length;            // Bytes of struct stored, sizeof(Settings) of the version that wrote it
+    uint16_t reserved2;
+    uint32_t crc;               // Over the payload
+};
+
+// Records are compared and CRC'd as bytes, so the struct mustn't have padding the compiler owns
+static_assert(sizeof(Settings) == 216, "Settings has implicit padding, make it a field");
+
+// Slots are rounded up to 16 bytes, the flash encryption write granularity
+static const uint32_t SLOT_SIZE = (sizeof(RecordHeader) + sizeof(Settings) + 15) & ~15u;
+
+Settings settings;
+
+static const SettingsFlash *flash = NULL;
+static SettingsStats stats;
+static Settings stored;         // What's in flash right now, to skip writes that change nothing
+static uint16_t activeSector = 0;
+static uint32_t activeSequence = 0;
+static uint32_t nextSlot = 0;   // First free slot in the active sector
+static bool haveSector = false;
+static bool dirty = false;
+static uint32_t firstChangeMs = 0;
+static uint32_t lastChangeMs = 0;
+
+static uint32_t slots_per_sector()
+{
+    return (flash->sectorSize - SECTOR_HEADER) / SLOT_SIZE;
+}
+
+static uint16_t sector_count()
+{
+    return flash->sectorCount < MAX_SECTORS ? flash->sectorCount : MAX_SECTORS;
+}
+
+static uint32_t slot_offset(uint16_t sector, uint32_t slot)
+{
+    return sector * flash->sectorSize + SECTOR_HEADER + slot * SLOT_SIZE;
+}
+
+static bool read_flash(uint32_t offset, void *data, size_t len)
+{
+    stats.bootReads++;
+    return flash->read(offset, data, len, flash->ctx);
+}
+
+void settings_defaults(Settings *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->spiFrequency = SPI_FREQUENCY;
+    s->touchTimeoutMs = TOUCH_TIMEOUT;
+    s->brightness = 255;
+    strncpy(s->wifiSsid, WIFI_SSID, sizeof(s->wifiSsid) - 1);
+    strncpy(s->wifiPassword, WIFI_PASSWORD, sizeof(s->wifiPassword) - 1);
+    strncpy(s->ntpServer1, NTP_SERVER1, sizeof(s->ntpServer1) - 1);
+    strncpy(s->ntpServer2, NTP_SERVER2, sizeof(s->ntpServer2) - 1);
+    s->gmtOffsetSec = GMT_OFFSET_SEC;
+    s->daylightOffsetSec = DAY_LIGHT_OFFSET_SEC;
+}
+
+// Number of written slots in a sector. They're always a prefix, so a binary search finds the end.
+static uint32_t written_slots(uint16_t sector)
+{
+    uint32_t lo = 0, hi = slots_per_sector();
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint16_t magic = UNWRITTEN;
+        read_flash(slot_offset(sector, mid), &magic, sizeof(magic));
+        if (magic == UNWRITTEN)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+// Newest record of a sector that passes its CRC, loaded over the defaults. A torn write at the end
+// (power cut mid-record) just falls back to the one before.
+static bool load_sector(uint16_t sector, uint32_t written)
+{
+    for (uint32_t slot = written; slot-- > 0;) {
+        RecordHeader h;
+        if (!read_flash(slot_offset(sector, slot), &h, sizeof(h)) || h.magic != RECORD_MAGIC)
+            continue;
+        if (h.length == 0 || h.length > sizeof(Settings) || h.version > SETTINGS_VERSION)
+            continue;                   // Written by newer firmware with a bigger struct, can't use it
+
+        Settings s;
+        settings_defaults(&s);
+        if (!read_flash(slot_offset(sector, slot) + sizeof(h), &s, h.length))
+            continue;
+        if (crc32_update(0, (const uint8_t *)&s, h.length) != h.crc)
+            continue;
+
+        settings = s;
+        stored = s;
+        return true;
+    }
+    return false;
+}
+
+bool settings_begin(const SettingsFlash *f)
+{
+    flash = f;
+    memset(&stats, 0, sizeof(stats));
+    settings_defaults(&settings);
+    stored = settings;
+    haveSector = false;
+    dirty = false;
+
+    if (flash == NULL || flash->sectorCount == 0 || slots_per_sector() == 0)
+        return false;
+
+    // Sector headers, newest (highest sequence, wrap-around safe) first
+    uint32_t sequences[MAX_SECTORS];
+    bool valid[MAX_SECTORS];
+    uint16_t count = sector_count();
+    for (uint16_t s = 0; s < count; s++) {
+        uint32_t header[2];
+        valid[s] = read_flash(s * flash->sectorSize, header, sizeof(header)) && header[0] == SECTOR_MAGIC;
+        sequences[s] = header[1];
+        if (valid[s] && (!haveSector || (int32_t)(sequences[s] - activeSequence) > 0)) {
+            activeSector = s;
+            activeSequence = sequences[s];
+            haveSector = true;
+        }
+    }
+
+    if (!haveSector) {
+        stats.loadedDefaults = true;
+        return true;
+    }
+
+    nextSlot = written_slots(activeSector);
+
+    // Normally the newest sector has a good record. If a move to a new sector was cut short, walk back.
+    for (uint16_t back = 0; back < count; back++) {
+        uint32_t seq = activeSequence - back;
+        for (uint16_t s = 0; s < count; s++) {
+            if (valid[s] && sequences[s] == seq) {
+                if (load_sector(s, s == activeSector ? nextSlot : written_slots(s)))
+                    return true;
+            }
+        }
+    }
+
+    stats.loadedDefaults = true;
+    return true;
+}
+
+void settings_changed(uint32_t nowMs)
+{
+    if (!dirty)
+        firstChangeMs = nowMs;
+    lastChangeMs = nowMs;
+    dirty = true;
+}
+
+// Starts the next sector: erase it and stamp it with the next sequence number
+static bool next_sector()
+{
+    uint16_t sector = haveSector ? (activeSector + 1) % sector_count() : 0;
+    uint32_t header[4] = {SECTOR_MAGIC, haveSector ? activeSequence + 1 : 1, 0xFFFFFFFF, 0xFFFFFFFF};
+
+    if (!flash->erase(sector, flash->ctx))
+        return false;
+    stats.erases++;
+    if (!flash->write(sector * flash->sectorSize, header, sizeof(header), flash->ctx))
+        return false;
+
+    activeSector = sector;
+    activeSequence = header[1];
+    nextSlot = 0;
+    haveSector = true;
+    return true;
+}
+
+bool settings_flush()
+{
+    if (!dirty || flash == NULL)
+        return false;
+
+    memset(settings.pad, 0, sizeof(settings.pad));
+    if (memcmp(&settings, &stored, sizeof(Settings)) == 0) {
+        dirty = false;
+        stats.unchanged++;
+        return false;
+    }
+
+    if (!haveSector || nextSlot >= slots_per_sector()) {
+        if (!next_sector())
+            return false;
+    }
+
+    uint8_t slot[SLOT_SIZE];
+    memset(slot, 0xFF, sizeof(slot));
+    RecordHeader h = {RECORD_MAGIC, SETTINGS_VERSION, 0xFF, sizeof(Settings), 0xFFFF,
+                      crc32_update(0, (const uint8_t *)&settings, sizeof(Settings))};
+    memcpy(slot, &h, sizeof(h));
+    memcpy(slot + sizeof(h), &settings, sizeof(Settings));
+
+    if (!flash->write(slot_offset(activeSector, nextSlot), slot, sizeof(slot), flash->ctx))
+        return false;
+
+    nextSlot++;
+    stored = settings;
+    dirty = false;
+    stats.writes++;
+    return true;
+}
+
+bool settings_tick(uint32_t nowMs)
+{
+    if (!dirty)
+        return false;
+    if (nowMs - lastChangeMs < SETTINGS_DEBOUNCE_MS && nowMs - firstChangeMs < SETTINGS_MAX_DELAY_MS)
+        return false;
+    return settings_flush();
+}
+
+const SettingsStats &settings_stats()
+{
+    return stats;
+}
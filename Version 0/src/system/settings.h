@@ -0,0 +1,87 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Persistent system settings
+ *
+ * The settings are one plain struct, stored as a fixed-size binary record in a dedicated flash
+ * partition ("settings", see partitions_spectra.csv). Loading is a straight read into the struct,
+ * there is nothing to parse.
+ *
+ * Flash layout: every sector starts with a header carrying a sequence number, followed by record
+ * slots written one after the other (version, length, CRC32, then the struct). A change appends a
+ * record to the next free slot; a full sector moves on to the next one, round-robin over the
+ * whole partition, so every sector gets the same number of erases.
+ *
+ * Boot does a bounded amount of work whatever the history: read each sector header to find the
+ * newest sector, binary search its slots for the last written one, check its CRC.
+ *
+ * Versioning: fields are only ever appended to the struct. An older record is loaded over the
+ * defaults, so new fields keep their default values; bump SETTINGS_VERSION when adding some.
+ *
+ * Writes are debounced: settings_changed() only marks the struct dirty and settings_tick() writes
+ * once it has been quiet for a while, so dragging a slider costs one record, not hundreds.
+ */
+
+const uint8_t SETTINGS_VERSION          = 1;
+const uint32_t SETTINGS_DEBOUNCE_MS     = 2000;     // Quiet time before a change is written
+const uint32_t SETTINGS_MAX_DELAY_MS    = 10000;    // Never hold a change back longer than this
+
+struct Settings {
+    // Version 1
+    uint32_t spiFrequency;
+    uint32_t touchTimeoutMs;
+    uint8_t brightness;
+    uint8_t reserved[3];
+    char wifiSsid[33];
+    char wifiPassword[65];
+    char ntpServer1[48];
+    char ntpServer2[48];
+    uint8_t pad[2];             // Where the compiler would pad anyway; kept zero so records compare byte for byte
+    int32_t gmtOffsetSec;
+    int32_t daylightOffsetSec;
+};
+
+// The flash the log lives in. Writes only ever clear bits; erase sets a whole sector back to 0xFF.
+struct SettingsFlash {
+    bool (*read)(uint32_t offset, void *data, size_t len, void *ctx);
+    bool (*write)(uint32_t offset, const void *data, size_t len, void *ctx);
+    bool (*erase)(uint32_t sector, void *ctx);
+    uint32_t sectorSize;
+    uint16_t sectorCount;
+    void *ctx;
+};
+
+struct SettingsStats {
+    uint32_t writes;            // Records written
+    uint32_t unchanged;         // Flushes skipped because nothing really changed
+    uint32_t erases;
+    uint32_t bootReads;         // Flash reads the last load needed
+    bool loadedDefaults;        // Nothing valid was found at boot
+};
+
+extern Settings settings;       // The live settings, read and change them directly
+
+void settings_defaults(Settings *s);
+
+// Loads the newest valid record (or the defaults) into `settings`
+bool settings_begin(const SettingsFlash *flash);
+
+// Call after changing `settings`
+void settings_changed(uint32_t nowMs);
+
+// Writes pending changes once the debounce time has passed. Returns true if a record was written.
+bool settings_tick(uint32_t nowMs);
+
+// Writes pending changes now (before a restart or deep sleep)
+bool settings_flush();
+
+const SettingsStats &settings_stats();
+
+// The "settings" flash partition. Device only (settings_flash.cpp).
+const SettingsFlash *settings_flash_partition();
+
+#endif
@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include "esp_partition.h"          // ESP-IDF partition API
+#include "settings.h"
+
+static const esp_partition_subtype_t SETTINGS_SUBTYPE = (esp_partition_subtype_t)0x40;    // First custom data subtype
+
+static bool partition_read(uint32_t offset, void *data, size_t len, void *ctx)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, data, len) == ESP_OK;
+}
+
+static bool partition_write(uint32_t offset, const void *data, size_t len, void *ctx)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, data, len) == ESP_OK;
+}
+
+static bool partition_erase(uint32_t sector, void *ctx)
+{
+    const esp_partition_t *part = (const esp_partition_t *)ctx;
+    return esp_partition_erase_range(part, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+const SettingsFlash *settings_flash_partition()
+{
+    static SettingsFlash flash;
+    static bool found = false;
+
+    if (!found) {
+        const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SETTINGS_SUBTYPE, "settings");
+        if (part == NULL)
+            return NULL;                // Flashed with the stock partition table
+
+        flash.read = partition_read;
+        flash.write = partition_write;
+        flash.erase = partition_erase;
+        flash.sectorSize = SPI_FLASH_SEC_SIZE;
+        flash.sectorCount = part->size / SPI_FLASH_SEC_SIZE;
+        flash.ctx = (void *)part;
+        found = true;
+    }
+    return &flash;
+}
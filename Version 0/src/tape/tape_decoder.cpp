@@ -0,0 +1,173 @@
+#include "tape_decoder.h"
+#include "tape_pulses.h"
+#include <string.h>
+
+/*
+ * The ROM saver's timings are the reference (see tape_pulses.h): pilot 2168, syncs 667/735,
+ * bits made of two 855 or 1710 T-state pulses. The windows below are generous because real
+ * recordings stretch and squash pulses, and bits are decided on the sum of both halves which
+ * is a lot more robust than looking at single pulses.
+ */
+
+enum DecoderState {
+    STATE_IDLE,                 // Waiting for pilot tone
+    STATE_PILOT,                // Counting pilot pulses, waiting for the first sync
+    STATE_SYNC,                 // Got sync 1, waiting for sync 2
+    STATE_DATA,
+};
+
+static const uint32_t PILOT_MIN         = 1800;     // Pulse windows in T-states
+static const uint32_t PILOT_MAX         = 2600;
+static const uint32_t SYNC_MAX          = 1100;
+static const uint32_t DATA_MIN          = 400;
+static const uint32_t DATA_MAX          = 2400;
+static const uint32_t BIT_THRESHOLD     = (2 * TAPE_ZERO_PULSE + 2 * TAPE_ONE_PULSE) / 2;  // Sum of a bit's two pulses
+static const uint16_t PILOT_LOCK_COUNT  = 256;      // Pilot pulses needed before a sync is believed
+static const int32_t NOISE_FLOOR        = 300;      // Envelope below this is treated as silence
+
+static void end_block(TapeDecoder *dec)
+{
+    if (dec->state == STATE_DATA && dec->blockLen > 0) {
+        uint8_t sum = 0;
+        for (uint32_t i = 0; i < dec->blockLen; i++)
+            sum ^= dec->block[i];
+        bool ok = (sum == 0) && dec->blockLen >= 2;     // Flag and checksum at least
+
+        if (ok)
+            dec->stats.blocksOk++;
+        else
+            dec->stats.blocksBad++;
+        if (dec->onBlock)
+            dec->onBlock(dec->block, (uint16_t)dec->blockLen, ok, dec->ctx);
+    }
+
+    dec->state = STATE_IDLE;
+    dec->pilotCount = 0;
+    dec->firstHalf = 0;
+    dec->bitCount = 0;
+    dec->blockLen = 0;
+}
+
+static void on_pulse(TapeDecoder *dec, uint32_t t)
+{
+    switch (dec->state) {
+    case STATE_IDLE:
+    case STATE_PILOT:
+        if (t >= PILOT_MIN && t <= PILOT_MAX) {
+            if (dec->pilotCount < 0xFFFF)
+                dec->pilotCount++;
+            dec->state = STATE_PILOT;
+        } else if (t < SYNC_MAX && dec->pilotCount >= PILOT_LOCK_COUNT) {
+            dec->state = STATE_SYNC;
+        } else {
+            dec->state = STATE_IDLE;
+            dec->pilotCount = 0;
+        }
+        break;
+
+    case STATE_SYNC:
+        if (t < SYNC_MAX) {
+            dec->state = STATE_DATA;
+            dec->firstHalf = 0;
+            dec->bitCount = 0;
+            dec->blockLen = 0;
+        } else {
+            dec->state = STATE_IDLE;
+            dec->pilotCount = 0;
+        }
+        break;
+
+    case STATE_DATA:
+        if (t < DATA_MIN || t > DATA_MAX) {
+            end_block(dec);
+            break;
+        }
+        if (dec->firstHalf == 0) {
+            dec->firstHalf = t;
+            break;
+        }
+
+        dec->byte = (dec->byte << 1) | ((dec->firstHalf + t) > BIT_THRESHOLD ? 1 : 0);
+        dec->firstHalf = 0;
+        if (++dec->bitCount == 8) {
+            dec->bitCount = 0;
+            if (dec->blockLen < dec->blockCapacity)
+                dec->block[dec->blockLen++] = dec->byte;
+            else
+                end_block(dec);             // Longer than any TAP block can be, give up on it
+        }
+        break;
+    }
+}
+
+void tape_decoder_init(TapeDecoder *dec, uint32_t sampleRate, uint8_t *blockStorage, uint32_t capacity,
+                       TapeBlockCallback onBlock, void *ctx)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->tstatesPerSample = (uint32_t)(((uint64_t)TAPE_TSTATES_PER_SECOND << 16) / sampleRate);
+    dec->block = blockStorage;
+    dec->blockCapacity = capacity;
+    dec->onBlock = onBlock;
+    dec->ctx = ctx;
+    dec->state = STATE_IDLE;
+}
+
+void tape_decoder_feed(TapeDecoder *dec, const int16_t *samples, size_t count)
+{
+    // Anything quiet for longer than a data pulse can be ends the block
+    const uint32_t timeout = ((uint64_t)DATA_MAX << 16) / dec->tstatesPerSample + 1;
+
+    int32_t mean = dec->mean;
+    int32_t envelope = dec->envelope;
+    uint32_t sinceEdge = dec->sinceEdge;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+
+        mean += ((s << 8) - mean) >> 9;                     // ~512 sample time constant
+        int32_t dev = s - (mean >> 8);
+        int32_t mag = dev < 0 ? -dev : dev;
+        if (mag > envelope)
+            envelope = mag;
+        else
+            envelope -= envelope >> 12;
+
+        sinceEdge++;
+        int32_t hysteresis = envelope >> 2;
+        bool edge = false;
+        if (envelope > NOISE_FLOOR) {
+            if (dec->level == 0 && dev > hysteresis) {
+                dec->level = 1;
+                edge = true;
+            } else if (dec->level == 1 && dev < -hysteresis) {
+                dec->level = 0;
+                edge = true;
+            }
+        }
+
+        if (edge) {
+            dec->stats.edges++;
+            uint64_t t = ((uint64_t)sinceEdge * dec->tstatesPerSample) >> 16;
+            on_pulse(dec, t > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)t);
+            sinceEdge = 0;
+        } else if (sinceEdge == timeout && dec->state == STATE_DATA) {
+            end_block(dec);
+        }
+    }
+
+    dec->mean = mean;
+    dec->envelope = envelope;
+    dec->sinceEdge = sinceEdge;
+    dec->stats.samples += count;
+}
+
+void tape_decoder_finish(TapeDecoder *dec)
+{
+    end_block(dec);
+}
+
+bool tape_write_tap_block(FILE *out, const uint8_t *data, uint16_t len)
+{
+    uint8_t header[2] = {(uint8_t)len, (uint8_t)(len >> 8)};
+    return fwrite(header, 1, 2, out) == 2 && fwrite(data, 1, len, out) == len;
+}
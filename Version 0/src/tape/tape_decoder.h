@@ -0,0 +1,68 @@
+#ifndef TAPE_DECODER_H
+#define TAPE_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Streaming tape signal decoder
+ *
+ * Turns the audio of a SAVE into TAP blocks as it arrives, one sample buffer at a time:
+ *   samples -> edges (Schmitt trigger around an adaptive mean/envelope)
+ *           -> pulses (length in T-states)
+ *           -> pilot / sync / bit classification
+ *           -> bytes, checksum, block callback
+ *
+ * Each sample costs the same handful of integer operations whatever state the decoder is in and
+ * nothing is allocated after init, so the time spent per buffer is bounded by its length.
+ * No Arduino dependencies: the same code decodes WAV recordings on Linux.
+ */
+
+// Called once per finished block with the raw TAP block body (flag, data, checksum)
+typedef void (*TapeBlockCallback)(const uint8_t *data, uint16_t len, bool checksumOk, void *ctx);
+
+struct TapeDecoderStats {
+    uint32_t samples;           // Samples consumed so far
+    uint32_t edges;
+    uint16_t blocksOk;
+    uint16_t blocksBad;         // Checksum failures
+};
+
+struct TapeDecoder {
+    // Edge detection
+    int32_t mean;               // Running DC level, 8 fractional bits
+    int32_t envelope;           // Peak deviation from the mean, decays slowly
+    uint8_t level;
+    uint32_t sinceEdge;         // Samples since the last edge
+    uint32_t tstatesPerSample;  // 16.16 fixed point
+
+    // Pulse classification and assembly
+    uint8_t state;
+    uint16_t pilotCount;
+    uint32_t firstHalf;         // First pulse of the bit being assembled, 0 if none
+    uint8_t byte;
+    uint8_t bitCount;
+
+    uint8_t *block;             // Caller supplied storage, at least 65535 bytes for any TAP block
+    uint32_t blockCapacity;
+    uint32_t blockLen;
+
+    TapeBlockCallback onBlock;
+    void *ctx;
+    TapeDecoderStats stats;
+};
+
+void tape_decoder_init(TapeDecoder *dec, uint32_t sampleRate, uint8_t *blockStorage, uint32_t capacity,
+                       TapeBlockCallback onBlock, void *ctx);
+
+// Feeds signed samples. Any number of samples can be given at a time.
+void tape_decoder_feed(TapeDecoder *dec, const int16_t *samples, size_t count);
+
+// Flushes a block that was cut short by the end of the recording.
+void tape_decoder_finish(TapeDecoder *dec);
+
+// Appends a block to a .tap file (2-byte length followed by the block body)
+bool tape_write_tap_block(FILE *out, const uint8_t *data, uint16_t len);
+
+#endif
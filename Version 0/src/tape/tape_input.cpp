@@ -0,0 +1,117 @@
+#include "tape_input.h"
+#include <Arduino.h>
+#include "driver/adc.h"             // ESP-IDF continuous (DMA) ADC driver
+
+static const uint32_t TAPE_DMA_BYTES    = 1024;     // 256 conversions per DMA buffer, ~5.8 ms of audio
+static const uint32_t TAPE_RING_BYTES   = 16384;    // Driver side ring, ~93 ms of slack for the task
+static const uint32_t TAPE_BLOCK_BYTES  = 65536;    // Longest possible TAP block
+static const int TAPE_TASK_CORE         = 0;        // Arduino's loop() and the UI live on core 1
+
+static TapeDecoder decoder;
+static TapeInputStats stats;
+static volatile bool running = false;
+static uint8_t *blockStorage = NULL;
+
+static void capture_task(void *)
+{
+    static uint8_t raw[TAPE_DMA_BYTES];
+    static int16_t samples[TAPE_DMA_BYTES / SOC_ADC_DIGI_RESULT_BYTES];
+
+    while (running) {
+        uint32_t got = 0;
+        esp_err_t err = adc_digi_read_bytes(raw, sizeof(raw), &got, ADC_MAX_DELAY);
+        if (err == ESP_ERR_INVALID_STATE)
+            stats.overruns++;           // The data we did get is still good, just not contiguous
+        else if (err != ESP_OK)
+            continue;
+
+        size_t n = 0;
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t *d = (adc_digi_output_data_t *)&raw[i];
+            samples[n++] = (int16_t)(((int32_t)d->type2.data - 2048) << 4);     // 12-bit unsigned to 16-bit signed
+        }
+
+        uint32_t start = micros();
+        tape_decoder_feed(&decoder, samples, n);
+        uint32_t spent = micros() - start;
+        if (spent > stats.worstBufferUs)
+            stats.worstBufferUs = spent;
+        stats.buffers++;
+    }
+
+    adc_digi_stop();
+    adc_digi_deinitialize();
+    tape_decoder_finish(&decoder);
+    vTaskDelete(NULL);
+}
+
+bool tape_input_begin(uint8_t pin, TapeBlockCallback onBlock, void *ctx)
+{
+    if (running)
+        return false;
+
+    int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0 || channel >= SOC_ADC_CHANNEL_NUM(0))
+        return false;                   // Needs to be an ADC1 pin, ADC2 is shared with Wi-Fi
+
+    if (blockStorage == NULL)
+        blockStorage = (uint8_t *)heap_caps_malloc(TAPE_BLOCK_BYTES, MALLOC_CAP_SPIRAM);
+    if (blockStorage == NULL)
+        return false;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = TAPE_RING_BYTES;
+    init.conv_num_each_intr = TAPE_DMA_BYTES;
+    init.adc1_chan_mask = BIT(channel);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK)
+        return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = channel;
+    pattern.unit = 0;                   // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = false;
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = TAPE_INPUT_SAMPLE_RATE;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&config) != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    tape_decoder_init(&decoder, TAPE_INPUT_SAMPLE_RATE, blockStorage, TAPE_BLOCK_BYTES, onBlock, ctx);
+
+    running = true;
+    adc_digi_start();
+    if (xTaskCreatePinnedToCore(capture_task, "tape_in", 4096, NULL, configMAX_PRIORITIES - 2, NULL,
+                                TAPE_TASK_CORE) != pdPASS) {
+        running = false;
+        adc_digi_stop();
+        adc_digi_deinitialize();
+        return false;
+    }
+    return true;
+}
+
+void tape_input_end()
+{
+    running = false;                    // The task stops the ADC and flushes the decoder on its way out
+}
+
+const TapeDecoderStats &tape_input_decoder_stats()
+{
+    return decoder.stats;
+}
+
+const TapeInputStats &tape_input_stats()
+{
+    return stats;
+}
@@ -0,0 +1,29 @@
+#ifndef TAPE_INPUT_H
+#define TAPE_INPUT_H
+
+#include "tape_decoder.h"
+
+/*
+ * Records the +3's MIC output into TAP blocks.
+ *
+ * The ADC samples the pin continuously into DMA buffers; a task on core 0 (the UI runs on core 1)
+ * drains them straight into the streaming decoder, so SAVEs keep decoding while the screen animates.
+ */
+
+const uint32_t TAPE_INPUT_SAMPLE_RATE = 44100;
+
+struct TapeInputStats {
+    uint32_t buffers;           // DMA buffers decoded
+    uint32_t overruns;          // Times the ADC ring filled up before we read it (samples were lost)
+    uint32_t worstBufferUs;     // Longest time spent decoding one buffer
+};
+
+// Starts sampling and decoding. onBlock is called from the capture task.
+bool tape_input_begin(uint8_t pin, TapeBlockCallback onBlock, void *ctx);
+
+void tape_input_end();
+
+const TapeDecoderStats &tape_input_decoder_stats();
+const TapeInputStats &tape_input_stats();
+
+#endif
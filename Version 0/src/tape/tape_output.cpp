@@ -0,0 +1,110 @@
+#include "tape_output.h"
+#include <Arduino.h>
+#include "driver/rmt.h"             // ESP-IDF RMT driver
+
+static const rmt_channel_t TAPE_RMT_CHANNEL = RMT_CHANNEL_0;
+static const uint8_t TAPE_RMT_CLK_DIV       = 8;        // 80 MHz APB / 8 = 10 MHz, 100 ns per tick
+static const uint32_t TAPE_RMT_MAX_TICKS    = 32767;    // An RMT item half holds 15 bits of duration
+
+// 10 MHz / 3.5 MHz: one T-state is 20/7 ticks. The remainder is carried from pulse to pulse
+// so the stream doesn't drift, even though a single pulse can be 100 ns off.
+static const uint32_t TICKS_NUM = 20;
+static const uint32_t TICKS_DEN = 7;
+
+static TapePulseCursor cursor;
+static uint32_t pendingTicks = 0;   // What's left of the segment being translated
+static uint8_t pendingLevel = 0;
+static uint32_t tickRemainder = 0;
+static uint8_t token = 0;           // The RMT driver wants "source data"; our real source is the cursor
+static bool started = false;
+
+// Takes up to one item half worth of ticks from the stream. Returns false at the end of the tape.
+static bool next_half(uint32_t *ticks, uint8_t *level)
+{
+    if (pendingTicks == 0) {
+        uint32_t tstates;
+        if (!tape_cursor_next(&cursor, &pendingLevel, &tstates))
+            return false;
+        // 64-bit: a pause of more than a minute overflows 32 bits once scaled (it fits again after / 7)
+        uint64_t scaled = (uint64_t)tstates * TICKS_NUM + tickRemainder;
+        pendingTicks = (uint32_t)(scaled / TICKS_DEN);
+        tickRemainder = (uint32_t)(scaled % TICKS_DEN);
+        if (pendingTicks == 0)
+            pendingTicks = 1;
+    }
+
+    *ticks = pendingTicks > TAPE_RMT_MAX_TICKS ? TAPE_RMT_MAX_TICKS : pendingTicks;
+    *level = pendingLevel;
+    pendingTicks -= *ticks;
+    return true;
+}
+
+// Called by the RMT driver (from its ISR) whenever it has room for wanted_num more items.
+// We only report the single token byte as consumed once the whole tape has been translated.
+static void tape_translate(const void *src, rmt_item32_t *dest, size_t src_size,
+                           size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    size_t n = 0;
+    bool more = true;
+
+    while (n < wanted_num && more) {
+        uint32_t ticks0, ticks1 = 0;
+        uint8_t level0, level1 = 0;
+
+        more = next_half(&ticks0, &level0);
+        if (!more)
+            break;
+        more = next_half(&ticks1, &level1);
+
+        dest[n].duration0 = ticks0;
+        dest[n].level0 = level0;
+        dest[n].duration1 = more ? ticks1 : 0;      // A zero duration ends the transmission
+        dest[n].level1 = more ? level1 : 0;
+        n++;
+    }
+
+    *item_num = n;
+    *translated_size = more ? 0 : src_size;
+}
+
+bool tape_output_begin(uint8_t pin)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, TAPE_RMT_CHANNEL);
+    config.clk_div = TAPE_RMT_CLK_DIV;
+    config.mem_block_num = 2;                           // Fewer refill interrupts
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+    if (rmt_config(&config) != ESP_OK)
+        return false;
+    if (rmt_driver_install(TAPE_RMT_CHANNEL, 0, 0) != ESP_OK)
+        return false;
+    if (rmt_translator_init(TAPE_RMT_CHANNEL, tape_translate) != ESP_OK)
+        return false;
+
+    started = true;
+    return true;
+}
+
+bool tape_output_play(const TapePulseBuffer *buf, uint16_t block)
+{
+    if (!started || tape_output_busy())
+        return false;
+
+    tape_cursor_init(&cursor, buf, block);
+    pendingTicks = 0;
+    tickRemainder = 0;
+
+    return rmt_write_sample(TAPE_RMT_CHANNEL, &token, 1, false) == ESP_OK;
+}
+
+bool tape_output_busy()
+{
+    return started && rmt_wait_tx_done(TAPE_RMT_CHANNEL, 0) != ESP_OK;
+}
+
+void tape_output_stop()
+{
+    if (started)
+        rmt_tx_stop(TAPE_RMT_CHANNEL);
+}
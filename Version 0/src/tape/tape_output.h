@@ -0,0 +1,24 @@
+#ifndef TAPE_OUTPUT_H
+#define TAPE_OUTPUT_H
+
+#include "tape_pulses.h"
+
+/*
+ * Plays a precomputed pulse stream on the EAR output pin through the RMT peripheral.
+ *
+ * The RMT clocks every edge out by itself; the CPU only steps in when half of the RMT memory
+ * has been sent, to translate the next few dozen pulses. That keeps the timing free of the
+ * jitter a bit-banged ISR gets whenever the display or Wi-Fi is busy.
+ */
+
+bool tape_output_begin(uint8_t pin);
+
+// Starts playing from the given block and returns right away. The buffer must stay alive until
+// playback ends or tape_output_stop() is called.
+bool tape_output_play(const TapePulseBuffer *buf, uint16_t block = 0);
+
+bool tape_output_busy();
+
+void tape_output_stop();
+
+#endif
@@ -0,0 +1,408 @@
+#include "tape_pulses.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>      // Pulse buffers live in PSRAM on the device
+#endif
+
+/*
+ * TAP/TZX to pulse stream conversion.
+ *
+ * TAP is just a list of [length][flag, data..., checksum] blocks, every one of them played with the
+ * standard ROM loader timings. TZX describes each block's timings explicitly; we support the blocks
+ * that are actually found in the wild (0x10-0x15, pauses, loops and all the informational ones) and
+ * give up on the rare generalized/CSW blocks (0x18, 0x19) rather than play something wrong.
+ */
+
+static const char TZX_SIGNATURE[] = "ZXTape!\x1A";
+static const uint8_t WAV_LEVEL_LOW  = 0x40;     // 8-bit unsigned sample values for the two tape levels
+static const uint8_t WAV_LEVEL_HIGH = 0xC0;
+
+static void *tape_realloc(void *ptr, size_t size)
+{
+#ifdef ARDUINO
+    return heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM);
+#else
+    return realloc(ptr, size);
+#endif
+}
+
+void tape_pulses_init(TapePulseBuffer *buf)
+{
+    memset(buf, 0, sizeof(*buf));
+}
+
+void tape_pulses_free(TapePulseBuffer *buf)
+{
+    free(buf->runs);
+    free(buf->blockStart);
+    tape_pulses_init(buf);
+}
+
+static bool begin_block(TapePulseBuffer *buf)
+{
+    if (buf->blockCount == buf->blockCapacity) {
+        uint16_t capacity = buf->blockCapacity ? buf->blockCapacity * 2 : 32;
+        uint32_t *blocks = (uint32_t *)tape_realloc(buf->blockStart, capacity * sizeof(uint32_t));
+        if (blocks == NULL)
+            return false;
+        buf->blockStart = blocks;
+        buf->blockCapacity = capacity;
+    }
+    buf->blockStart[buf->blockCount++] = buf->count;
+    return true;
+}
+
+static bool push_run(TapePulseBuffer *buf, uint16_t length, uint32_t repeat)
+{
+    if (repeat == 0)
+        return true;
+
+    // Extend the previous run when it's the same pulse, as long as it belongs to the current block
+    // (otherwise seeking to a block would land in the middle of the previous one's pulses)
+    if (length != 0 && buf->count > 0 && buf->blockCount > 0 &&
+        buf->count - 1 >= buf->blockStart[buf->blockCount - 1]) {
+        TapePulse *last = &buf->runs[buf->count - 1];
+        if (last->length == length) {
+            uint32_t room = 0xFFFF - last->repeat;
+            uint32_t add = repeat < room ? repeat : room;
+            last->repeat += add;
+            repeat -= add;
+        }
+    }
+
+    while (repeat > 0) {
+        if (buf->count == buf->capacity) {
+            uint32_t capacity = buf->capacity ? buf->capacity * 2 : 1024;
+            TapePulse *runs = (TapePulse *)tape_realloc(buf->runs, capacity * sizeof(TapePulse));
+            if (runs == NULL)
+                return false;
+            buf->runs = runs;
+            buf->capacity = capacity;
+        }
+        uint16_t chunk = repeat > 0xFFFF ? 0xFFFF : repeat;
+        buf->runs[buf->count].length = length;
+        buf->runs[buf->count].repeat = chunk;
+        buf->count++;
+        repeat -= chunk;
+    }
+    return true;
+}
+
+// Data bits are two equal pulses each, MSB first. usedBits applies to the last byte only.
+static bool push_data(TapePulseBuffer *buf, const uint8_t *data, uint32_t len,
+                      uint16_t zero, uint16_t one, uint8_t usedBits = 8)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t bits = (i == len - 1) ? usedBits : 8;
+        uint8_t byte = data[i];
+        for (uint8_t b = 0; b < bits; b++) {
+            if (!push_run(buf, (byte & 0x80) ? one : zero, 2))
+                return false;
+            byte <<= 1;
+        }
+    }
+    return true;
+}
+
+// Pilot, syncs and data of a block played with ROM timings (TAP blocks and TZX block 0x10)
+static bool push_standard_block(TapePulseBuffer *buf, const uint8_t *data, uint32_t len, uint16_t pauseMs)
+{
+    uint16_t pilots = (len > 0 && data[0] < 128) ? TAPE_PILOT_HEADER_COUNT : TAPE_PILOT_DATA_COUNT;
+
+    return begin_block(buf) &&
+           push_run(buf, TAPE_PILOT_PULSE, pilots) &&
+           push_run(buf, TAPE_SYNC1_PULSE, 1) &&
+           push_run(buf, TAPE_SYNC2_PULSE, 1) &&
+           push_data(buf, data, len, TAPE_ZERO_PULSE, TAPE_ONE_PULSE) &&
+           push_run(buf, 0, pauseMs);
+}
+
+static inline uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline uint32_t rd24(const uint8_t *p) { return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16); }
+static inline uint32_t rd32(const uint8_t *p) { return rd24(p) | ((uint32_t)p[3] << 24); }
+
+TapeResult tape_build_pulses_tap(const uint8_t *image, size_t len, TapePulseBuffer *buf)
+{
+    size_t pos = 0;
+    while (pos + 2 <= len) {
+        uint16_t blockLen = rd16(image + pos);
+        pos += 2;
+        if (pos + blockLen > len)
+            return TAPE_ERR_FORMAT;
+        if (!push_standard_block(buf, image + pos, blockLen, TAPE_BLOCK_PAUSE_MS))
+            return TAPE_ERR_NO_MEMORY;
+        pos += blockLen;
+    }
+    return pos == len ? TAPE_OK : TAPE_ERR_FORMAT;
+}
+
+TapeResult tape_build_pulses_tzx(const uint8_t *image, size_t len, TapePulseBuffer *buf)
+{
+    if (len < 10 || memcmp(image, TZX_SIGNATURE, 8) != 0)
+        return TAPE_ERR_FORMAT;
+
+    size_t pos = 10;                // Signature plus major/minor version
+    uint32_t loopStart = 0;         // First run of the loop body (block 0x24)
+    uint16_t loopCount = 0;
+
+    // Every block needs at least "need" bytes to be read; checked before touching them
+    #define TZX_NEED(n) do { if (pos + (n) > len) return TAPE_ERR_FORMAT; } while (0)
+
+    while (pos < len) {
+        uint8_t id = image[pos++];
+        const uint8_t *p = image + pos;
+
+        switch (id) {
+        case 0x10: {                // Standard speed data
+            TZX_NEED(4);
+            uint16_t pause = rd16(p);
+            uint16_t dataLen = rd16(p + 2);
+            TZX_NEED(4 + dataLen);
+            if (!push_standard_block(buf, p + 4, dataLen, pause))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 4 + dataLen;
+            break;
+        }
+        case 0x11: {                // Turbo speed data
+            TZX_NEED(0x12);
+            uint32_t dataLen = rd24(p + 0x0F);
+            TZX_NEED(0x12 + dataLen);
+            if (!begin_block(buf) ||
+                !push_run(buf, rd16(p), rd16(p + 0x0A)) ||
+                !push_run(buf, rd16(p + 2), 1) ||
+                !push_run(buf, rd16(p + 4), 1) ||
+                !push_data(buf, p + 0x12, dataLen, rd16(p + 6), rd16(p + 8), p[0x0C]) ||
+                !push_run(buf, 0, rd16(p + 0x0D)))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 0x12 + dataLen;
+            break;
+        }
+        case 0x12:                  // Pure tone
+            TZX_NEED(4);
+            if (!begin_block(buf) || !push_run(buf, rd16(p), rd16(p + 2)))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 4;
+            break;
+        case 0x13: {                // Sequence of pulses of various lengths
+            TZX_NEED(1);
+            uint8_t n = p[0];
+            TZX_NEED(1 + n * 2);
+            if (!begin_block(buf))
+                return TAPE_ERR_NO_MEMORY;
+            for (uint8_t i = 0; i < n; i++) {
+                if (!push_run(buf, rd16(p + 1 + i * 2), 1))
+                    return TAPE_ERR_NO_MEMORY;
+            }
+            pos += 1 + n * 2;
+            break;
+        }
+        case 0x14: {                // Pure data, no pilot or syncs
+            TZX_NEED(0x0A);
+            uint32_t dataLen = rd24(p + 7);
+            TZX_NEED(0x0A + dataLen);
+            if (!begin_block(buf) ||
+                !push_data(buf, p + 0x0A, dataLen, rd16(p), rd16(p + 2), p[4]) ||
+                !push_run(buf, 0, rd16(p + 5)))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 0x0A + dataLen;
+            break;
+        }
+        case 0x15: {                // Direct recording, one bit per sample
+            TZX_NEED(8);
+            uint16_t perSample = rd16(p);
+            uint8_t usedBits = p[4];
+            uint32_t dataLen = rd24(p + 5);
+            TZX_NEED(8 + dataLen);
+            if (!begin_block(buf))
+                return TAPE_ERR_NO_MEMORY;
+
+            // Every change of level becomes a pulse. A level held longer than a pulse can describe
+            // (~18 ms) is silence in practice, so it gets clamped.
+            int last = -1;
+            uint32_t held = 0;
+            for (uint32_t i = 0; i < dataLen; i++) {
+                uint8_t bits = (i == dataLen - 1) ? usedBits : 8;
+                for (uint8_t b = 0; b < bits; b++) {
+                    int level = (p[8 + i] >> (7 - b)) & 1;
+                    if (level != last && last >= 0) {
+                        if (!push_run(buf, held > 0xFFFF ? 0xFFFF : held, 1))
+                            return TAPE_ERR_NO_MEMORY;
+                        held = 0;
+                    }
+                    last = level;
+                    held += perSample;
+                }
+            }
+            if (held > 0 && !push_run(buf, held > 0xFFFF ? 0xFFFF : held, 1))
+                return TAPE_ERR_NO_MEMORY;
+            if (!push_run(buf, 0, rd16(p + 2)))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 8 + dataLen;
+            break;
+        }
+        case 0x20:                  // Pause, 0 means "stop the tape" which we just play through
+            TZX_NEED(2);
+            if (!begin_block(buf) || !push_run(buf, 0, rd16(p)))
+                return TAPE_ERR_NO_MEMORY;
+            pos += 2;
+            break;
+        case 0x24:                  // Loop start
+            TZX_NEED(2);
+            loopCount = rd16(p);
+            loopStart = buf->count;
+            pos += 2;
+            break;
+        case 0x25: {                // Loop end: replay the body loopCount - 1 more times
+            uint32_t bodyEnd = buf->count;
+            for (uint16_t n = 1; n < loopCount; n++) {
+                if (!begin_block(buf))
+                    return TAPE_ERR_NO_MEMORY;
+                for (uint32_t r = loopStart; r < bodyEnd; r++) {
+                    TapePulse run = buf->runs[r];
+                    if (!push_run(buf, run.length, run.repeat))
+                        return TAPE_ERR_NO_MEMORY;
+                }
+            }
+            loopCount = 0;
+            break;
+        }
+        case 0x21: TZX_NEED(1); pos += 1 + p[0]; break;                 // Group start
+        case 0x22: break;                                               // Group end
+        case 0x23: pos += 2; break;                                     // Jump (ignored, we play linearly)
+        case 0x26: TZX_NEED(2); pos += 2 + rd16(p) * 2; break;          // Call sequence (ignored)
+        case 0x27: break;                                               // Return from sequence
+        case 0x28: TZX_NEED(2); pos += 2 + rd16(p); break;              // Select block
+        case 0x2A: pos += 4; break;                                     // Stop the tape if in 48K mode
+        case 0x2B: pos += 5; break;                                     // Set signal level
+        case 0x30: TZX_NEED(1); pos += 1 + p[0]; break;                 // Text description
+        case 0x31: TZX_NEED(2); pos += 2 + p[1]; break;                 // Message
+        case 0x32: TZX_NEED(2); pos += 2 + rd16(p); break;              // Archive info
+        case 0x33: TZX_NEED(1); pos += 1 + p[0] * 3; break;             // Hardware type
+        case 0x35:                                                      // Custom info
+            TZX_NEED(0x14);
+            if (rd32(p + 0x10) > len - pos - 0x14)
+                return TAPE_ERR_FORMAT;         // A 32-bit length could wrap pos back onto this block
+            pos += 0x14 + rd32(p + 0x10);
+            break;
+        case 0x5A: pos += 9; break;                                     // Glue block (concatenated files)
+        default:
+            return TAPE_ERR_UNSUPPORTED;
+        }
+    }
+    #undef TZX_NEED
+
+    return pos == len ? TAPE_OK : TAPE_ERR_FORMAT;
+}
+
+TapeResult tape_build_pulses(const uint8_t *image, size_t len, TapePulseBuffer *buf)
+{
+    if (len >= 8 && memcmp(image, TZX_SIGNATURE, 8) == 0)
+        return tape_build_pulses_tzx(image, len, buf);
+    return tape_build_pulses_tap(image, len, buf);
+}
+
+uint64_t tape_pulses_duration(const TapePulseBuffer *buf)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < buf->count; i++) {
+        const TapePulse &r = buf->runs[i];
+        total += r.length ? (uint64_t)r.length * r.repeat : (uint64_t)r.repeat * (TAPE_TSTATES_PER_SECOND / 1000);
+    }
+    return total;
+}
+
+void tape_cursor_init(TapePulseCursor *cur, const TapePulseBuffer *buf, uint16_t block)
+{
+    cur->buffer = buf;
+    cur->run = (block < buf->blockCount) ? buf->blockStart[block] : (block ? buf->count : 0);
+    cur->done = 0;
+    cur->level = 0;
+}
+
+bool tape_cursor_next(TapePulseCursor *cur, uint8_t *level, uint32_t *tstates)
+{
+    const TapePulseBuffer *buf = cur->buffer;
+
+    while (cur->run < buf->count) {
+        const TapePulse &r = buf->runs[cur->run];
+
+        if (r.length == 0) {        // Pause: hold the level low
+            cur->run++;
+            cur->done = 0;
+            cur->level = 0;
+            *level = 0;
+            *tstates = (uint32_t)r.repeat * (TAPE_TSTATES_PER_SECOND / 1000);
+            return true;
+        }
+
+        if (cur->done < r.repeat) {
+            cur->done++;
+            cur->level ^= 1;
+            *level = cur->level;
+            *tstates = r.length;
+            return true;
+        }
+
+        cur->run++;
+        cur->done = 0;
+    }
+    return false;
+}
+
+static void put_le(uint8_t *p, uint32_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+bool tape_render_wav(const TapePulseBuffer *buf, FILE *out, uint32_t sampleRate)
+{
+    // Sample n covers the time n * TSTATES / rate, so the number of samples is exactly
+    // ceil(duration * rate / TSTATES) and the header can be written up front.
+    uint64_t duration = tape_pulses_duration(buf);
+    uint64_t scaledEnd = duration * sampleRate;
+    uint32_t samples = (uint32_t)((scaledEnd + TAPE_TSTATES_PER_SECOND - 1) / TAPE_TSTATES_PER_SECOND);
+
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    put_le(header + 4, 36 + samples, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le(header + 16, 16, 4);             // fmt chunk size
+    put_le(header + 20, 1, 2);              // PCM
+    put_le(header + 22, 1, 2);              // Mono
+    put_le(header + 24, sampleRate, 4);
+    put_le(header + 28, sampleRate, 4);     // Byte rate
+    put_le(header + 32, 1, 2);              // Block align
+    put_le(header + 34, 8, 2);              // Bits per sample
+    memcpy(header + 36, "data", 4);
+    put_le(header + 40, samples, 4);
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header))
+        return false;
+
+    uint8_t chunk[512];
+    size_t fill = 0;
+    uint64_t n = 0;                         // Next sample to write
+    uint64_t segmentEnd = 0;                // End of the current segment, scaled by sampleRate
+
+    TapePulseCursor cur;
+    uint8_t level;
+    uint32_t tstates;
+    tape_cursor_init(&cur, buf);
+
+    while (tape_cursor_next(&cur, &level, &tstates)) {
+        segmentEnd += (uint64_t)tstates * sampleRate;
+        while (n * TAPE_TSTATES_PER_SECOND < segmentEnd) {
+            chunk[fill++] = level ? WAV_LEVEL_HIGH : WAV_LEVEL_LOW;
+            n++;
+            if (fill == sizeof(chunk)) {
+                if (fwrite(chunk, 1, fill, out) != fill)
+                    return false;
+                fill = 0;
+            }
+        }
+    }
+
+    return fwrite(chunk, 1, fill, out) == fill;
+}
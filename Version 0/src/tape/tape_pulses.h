@@ -0,0 +1,83 @@
+#ifndef TAPE_PULSES_H
+#define TAPE_PULSES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Tape pulse streams
+ *
+ * TAP and TZX images are converted ahead of time into a compact run-length list of pulses,
+ * so whatever plays the tape (the RMT on the device, a WAV file on the host) only has to walk
+ * a list instead of working out pilot/sync/data timings bit by bit while it plays.
+ *
+ * A run is "repeat" pulses of "length" T-states (3.5 MHz Spectrum clock). Every pulse starts
+ * with an edge, so the level flips at the start of each one. A run with length 0 is a pause:
+ * the level is held low for "repeat" milliseconds.
+ *
+ * This file is plain C++ with no Arduino dependencies on purpose, so it builds on Linux too.
+ */
+
+const uint32_t TAPE_TSTATES_PER_SECOND  = 3500000;     // Spectrum 48K CPU clock, the unit of all pulse lengths
+
+// Standard ROM loader timings, in T-states
+const uint16_t TAPE_PILOT_PULSE         = 2168;
+const uint16_t TAPE_PILOT_HEADER_COUNT  = 8063;        // Pilot pulses before a header block (flag < 128)
+const uint16_t TAPE_PILOT_DATA_COUNT    = 3223;        // Pilot pulses before a data block (flag >= 128)
+const uint16_t TAPE_SYNC1_PULSE         = 667;
+const uint16_t TAPE_SYNC2_PULSE         = 735;
+const uint16_t TAPE_ZERO_PULSE          = 855;
+const uint16_t TAPE_ONE_PULSE           = 1710;
+const uint16_t TAPE_BLOCK_PAUSE_MS      = 1000;
+
+enum TapeResult {
+    TAPE_OK = 0,
+    TAPE_ERR_FORMAT,            // Not a TAP/TZX image, or a block runs past the end of the file
+    TAPE_ERR_UNSUPPORTED,       // TZX block type we don't know how to turn into pulses
+    TAPE_ERR_NO_MEMORY,
+};
+
+struct TapePulse {
+    uint16_t length;            // Pulse length in T-states, 0 for a pause
+    uint16_t repeat;            // Number of identical pulses, or pause length in ms
+};
+
+struct TapePulseBuffer {
+    TapePulse *runs;            // All runs of the tape, back to back
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *blockStart;       // Index into runs[] where each tape block starts (for seeking)
+    uint16_t blockCount;
+    uint16_t blockCapacity;
+};
+
+// Walks a pulse buffer one level segment at a time. Pauses come out as a single segment.
+struct TapePulseCursor {
+    const TapePulseBuffer *buffer;
+    uint32_t run;               // Current run
+    uint16_t done;              // Pulses of the current run already returned
+    uint8_t level;              // Level of the last segment returned
+};
+
+void tape_pulses_init(TapePulseBuffer *buf);
+void tape_pulses_free(TapePulseBuffer *buf);
+
+// Detects TAP or TZX from the content and appends its pulses to buf.
+TapeResult tape_build_pulses(const uint8_t *image, size_t len, TapePulseBuffer *buf);
+TapeResult tape_build_pulses_tap(const uint8_t *image, size_t len, TapePulseBuffer *buf);
+TapeResult tape_build_pulses_tzx(const uint8_t *image, size_t len, TapePulseBuffer *buf);
+
+// Total running time of the stream, in T-states
+uint64_t tape_pulses_duration(const TapePulseBuffer *buf);
+
+void tape_cursor_init(TapePulseCursor *cur, const TapePulseBuffer *buf, uint16_t block = 0);
+
+// Returns false at the end of the tape, otherwise the next segment's level and length in T-states.
+bool tape_cursor_next(TapePulseCursor *cur, uint8_t *level, uint32_t *tstates);
+
+// Renders the stream as an 8-bit mono WAV. Each sample takes the level at its start time, using
+// integer arithmetic only, so the output is bit-exact and repeatable. Returns false on a write error.
+bool tape_render_wav(const TapePulseBuffer *buf, FILE *out, uint32_t sampleRate = 44100);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * asset_pack - packs PNG and JPEG images into an asset atlas for the "assets" flash partition
+ * (see src/storage/asset_atlas.h), decoded by the firmware's own strip decoders so the pixels are
+ * exactly what image_draw_file() would show.
+ *
+ * Each image is stored rotated and byte-swapped for the panel. The panel takes landscape rows in
+ * fours, so an image whose height isn't a multiple of 4 is padded with black rows at the bottom.
+ * Names are the file names without their extension unless given as name=file.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/asset_pack.cpp src/storage/asset_atlas.cpp src/image/image.cpp src/image/inflate.cpp \
+ *       src/image/png_decoder.cpp src/image/jpeg_decoder.cpp src/system/crc32.cpp -o asset_pack
+ *
+ * Usage:
+ *   asset_pack atlas.bin [name=]image.png|image.jpg ...
+ *   asset_pack --list atlas.bin
+ *
+ * Flash the result at the partition's offset, e.g.
+ *   esptool.py write_flash 0xee0000 atlas.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "image/image.h"
+#include "storage/asset_atlas.h"
+#include "system/crc32.h"
+
+static const uint32_t PARTITION_SIZE = 0x100000;    // "assets" in partitions_spectra.csv
+
+struct Asset {
+    std::string name, path;
+    uint16_t w, h;
+    uint16_t imageH;                // Before padding
+    std::vector<uint16_t> pixels;   // w native rows of h
+};
+
+// Tiles land in the asset at their place: tile column i is part of asset native row x + i
+struct PackState {
+    Asset *asset;
+    uint16_t tile[IMAGE_TILE_PIXELS];
+};
+
+static uint16_t *place_tile(const ImageTile &tile, void *ctx)
+{
+    PackState *s = (PackState *)ctx;
+    Asset &a = *s->asset;
+    for (uint16_t i = 0; i < tile.w; i++)
+        memcpy(&a.pixels[(size_t)(tile.x + i) * a.h + (a.h - tile.y - tile.h)], tile.pixels + (size_t)i * tile.h,
+               tile.h * 2);
+    return s->tile;
+}
+
+static bool load(Asset &a)
+{
+    FILE *f = fopen(a.path.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "%s: can't open\n", a.path.c_str());
+        return false;
+    }
+    static ImageInput in;
+    image_input_file(&in, f);
+    uint16_t width = 0, height = 0;
+    if (!image_size(&in, &width, &height) || width == 0 || height == 0) {
+        fprintf(stderr, "%s: not a PNG or JPEG\n", a.path.c_str());
+        fclose(f);
+        return false;
+    }
+    rewind(f);
+    image_input_file(&in, f);
+
+    a.w = width;
+    a.imageH = height;
+    a.h = (height + 3) & ~3;
+    a.pixels.assign((size_t)a.w * a.h, 0);      // Black is 0 in either byte order
+    static PackState s;
+    s.asset = &a;
+    ImageTarget target = {0, 0, width, height, s.tile, place_tile, &s};
+    ImageResult result = image_decode(&in, target);
+    fclose(f);
+    if (result != IMAGE_OK) {
+        static const char *RESULTS[] = {"ok", "unsupported", "corrupt", "no memory"};
+        fprintf(stderr, "%s: %s\n", a.path.c_str(), RESULTS[result]);
+        return false;
+    }
+    return true;
+}
+
+static int list(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: can't open\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> data(PARTITION_SIZE);
+    data.resize(fread(data.data(), 1, data.size(), f));
+    fclose(f);
+
+    AssetAtlas atlas;
+    if (!asset_atlas_open(&atlas, data.data(), data.size())) {
+        fprintf(stderr, "%s: not a valid atlas\n", path);
+        return 1;
+    }
+    printf("%-24s %9s %8s %8s\n", "name", "size", "offset", "bytes");
+    for (uint16_t i = 0; i < atlas.count; i++) {
+        const AssetEntry &e = atlas.entries[i];
+        char size[16];
+        snprintf(size, sizeof(size), "%ux%u", e.w, e.h);
+        printf("%-24s %9s %8u %8u\n", e.name, size, e.offset, e.w * e.h * 2);
+    }
+    printf("%u assets, %u of %u bytes\n", atlas.count, atlas.size, PARTITION_SIZE);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--list") == 0)
+        return list(argv[2]);
+    if (argc < 3) {
+        fprintf(stderr, "usage: asset_pack atlas.bin [name=]image.png|image.jpg ...\n"
+                        "       asset_pack --list atlas.bin\n");
+        return 2;
+    }
+
+    std::vector<Asset> assets;
+    for (int i = 2; i < argc; i++) {
+        Asset a;
+        const char *eq = strchr(argv[i], '=');
+        if (eq) {
+            a.name.assign(argv[i], eq - argv[i]);
+            a.path = eq + 1;
+        } else {
+            a.path = argv[i];
+            const char *base = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+            const char *dot = strrchr(base, '.');
+            a.name.assign(base, dot ? dot - base : strlen(base));
+        }
+        if (a.name.empty() || a.name.size() >= ASSET_NAME_MAX) {
+            fprintf(stderr, "%s: name must be 1 to %u characters\n", argv[i], ASSET_NAME_MAX - 1);
+            return 1;
+        }
+        if (!load(a))
+            return 1;
+        assets.push_back(a);
+    }
+
+    std::sort(assets.begin(), assets.end(), [](const Asset &a, const Asset &b) { return a.name < b.name; });
+    for (size_t i = 1; i < assets.size(); i++) {
+        if (assets[i].name == assets[i - 1].name) {
+            fprintf(stderr, "%s: name used twice\n", assets[i].name.c_str());
+            return 1;
+        }
+    }
+
+    // Header, table, then the pixels of each image in name order
+    std::vector<uint8_t> out(sizeof(AssetAtlasHeader) + assets.size() * sizeof(AssetEntry));
+    std::vector<AssetEntry> entries(assets.size());
+    for (size_t i = 0; i < assets.size(); i++) {
+        out.resize((out.size() + 3) & ~(size_t)3);
+        AssetEntry &e = entries[i];
+        memset(&e, 0, sizeof(e));
+        strcpy(e.name, assets[i].name.c_str());
+        e.w = assets[i].w;
+        e.h = assets[i].h;
+        e.offset = (uint32_t)out.size();
+        const uint8_t *p = (const uint8_t *)assets[i].pixels.data();
+        out.insert(out.end(), p, p + assets[i].pixels.size() * 2);
+    }
+    if (out.size() > PARTITION_SIZE) {
+        fprintf(stderr, "atlas is %zu bytes, the partition holds %u\n", out.size(), PARTITION_SIZE);
+        return 1;
+    }
+    memcpy(out.data() + sizeof(AssetAtlasHeader), entries.data(), entries.size() * sizeof(AssetEntry));
+    AssetAtlasHeader h = {ASSET_ATLAS_MAGIC, ASSET_ATLAS_VERSION, (uint16_t)assets.size(), (uint32_t)out.size(), 0};
+    h.crc = crc32_update(0, out.data() + sizeof(h), out.size() - sizeof(h));
+    memcpy(out.data(), &h, sizeof(h));
+
+    FILE *f = fopen(argv[1], "wb");
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size() || fclose(f) != 0) {
+        fprintf(stderr, "%s: can't write\n", argv[1]);
+        return 1;
+    }
+    for (const Asset &a : assets) {
+        if (a.h != a.imageH)
+            printf("%-24s %ux%u (padded from %u rows)\n", a.name.c_str(), a.w, a.h, a.imageH);
+        else
+            printf("%-24s %ux%u\n", a.name.c_str(), a.w, a.h);
+    }
+    printf("%zu assets, %zu of %u bytes\n", assets.size(), out.size(), PARTITION_SIZE);
+    return 0;
+}
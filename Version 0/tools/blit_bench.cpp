@@ -0,0 +1,105 @@
+/*
+ * blit_bench - blits per second against rect size, for the plain window-then-push path and the
+ * batched blit path of the panel driver.
+ *
+ * The driver runs on the host panel model, so figures are simulated time: bus time at the configured
+ * SPI clock, the model's per-transaction overhead and its cost of acquiring the bus
+ * (HAL_SPI_ACQUIRE_US), which a single blit pays every time and a batch once. The CPU cost the batch
+ * also saves (building and clearing descriptors per command) isn't counted. Rects are laid out like
+ * glyphs along text lines, so neighbours share a row band. Every path must leave the same picture on
+ * the panel.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/blit_bench
+ *
+ * Usage:
+ *   blit_bench [blits per size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "display/AXS15231B.h"
+#include "hal_host.h"
+
+struct Run {
+    uint64_t us;
+    uint32_t transactions;
+    std::vector<uint16_t> picture;
+};
+
+static std::vector<uint16_t> blank(HAL_PANEL_WIDTH * HAL_PANEL_HEIGHT);
+
+// Glyph-like layout: s x s cells down one native column band (a landscape text line), then the next band
+static std::vector<lcd_blit_t> layout(uint16_t s, int count, std::vector<uint16_t> &pixels)
+{
+    int perBand = HAL_PANEL_HEIGHT / s;
+    int bands = HAL_PANEL_WIDTH / s;
+    pixels.resize((size_t)count * s * s);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = (uint16_t)(i * 0x9E37 + 1);
+
+    std::vector<lcd_blit_t> blits(count);
+    for (int i = 0; i < count; i++) {
+        int cell = i % (perBand * bands);
+        lcd_blit_t b = {(uint16_t)(cell / perBand * s), (uint16_t)(cell % perBand * s), s, s,
+                        &pixels[(size_t)i * s * s]};
+        blits[i] = b;
+    }
+    return blits;
+}
+
+static Run measure(int mode, std::vector<lcd_blit_t> &blits)
+{
+    lcd_PushColors(0, 0, HAL_PANEL_WIDTH, HAL_PANEL_HEIGHT, blank.data());
+
+    Run run;
+    uint64_t start = hal_now_us();
+    uint32_t startTransactions = hal_panel_stats().transactions;
+    if (mode == 0) {
+        for (size_t i = 0; i < blits.size(); i++)
+            lcd_PushColors(blits[i].x, blits[i].y, blits[i].w, blits[i].h, (uint16_t *)blits[i].data);
+    } else if (mode == 1) {
+        for (size_t i = 0; i < blits.size(); i++)
+            lcd_blit(blits[i].x, blits[i].y, blits[i].w, blits[i].h, blits[i].data);
+    } else {
+        lcd_blit_batch(blits.data(), blits.size());
+    }
+    run.us = hal_now_us() - start;
+    run.transactions = hal_panel_stats().transactions - startTransactions;
+    run.picture.assign(hal_panel_pixels(), hal_panel_pixels() + HAL_PANEL_WIDTH * HAL_PANEL_HEIGHT);
+    return run;
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: blit_bench [blits per size]\n");
+        return 2;
+    }
+
+    axs15231_init();
+    lcd_setRotation(0);
+
+    static const uint16_t SIZES[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64};
+    printf("size   push/s    blit/s   batch/s   txn/blit push  batch   speedup\n");
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        uint16_t s = SIZES[i];
+        std::vector<uint16_t> pixels;
+        std::vector<lcd_blit_t> blits = layout(s, count, pixels);
+
+        Run push = measure(0, blits);
+        Run single = measure(1, blits);
+        Run batch = measure(2, blits);
+        bool same = push.picture == single.picture && push.picture == batch.picture;
+        failures += !same;
+
+        printf("%2ux%-2u %8.0f  %8.0f  %8.0f   %8.2f  %6.2f   %6.2fx%s\n", s, s,
+               count * 1e6 / push.us, count * 1e6 / single.us, count * 1e6 / batch.us,
+               (double)push.transactions / count, (double)batch.transactions / count,
+               (double)push.us / batch.us, same ? "" : "  MISMATCH");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+/*
+ * capture_bench - frame capture end to end on the host panel model: the driver's tap, the encoder,
+ * a serial link of limited speed, and the receiver's decoder.
+ *
+ * A scene of moving fills, a noisy sprite, async pushes and hardware scrolling is drawn at 60 fps
+ * while frames are captured at the given rate and drained into the link as fast as it goes, so
+ * frames are dropped when it can't keep up. Log lines go out between frames, and with --corrupt
+ * one drained chunk in n has a byte damaged. Every frame the decoder applies has to match the panel
+ * model's memory and scroll at the moment that frame was encoded. --save keeps the stream, as
+ * capture_recv would have read it from the port.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/capture_bench
+ *
+ * Usage:
+ *   capture_bench [seconds] [--fps n] [--link KB/s] [--corrupt n] [--save stream.bin]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include "config.h"
+#include "display/AXS15231B.h"
+#include "display/frame_capture.h"
+#include "hal_host.h"
+
+static const uint32_t SCENE_FRAME_US    = 16667;
+static const uint32_t LOG_EVERY_MS      = 300;      // Log line written into the stream this often
+static const uint32_t DRAIN_EVERY_US    = 5000;     // As the capture task's period
+
+struct Snapshot {
+    std::vector<uint16_t> pixels;       // Native, panel byte order
+    uint16_t scrollTop, scrollRows, scrollStart;
+};
+
+static FrameCapture capture;
+static std::map<uint32_t, Snapshot> snapshots;
+static uint16_t scrollTop = 0, scrollRows = HAL_PANEL_HEIGHT, scrollStart = 0;
+static uint32_t checked = 0, mismatches = 0;
+static FILE *saved = NULL;
+
+static void tap_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h, void *ctx)
+{
+    capture_window(&capture, x, y, w, h);
+}
+
+static void tap_pixels(const uint16_t *data, uint32_t len, void *ctx)
+{
+    capture_pixels(&capture, data, len);
+}
+
+static void tap_scroll(uint16_t top, uint16_t rows, uint16_t start, void *ctx)
+{
+    capture_scroll(&capture, top, rows, start);
+    scrollTop = top;
+    scrollRows = rows;
+    scrollStart = start;
+}
+
+static void link_out(CaptureDecoder *d, const uint8_t *data, size_t len)
+{
+    if (saved)
+        fwrite(data, 1, len, saved);
+    capture_decoder_feed(d, data, len);
+}
+
+static void on_frame(const CaptureDecoder *d, void *ctx)
+{
+    auto it = snapshots.find(d->number);
+    if (it == snapshots.end()) {
+        printf("frame %u: decoded but never encoded\n", d->number);
+        mismatches++;
+        return;
+    }
+    const Snapshot &s = it->second;
+    bool same = d->width == HAL_PANEL_WIDTH && d->height == HAL_PANEL_HEIGHT &&
+                memcmp(d->pixels, s.pixels.data(), s.pixels.size() * 2) == 0 &&
+                d->scrollTop == s.scrollTop && d->scrollRows == s.scrollRows && d->scrollStart == s.scrollStart;
+    if (!same && mismatches++ < 5)
+        printf("frame %u: differs from the panel\n", d->number);
+    checked++;
+    snapshots.erase(snapshots.begin(), ++it);
+}
+
+static void snapshot(uint32_t number)
+{
+    Snapshot &s = snapshots[number];
+    const uint16_t *fb = hal_panel_pixels();
+    s.pixels.resize((size_t)HAL_PANEL_WIDTH * HAL_PANEL_HEIGHT);
+    for (size_t i = 0; i < s.pixels.size(); i++)
+        s.pixels[i] = (uint16_t)(fb[i] << 8 | fb[i] >> 8);
+    s.scrollTop = scrollTop;
+    s.scrollRows = scrollRows;
+    s.scrollStart = scrollStart;
+}
+
+// One 60 fps frame of the scene
+static void draw_scene(uint32_t n, uint32_t &rng)
+{
+    static uint16_t sprite[48 * 32];
+    static uint16_t async[SEND_BUF_SIZE];
+
+    // A box sweeping across, over a background it repaints behind itself
+    uint16_t x = (uint16_t)(n * 5 % (LCD_WIDTH - 60));
+    drawRect(x ? x - 5 : LCD_WIDTH - 65, 20, 60, 40, COLORS::BLACK);
+    drawRect(x, 20, 60, 40, (uint16_t)(n * 97));
+
+    // A sprite of noise, which doesn't compress, every fourth frame
+    if (n % 4 == 0) {
+        for (uint16_t &p : sprite) {
+            rng = rng * 1664525 + 1013904223;
+            p = (uint16_t)(rng >> 16);
+        }
+        lcd_PushColors_rotated_90((uint16_t)(100 + n % 300), 100, 48, 32, sprite);
+    }
+
+    // A gradient bar pushed with DMA, in native coordinates
+    if (n % 10 == 5) {
+        for (uint32_t i = 0; i < 20 * LCD_HEIGHT; i++)
+            async[i] = (uint16_t)(i * 13 + n);
+        lcd_push_async(0, (uint16_t)(500 + n % 100), LCD_HEIGHT, 20, async);
+        lcd_push_wait();
+    }
+
+    // The scroll region wanders, and now and then is put back
+    if (n % 120 == 0)
+        lcd_scroll_area(400, 200);
+    if (n % 120 < 100)
+        lcd_scroll_start((uint16_t)(400 + n % 200));
+    else if (n % 120 == 100) {
+        lcd_scroll_area(0, HAL_PANEL_HEIGHT);
+        lcd_scroll_start(0);
+    }
+    lcd_push_wait();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = 20, fps = CAPTURE_DEFAULT_FPS, linkKBs = 400, corruptOneIn = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            fps = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc)
+            linkKBs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--corrupt") == 0 && i + 1 < argc)
+            corruptOneIn = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            saved = fopen(argv[++i], "wb");
+        else
+            seconds = strtoul(argv[i], NULL, 10);
+    }
+    if (seconds == 0 || fps == 0 || fps > 60 || linkKBs == 0) {
+        fprintf(stderr, "usage: capture_bench [seconds] [--fps n] [--link KB/s] [--corrupt n] [--save stream.bin]\n");
+        return 2;
+    }
+
+    axs15231_init();
+    size_t pixels = (size_t)HAL_PANEL_WIDTH * HAL_PANEL_HEIGHT;
+    size_t outSize = capture_out_size(HAL_PANEL_WIDTH, HAL_PANEL_HEIGHT);
+    std::vector<uint16_t> shadow(pixels), sent(pixels), decoded(pixels);
+    std::vector<uint8_t> out(outSize), frame(outSize);
+    capture_init(&capture, HAL_PANEL_WIDTH, HAL_PANEL_HEIGHT, CAPTURE_FLAG_LANDSCAPE, shadow.data(),
+                 sent.data(), out.data(), outSize);
+    static const lcd_tap_t tap = {tap_window, tap_pixels, tap_scroll, NULL};
+    lcd_set_tap(&tap);
+    static CaptureDecoder decoder;
+    capture_decoder_init(&decoder, decoded.data(), pixels, frame.data(), outSize, on_frame, NULL);
+
+    uint64_t start = hal_now_us(), end = start + seconds * 1000000ull;
+    uint64_t nextScene = start, nextDrain = start, nextFrame = start, nextLog = start, lastDrain = start;
+    uint64_t frameUs = 1000000 / fps;
+    double budget = 0;
+    uint32_t sceneFrames = 0, rng = 1, corrupted = 0, logLines = 0;
+    uint64_t linkBytes = 0;
+    while (hal_now_us() < end) {
+        uint64_t now = hal_now_us();
+        if (now >= nextScene) {
+            draw_scene(sceneFrames++, rng);
+            nextScene += SCENE_FRAME_US;
+        }
+        if (now >= nextDrain) {
+            // What the link carried since the last drain, as the TX buffer's free space
+            budget += (now - lastDrain) * linkKBs * 1024.0 / 1e6;
+            lastDrain = now;
+            const uint8_t *data;
+            size_t len = capture_pending(&capture, &data);
+            size_t room = budget > 0 ? (size_t)budget : 0;
+            if (len > room)
+                len = room;
+            if (len > 0) {
+                std::vector<uint8_t> chunk(data, data + len);
+                rng = rng * 1664525 + 1013904223;
+                if (corruptOneIn && (rng >> 8) % corruptOneIn == 0) {
+                    chunk[(rng >> 4) % len] ^= 0x10;
+                    corrupted++;
+                }
+                link_out(&decoder, chunk.data(), len);
+                capture_sent(&capture, len);
+                budget -= len;
+                linkBytes += len;
+            } else if (budget > 65536) {
+                budget = 65536;                 // The TX buffer doesn't hold more than that
+            }
+            if (now >= nextLog && capture_pending(&capture, &data) == 0) {
+                char line[64];
+                int n = snprintf(line, sizeof(line), "hud: %u frames drawn\r\n", sceneFrames);
+                link_out(&decoder, (const uint8_t *)line, n);
+                budget -= n;
+                logLines++;
+                nextLog += LOG_EVERY_MS * 1000;
+            }
+            if (now >= nextFrame) {
+                uint32_t number = capture.number;
+                capture_frame(&capture, (uint32_t)((now - start) / 1000));
+                if (capture.number != number)
+                    snapshot(number);
+                nextFrame += frameUs;
+            }
+            nextDrain += DRAIN_EVERY_US;
+        }
+        uint64_t next = nextScene < nextDrain ? nextScene : nextDrain;
+        if (next > hal_now_us())
+            hal_advance_us(next - hal_now_us());
+    }
+
+    if (saved)
+        fclose(saved);
+    const CaptureStats &s = capture.stats;
+    double secs = (hal_now_us() - start) / 1e6;
+    printf("%u s at %u fps asked, link %u KB/s, %u scene frames\n", seconds, fps, linkKBs, sceneFrames);
+    printf("encoded   %u frames (%.1f fps), %u keyframes, %u dropped\n", s.frames, s.frames / secs,
+           s.keyframes, s.dropped);
+    printf("encoded   %llu bytes for %llu damaged pixels: %.2f bytes/pixel, %.1fx against raw frames\n",
+           (unsigned long long)s.bytes, (unsigned long long)s.pixels, (double)s.bytes / s.pixels,
+           (double)s.frames * pixels * 2 / s.bytes);
+    printf("link      %llu bytes (%.0f KB/s), %u log lines, %u chunks damaged\n", (unsigned long long)linkBytes,
+           linkBytes / secs / 1024, logLines, corrupted);
+    printf("decoded   %u frames, %u checked against the panel, %u mismatched; %u CRC errors, %u skipped "
+           "to a keyframe\n",
+           decoder.frames, checked, mismatches, decoder.crcErrors, decoder.missed);
+
+    bool ok = mismatches == 0 && checked > 0 && (corruptOneIn || decoder.crcErrors == 0);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+/*
+ * capture_recv - turns the device's frame capture stream (src/display/frame_capture.h) back into
+ * pictures: one PPM or PNG per frame, as the screen showed it.
+ *
+ * Reads from the USB serial port, where it sends "cap start" to begin and "cap stop" on Ctrl-C, or
+ * from a file the stream was saved in. Other serial output around and inside the frames is skipped;
+ * after a frame that failed its CRC, the pictures carry on from the next keyframe.
+ *
+ * With --fps the pictures come out at that steady rate, a frame repeated until the next one's
+ * timestamp, ready for a video encoder:
+ *   ffmpeg -framerate 25 -i out/frame_%06d.png capture.mp4
+ * Without it there's one picture per frame received.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/capture_recv.cpp src/display/frame_capture.cpp src/system/crc32.cpp \
+ *       -o capture_recv
+ *
+ * Usage:
+ *   capture_recv <port | file> <outdir> [--png] [--fps n] [--rate n]
+ *     --rate  capture rate asked of the device, 1..60 (default 25)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "display/frame_capture.h"
+#include "system/crc32.h"
+
+static const uint32_t MAX_PIXELS    = 1024 * 1024;  // Largest panel taken
+
+static volatile sig_atomic_t stopping = 0;
+
+struct Output {
+    std::string dir;
+    bool png;
+    uint32_t fps;               // 0: a picture per frame
+    uint32_t written;
+    bool started;
+    double nextMs;              // Time of the next picture, with --fps
+    std::vector<uint16_t> shown;
+    uint16_t w, h;
+    bool failed;
+};
+
+static void put_be32(std::vector<uint8_t> &v, uint32_t x)
+{
+    v.push_back((uint8_t)(x >> 24));
+    v.push_back((uint8_t)(x >> 16));
+    v.push_back((uint8_t)(x >> 8));
+    v.push_back((uint8_t)x);
+}
+
+static void png_chunk(FILE *f, const char *type, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> c;
+    put_be32(c, (uint32_t)data.size());
+    c.insert(c.end(), type, type + 4);
+    c.insert(c.end(), data.begin(), data.end());
+    put_be32(c, crc32_update(0, c.data() + 4, c.size() - 4));
+    fwrite(c.data(), 1, c.size(), f);
+}
+
+// RGB rows in stored deflate blocks: no compression, but nothing to link against either
+static void write_png(FILE *f, const uint8_t *rgb, uint16_t w, uint16_t h)
+{
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(SIGNATURE, 1, 8, f);
+    std::vector<uint8_t> ihdr;
+    put_be32(ihdr, w);
+    put_be32(ihdr, h);
+    const uint8_t rest[5] = {8, 2, 0, 0, 0};       // 8-bit RGB, no interlace
+    ihdr.insert(ihdr.end(), rest, rest + 5);
+    png_chunk(f, "IHDR", ihdr);
+
+    std::vector<uint8_t> raw;
+    for (uint16_t y = 0; y < h; y++) {
+        raw.push_back(0);                           // Filter: none
+        raw.insert(raw.end(), rgb + (size_t)y * w * 3, rgb + (size_t)(y + 1) * w * 3);
+    }
+    std::vector<uint8_t> z = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t at = 0, n; at < raw.size(); at += n) {
+        n = raw.size() - at < 65535 ? raw.size() - at : 65535;
+        z.push_back(at + n == raw.size() ? 1 : 0);
+        z.push_back((uint8_t)n);
+        z.push_back((uint8_t)(n >> 8));
+        z.push_back((uint8_t)~n);
+        z.push_back((uint8_t)(~n >> 8));
+        z.insert(z.end(), raw.begin() + at, raw.begin() + at + n);
+    }
+    put_be32(z, b << 16 | a);
+    png_chunk(f, "IDAT", z);
+    png_chunk(f, "IEND", std::vector<uint8_t>());
+}
+
+static void write_picture(Output &o)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%06u.%s", o.written++, o.png ? "png" : "ppm");
+    std::string path = o.dir + name;
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f == NULL) {
+        fprintf(stderr, "can't write %s\n", path.c_str());
+        o.failed = true;
+        stopping = 1;
+        return;
+    }
+    std::vector<uint8_t> rgb((size_t)o.w * o.h * 3);
+    for (size_t i = 0; i < (size_t)o.w * o.h; i++) {
+        uint16_t c = o.shown[i];
+        rgb[i * 3] = (uint8_t)((c >> 11) * 255 / 31);
+        rgb[i * 3 + 1] = (uint8_t)(((c >> 5) & 0x3F) * 255 / 63);
+        rgb[i * 3 + 2] = (uint8_t)((c & 0x1F) * 255 / 31);
+    }
+    if (o.png) {
+        write_png(f, rgb.data(), o.w, o.h);
+    } else {
+        fprintf(f, "P6\n%u %u\n255\n", o.w, o.h);
+        fwrite(rgb.data(), 1, rgb.size(), f);
+    }
+    if (fclose(f) != 0) {
+        fprintf(stderr, "can't write %s\n", path.c_str());
+        o.failed = true;
+        stopping = 1;
+    }
+}
+
+static void on_frame(const CaptureDecoder *d, void *ctx)
+{
+    Output &o = *(Output *)ctx;
+    if (o.fps && o.started) {
+        // The picture before this one stays up until this one's time
+        for (; o.nextMs < d->timeMs; o.nextMs += 1000.0 / o.fps)
+            write_picture(o);
+    }
+    if (!o.started)
+        o.nextMs = d->timeMs;
+    o.started = true;
+    o.shown.resize((size_t)d->width * d->height);
+    capture_decoder_render(d, o.shown.data(), &o.w, &o.h);
+    if (!o.fps)
+        write_picture(o);
+    if (d->dropped)
+        printf("frame %u: %u dropped by the device before it\n", d->number, d->dropped);
+}
+
+static bool make_raw(int fd)
+{
+    termios t;
+    if (tcgetattr(fd, &t) != 0)
+        return false;
+    cfmakeraw(&t);
+    cfsetspeed(&t, B921600);        // Ignored by USB CDC, which runs at USB speed
+    return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+static void send_line(int fd, const char *line)
+{
+    if (write(fd, line, strlen(line)) < 0)
+        perror("write");
+}
+
+static void on_signal(int sig)
+{
+    stopping = 1;
+}
+
+int main(int argc, char **argv)
+{
+    Output out = {};
+    long rate = CAPTURE_DEFAULT_FPS;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--png") == 0)
+            out.png = true;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            out.fps = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+            rate = atol(argv[++i]);
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != 2 || rate < 1 || rate > 60) {
+        fprintf(stderr, "usage: capture_recv <port | file> <outdir> [--png] [--fps n] [--rate n]\n");
+        return 2;
+    }
+    out.dir = files[1];
+    if (mkdir(files[1], 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "can't make %s\n", files[1]);
+        return 1;
+    }
+
+    int fd = open(files[0], O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        fd = open(files[0], O_RDONLY);      // A saved stream
+    if (fd < 0) {
+        fprintf(stderr, "%s: can't open\n", files[0]);
+        return 1;
+    }
+    bool port = isatty(fd);
+    if (port) {
+        if (!make_raw(fd)) {
+            fprintf(stderr, "%s: can't set up the port\n", files[0]);
+            return 1;
+        }
+        tcflush(fd, TCIOFLUSH);
+        signal(SIGINT, on_signal);
+        char line[32];
+        snprintf(line, sizeof(line), "\ncap start %ld\n", rate);
+        send_line(fd, line);
+        printf("capturing, Ctrl-C to stop\n");
+    }
+
+    static CaptureDecoder decoder;
+    size_t frameSize = capture_out_size(1024, 1024);
+    std::vector<uint16_t> pixels(MAX_PIXELS);
+    std::vector<uint8_t> frame(frameSize);
+    capture_decoder_init(&decoder, pixels.data(), MAX_PIXELS, frame.data(), frameSize, on_frame, &out);
+
+    // The port is drained for a moment after "cap stop" for the rest of the last frame
+    int drainMs = -1;
+    uint8_t buf[65536];
+    for (;;) {
+        if (port && stopping && drainMs < 0) {
+            send_line(fd, "\ncap stop\n");
+            drainMs = 500;
+        }
+        if (port) {
+            pollfd p = {fd, POLLIN, 0};
+            if (poll(&p, 1, 100) <= 0) {
+                if (drainMs >= 0 && (drainMs -= 100) < 0)
+                    break;
+                continue;
+            }
+        } else if (stopping) {
+            break;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        capture_decoder_feed(&decoder, buf, n);
+    }
+    close(fd);
+    if (out.fps && out.started && !out.failed)
+        write_picture(out);             // The last frame, once
+
+    printf("%u frames, %u pictures in %s; %u failed their CRC, %u skipped waiting for a keyframe\n",
+           decoder.frames, out.written, out.dir.c_str(), decoder.crcErrors, decoder.missed);
+    return out.failed ? 1 : 0;
+}
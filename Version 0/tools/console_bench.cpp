@@ -0,0 +1,92 @@
+/*
+ * console_bench - what printing to the text console costs on the bus, against redrawing the whole
+ * grid, on the host panel model.
+ *
+ * A screen-sized console (80x22 on the strip) gets log lines of various lengths (first filling the
+ * screen, then scrolling), a status field rewritten in place, and a screen of identical lines; after
+ * each flush the panel must show exactly what a full render of the grid gives.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/console_bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "config.h"
+#include "display/AXS15231B.h"
+#include "gfx/console.h"
+#include "hal_host.h"
+
+static Console console;
+static int failures = 0;
+
+// The whole grid rendered span by span, compared with the panel's memory
+static bool check()
+{
+    static uint16_t row[CONSOLE_MAX_COLS * CONSOLE_CELL * CONSOLE_CELL];
+    const uint16_t *fb = hal_panel_pixels();
+    for (uint8_t r = 0; r < console.rows; r++) {
+        ConsoleSpan span = {r, 0, console.cols};
+        console_render_span(&console, span, row);
+        uint16_t nativeX = LCD_HEIGHT - (console.y + r * CONSOLE_CELL + CONSOLE_CELL);
+        for (int j = 0; j < console.cols * CONSOLE_CELL; j++) {
+            for (int i = 0; i < CONSOLE_CELL; i++) {
+                uint16_t want = row[j * CONSOLE_CELL + i];
+                if (fb[(console.x + j) * HAL_PANEL_WIDTH + nativeX + i] != (uint16_t)(want >> 8 | want << 8))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void report(const char *what, int lines, uint64_t bytes, uint64_t us, uint32_t transactions)
+{
+    const double fullBytes = console.cols * console.rows * CONSOLE_CELL * CONSOLE_CELL * 2.0;
+    bool ok = check();
+    failures += !ok;
+    printf("%-26s %9.0f %9.0f %8.1f %9.1f%%%s\n", what, (double)bytes / lines, (double)us / lines,
+           (double)transactions / lines, 100.0 * bytes / lines / fullBytes, ok ? "" : "  MISMATCH");
+}
+
+// Runs body lines times with a flush after each, and reports the average per line
+template <typename F> static void measure(const char *what, int lines, F body)
+{
+    uint64_t bytes = hal_panel_stats().pixelBytes, start = hal_now_us();
+    uint32_t transactions = hal_panel_stats().transactions;
+    for (int i = 0; i < lines; i++) {
+        body(i);
+        console_flush(&console);
+    }
+    report(what, lines, hal_panel_stats().pixelBytes - bytes, hal_now_us() - start,
+           hal_panel_stats().transactions - transactions);
+}
+
+int main()
+{
+    axs15231_init();
+    lcd_setRotation(0);
+    // As big as the screen allows: 80x22 on the 640x180 strip
+    console_init(&console, 0, 4, LCD_WIDTH / CONSOLE_CELL, (LCD_HEIGHT - 4) / CONSOLE_CELL);
+
+    printf("per line                    bytes    bus us      txn  of redraw\n");
+    measure("first draw (whole grid)", 1, [](int) {});
+    measure("log line, 20-60 chars", console.rows - 1, [](int i) {
+        console_printf(&console, "%05d boot: %.*s\n", i, 8 + (i * 7) % 42, "loading modules and checking the sd card slot..");
+    });
+    measure("status field, 12 chars", 50, [](int i) {
+        uint8_t col = console.cursorCol, row = console.cursorRow;
+        console_set_pen(&console, 6 + (i & 1), 1, CONSOLE_BOLD);
+        console_move(&console, console.cols - 14, 0);
+        console_printf(&console, "%6d bytes", i * 1234);
+        console_set_pen(&console, 15, 0);
+        console_move(&console, col, row);
+    });
+    measure("log line with scroll", 40, [](int i) {
+        console_printf(&console, "%05d tape: block %d, %d bytes%s\n", i, i, 17 + i * 311, i % 3 ? "" : ", checksum ok");
+    });
+    measure("same line with scroll", 40, [](int) {
+        console_print(&console, "==== identical lines scroll for free ====\n");
+    });
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * dlog_decode - turns a dump of the firmware's deferred binary log back into text.
+ *
+ * Format strings aren't in the dump, only their addresses: they're read from the ELF file of the
+ * exact build that produced it (.pio/build/<env>/firmware.elf), along with the string literals
+ * passed to %s. The dump can have other serial output around it, the decoder looks for the header.
+ *
+ * Records of both cores are merged by time. Each core has its own cycle counter, so the order of
+ * records from different cores that are less than a few microseconds apart isn't meaningful.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/dlog_decode.cpp -o dlog_decode
+ *
+ * Usage:
+ *   dlog_decode <firmware.elf> <dump.bin>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "system/dlog.h"
+
+struct Section {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t offset;
+};
+
+struct Line {
+    uint64_t ticks;
+    uint8_t core;
+    std::string text;
+};
+
+static std::vector<uint8_t> elf;
+static std::vector<Section> sections;
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+template <typename T> static T get(const uint8_t *p)
+{
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Collects the sections that hold initialised data in the image (strings are in one of those)
+static bool load_elf(const char *path)
+{
+    if (!read_file(path, elf) || elf.size() < 64 || memcmp(elf.data(), "\x7f" "ELF", 4) != 0)
+        return false;
+
+    bool is64 = elf[4] == 2;
+    uint64_t shoff = is64 ? get<uint64_t>(&elf[0x28]) : get<uint32_t>(&elf[0x20]);
+    uint16_t shentsize = get<uint16_t>(&elf[is64 ? 0x3A : 0x2E]);
+    uint16_t shnum = get<uint16_t>(&elf[is64 ? 0x3C : 0x30]);
+
+    for (uint16_t i = 0; i < shnum; i++) {
+        uint64_t at = shoff + (uint64_t)i * shentsize;
+        if (at + shentsize > elf.size())
+            return false;
+        const uint8_t *sh = &elf[at];
+        uint32_t type = get<uint32_t>(sh + 4);
+        uint64_t flags = is64 ? get<uint64_t>(sh + 8) : get<uint32_t>(sh + 8);
+        Section s;
+        s.addr = is64 ? get<uint64_t>(sh + 16) : get<uint32_t>(sh + 12);
+        s.offset = is64 ? get<uint64_t>(sh + 24) : get<uint32_t>(sh + 16);
+        s.size = is64 ? get<uint64_t>(sh + 32) : get<uint32_t>(sh + 20);
+        if (type == 1 && (flags & 2) && s.offset + s.size <= elf.size())     // SHT_PROGBITS, SHF_ALLOC
+            sections.push_back(s);
+    }
+    return true;
+}
+
+static const char *string_at(uint32_t addr)
+{
+    for (const Section &s : sections) {
+        if (addr >= s.addr && addr < s.addr + s.size) {
+            const char *p = (const char *)&elf[s.offset + (addr - s.addr)];
+            if (memchr(p, 0, s.size - (addr - s.addr)) == NULL)
+                return NULL;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static std::string format_record(const DlogRecord &r)
+{
+    const char *fmt = string_at(r.fmt);
+    char buf[256];
+    if (fmt == NULL) {
+        snprintf(buf, sizeof(buf), "<unknown format 0x%08x>", r.fmt);
+        return buf;
+    }
+
+    std::string out;
+    uint8_t arg = 0;
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') {
+            out += *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            out += '%';
+            p++;
+            continue;
+        }
+
+        // Flags, width and precision go to snprintf as they are, length modifiers are dropped
+        std::string spec = "%";
+        const char *q = p + 1;
+        while (*q && strchr("-+ #0123456789.", *q))
+            spec += *q++;
+        while (*q && strchr("hlzjt", *q))
+            q++;
+        char conv = *q;
+        if (conv == 0)
+            break;
+        p = q;
+
+        if (arg >= DLOG_MAX_ARGS) {
+            out += "?";
+            continue;
+        }
+        uint32_t v = r.args[arg++];
+        switch (conv) {
+        case 'd': case 'i':
+            snprintf(buf, sizeof(buf), (spec + "d").c_str(), (int32_t)v);
+            break;
+        case 'u': case 'x': case 'X': case 'o': case 'c':
+            snprintf(buf, sizeof(buf), (spec + conv).c_str(), v);
+            break;
+        case 'p':
+            snprintf(buf, sizeof(buf), "0x%08x", v);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+            float f;
+            memcpy(&f, &v, sizeof(f));
+            snprintf(buf, sizeof(buf), (spec + conv).c_str(), (double)f);
+            break;
+        }
+        case 's': {
+            const char *s = string_at(v);
+            if (s)
+                snprintf(buf, sizeof(buf), (spec + "s").c_str(), s);
+            else
+                snprintf(buf, sizeof(buf), "<0x%08x>", v);
+            break;
+        }
+        default:
+            snprintf(buf, sizeof(buf), "<%%%c?>", conv);
+            break;
+        }
+        out += buf;
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: dlog_decode <firmware.elf> <dump.bin>\n");
+        return 2;
+    }
+    if (!load_elf(argv[1])) {
+        fprintf(stderr, "can't read ELF file %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> dump;
+    if (!read_file(argv[2], dump)) {
+        fprintf(stderr, "can't read %s\n", argv[2]);
+        return 1;
+    }
+
+    const uint32_t header[6] = {DLOG_MAGIC, DLOG_VERSION, DLOG_CORES, DLOG_SLOTS, DLOG_MAX_ARGS};
+    const size_t headerSize = sizeof(header);
+    const size_t ringSize = 4 + DLOG_SLOTS * sizeof(DlogRecord);
+    size_t at = 0;
+    for (; at + headerSize + DLOG_CORES * ringSize <= dump.size(); at++) {
+        if (memcmp(&dump[at], header, 5 * sizeof(uint32_t)) == 0)
+            break;
+    }
+    if (at + headerSize + DLOG_CORES * ringSize > dump.size()) {
+        fprintf(stderr, "no complete dlog dump (version %u, %u cores, %u slots) in %s\n",
+                DLOG_VERSION, DLOG_CORES, DLOG_SLOTS, argv[2]);
+        return 1;
+    }
+    uint32_t ticksPerUs = get<uint32_t>(&dump[at + 20]);
+    if (ticksPerUs == 0)
+        ticksPerUs = 1;
+    at += headerSize;
+
+    std::vector<Line> lines;
+    uint32_t dropped = 0;
+    for (uint8_t c = 0; c < DLOG_CORES; c++, at += ringSize) {
+        uint32_t head = get<uint32_t>(&dump[at]);
+        uint32_t count = head < DLOG_SLOTS ? head : DLOG_SLOTS;
+        dropped += head - count;
+
+        // Oldest first; the 32 bit counter wraps every few seconds, so time is summed up in steps
+        uint64_t time = 0;
+        uint32_t last = 0;
+        bool first = true;
+        for (uint32_t n = head - count; n != head; n++) {
+            DlogRecord r;
+            memcpy(&r, &dump[at + 4 + (n % DLOG_SLOTS) * sizeof(DlogRecord)], sizeof(r));
+            if (r.fmt == 0)
+                continue;       // Was being written when the dump was taken
+            if (first)
+                time = r.ticks;
+            else
+                time += (uint32_t)(r.ticks - last);
+            last = r.ticks;
+            first = false;
+            lines.push_back({time, c, format_record(r)});
+        }
+    }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) { return a.ticks < b.ticks; });
+    if (dropped)
+        printf("(%u older records overwritten)\n", dropped);
+    uint64_t start = lines.empty() ? 0 : lines[0].ticks;
+    for (const Line &l : lines)
+        printf("%12.3f ms  core %u  %s\n", (double)(l.ticks - start) / ticksPerUs / 1000.0, l.core, l.text.c_str());
+    return 0;
+}
@@ -0,0 +1,575 @@
+/*
+ * emu_bench - checks the Z80/Spectrum core (src/emu/) and measures how fast it emulates.
+ *
+ * With no arguments it runs on built-in test material, so no ROM is needed:
+ *   - cpu: a CRC-16 of 16K written in Z80 code, checked against the same CRC in C
+ *   - capture: a synthetic tape (header, headerless SCREEN$, code) through tape_screen_capture on a
+ *     test ROM whose LD-BYTES at 0x0556 is a copy of the Spectrum ROM's edge loader, on 48K and 128K,
+ *     with the trap and without (the loader then times every edge itself). The screen has to come
+ *     out as it went in.
+ *   - full load: the whole tape, until the test program flags it loaded, checking the code block
+ * Speeds are emulated MHz: T-states run per second of host time (the real machine is 3.5 MHz).
+ *
+ * With --rom it captures real tapes on the real ROM instead, and writes each screen as a PPM next
+ * to the tape.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/emu_bench.cpp src/emu/z80.cpp src/emu/spectrum.cpp src/emu/tape_screen.cpp \
+ *       src/tape/tape_pulses.cpp src/input/macro.cpp src/storage/thumb_cache.cpp src/gfx/zx_screen.cpp \
+ *       -o emu_bench
+ *
+ * Usage:
+ *   emu_bench [--reps n]
+ *   emu_bench --rom 48.rom|128.rom [--notrap] tape.tap|tape.tzx ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "emu/z80.h"
+#include "emu/spectrum.h"
+#include "emu/tape_screen.h"
+#include "gfx/zx_screen.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static double now_s()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool read_file(const char *path, Bytes &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static uint32_t rng = 1;
+
+static uint32_t next_random()
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+// Just enough of an assembler to place code by hand with labels for the jumps
+struct Asm {
+    uint8_t *mem;               // Address 0
+    uint16_t pc;
+    std::map<std::string, uint16_t> labels;
+    struct Fix {
+        uint16_t at;
+        std::string label;
+        bool relative;
+    };
+    std::vector<Fix> fixes;
+
+    Asm(uint8_t *m, uint16_t org) : mem(m), pc(org) {}
+
+    void op(std::initializer_list<int> bytes)
+    {
+        for (int b : bytes)
+            mem[pc++] = (uint8_t)b;
+    }
+    void at(const char *name) { labels[name] = pc; }
+    void org(uint16_t addr) { pc = addr; }
+    void jr(uint8_t opcode, const char *label)      // JR cc / DJNZ
+    {
+        op({opcode, 0});
+        fixes.push_back({(uint16_t)(pc - 1), label, true});
+    }
+    void jp(uint8_t opcode, const char *label)      // JP cc / CALL cc, nn
+    {
+        op({opcode, 0, 0});
+        fixes.push_back({(uint16_t)(pc - 2), label, false});
+    }
+    void resolve()
+    {
+        for (const Fix &f : fixes) {
+            auto l = labels.find(f.label);
+            if (l == labels.end()) {
+                fprintf(stderr, "asm: no label %s\n", f.label.c_str());
+                exit(1);
+            }
+            if (f.relative) {
+                int d = l->second - (f.at + 1);
+                if (d < -128 || d > 127) {
+                    fprintf(stderr, "asm: %s out of reach\n", f.label.c_str());
+                    exit(1);
+                }
+                mem[f.at] = (uint8_t)d;
+            } else {
+                mem[f.at] = (uint8_t)l->second;
+                mem[f.at + 1] = (uint8_t)(l->second >> 8);
+            }
+        }
+    }
+};
+
+const uint8_t JR = 0x18, JR_NZ = 0x20, JR_Z = 0x28, JR_NC = 0x30, JR_C = 0x38, DJNZ = 0x10;
+const uint8_t JP = 0xC3, JP_NC = 0xD2, CALL = 0xCD;
+
+// ---- cpu: CRC-16/CCITT of 16K at 0x8000 into DE, code at 0xC000 ----
+
+static uint8_t no_in(uint16_t port, void *ctx)
+{
+    return 0xFF;
+}
+
+static void no_out(uint16_t port, uint8_t value, void *ctx)
+{
+}
+
+static void build_crc(uint8_t *mem)
+{
+    Asm a(mem, 0xC000);
+    a.op({0x21, 0x00, 0x80});       // LD HL,0x8000
+    a.op({0x01, 0x00, 0x40});       // LD BC,0x4000
+    a.op({0x11, 0xFF, 0xFF});       // LD DE,0xFFFF
+    a.at("byte");
+    a.op({0x7E});                   // LD A,(HL)
+    a.op({0xAA});                   // XOR D
+    a.op({0x57});                   // LD D,A
+    a.op({0xC5});                   // PUSH BC
+    a.op({0x06, 0x08});             // LD B,8
+    a.at("bit");
+    a.op({0xCB, 0x23});             // SLA E
+    a.op({0xCB, 0x12});             // RL D
+    a.jr(JR_NC, "skip");
+    a.op({0x7A, 0xEE, 0x10, 0x57}); // LD A,D : XOR 0x10 : LD D,A
+    a.op({0x7B, 0xEE, 0x21, 0x5F}); // LD A,E : XOR 0x21 : LD E,A
+    a.at("skip");
+    a.jr(DJNZ, "bit");
+    a.op({0xC1});                   // POP BC
+    a.op({0x23});                   // INC HL
+    a.op({0x0B});                   // DEC BC
+    a.op({0x78, 0xB1});             // LD A,B : OR C
+    a.jr(JR_NZ, "byte");
+    a.op({0x76});                   // HALT
+    a.resolve();
+}
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int b = 0; b < 8; b++)
+            crc = (uint16_t)(crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1);
+    }
+    return crc;
+}
+
+static bool bench_cpu(int reps)
+{
+    static uint8_t mem[65536];
+    for (int i = 0x8000; i < 0xC000; i++)
+        mem[i] = (uint8_t)next_random();
+    build_crc(mem);
+    Z80 z;
+    memset(&z, 0, sizeof(z));
+    z80_reset(&z);
+    for (int p = 0; p < 4; p++)
+        z.page[p] = mem + p * 0x4000;
+    z.in = no_in;
+    z.out = no_out;
+    z.trapPc = 0x10000;
+
+    uint64_t tstates = 0;
+    bool ok = true;
+    double start = now_s();
+    for (int i = 0; i < reps; i++) {
+        z.pc = 0xC000;
+        z.sp = 0xFF00;
+        z.t = 0;
+        z.halted = false;
+        while (!z.halted)
+            z80_run(&z, z.t + 1000000);
+        tstates += z.t;
+        ok = ok && z.de.w == crc16(mem + 0x8000, 0x4000);
+    }
+    double s = now_s() - start;
+    printf("%-34s %10llu T  %8.1f ms  %7.1f MHz  %s\n", "cpu crc16 16K", (unsigned long long)tstates,
+           s * 1e3, tstates / s / 1e6, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+// ---- the test ROM and tape ----
+
+static const uint16_t TEST_HEADER   = 0xFE00;
+static const uint16_t TEST_CODE     = 0x8000;
+static const uint16_t TEST_CODE_LEN = 1024;
+static const uint16_t TEST_RESULT   = 0xFFF8;   // Where the test program leaves how it went
+static const uint8_t TEST_LOADED    = 1;
+static const uint8_t TEST_FAILED    = 2;
+
+// LD-BYTES as the 48K ROM has it (less the SA/LD-RET return address), at 0x0556
+static void build_ld_bytes(Asm &a)
+{
+    a.org(SPECTRUM_LD_BYTES);
+    a.op({0x14});                   // INC D          (resets Z)
+    a.op({0x08});                   // EX AF,AF'      (flag byte and load/verify kept in A'F')
+    a.op({0x15});                   // DEC D
+    a.op({0xF3});                   // DI
+    a.op({0x3E, 0x0F});             // LD A,0x0F
+    a.op({0xD3, 0xFE});             // OUT (0xFE),A
+    a.op({0xDB, 0xFE});             // IN A,(0xFE)
+    a.op({0x1F});                   // RRA
+    a.op({0xE6, 0x20});             // AND 0x20
+    a.op({0xF6, 0x02});             // OR 0x02
+    a.op({0x4F});                   // LD C,A
+    a.op({0xBF});                   // CP A
+    a.at("ld_break");
+    a.op({0xC0});                   // RET NZ
+    a.at("ld_start");
+    a.jp(CALL, "ld_edge_1");
+    a.jr(JR_NC, "ld_break");
+    a.op({0x21, 0x15, 0x04});       // LD HL,0x0415
+    a.at("ld_wait");
+    a.jr(DJNZ, "ld_wait");
+    a.op({0x2B, 0x7C, 0xB5});       // DEC HL : LD A,H : OR L
+    a.jr(JR_NZ, "ld_wait");
+    a.jp(CALL, "ld_edge_2");
+    a.jr(JR_NC, "ld_break");
+    a.at("ld_leader");
+    a.op({0x06, 0x9C});             // LD B,0x9C
+    a.jp(CALL, "ld_edge_2");
+    a.jr(JR_NC, "ld_break");
+    a.op({0x3E, 0xC6, 0xB8});       // LD A,0xC6 : CP B
+    a.jr(JR_NC, "ld_start");
+    a.op({0x24});                   // INC H
+    a.jr(JR_NZ, "ld_leader");
+    a.at("ld_sync");
+    a.op({0x06, 0xC9});             // LD B,0xC9
+    a.jp(CALL, "ld_edge_1");
+    a.jr(JR_NC, "ld_break");
+    a.op({0x78, 0xFE, 0xD4});       // LD A,B : CP 0xD4
+    a.jr(JR_NC, "ld_sync");
+    a.jp(CALL, "ld_edge_1");
+    a.op({0xD0});                   // RET NC
+    a.op({0x79, 0xEE, 0x03, 0x4F}); // LD A,C : XOR 0x03 : LD C,A
+    a.op({0x26, 0x00});             // LD H,0
+    a.op({0x06, 0xB0});             // LD B,0xB0
+    a.jr(JR, "ld_marker");
+    a.at("ld_loop");
+    a.op({0x08});                   // EX AF,AF'
+    a.jr(JR_NZ, "ld_flag");
+    a.jr(JR_NC, "ld_verify");
+    a.op({0xDD, 0x75, 0x00});       // LD (IX+0),L
+    a.jr(JR, "ld_next");
+    a.at("ld_flag");
+    a.op({0xCB, 0x11});             // RL C
+    a.op({0xAD});                   // XOR L
+    a.op({0xC0});                   // RET NZ
+    a.op({0x79, 0x1F, 0x4F});       // LD A,C : RRA : LD C,A
+    a.op({0x13});                   // INC DE
+    a.jr(JR, "ld_dec");
+    a.at("ld_verify");
+    a.op({0xDD, 0x7E, 0x00});       // LD A,(IX+0)
+    a.op({0xAD});                   // XOR L
+    a.op({0xC0});                   // RET NZ
+    a.at("ld_next");
+    a.op({0xDD, 0x23});             // INC IX
+    a.at("ld_dec");
+    a.op({0x1B});                   // DEC DE
+    a.op({0x08});                   // EX AF,AF'
+    a.op({0x06, 0xB2});             // LD B,0xB2
+    a.at("ld_marker");
+    a.op({0x2E, 0x01});             // LD L,1
+    a.at("ld_8_bits");
+    a.jp(CALL, "ld_edge_2");
+    a.op({0xD0});                   // RET NC
+    a.op({0x3E, 0xCB, 0xB8});       // LD A,0xCB : CP B
+    a.op({0xCB, 0x15});             // RL L
+    a.op({0x06, 0xB0});             // LD B,0xB0
+    a.jp(JP_NC, "ld_8_bits");
+    a.op({0x7C, 0xAD, 0x67});       // LD A,H : XOR L : LD H,A
+    a.op({0x7A, 0xB3});             // LD A,D : OR E
+    a.jr(JR_NZ, "ld_loop");
+    a.op({0x7C, 0xFE, 0x01});       // LD A,H : CP 1
+    a.op({0xC9});                   // RET
+    a.at("ld_edge_2");
+    a.jp(CALL, "ld_edge_1");
+    a.op({0xD0});                   // RET NC
+    a.at("ld_edge_1");
+    a.op({0x3E, 0x16});             // LD A,0x16
+    a.at("ld_delay");
+    a.op({0x3D});                   // DEC A
+    a.jr(JR_NZ, "ld_delay");
+    a.op({0xA7});                   // AND A
+    a.at("ld_sample");
+    a.op({0x04});                   // INC B
+    a.op({0xC8});                   // RET Z
+    a.op({0x3E, 0x7F});             // LD A,0x7F
+    a.op({0xDB, 0xFE});             // IN A,(0xFE)
+    a.op({0x1F});                   // RRA
+    a.op({0xD0});                   // RET NC         (SPACE)
+    a.op({0xA9});                   // XOR C
+    a.op({0xE6, 0x20});             // AND 0x20
+    a.jr(JR_Z, "ld_sample");
+    a.op({0x79, 0x2F, 0x4F});       // LD A,C : CPL : LD C,A
+    a.op({0xE6, 0x07, 0xF6, 0x08}); // AND 7 : OR 8
+    a.op({0xD3, 0xFE});             // OUT (0xFE),A
+    a.op({0x37});                   // SCF
+    a.op({0xC9});                   // RET
+}
+
+// Load one block with LD-BYTES: IX, DE, flag; jumps to fail if it doesn't load
+static void load_block(Asm &a, std::initializer_list<int> ixde, uint8_t flag)
+{
+    a.op(ixde);
+    a.op({0x3E, flag});             // LD A,flag
+    a.op({0x37});                   // SCF
+    a.op({CALL, SPECTRUM_LD_BYTES & 0xFF, SPECTRUM_LD_BYTES >> 8});
+    a.jr(JR_NC, "fail");
+}
+
+/*
+ * A 32K ROM pair. ROM 0 only pages in ROM 1 (which a 48K ignores, its first 7 bytes being the
+ * same); ROM 1 waits for ENTER to be pressed and let go, then loads the header to 0xFE00, a
+ * headerless SCREEN$, and the code block the header describes, notes how that went at 0xFFF8 and
+ * idles with interrupts on.
+ */
+static void build_rom(uint8_t *rom)
+{
+    memset(rom, 0, 2 * SPECTRUM_ROM_SIZE);
+    uint8_t *basic = rom + SPECTRUM_ROM_SIZE;
+    Asm a(basic, 0);
+    a.op({0x3E, 0x10});             // LD A,0x10
+    a.op({0x01, 0xFD, 0x7F});       // LD BC,0x7FFD
+    a.op({0xED, 0x79});             // OUT (C),A
+    memcpy(rom, basic, a.pc);       // ROM 0 stops here, and carries on in ROM 1
+    a.jp(JP, "main");
+    a.org(0x0038);
+    a.op({0xFB, 0xC9});             // EI : RET
+    a.org(0x0100);
+    a.at("main");
+    a.op({0xF3});                   // DI
+    a.op({0x31, 0xF0, 0xFF});       // LD SP,0xFFF0
+    a.op({0xED, 0x56});             // IM 1
+    a.op({0x01, 0xFE, 0xBF});       // LD BC,0xBFFE
+    a.at("press");
+    a.op({0xED, 0x78, 0x1F});       // IN A,(C) : RRA
+    a.jr(JR_C, "press");
+    a.at("release");
+    a.op({0xED, 0x78, 0x1F});
+    a.jr(JR_NC, "release");
+    load_block(a, {0xDD, 0x21, TEST_HEADER & 0xFF, TEST_HEADER >> 8, 0x11, 17, 0}, 0x00);
+    load_block(a, {0xDD, 0x21, 0x00, 0x40, 0x11, ZX_SCREEN_SIZE & 0xFF, ZX_SCREEN_SIZE >> 8}, 0xFF);
+    load_block(a, {0xDD, 0x2A, (TEST_HEADER + 13) & 0xFF, TEST_HEADER >> 8,        // LD IX,(start)
+                   0xED, 0x5B, (TEST_HEADER + 11) & 0xFF, TEST_HEADER >> 8}, 0xFF); // LD DE,(length)
+    a.op({0x3E, TEST_LOADED});
+    a.jr(JR, "done");
+    a.at("fail");
+    a.op({0x3E, TEST_FAILED});
+    a.at("done");
+    a.op({0x32, TEST_RESULT & 0xFF, TEST_RESULT >> 8});    // LD (result),A
+    a.op({0xFB});                   // EI
+    a.at("idle");
+    a.op({0x76});                   // HALT
+    a.jr(JR, "idle");
+    build_ld_bytes(a);
+    a.resolve();
+}
+
+static void tap_block(Bytes &tap, uint8_t flag, const uint8_t *data, size_t len)
+{
+    uint16_t blockLen = (uint16_t)(len + 2);
+    uint8_t check = flag;
+    tap.push_back((uint8_t)blockLen);
+    tap.push_back((uint8_t)(blockLen >> 8));
+    tap.push_back(flag);
+    for (size_t i = 0; i < len; i++) {
+        tap.push_back(data[i]);
+        check ^= data[i];
+    }
+    tap.push_back(check);
+}
+
+static void build_tape(Bytes &tap, uint8_t *screen, uint8_t *code)
+{
+    for (int i = 0; i < ZX_SCREEN_BITMAP_SIZE; i++)
+        screen[i] = (uint8_t)(next_random() | (i & 1));
+    for (int i = ZX_SCREEN_BITMAP_SIZE; i < ZX_SCREEN_SIZE; i++)
+        screen[i] = (uint8_t)(next_random() & 0x7F);  // No FLASH
+    for (int i = 0; i < TEST_CODE_LEN; i++)
+        code[i] = (uint8_t)next_random();
+    uint8_t header[17] = {3, 'e', 'm', 'u', 'b', 'e', 'n', 'c', 'h', ' ', ' ',
+                          TEST_CODE_LEN & 0xFF, TEST_CODE_LEN >> 8, TEST_CODE & 0xFF, TEST_CODE >> 8, 0, 0x80};
+    tap_block(tap, 0x00, header, sizeof(header));
+    tap_block(tap, 0xFF, screen, ZX_SCREEN_SIZE);
+    tap_block(tap, 0xFF, code, TEST_CODE_LEN);
+}
+
+static const char *end_name(TapeScreenEnd end)
+{
+    static const char *NAMES[] = {"none", "loaded", "settled", "tape end"};
+    return NAMES[end];
+}
+
+static uint8_t ram[8 * SPECTRUM_BANK_SIZE];
+
+static bool bench_capture(const uint8_t *rom, const Bytes &tap, const uint8_t *want, SpectrumModel model, bool traps)
+{
+    TapeScreenConfig config = {model, rom, ram, traps, TAPE_SCREEN_MAX_FRAMES};
+    uint8_t screen[ZX_SCREEN_SIZE];
+    TapeScreenStats stats;
+    double start = now_s();
+    bool ok = tape_screen_capture(config, tap.data(), tap.size(), screen, &stats);
+    double s = now_s() - start;
+    ok = ok && stats.end == (traps ? TAPE_SCREEN_LOADED : TAPE_SCREEN_SETTLED) &&
+         memcmp(screen, want, ZX_SCREEN_SIZE) == 0;
+    char name[48];
+    snprintf(name, sizeof(name), "capture %s %s", model == SPECTRUM_128K ? "128K" : "48K",
+             traps ? "trap" : "edges");
+    printf("%-34s %10llu T  %8.1f ms  %7.1f MHz  %s, %u frames, %u trapped  %s\n", name,
+           (unsigned long long)stats.tstates, s * 1e3, stats.tstates / s / 1e6, end_name(stats.end),
+           (unsigned)stats.frames, (unsigned)stats.trapped, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+// The whole tape, pressing ENTER by hand, until the test program says how it went
+static bool bench_full_load(const uint8_t *rom, const Bytes &tap, const uint8_t *code, SpectrumModel model,
+                            bool traps)
+{
+    const uint8_t ENTER = 30;       // Row 6 (0xBFFE), column 0
+    TapePulseBuffer tape;
+    tape_pulses_init(&tape);
+    if (tape_build_pulses(tap.data(), tap.size(), &tape) != TAPE_OK)
+        return false;
+    Spectrum s;
+    double start = now_s();
+    spectrum_init(&s, model, rom, ram);
+    spectrum_insert_tape(&s, &tape, traps);
+    const uint8_t &result = ram[(model == SPECTRUM_128K ? 0 : 2 * SPECTRUM_BANK_SIZE) + TEST_RESULT - 0xC000];
+    uint32_t frame = 0;
+    for (; result == 0 && frame < TAPE_SCREEN_MAX_FRAMES; frame++) {
+        if (frame < 10)
+            spectrum_key(&s, ENTER, frame < 5);
+        spectrum_run_frame(&s);
+    }
+    double sec = now_s() - start;
+    const uint8_t *loaded = model == SPECTRUM_128K ? ram + 2 * SPECTRUM_BANK_SIZE : ram + SPECTRUM_BANK_SIZE;
+    bool ok = result == TEST_LOADED && memcmp(loaded, code, TEST_CODE_LEN) == 0 && s.trapped.count == (traps ? 3u : 0u);
+    uint64_t t = spectrum_tstates(&s);
+    char name[48];
+    snprintf(name, sizeof(name), "full load %s %s", model == SPECTRUM_128K ? "128K" : "48K",
+             traps ? "trap" : "edges");
+    printf("%-34s %10llu T  %8.1f ms  %7.1f MHz  %u frames (%.1f s of tape time)  %s\n", name,
+           (unsigned long long)t, sec * 1e3, t / sec / 1e6, (unsigned)frame, t / 3.5e6, ok ? "ok" : "WRONG");
+    tape_pulses_free(&tape);
+    return ok;
+}
+
+static int run_builtin(int reps)
+{
+    static uint8_t rom[2 * SPECTRUM_ROM_SIZE];
+    build_rom(rom);
+    static uint8_t screen[ZX_SCREEN_SIZE], code[TEST_CODE_LEN];
+    Bytes tap;
+    build_tape(tap, screen, code);
+
+    int failed = 0;
+    failed += !bench_cpu(reps);
+    for (int m = 0; m < 2; m++) {
+        SpectrumModel model = m ? SPECTRUM_128K : SPECTRUM_48K;
+        const uint8_t *r = m ? rom : rom + SPECTRUM_ROM_SIZE;   // 48K: just the BASIC half
+        failed += !bench_capture(r, tap, screen, model, true);
+        failed += !bench_capture(r, tap, screen, model, false);
+        failed += !bench_full_load(r, tap, code, model, true);
+        failed += !bench_full_load(r, tap, code, model, false);
+    }
+    if (failed)
+        printf("%d FAILED\n", failed);
+    return failed ? 1 : 0;
+}
+
+static bool write_ppm(const char *path, const uint8_t *screen)
+{
+    static uint16_t pixels[256 * 192];
+    ZxScreenView view = {0, 0, 256, 192, 256, 192};
+    zx_screen_render(screen, view, false, pixels, 256);
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return false;
+    fprintf(f, "P6\n256 192\n255\n");
+    for (int i = 0; i < 256 * 192; i++) {
+        uint16_t p = pixels[i];
+        uint8_t rgb[3] = {(uint8_t)((p >> 11) << 3), (uint8_t)(((p >> 5) & 0x3F) << 2), (uint8_t)((p & 0x1F) << 3)};
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f) == 0;
+}
+
+static int run_tapes(const char *romPath, bool traps, char **paths, int count)
+{
+    Bytes rom;
+    if (!read_file(romPath, rom) || (rom.size() != SPECTRUM_ROM_SIZE && rom.size() != 2u * SPECTRUM_ROM_SIZE)) {
+        fprintf(stderr, "%s: not a 16K or 32K ROM\n", romPath);
+        return 2;
+    }
+    SpectrumModel model = rom.size() == SPECTRUM_ROM_SIZE ? SPECTRUM_48K : SPECTRUM_128K;
+    zx_screen_init(false);
+    int failed = 0;
+    uint64_t tstates = 0;
+    double seconds = 0;
+    for (int i = 0; i < count; i++) {
+        Bytes tap;
+        if (!read_file(paths[i], tap)) {
+            printf("%-34s can't read\n", paths[i]);
+            failed++;
+            continue;
+        }
+        TapeScreenConfig config = {model, rom.data(), ram, traps, TAPE_SCREEN_MAX_FRAMES};
+        uint8_t screen[ZX_SCREEN_SIZE];
+        TapeScreenStats stats;
+        double start = now_s();
+        bool ok = tape_screen_capture(config, tap.data(), tap.size(), screen, &stats);
+        double s = now_s() - start;
+        tstates += stats.tstates;
+        seconds += s;
+        std::string out = std::string(paths[i]) + ".ppm";
+        ok = ok && write_ppm(out.c_str(), screen);
+        printf("%-34s %10llu T  %8.1f ms  %7.1f MHz  %s, %u frames, %u trapped\n", paths[i],
+               (unsigned long long)stats.tstates, s * 1e3, stats.tstates / s / 1e6, end_name(stats.end),
+               (unsigned)stats.frames, (unsigned)stats.trapped);
+        failed += !ok;
+    }
+    if (seconds > 0)
+        printf("\n%d tapes: %.1f MHz emulated on average, %d without a screen\n", count, tstates / seconds / 1e6,
+               failed);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "--rom") == 0) {
+        bool traps = !(argc > 3 && strcmp(argv[3], "--notrap") == 0);
+        int first = traps ? 3 : 4;
+        if (first >= argc) {
+            fprintf(stderr, "usage: emu_bench --rom 48.rom|128.rom [--notrap] tape ...\n");
+            return 2;
+        }
+        return run_tapes(argv[2], traps, argv + first, argc - first);
+    }
+    int reps = 20;
+    if (argc == 3 && strcmp(argv[1], "--reps") == 0)
+        reps = atoi(argv[2]);
+    if (reps < 1 || (argc != 1 && argc != 3)) {
+        fprintf(stderr, "usage: emu_bench [--reps n]\n"
+                        "       emu_bench --rom 48.rom|128.rom [--notrap] tape.tap|tape.tzx ...\n");
+        return 2;
+    }
+    return run_builtin(reps);
+}
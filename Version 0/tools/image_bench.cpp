@@ -0,0 +1,137 @@
+/*
+ * image_bench - decode-to-flush time of the strip JPEG/PNG decoders, with tiles pushed through the
+ * panel driver's queued DMA path on the host panel model.
+ *
+ * For each image: host CPU time spent decoding, simulated bus time of the pushes, and the time a
+ * whole draw takes when every flush overlaps the next tile's decode (the device's two buffers)
+ * against decoding and pushing one after the other. Decode times are the host's; the ESP32-S3 is
+ * many times slower, which moves the balance further towards decode. The peak is heap in use by the
+ * decoder at any flush, on top of the two tile buffers.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/image_bench
+ *
+ * Usage:
+ *   image_bench [--ppm out.ppm] image.jpg|image.png ...
+ *   (--ppm saves the screen after the last image)
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "display/AXS15231B.h"
+#include "image/image.h"
+#include "hal_host.h"
+
+struct BenchState {
+    uint16_t *tiles[2];
+    uint8_t next;
+    uint32_t count;
+    double decodeUs;            // Since the last flush
+    double totalDecodeUs, totalBusUs, overlappedUs;
+    double lastBusUs;           // Push still "running" while the next tile decodes
+    double mark;
+    size_t heapBase, heapPeak;
+};
+
+static double cpu_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static size_t heap_in_use()
+{
+    return mallinfo2().uordblks;
+}
+
+static uint16_t *flush_tile(const ImageTile &tile, void *ctx)
+{
+    BenchState *s = (BenchState *)ctx;
+    double decode = cpu_us() - s->mark;
+    size_t heap = heap_in_use() - s->heapBase;
+    if (heap > s->heapPeak)
+        s->heapPeak = heap;
+
+    // The tile can't go out before the previous push ends, and its decode ran alongside that push
+    s->overlappedUs += decode > s->lastBusUs ? decode : s->lastBusUs;
+    uint64_t bus = hal_panel_stats().busUs;
+    lcd_push_async(LCD_HEIGHT - (tile.y + tile.h), tile.x, tile.h, tile.w, tile.pixels);
+    s->lastBusUs = (double)(hal_panel_stats().busUs - bus);
+
+    s->totalDecodeUs += decode;
+    s->totalBusUs += s->lastBusUs;
+    s->count++;
+    uint16_t *next = s->tiles[s->next];
+    s->next ^= 1;
+    s->mark = cpu_us();
+    return next;
+}
+
+int main(int argc, char **argv)
+{
+    const char *ppm = NULL;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--ppm") == 0) {
+        ppm = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: image_bench [--ppm out.ppm] image.jpg|image.png ...\n");
+        return 2;
+    }
+
+    axs15231_init();
+    lcd_setRotation(0);
+    static uint16_t tileA[IMAGE_TILE_PIXELS], tileB[IMAGE_TILE_PIXELS];
+    static const char *RESULTS[] = {"ok", "unsupported", "corrupt", "no memory"};
+
+    printf("%-28s %9s %6s %9s %9s %9s %9s %8s\n", "image", "size", "tiles", "decode us", "bus us",
+           "serial", "overlap", "peak");
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            fprintf(stderr, "%s: can't open\n", argv[i]);
+            failures++;
+            continue;
+        }
+        static ImageInput in;
+        image_input_file(&in, f);
+        uint16_t width = 0, height = 0;
+        image_size(&in, &width, &height);
+        rewind(f);
+        image_input_file(&in, f);
+
+        BenchState s;
+        memset(&s, 0, sizeof(s));
+        s.tiles[0] = tileB;
+        s.tiles[1] = tileA;
+        s.heapBase = heap_in_use();
+        uint16_t rows = height < LCD_HEIGHT ? height : LCD_HEIGHT;
+        ImageTarget target = {0, 0, LCD_WIDTH, (uint16_t)(rows & ~3), tileA, flush_tile, &s};
+        s.mark = cpu_us();
+        ImageResult result = image_decode(&in, target);
+        lcd_push_wait();
+        s.overlappedUs += s.lastBusUs;
+        fclose(f);
+
+        const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        char size[16];
+        snprintf(size, sizeof(size), "%ux%u", width, height);
+        if (result != IMAGE_OK) {
+            printf("%-28s %9s  %s\n", name, size, RESULTS[result]);
+            failures++;
+            continue;
+        }
+        printf("%-28s %9s %6u %9.0f %9.0f %9.0f %9.0f %7zuK\n", name, size, s.count, s.totalDecodeUs,
+               s.totalBusUs, s.totalDecodeUs + s.totalBusUs, s.overlappedUs, (s.heapPeak + 1023) / 1024);
+    }
+    if (ppm && !hal_panel_save_ppm(ppm)) {
+        fprintf(stderr, "%s: can't write\n", ppm);
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * list_bench - frame cost of the virtualised list (src/gfx/list_view.h) against its length, on the
+ * host panel model.
+ *
+ * The same scripted gestures (drags, flings both ways, a fling from the middle) are played on lists
+ * from two strips' worth of items to 100,000, at 60 frames a second of simulated time. Per frame it
+ * reports the time on the panel model's clock (hal_now_us: the modelled bus, not host time), the
+ * items the data source was asked to render and the bytes pushed; none of them should grow with
+ * the list. Every item the data source renders has to be on screen at the time, and at
+ * the end the panel has to show the list at its position with the rows outside the strip untouched.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/list_bench
+ *
+ * Usage:
+ *   list_bench [item width] [item height]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "config.h"
+#include "display/AXS15231B.h"
+#include "gfx/list_view.h"
+#include "hal_host.h"
+
+static const uint16_t STRIP_X       = LCD_WIDTH / 16;
+static const uint16_t STRIP_WIDTH   = LCD_WIDTH - 2 * STRIP_X;
+static const uint16_t MARKER        = 0x1234;
+static const uint16_t BACKGROUND    = 0x0861;
+static const uint32_t FRAME_MS      = 16;
+
+// Different for every item and every pixel of it, so a column out of place shows
+static uint16_t item_pixel(uint32_t index, uint16_t lx, uint16_t ly)
+{
+    uint32_t h = index * 2654435761u;
+    return (uint16_t)((h >> 16) ^ (lx * 31 + ly * 7) ^ (lx == 0 || ly == 0 ? 0xFFFF : 0));
+}
+
+struct Source {
+    ScrollRegion *region;
+    uint16_t itemW;
+    uint16_t rows;
+    uint32_t offscreen;         // Items asked for that weren't in view
+};
+
+static void render_item(uint32_t index, uint16_t *pixels, uint16_t w, uint16_t h, void *ctx)
+{
+    Source *src = (Source *)ctx;
+    int32_t x = (int32_t)(index / src->rows) * src->itemW;
+    if (x + src->itemW <= src->region->position || x >= src->region->position + src->region->width)
+        src->offscreen++;
+    for (uint16_t c = 0; c < w; c++) {
+        for (uint16_t i = 0; i < h; i++)
+            pixels[c * h + i] = item_pixel(index, c, (uint16_t)(h - 1 - i));
+    }
+}
+
+// What the panel shows against what it should: the list at position, the marker elsewhere
+static bool check(const ListView *lv, int32_t position)
+{
+    const uint16_t *fb = hal_panel_pixels();
+    for (uint16_t row = 0; row < HAL_PANEL_HEIGHT; row++) {
+        const uint16_t *shown = fb + hal_panel_shown_row(row) * HAL_PANEL_WIDTH;
+        int32_t cx = position + row - STRIP_X;
+        for (int i = 0; i < LCD_HEIGHT; i++) {
+            uint16_t want = MARKER;
+            if (row >= STRIP_X && row < STRIP_X + STRIP_WIDTH) {
+                int y = LCD_HEIGHT - 1 - i;
+                uint32_t index = (uint32_t)(cx / lv->itemW) * lv->rows + y / lv->itemH;
+                want = y / lv->itemH < lv->rows && index < lv->count
+                           ? item_pixel(index, (uint16_t)(cx % lv->itemW), (uint16_t)(y % lv->itemH))
+                           : BACKGROUND;
+            }
+            if (shown[i] != (uint16_t)(want >> 8 | want << 8))
+                return false;
+        }
+    }
+    return true;
+}
+
+struct Run {
+    ListView *lv;
+    ScrollRegion *region;
+    uint32_t ms;
+    std::vector<uint32_t> frameUs;
+};
+
+static void frame(Run &r)
+{
+    r.ms += FRAME_MS;
+    uint64_t start = hal_now_us();
+    list_view_frame(r.lv, r.region, r.ms);
+    r.frameUs.push_back((uint32_t)(hal_now_us() - start));
+}
+
+// A drag from x0 to x1 over ms, let go (flinging if it was quick), and frames until it stops. The
+// x's are for a 640 wide screen and scaled to this one.
+static void gesture(Run &r, int32_t x0, int32_t x1, uint32_t ms)
+{
+    x0 = x0 * LCD_WIDTH / 640;
+    x1 = x1 * LCD_WIDTH / 640;
+    uint32_t steps = ms / FRAME_MS;
+    for (uint32_t i = 0; i <= steps; i++) {
+        list_view_touch(r.lv, true, x0 + (x1 - x0) * (int32_t)i / (int32_t)steps, r.ms);
+        frame(r);
+    }
+    list_view_touch(r.lv, false, 0, r.ms);
+    for (int i = 0; i < 600 && list_view_moving(r.lv); i++)
+        frame(r);
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t itemW = (uint16_t)(argc > 1 ? atoi(argv[1]) : 200);
+    uint16_t itemH = (uint16_t)(argc > 2 ? atoi(argv[2]) : 30);
+    if (itemW == 0 || itemW > STRIP_WIDTH || itemH == 0 || itemH > LCD_HEIGHT) {
+        fprintf(stderr, "usage: list_bench [item width 1..%u] [item height 1..%u]\n", STRIP_WIDTH, LCD_HEIGHT);
+        return 2;
+    }
+
+    axs15231_init();
+    lcd_setRotation(0);
+    static uint16_t marker[SEND_BUF_SIZE];
+    for (size_t i = 0; i < SEND_BUF_SIZE; i++)
+        marker[i] = MARKER;
+    for (uint16_t row = 0; row < HAL_PANEL_HEIGHT; row += SEND_BUF_SIZE / LCD_HEIGHT)
+        lcd_PushColors(0, row, LCD_HEIGHT, SEND_BUF_SIZE / LCD_HEIGHT, marker);
+
+    uint16_t slots = list_view_cache_slots(STRIP_WIDTH, itemW, itemH, LCD_HEIGHT);
+    if (slots == 0) {
+        fprintf(stderr, "%u x %u items need more than %u cache slots\n", itemW, itemH, LIST_MAX_CACHE_SLOTS);
+        return 2;
+    }
+
+    // The shortest list is two strips' worth, so every list scrolls
+    uint32_t rows = LCD_HEIGHT / itemH;
+    std::vector<uint32_t> counts = {(STRIP_WIDTH / itemW + 1) * rows * 2};
+    for (uint32_t count = 100; count <= 100000; count *= 10) {
+        if (count > counts[0])
+            counts.push_back(count);
+    }
+
+    printf("%u x %u items, %u rows, %u cache slots, strip %u px, times in us of the panel model's clock\n", itemW,
+           itemH, rows, slots, STRIP_WIDTH);
+    printf("   items  frames   avg us   p99 us   max us   items/frame  cols/frame  KB/frame\n");
+    int failures = 0;
+    for (size_t n = 0; n < counts.size(); n++) {
+        ScrollRegion region;
+        ListView lv;
+        Source src = {&region, itemW, (uint16_t)rows, 0};
+        if (!list_view_create(&lv, counts[n], itemW, itemH, STRIP_WIDTH, LCD_HEIGHT, render_item, &src)) {
+            fprintf(stderr, "no memory\n");
+            return 1;
+        }
+        lv.background = BACKGROUND;
+        list_view_begin(&lv, &region, STRIP_X);
+
+        Run r = {&lv, &region, 0, {}};
+        uint64_t bytes = hal_panel_stats().pixelBytes;
+        ListViewStats before = lv.stats;
+
+        gesture(r, 500, 420, 300);                  // Slow drag, no fling
+        gesture(r, 500, 200, 120);                  // Flings on
+        gesture(r, 100, 500, 100);                  // And back
+        list_view_scroll_to(&lv, list_view_max_position(&lv) / 2);
+        frame(r);                                   // A jump redraws the strip
+        gesture(r, 500, 100, 80);                   // Fastest fling
+        gesture(r, 300, 320, 200);
+        gesture(r, 100, 540, 90);
+
+        bool ok = check(&lv, region.position) && region.position == (int32_t)(lv.position >> 8) && src.offscreen == 0;
+        failures += !ok;
+
+        std::vector<uint32_t> us = r.frameUs;
+        std::sort(us.begin(), us.end());
+        uint64_t sum = 0;
+        for (uint32_t u : us)
+            sum += u;
+        size_t frames = us.size();
+        printf("%8u  %6zu  %7.1f  %7u  %7u  %12.2f  %10.1f  %8.1f%s\n", counts[n], frames, (double)sum / frames,
+               us[frames * 99 / 100], us.back(), (double)(lv.stats.rendered - before.rendered) / frames,
+               (double)(lv.stats.columns - before.columns) / frames,
+               (hal_panel_stats().pixelBytes - bytes) / 1024.0 / frames, ok ? "" : "  MISMATCH");
+        if (src.offscreen)
+            printf("          %u items rendered off screen\n", src.offscreen);
+        scroll_region_end(&region);
+        list_view_free(&lv);
+    }
+    return failures ? 1 : 0;
+}
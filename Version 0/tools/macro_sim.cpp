@@ -0,0 +1,137 @@
+/*
+ * macro_sim - compiles a keyboard macro and runs it on the firmware's VM against a simulated clock.
+ *
+ * Prints the key timeline ("<time us> <key> down|up") and, given an expected timeline in the same
+ * format, checks every event against it. Wake-ups can be made late on purpose (--jitter) to check
+ * that lateness never adds up across the macro.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/input/macro.cpp tools/macro_sim.cpp -o macro_sim
+ *
+ * Usage:
+ *   macro_sim <macro.txt> [expected.txt] [--jitter <max us>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "input/macro.h"
+
+struct Event {
+    uint32_t timeUs;            // Scheduled time, what the timeline is checked against
+    uint32_t appliedUs;         // Simulated time the key actually changed
+    std::string key;
+    bool pressed;
+};
+
+static uint32_t simNow = 0;
+
+static void on_key(uint8_t key, bool pressed, uint32_t timeUs, void *ctx)
+{
+    ((std::vector<Event> *)ctx)->push_back({timeUs, simNow, macro_key_name(key), pressed});
+}
+
+static std::string read_file(const char *path)
+{
+    std::string text;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return text;
+    char buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        text.append(buf, n);
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    const char *macroPath = NULL;
+    const char *expectPath = NULL;
+    uint32_t jitter = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+            jitter = atoi(argv[++i]);
+        else if (macroPath == NULL)
+            macroPath = argv[i];
+        else
+            expectPath = argv[i];
+    }
+    if (macroPath == NULL) {
+        fprintf(stderr, "usage: %s <macro.txt> [expected.txt] [--jitter <max us>]\n", argv[0]);
+        return 2;
+    }
+
+    std::string source = read_file(macroPath);
+    uint8_t code[4096];
+    MacroError err;
+    size_t len = macro_compile(source.c_str(), code, sizeof(code), &err);
+    if (len == 0) {
+        fprintf(stderr, "%s:%u: %s\n", macroPath, err.line, err.message);
+        return 1;
+    }
+
+    // Simulated clock: the "timer" fires at the requested time plus a random delay
+    std::vector<Event> events;
+    MacroVM vm;
+    macro_vm_init(&vm, code, len, on_key, &events);
+    uint32_t next = 0, worstLate = 0;
+    srand(1);
+    while (macro_vm_step(&vm, &next))
+        simNow = next + (jitter ? rand() % (jitter + 1) : 0);
+
+    // Each event is at most one wake-up late: lateness must not build up along the macro
+    for (const Event &e : events) {
+        if (e.appliedUs - e.timeUs > worstLate)
+            worstLate = e.appliedUs - e.timeUs;
+    }
+
+    for (const Event &e : events)
+        printf("%u %s %s\n", e.timeUs, e.key.c_str(), e.pressed ? "down" : "up");
+    printf("# %zu bytes of bytecode, %zu events, %u us, worst event lateness %u us\n",
+           len, events.size(), events.empty() ? 0 : events.back().timeUs, worstLate);
+    if (worstLate > jitter) {
+        printf("FAIL: lateness accumulated beyond a single wake-up\n");
+        return 1;
+    }
+
+    if (expectPath == NULL)
+        return 0;
+
+    // Expected timeline: same format, '#' lines ignored
+    FILE *f = fopen(expectPath, "r");
+    if (f == NULL) {
+        fprintf(stderr, "can't read %s\n", expectPath);
+        return 1;
+    }
+    char line[128];
+    size_t index = 0;
+    int failures = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned t;
+        char key[16], dir[8];
+        if (line[0] == '#' || sscanf(line, "%u %15s %7s", &t, key, dir) != 3)
+            continue;
+        bool pressed = strcmp(dir, "down") == 0;
+        if (index >= events.size()) {
+            printf("MISSING: %u %s %s\n", t, key, dir);
+            failures++;
+        } else if (events[index].timeUs != t || events[index].key != key || events[index].pressed != pressed) {
+            const Event &e = events[index];
+            printf("MISMATCH #%zu: expected %u %s %s, got %u %s %s\n", index, t, key, dir,
+                   e.timeUs, e.key.c_str(), e.pressed ? "down" : "up");
+            failures++;
+        }
+        index++;
+    }
+    fclose(f);
+    if (index < events.size()) {
+        printf("EXTRA: %zu events after the expected timeline\n", events.size() - index);
+        failures++;
+    }
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
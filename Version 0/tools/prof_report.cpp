@@ -0,0 +1,263 @@
+/*
+ * prof_report - turns a dump of the firmware's sampling profiler into a flat profile and, with
+ * --folded, stacks for a flame graph.
+ *
+ * The dump holds addresses only: the interrupted PC of each sample and its caller's return
+ * address. They're looked up in the symbol table of the ELF file of the exact build that was
+ * profiled (.pio/build/<env>/firmware.elf). The dump can have other serial output around it, like
+ * the "prof:" lines; the tool looks for the header.
+ *
+ * Folded stacks are one line per core, caller and function with its sample count
+ * ("core1;hud_update;lcd_PushColors_rotated_90 212"), the input flamegraph.pl and speedscope take.
+ * Only one level of caller is known, so the graph is two frames deep under each core.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/prof_report.cpp -o prof_report
+ *
+ * Usage:
+ *   prof_report <firmware.elf> <dump.bin> [--top n] [--folded out.txt]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cxxabi.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "system/profiler.h"
+
+struct Symbol {
+    uint64_t addr;
+    uint64_t size;              // 0: runs to the next symbol
+    std::string name;
+};
+
+struct Function {
+    std::string name;
+    uint64_t samples;
+    uint64_t perCore[PROF_CORES];
+};
+
+static std::vector<uint8_t> elf;
+static std::vector<Symbol> symbols;
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+template <typename T> static T get(const uint8_t *p)
+{
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static std::string demangle(const char *name)
+{
+    int status = 0;
+    char *out = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if (status != 0 || out == NULL)
+        return name;
+    std::string s = out;
+    free(out);
+    return s;
+}
+
+// Functions from .symtab, plus absolute symbols: the ROM functions the linker scripts provide
+static bool load_elf(const char *path)
+{
+    if (!read_file(path, elf) || elf.size() < 64 || memcmp(elf.data(), "\x7f" "ELF", 4) != 0)
+        return false;
+
+    bool is64 = elf[4] == 2;
+    uint64_t shoff = is64 ? get<uint64_t>(&elf[0x28]) : get<uint32_t>(&elf[0x20]);
+    uint16_t shentsize = get<uint16_t>(&elf[is64 ? 0x3A : 0x2E]);
+    uint16_t shnum = get<uint16_t>(&elf[is64 ? 0x3C : 0x30]);
+    if (shoff + (uint64_t)shnum * shentsize > elf.size())
+        return false;
+
+    for (uint16_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = &elf[shoff + (uint64_t)i * shentsize];
+        if (get<uint32_t>(sh + 4) != 2)                     // SHT_SYMTAB
+            continue;
+        uint64_t offset = is64 ? get<uint64_t>(sh + 24) : get<uint32_t>(sh + 16);
+        uint64_t size = is64 ? get<uint64_t>(sh + 32) : get<uint32_t>(sh + 20);
+        uint32_t link = get<uint32_t>(sh + (is64 ? 40 : 24));
+        uint64_t entsize = is64 ? get<uint64_t>(sh + 56) : get<uint32_t>(sh + 36);
+        if (link >= shnum || entsize == 0 || offset + size > elf.size())
+            return false;
+        const uint8_t *strSh = &elf[shoff + (uint64_t)link * shentsize];
+        uint64_t strOffset = is64 ? get<uint64_t>(strSh + 24) : get<uint32_t>(strSh + 16);
+        uint64_t strSize = is64 ? get<uint64_t>(strSh + 32) : get<uint32_t>(strSh + 20);
+        if (strOffset + strSize > elf.size())
+            return false;
+
+        for (uint64_t at = offset; at + entsize <= offset + size; at += entsize) {
+            const uint8_t *st = &elf[at];
+            uint32_t name = get<uint32_t>(st);
+            uint8_t info = st[is64 ? 4 : 12];
+            uint16_t shndx = get<uint16_t>(st + (is64 ? 6 : 14));
+            Symbol s;
+            s.addr = is64 ? get<uint64_t>(st + 8) : get<uint32_t>(st + 4);
+            s.size = is64 ? get<uint64_t>(st + 16) : get<uint32_t>(st + 8);
+            uint8_t type = info & 0xf;
+            bool function = type == 2;                      // STT_FUNC
+            bool absolute = type == 0 && shndx == 0xfff1;   // STT_NOTYPE, SHN_ABS
+            if ((!function && !absolute) || s.addr == 0 || name >= strSize)
+                continue;
+            const char *p = (const char *)&elf[strOffset + name];
+            if (memchr(p, 0, strSize - name) == NULL || *p == 0)
+                continue;
+            s.name = demangle(p);
+            symbols.push_back(s);
+        }
+    }
+
+    // Sized symbols win over sizeless ones at the same address
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol &a, const Symbol &b) {
+        return a.addr != b.addr ? a.addr < b.addr : a.size > b.size;
+    });
+    return true;
+}
+
+static std::string symbolise(uint32_t addr)
+{
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), (uint64_t)addr,
+                               [](uint64_t a, const Symbol &s) { return a < s.addr; });
+    if (it != symbols.begin()) {
+        const Symbol &s = *(it - 1);
+        // Sizeless: the next symbol is the end, as long as it's not far (ROM entry points)
+        uint64_t end = s.size ? s.addr + s.size : it != symbols.end() ? it->addr : s.addr + 4096;
+        if (!s.size && end - s.addr > 4096)
+            end = s.addr + 4096;
+        if (addr < end)
+            return s.name;
+    }
+    char buf[16];
+    snprintf(buf, sizeof(buf), "[%08x]", addr);
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    const char *foldedPath = NULL;
+    size_t top = 40;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--folded") == 0 && i + 1 < argc)
+            foldedPath = argv[++i];
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            top = strtoul(argv[++i], NULL, 10);
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != 2) {
+        fprintf(stderr, "usage: prof_report <firmware.elf> <dump.bin> [--top n] [--folded out.txt]\n");
+        return 2;
+    }
+    if (!load_elf(files[0])) {
+        fprintf(stderr, "can't read ELF file %s\n", files[0]);
+        return 1;
+    }
+    if (symbols.empty())
+        fprintf(stderr, "warning: %s has no symbol table, addresses stay as they are\n", files[0]);
+    std::vector<uint8_t> dump;
+    if (!read_file(files[1], dump)) {
+        fprintf(stderr, "can't read %s\n", files[1]);
+        return 1;
+    }
+
+    const uint32_t header[5] = {PROF_MAGIC, PROF_VERSION, PROF_CORES, PROF_SLOTS};
+    const size_t headerSize = sizeof(header);
+    const size_t coreSize = 3 * sizeof(uint32_t) + PROF_SLOTS * sizeof(ProfSlot);
+    size_t at = 0;
+    for (; at + headerSize + PROF_CORES * coreSize <= dump.size(); at++) {
+        if (memcmp(&dump[at], header, 4 * sizeof(uint32_t)) == 0)
+            break;
+    }
+    if (at + headerSize + PROF_CORES * coreSize > dump.size()) {
+        fprintf(stderr, "no complete profiler dump (version %u, %u cores, %u slots) in %s\n",
+                PROF_VERSION, PROF_CORES, PROF_SLOTS, files[1]);
+        return 1;
+    }
+    uint32_t rateHz = get<uint32_t>(&dump[at + 16]);
+    at += headerSize;
+
+    std::map<std::string, Function> functions;
+    std::map<std::string, uint64_t> folded;
+    uint64_t samples = 0, inInterrupt = 0, dropped = 0;
+    for (uint8_t c = 0; c < PROF_CORES; c++, at += coreSize) {
+        const uint8_t *h = &dump[at];
+        samples += get<uint32_t>(h);
+        inInterrupt += get<uint32_t>(h + 4);
+        dropped += get<uint32_t>(h + 8);
+        std::string core = "core" + std::to_string(c);
+        if (get<uint32_t>(h + 4))
+            folded[core + ";[interrupt]"] += get<uint32_t>(h + 4);
+
+        for (uint16_t i = 0; i < PROF_SLOTS; i++) {
+            ProfSlot s;
+            memcpy(&s, h + 12 + i * sizeof(ProfSlot), sizeof(s));
+            if (s.pc == 0 || s.count == 0)
+                continue;
+            std::string name = symbolise(s.pc);
+            Function &f = functions[name];
+            f.name = name;
+            f.samples += s.count;
+            f.perCore[c] += s.count;
+            // The return address is just past the call, which may be the caller's last instruction
+            folded[core + ";" + symbolise(s.caller - 1) + ";" + name] += s.count;
+        }
+    }
+
+    printf("%u cores at %u Hz: %llu samples, %llu in interrupts, %llu dropped (histogram full)\n",
+           PROF_CORES, rateHz, (unsigned long long)samples, (unsigned long long)inInterrupt,
+           (unsigned long long)dropped);
+    if (samples == 0)
+        return 0;
+
+    std::vector<Function> flat;
+    for (auto &f : functions)
+        flat.push_back(f.second);
+    std::sort(flat.begin(), flat.end(), [](const Function &a, const Function &b) {
+        return a.samples != b.samples ? a.samples > b.samples : a.name < b.name;
+    });
+
+    printf("\n  self%%   samples");
+    for (uint8_t c = 0; c < PROF_CORES; c++)
+        printf("    core%u", c);
+    printf("  function\n");
+    for (size_t i = 0; i < flat.size() && i < top; i++) {
+        printf("%6.1f%% %9llu", 100.0 * flat[i].samples / samples, (unsigned long long)flat[i].samples);
+        for (uint8_t c = 0; c < PROF_CORES; c++)
+            printf(" %8llu", (unsigned long long)flat[i].perCore[c]);
+        printf("  %s\n", flat[i].name.c_str());
+    }
+    if (flat.size() > top)
+        printf("  (%zu more functions)\n", flat.size() - top);
+    printf("%6.1f%% %9llu  in other interrupt handlers\n", 100.0 * inInterrupt / samples,
+           (unsigned long long)inInterrupt);
+
+    if (foldedPath) {
+        FILE *f = fopen(foldedPath, "w");
+        if (f == NULL) {
+            fprintf(stderr, "can't write %s\n", foldedPath);
+            return 1;
+        }
+        for (auto &line : folded)
+            fprintf(f, "%s %llu\n", line.first.c_str(), (unsigned long long)line.second);
+        fclose(f);
+    }
+    return 0;
+}
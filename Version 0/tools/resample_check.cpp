@@ -0,0 +1,108 @@
+/*
+ * resample_check - runs a WAV through the firmware's ingestion stage and compares the result
+ * with a double precision reference resampler.
+ *
+ * The reference evaluates the same windowed-sinc filter at the exact fractional position of every
+ * output sample (no phase table, no Q15 rounding), so the difference is purely the cost of the
+ * fixed-point implementation. The firmware's output can also be written to a WAV to diff against
+ * other tools (e.g. sox).
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/audio/wav_reader.cpp src/audio/resampler.cpp src/audio/audio_ingest.cpp \
+ *       tools/resample_check.cpp -o resample_check
+ *
+ * Usage:
+ *   resample_check <input.wav> [output rate, default 44100] [output.wav]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "audio/audio_ingest.h"
+
+static const double MIN_SNR_DB = 70.0;     // Below this the fixed-point path is considered broken
+
+static void write_wav(const char *path, const std::vector<int16_t> &samples, uint32_t rate)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return;
+    uint32_t bytes = samples.size() * 2;
+    uint32_t header[] = {0x46464952, 36 + bytes, 0x45564157, 0x20746D66, 16, 0x00010001, rate, rate * 2, 0x00100002,
+                         0x61746164, bytes};       // Little-endian host assumed
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(samples.data(), 2, samples.size(), f);
+    fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <input.wav> [output rate] [output.wav]\n", argv[0]);
+        return 2;
+    }
+    uint32_t outRate = argc > 2 ? (uint32_t)atoi(argv[2]) : 44100;
+
+    // Firmware path, in the same block sizes the audio output uses
+    FILE *f = fopen(argv[1], "rb");
+    static AudioIngest ing;
+    if (f == NULL || !audio_ingest_open(&ing, f, outRate)) {
+        fprintf(stderr, "can't read %s (PCM 8/16-bit WAV expected)\n", argv[1]);
+        return 1;
+    }
+    std::vector<int16_t> fixed;
+    int16_t block[512];
+    size_t n;
+    while ((n = audio_ingest_fill(&ing, block, 512)) > 0)
+        fixed.insert(fixed.end(), block, block + n);
+    fclose(f);
+
+    // Same mono input for the reference
+    f = fopen(argv[1], "rb");
+    static WavReader wav;
+    wav_open(&wav, f);
+    std::vector<int16_t> input;
+    while ((n = wav_read_mono(&wav, block, 512)) > 0)
+        input.insert(input.end(), block, block + n);
+    fclose(f);
+
+    uint32_t inRate = wav.info.sampleRate;
+    double signal = 0, noise = 0;
+    int maxDiff = 0;
+
+    for (size_t o = 0; o < fixed.size(); o++) {
+        double ref;
+        if (inRate == outRate) {
+            ref = input[o];
+        } else {
+            double t = (double)o * inRate / outRate;
+            long i0 = (long)floor(t);
+            double frac = t - i0;
+            double acc = 0, sum = 0;
+            for (int k = 0; k < RESAMPLER_TAPS; k++) {
+                double h = resampler_reference_tap(inRate, outRate, k, frac);
+                long idx = i0 + k - (RESAMPLER_TAPS / 2 - 1);
+                acc += h * ((idx >= 0 && idx < (long)input.size()) ? input[idx] : 0);
+                sum += h;
+            }
+            ref = acc / sum;
+        }
+        double diff = fixed[o] - ref;
+        signal += ref * ref;
+        noise += diff * diff;
+        if (fabs(diff) > maxDiff)
+            maxDiff = (int)ceil(fabs(diff));
+    }
+
+    double snr = noise > 0 ? 10 * log10(signal / noise) : INFINITY;
+    printf("%u Hz -> %u Hz, %zu -> %zu samples\n", inRate, outRate, input.size(), fixed.size());
+    printf("vs reference: max diff %d LSB, SNR %.1f dB\n", maxDiff, snr);
+    printf("cpu: %u us per second of audio (%.3f%% of a core)\n", audio_ingest_cpu_us_per_second(&ing),
+           audio_ingest_cpu_us_per_second(&ing) / 10000.0);
+
+    if (argc > 3)
+        write_wav(argv[3], fixed, outRate);
+    return snr >= MIN_SNR_DB || signal == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/*
+ * sched_sim - runs the firmware's cooperative scheduler against a simulated clock.
+ *
+ * A made-up but representative load: a tape-rate job, macro key events woken from a fake
+ * interrupt, touch polling, the splash frame push, SD transfers in slices and the settings flush.
+ * Each task "costs" simulated time instead of doing work, so a run is exact and repeatable.
+ *
+ * Prints per-task runs, CPU share, worst run time, latency, jitter, missed deadlines and dropped
+ * releases, then checks what a non-preemptive scheduler can promise: the most urgent tasks are
+ * never held up by more than the longest single run of another task, no task finishes past its
+ * deadline, and nothing is dropped while the load is below 100%. Exits non-zero if that doesn't
+ * hold. That needs every run to be short next to the tightest deadline, so the long jobs are
+ * sliced the way the firmware slices them: the splash renders a frame and leaves the push to DMA,
+ * SD transfers go 1 KB at a time.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/system/scheduler.cpp src/system/dlog.cpp src/system/metrics.cpp tools/sched_sim.cpp -o sched_sim
+ *
+ * Usage:
+ *   sched_sim [--seconds <n>] [--seed <n>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system/scheduler.h"
+
+static uint64_t simNow = 0;
+static uint32_t rng = 1;
+
+static uint64_t sim_clock()
+{
+    return simNow;
+}
+
+static uint32_t random_below(uint32_t n)
+{
+    rng = rng * 1664525 + 1013904223;
+    return (rng >> 8) % n;
+}
+
+struct SimCost {
+    uint32_t minUs;
+    uint32_t maxUs;
+};
+
+static void sim_task(void *ctx)
+{
+    const SimCost *c = (const SimCost *)ctx;
+    simNow += c->minUs + (c->maxUs > c->minUs ? random_below(c->maxUs - c->minUs + 1) : 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = 10;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--seconds") == 0)
+            seconds = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            rng = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "usage: sched_sim [--seconds <n>] [--seed <n>]\n");
+            return 2;
+        }
+    }
+
+    static const SimCost tape = {30, 60};
+    static const SimCost macro = {5, 15};
+    static const SimCost touch = {60, 120};
+    static const SimCost splash = {600, 1200};      // Render a frame; the push goes out by DMA
+    static const SimCost sd = {400, 800};           // One 1 KB slice
+    static const SimCost settings = {10, 20};
+
+    static Scheduler s;
+    sched_init(&s, sim_clock);
+    int urgent[2];
+    urgent[0] = sched_add(&s, "tape", sim_task, (void *)&tape, 5, 10000, 2000);
+    urgent[1] = sched_add(&s, "macro", sim_task, (void *)&macro, 4, 0, 2000);
+    sched_add(&s, "touch", sim_task, (void *)&touch, 3, 10000);
+    sched_add(&s, "splash", sim_task, (void *)&splash, 2, 16000);
+    sched_add(&s, "sd", sim_task, (void *)&sd, 1, 8000);
+    sched_add(&s, "settings", sim_task, (void *)&settings, 0, 100000);
+
+    // Fake interrupt: macro key events at random intervals
+    uint64_t nextWake = 1000 + random_below(20000);
+    uint64_t endUs = (uint64_t)seconds * 1000000;
+
+    while (simNow < endUs) {
+        if (simNow >= nextWake) {
+            uint64_t now = simNow;
+            simNow = nextWake;                      // Stamped when it fired, possibly mid-task
+            sched_wake(&s, urgent[1]);
+            simNow = now;
+            nextWake += 1000 + random_below(20000);
+        }
+        uint32_t wait = sched_run_once(&s);
+        if (wait) {
+            uint64_t until = simNow + wait;
+            simNow = until < nextWake ? until : nextWake;   // The interrupt ends the sleep early
+        }
+    }
+
+    uint32_t longestRun = 0;
+    for (int i = 0; i < s.count; i++) {
+        if (s.tasks[i].stats.worstRunUs > longestRun)
+            longestRun = s.tasks[i].stats.worstRunUs;
+    }
+
+    printf("%-10s %4s %8s %6s %9s %9s %9s %6s %7s\n", "task", "prio", "runs", "cpu%", "worst us",
+           "lat us", "jitter", "missed", "dropped");
+    for (int i = 0; i < s.count; i++) {
+        const SchedTask *t = sched_task(&s, i);
+        printf("%-10s %4u %8u %6.2f %9u %9u %9u %6u %7u\n", t->name, t->priority, t->stats.runs,
+               100.0 * t->stats.cpuUs / endUs, t->stats.worstRunUs, t->stats.worstLatencyUs,
+               sched_jitter_us(t), t->stats.deadlineMisses, t->stats.skipped);
+    }
+    printf("load %u%%\n", sched_load_percent(&s));
+
+    bool ok = true;
+    for (int id : urgent) {
+        const SchedTask *t = sched_task(&s, id);
+        if (t->stats.worstLatencyUs > longestRun + t->stats.worstRunUs) {
+            printf("FAIL: %s waited %u us, longer than one run of anything else\n", t->name, t->stats.worstLatencyUs);
+            ok = false;
+        }
+    }
+    for (int i = 0; i < s.count; i++) {
+        const SchedTask *t = sched_task(&s, i);
+        if (t->stats.deadlineMisses) {
+            printf("FAIL: %s missed its deadline %u times\n", t->name, t->stats.deadlineMisses);
+            ok = false;
+        }
+        if (t->stats.skipped) {
+            printf("FAIL: %s dropped %u releases\n", t->name, t->stats.skipped);
+            ok = false;
+        }
+    }
+    printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
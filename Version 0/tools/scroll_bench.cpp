@@ -0,0 +1,124 @@
+/*
+ * scroll_bench - bytes sent per scrolled pixel with hardware scrolling against a full redraw of
+ * the strip, on the host panel model.
+ *
+ * A strip of the screen scrolls through wide generated content in steps of various sizes, forwards
+ * and back, through the scroll region (only exposed columns pushed, VSCSAD moves the rest) and by
+ * redrawing all of it every step. The panel model applies the scroll when it shows the picture,
+ * and what it shows has to match the content at the final position, with the rows outside the
+ * strip untouched.
+ *
+ * Build: part of the host build (see "Host build" in readme.md), as build/scroll_bench
+ *
+ * Usage:
+ *   scroll_bench [steps per size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "display/AXS15231B.h"
+#include "gfx/scroll_region.h"
+#include "hal_host.h"
+
+static const uint16_t STRIP_X       = 32;
+static const uint16_t STRIP_WIDTH   = 448;
+static const uint16_t MARKER        = 0x1234;
+
+// Stripes and a gradient, different enough everywhere to catch a column in the wrong place
+static uint16_t content_pixel(int32_t cx, int y)
+{
+    return (uint16_t)((cx * 7 + y * 3) ^ (cx >> 3) * 0x0841 ^ ((cx & 15) == 0 ? 0xFFFF : 0));
+}
+
+static void render(int32_t contentX, uint16_t cols, uint16_t *dst, void *ctx)
+{
+    for (uint16_t c = 0; c < cols; c++) {
+        for (int i = 0; i < LCD_HEIGHT; i++)
+            dst[c * LCD_HEIGHT + i] = content_pixel(contentX + c, LCD_HEIGHT - 1 - i);
+    }
+}
+
+// What the panel shows against what it should: the strip at position, the marker elsewhere
+static bool check(int32_t position)
+{
+    const uint16_t *fb = hal_panel_pixels();
+    for (uint16_t row = 0; row < HAL_PANEL_HEIGHT; row++) {
+        const uint16_t *shown = fb + hal_panel_shown_row(row) * HAL_PANEL_WIDTH;
+        for (int i = 0; i < LCD_HEIGHT; i++) {
+            uint16_t want = MARKER;
+            if (row >= STRIP_X && row < STRIP_X + STRIP_WIDTH)
+                want = content_pixel(position + row - STRIP_X, LCD_HEIGHT - 1 - i);
+            if (shown[i] != (uint16_t)(want >> 8 | want << 8))
+                return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int steps = argc > 1 ? atoi(argv[1]) : 200;
+    if (steps <= 0) {
+        fprintf(stderr, "usage: scroll_bench [steps per size]\n");
+        return 2;
+    }
+
+    axs15231_init();
+    lcd_setRotation(0);
+    static uint16_t marker[SEND_BUF_SIZE];
+    for (size_t i = 0; i < SEND_BUF_SIZE; i++)
+        marker[i] = MARKER;
+    for (uint16_t row = 0; row < HAL_PANEL_HEIGHT; row += SEND_BUF_SIZE / LCD_HEIGHT)
+        lcd_PushColors(0, row, LCD_HEIGHT, SEND_BUF_SIZE / LCD_HEIGHT, marker);
+
+    static const int32_t STEPS[] = {1, 2, 4, 8, 16, 32, 64, 128};
+    printf("step   scroll B/px  redraw B/px   scroll us/step  redraw us/step   saving\n");
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(STEPS) / sizeof(STEPS[0]); s++) {
+        int32_t step = STEPS[s];
+
+        ScrollRegion region;
+        scroll_region_init(&region, STRIP_X, STRIP_WIDTH, 1000);
+        scroll_region_begin(&region, render, NULL);
+
+        // Forwards for three quarters of the steps, then back, so both directions and wraps are hit
+        uint64_t bytes = hal_panel_stats().pixelBytes, start = hal_now_us(), moved = 0;
+        for (int i = 0; i < steps; i++) {
+            int32_t dx = i < steps * 3 / 4 ? step : -step;
+            scroll_region_move(&region, dx, render, NULL);
+            moved += step;
+        }
+        double scrollBytes = (double)(hal_panel_stats().pixelBytes - bytes) / moved;
+        double scrollUs = (double)(hal_now_us() - start) / steps;
+        bool ok = check(region.position);
+        scroll_region_end(&region);
+
+        // The same moves as full redraws of the strip
+        scroll_region_init(&region, STRIP_X, STRIP_WIDTH, 1000);
+        bytes = hal_panel_stats().pixelBytes;
+        start = hal_now_us();
+        for (int i = 0; i < steps; i++) {
+            region.position += i < steps * 3 / 4 ? step : -step;
+            ScrollSpan spans[2];
+            int count = scroll_region_redraw(&region, spans);
+            static uint16_t chunk[SEND_BUF_SIZE];
+            const uint16_t colsPerChunk = SEND_BUF_SIZE / LCD_HEIGHT;
+            for (int k = 0; k < count; k++) {
+                for (uint16_t col = 0; col < spans[k].cols; col += colsPerChunk) {
+                    uint16_t cols = spans[k].cols - col < colsPerChunk ? spans[k].cols - col : colsPerChunk;
+                    render(spans[k].contentX + col, cols, chunk, NULL);
+                    lcd_PushColors(0, STRIP_X + spans[k].memoryRow + col, LCD_HEIGHT, cols, chunk);
+                }
+            }
+        }
+        double redrawBytes = (double)(hal_panel_stats().pixelBytes - bytes) / moved;
+        double redrawUs = (double)(hal_now_us() - start) / steps;
+        ok = ok && check(region.position);
+        failures += !ok;
+
+        printf("%4d   %11.0f  %11.0f   %14.0f  %14.0f   %5.1fx%s\n", step, scrollBytes, redrawBytes,
+               scrollUs, redrawUs, redrawBytes / scrollBytes, ok ? "" : "  MISMATCH");
+    }
+    return failures ? 1 : 0;
+}
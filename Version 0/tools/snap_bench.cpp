@@ -0,0 +1,508 @@
+/*
+ * snap_bench - checks the snapshot reader (src/snapshot/snapshot.h) against a straightforward
+ * byte-at-a-time reference and measures its decompression throughput over a corpus of .Z80 and
+ * .SNA files.
+ *
+ * Each file is read whole into RAM banks, and just its screen (what a preview takes), from memory
+ * and from the file; the RAM has to match the reference and the screens the RAM. Throughput is
+ * memory image bytes out per second.
+ *
+ * --make writes a corpus of synthetic snapshots (.Z80 v1 packed and raw, v2 48K, v3 128K and +3
+ * with a raw page, .SNA 48K and 128K) of screen-like, code-like and empty memory with ED bytes
+ * placed to catch the corner cases of the compression, and checks each reads back as written.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc tools/snap_bench.cpp src/snapshot/snapshot.cpp src/image/image.cpp \
+ *       src/image/inflate.cpp src/image/png_decoder.cpp src/image/jpeg_decoder.cpp -o snap_bench
+ *
+ * Usage:
+ *   snap_bench <file | dir> ... [--reps n]
+ *   snap_bench --make <dir> [count]
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "snapshot/snapshot.h"
+#include "gfx/zx_screen.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool read_file(const char *path, Bytes &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static double now_s()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The reference: every byte through one loop, nothing skipped
+
+static bool ref_unpack(const Bytes &f, size_t &at, size_t end, uint8_t *dst, size_t len)
+{
+    size_t out = 0;
+    while (out < len) {
+        if (at >= end)
+            return false;
+        if (f[at] == 0xED && at + 1 < end && f[at + 1] == 0xED) {
+            if (at + 3 >= end || out + f[at + 2] > len)
+                return false;
+            for (int i = 0; i < f[at + 2]; i++)
+                dst[out++] = f[at + 3];
+            at += 4;
+        } else {
+            dst[out++] = f[at++];
+        }
+    }
+    return true;
+}
+
+static bool reference(const Bytes &f, const SnapshotInfo &info, uint8_t *ram)
+{
+    static const uint8_t ORDER_48K[3] = {5, 2, 0};
+    size_t at = info.dataOffset;
+    if (info.format == SNAP_SNA) {
+        for (int i = 0; i < 3; i++) {
+            uint8_t bank = i < 2 ? ORDER_48K[i] : (info.machine == SNAP_128K ? info.port7ffd & 7 : 0);
+            memcpy(ram + bank * SNAP_BANK_SIZE, &f[at], SNAP_BANK_SIZE);
+            at += SNAP_BANK_SIZE;
+        }
+        if (info.machine == SNAP_128K) {
+            at += 4;
+            for (int bank = 0; bank < 8; bank++) {
+                if (bank != 2 && bank != 5 && bank != (info.port7ffd & 7)) {
+                    memcpy(ram + bank * SNAP_BANK_SIZE, &f[at], SNAP_BANK_SIZE);
+                    at += SNAP_BANK_SIZE;
+                }
+            }
+        }
+        return true;
+    }
+    if (info.version == 1) {
+        uint8_t mem[3 * SNAP_BANK_SIZE];
+        if (info.compressed) {
+            if (!ref_unpack(f, at, f.size(), mem, sizeof(mem)))
+                return false;
+        } else {
+            memcpy(mem, &f[at], sizeof(mem));
+        }
+        for (int i = 0; i < 3; i++)
+            memcpy(ram + ORDER_48K[i] * SNAP_BANK_SIZE, mem + i * SNAP_BANK_SIZE, SNAP_BANK_SIZE);
+        return true;
+    }
+    while (at + 3 <= f.size()) {
+        uint16_t length = (uint16_t)(f[at] | f[at + 1] << 8);
+        uint8_t page = f[at + 2];
+        at += 3;
+        int bank = -1;
+        if (info.machine >= SNAP_128K)
+            bank = page >= 3 && page <= 10 ? page - 3 : -1;
+        else
+            bank = page == 8 ? 5 : page == 4 ? 2 : page == 5 ? 0 : -1;
+        size_t stored = length == 0xFFFF ? SNAP_BANK_SIZE : length;
+        if (bank >= 0) {
+            size_t p = at;
+            if (length == 0xFFFF)
+                memcpy(ram + bank * SNAP_BANK_SIZE, &f[at], SNAP_BANK_SIZE);
+            else if (!ref_unpack(f, p, at + stored, ram + bank * SNAP_BANK_SIZE, SNAP_BANK_SIZE))
+                return false;
+        }
+        at += stored;
+    }
+    return true;
+}
+
+// Synthetic snapshots
+
+static uint32_t rng = 1;
+
+static uint32_t next_random()
+{
+    rng = rng * 1664525 + 1013904223;
+    return rng >> 8;
+}
+
+// Empty stretches, fills, code-like noise and text, with ED bytes alone, in pairs and in runs
+static void make_bank(uint8_t *bank, bool screen)
+{
+    uint32_t at = 0;
+    while (at < SNAP_BANK_SIZE) {
+        uint32_t n = 1 + next_random() % 600;
+        if (n > SNAP_BANK_SIZE - at)
+            n = SNAP_BANK_SIZE - at;
+        switch (next_random() % (screen ? 4 : 6)) {
+        case 0: memset(bank + at, 0, n); break;
+        case 1: memset(bank + at, (uint8_t)next_random(), n); break;
+        case 2:
+            for (uint32_t i = 0; i < n; i++)
+                bank[at + i] = (uint8_t)(i & 1 ? 0xAA : 0x55);
+            break;
+        case 3:
+            for (uint32_t i = 0; i < n; i++)
+                bank[at + i] = (uint8_t)(0x38 | (next_random() % 8));   // Attributes, mostly runs
+            break;
+        case 4:
+            for (uint32_t i = 0; i < n; i++)
+                bank[at + i] = (uint8_t)next_random();
+            break;
+        default:
+            for (uint32_t i = 0; i < n; i++)
+                bank[at + i] = (uint8_t)(' ' + next_random() % 64);
+            break;
+        }
+        at += n;
+    }
+    static const uint8_t TRICKY[][6] = {
+        {0xED, 0x00, 0x00, 0x00, 0x00, 0x00}, {0xED, 0xED, 0x00, 0x11, 0x22, 0x33},
+        {0xED, 0xED, 0xED, 0xED, 0xED, 0xED}, {0x00, 0xED, 0xED, 0x00, 0x01, 0x02},
+    };
+    for (int i = 0; i < 8; i++)
+        memcpy(bank + next_random() % (SNAP_BANK_SIZE - 6), TRICKY[next_random() % 4], 6);
+}
+
+// As emulators write it: runs of 5 or more, or of 2 or more EDs; the byte after a lone ED is
+// never the start of a run
+static void z80_pack(const uint8_t *src, size_t len, Bytes &out)
+{
+    size_t i = 0;
+    while (i < len) {
+        uint8_t b = src[i];
+        size_t run = 1;
+        while (i + run < len && src[i + run] == b && run < 255)
+            run++;
+        if (run >= 5 || (b == 0xED && run >= 2)) {
+            const uint8_t token[4] = {0xED, 0xED, (uint8_t)run, b};
+            out.insert(out.end(), token, token + 4);
+            i += run;
+        } else {
+            out.push_back(b);
+            i++;
+            if (b == 0xED && i < len)
+                out.push_back(src[i++]);
+        }
+    }
+}
+
+static void append(Bytes &out, const uint8_t *data, size_t len)
+{
+    size_t at = out.size();
+    out.resize(at + len);
+    memcpy(&out[at], data, len);
+}
+
+static void put16(Bytes &out, uint16_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+static const uint16_t MAKE_PC = 0x8123, MAKE_SP = 0xFF00;
+
+static Bytes z80_header(uint8_t version, bool packed)
+{
+    Bytes h(30);
+    h[0] = 0x12;                                    // A
+    h[1] = 0x34;                                    // F
+    h[6] = version == 1 ? (uint8_t)MAKE_PC : 0;
+    h[7] = version == 1 ? (uint8_t)(MAKE_PC >> 8) : 0;
+    h[8] = (uint8_t)MAKE_SP;
+    h[9] = (uint8_t)(MAKE_SP >> 8);
+    h[12] = (uint8_t)(2 << 1 | (packed ? 0x20 : 0));   // Border red
+    h[29] = 1;                                      // IM 1
+    return h;
+}
+
+static void write_file(const std::string &path, const Bytes &data)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f == NULL || fwrite(data.data(), 1, data.size(), f) != data.size() || fclose(f) != 0) {
+        fprintf(stderr, "can't write %s\n", path.c_str());
+        exit(1);
+    }
+}
+
+static Bytes make_z80_v1(const uint8_t *ram, bool packed)
+{
+    Bytes f = z80_header(1, packed);
+    uint8_t mem[3 * SNAP_BANK_SIZE];
+    memcpy(mem, ram + 5 * SNAP_BANK_SIZE, SNAP_BANK_SIZE);
+    memcpy(mem + SNAP_BANK_SIZE, ram + 2 * SNAP_BANK_SIZE, SNAP_BANK_SIZE);
+    memcpy(mem + 2 * SNAP_BANK_SIZE, ram, SNAP_BANK_SIZE);
+    if (packed) {
+        z80_pack(mem, sizeof(mem), f);
+        const uint8_t end[4] = {0x00, 0xED, 0xED, 0x00};
+        f.insert(f.end(), end, end + 4);
+    } else {
+        append(f, mem, sizeof(mem));
+    }
+    return f;
+}
+
+static Bytes make_z80_paged(const uint8_t *ram, uint8_t version, SnapshotMachine machine, uint8_t rawPage)
+{
+    Bytes f = z80_header(version, true);
+    uint16_t extra = version == 2 ? 23 : 55;
+    Bytes x(extra);
+    x[0] = (uint8_t)MAKE_PC;
+    x[1] = (uint8_t)(MAKE_PC >> 8);
+    x[2] = machine == SNAP_48K ? 0 : machine == SNAP_128K ? (version == 2 ? 3 : 4) : 7;
+    x[3] = machine == SNAP_48K ? 0 : 0x1B;          // 0x7FFD: bank 3, shadow screen, ROM 1
+    x[5] = 0x04;                                    // AY in use
+    if (extra == 55)
+        x[54] = 0x04;
+    put16(f, extra);
+    f.insert(f.end(), x.begin(), x.end());
+
+    static const uint8_t PAGES_48K[3][2] = {{8, 5}, {4, 2}, {5, 0}};
+    for (int i = 0; i < (machine == SNAP_48K ? 3 : 8); i++) {
+        uint8_t page = machine == SNAP_48K ? PAGES_48K[i][0] : (uint8_t)(i + 3);
+        uint8_t bank = machine == SNAP_48K ? PAGES_48K[i][1] : (uint8_t)i;
+        const uint8_t *src = ram + bank * SNAP_BANK_SIZE;
+        Bytes packed;
+        z80_pack(src, SNAP_BANK_SIZE, packed);
+        if (page == rawPage || packed.size() >= SNAP_BANK_SIZE) {
+            put16(f, 0xFFFF);
+            f.push_back(page);
+            append(f, src, SNAP_BANK_SIZE);
+        } else {
+            put16(f, (uint16_t)packed.size());
+            f.push_back(page);
+            f.insert(f.end(), packed.begin(), packed.end());
+        }
+    }
+    return f;
+}
+
+static Bytes make_sna(const uint8_t *ram, bool is128, uint8_t paged)
+{
+    Bytes f(27);
+    f[21] = 0x34;                                   // F
+    f[22] = 0x12;                                   // A
+    f[25] = 1;
+    f[26] = 2;
+    uint16_t sp = is128 ? MAKE_SP : (uint16_t)(MAKE_SP - 2);
+    f[23] = (uint8_t)sp;
+    f[24] = (uint8_t)(sp >> 8);
+    uint8_t first[3] = {5, 2, (uint8_t)(is128 ? paged : 0)};
+    for (int i = 0; i < 3; i++)
+        append(f, ram + first[i] * SNAP_BANK_SIZE, SNAP_BANK_SIZE);
+    if (!is128) {
+        // PC pushed onto the stack, as a 48K .SNA keeps it
+        f[27 + sp - 0x4000] = (uint8_t)MAKE_PC;
+        f[27 + sp - 0x4000 + 1] = (uint8_t)(MAKE_PC >> 8);
+        return f;
+    }
+    put16(f, MAKE_PC);
+    f.push_back(paged);
+    f.push_back(0);
+    for (int bank = 0; bank < 8; bank++) {
+        if (bank != 2 && bank != 5 && bank != paged)
+            append(f, ram + bank * SNAP_BANK_SIZE, SNAP_BANK_SIZE);
+    }
+    return f;
+}
+
+static bool read_memory(const Bytes &f, SnapshotFormat format, SnapshotInfo &info, uint8_t *ram,
+                        uint8_t banks, uint16_t from, uint32_t to)
+{
+    ImageInput in;
+    image_input_memory(&in, f.data(), f.size());
+    if (snapshot_open(&in, format, (uint32_t)f.size(), &info) != SNAP_OK)
+        return false;
+    SnapshotTarget target = {ram, NULL, NULL, banks, from, to};
+    return snapshot_read(&in, info, target) == SNAP_OK;
+}
+
+static int make_corpus(const char *dir, int count)
+{
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "can't make %s\n", dir);
+        return 1;
+    }
+    int failures = 0;
+    static uint8_t ram[SNAP_BANKS * SNAP_BANK_SIZE], back[SNAP_BANKS * SNAP_BANK_SIZE];
+    for (int n = 0; n < count; n++) {
+        for (int bank = 0; bank < SNAP_BANKS; bank++)
+            make_bank(ram + bank * SNAP_BANK_SIZE, bank == 5 || bank == 7);
+        // The 48K .SNA's stack holds the PC; keep the generated bytes there out of the way
+        struct Made {
+            const char *name;
+            Bytes data;
+            uint8_t banks;
+        } made[] = {
+            {"v1", make_z80_v1(ram, true), 0x25},
+            {"v1raw", make_z80_v1(ram, false), 0x25},
+            {"v2", make_z80_paged(ram, 2, SNAP_48K, 0), 0x25},
+            {"v3_128", make_z80_paged(ram, 3, SNAP_128K, 0), 0xFF},
+            {"v3_p3", make_z80_paged(ram, 3, SNAP_PLUS3, 5), 0xFF},
+            {"sna48", make_sna(ram, false, 0), 0x25},
+            {"sna128", make_sna(ram, true, 3), 0xFF},
+            {"sna128_5", make_sna(ram, true, 5), 0xFF},
+        };
+        for (const Made &m : made) {
+            bool sna = strncmp(m.name, "sna", 3) == 0;
+            char name[64];
+            snprintf(name, sizeof(name), "/%03d_%s.%s", n, m.name, sna ? "sna" : "z80");
+            std::string path = std::string(dir) + name;
+            write_file(path, m.data);
+
+            // Back as written: the banks, and PC and SP wherever they were kept
+            SnapshotInfo info;
+            memset(back, 0, sizeof(back));
+            bool ok = read_memory(m.data, sna ? SNAP_SNA : SNAP_Z80, info, back, 0xFF, 0, SNAP_BANK_SIZE) &&
+                      info.banks == m.banks && info.regs.pc == MAKE_PC && info.regs.sp == MAKE_SP &&
+                      info.regs.af == 0x1234 && info.border == 2 && info.regs.im == 1;
+            for (int bank = 0; ok && bank < SNAP_BANKS; bank++) {
+                const uint8_t *a = ram + bank * SNAP_BANK_SIZE, *b = back + bank * SNAP_BANK_SIZE;
+                bool stack = sna && !(m.banks & 0x80) && bank == 0;    // 48K .SNA: PC pushed at 0xFEFE
+                if ((m.banks & 1 << bank) &&
+                    memcmp(a, b, stack ? MAKE_SP - 2 - 0xC000 : SNAP_BANK_SIZE) != 0)
+                    ok = false;
+            }
+            if (!ok) {
+                printf("%s: doesn't read back as written\n", path.c_str());
+                failures++;
+            }
+        }
+    }
+    printf("%d snapshots in %s, %s\n", count * 8, dir, failures ? "some FAILED" : "all read back");
+    return failures ? 1 : 0;
+}
+
+// The bench
+
+struct Totals {
+    uint32_t files, failed;
+    double bytes, seconds, refSeconds, screenSeconds;
+};
+
+static const char *describe(const SnapshotInfo &info)
+{
+    static char text[32];
+    static const char *MACHINES[] = {"16K", "48K", "128K", "+3"};
+    if (info.format == SNAP_SNA)
+        snprintf(text, sizeof(text), "SNA %s", MACHINES[info.machine]);
+    else
+        snprintf(text, sizeof(text), "Z80 v%u %s%s", info.version, MACHINES[info.machine],
+                 info.version == 1 && !info.compressed ? " raw" : "");
+    return text;
+}
+
+static void bench_file(const char *path, int reps, Totals &t)
+{
+    Bytes f;
+    SnapshotFormat format = snapshot_format(path);
+    if (format == SNAP_UNKNOWN || !read_file(path, f))
+        return;
+    t.files++;
+    static uint8_t ram[SNAP_BANKS * SNAP_BANK_SIZE], ref[SNAP_BANKS * SNAP_BANK_SIZE];
+    SnapshotInfo info;
+    memset(ram, 0, sizeof(ram));
+    if (!read_memory(f, format, info, ram, 0xFF, 0, SNAP_BANK_SIZE)) {
+        printf("%-28s can't read\n", path);
+        t.failed++;
+        return;
+    }
+    memset(ref, 0, sizeof(ref));
+    bool ok = reference(f, info, ref) && memcmp(ram, ref, sizeof(ram)) == 0;
+
+    // Just the screen, from memory and from the file
+    uint8_t screen[ZX_SCREEN_SIZE];
+    uint8_t bank = snapshot_screen_bank(info);
+    FILE *file = fopen(path, "rb");
+    ok = ok && file && snapshot_screen(file, format, (uint32_t)f.size(), screen) == SNAP_OK &&
+         memcmp(screen, ram + bank * SNAP_BANK_SIZE, ZX_SCREEN_SIZE) == 0;
+    if (file)
+        fclose(file);
+
+    double start = now_s();
+    for (int i = 0; i < reps; i++)
+        read_memory(f, format, info, ram, 0xFF, 0, SNAP_BANK_SIZE);
+    double fast = (now_s() - start) / reps;
+    start = now_s();
+    for (int i = 0; i < reps; i++)
+        reference(f, info, ref);
+    double slow = (now_s() - start) / reps;
+    start = now_s();
+    for (int i = 0; i < reps; i++)
+        read_memory(f, format, info, ram, (uint8_t)(1 << bank), 0, ZX_SCREEN_SIZE);
+    double scr = (now_s() - start) / reps;
+
+    int banks = __builtin_popcount(info.banks);
+    printf("%-28s %-14s %5.1f%%  %8.0f %8.0f %7.1f  %6.1f  %s\n", path, describe(info),
+           100.0 * f.size() / (banks * SNAP_BANK_SIZE), banks * SNAP_BANK_SIZE / fast / 1e6,
+           banks * SNAP_BANK_SIZE / slow / 1e6, slow / fast, scr * 1e6, ok ? "ok" : "MISMATCH");
+    t.bytes += banks * SNAP_BANK_SIZE;
+    t.seconds += fast;
+    t.refSeconds += slow;
+    t.screenSeconds += scr;
+    if (!ok)
+        t.failed++;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "--make") == 0)
+        return make_corpus(argv[2], argc > 3 ? atoi(argv[3]) : 4);
+
+    int reps = 50;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            continue;
+        }
+        DIR *d = opendir(argv[i]);
+        if (d == NULL) {
+            paths.push_back(argv[i]);
+            continue;
+        }
+        std::vector<std::string> names;
+        while (dirent *e = readdir(d)) {
+            if (snapshot_format(e->d_name) != SNAP_UNKNOWN)
+                names.push_back(std::string(argv[i]) + "/" + e->d_name);
+        }
+        closedir(d);
+        std::sort(names.begin(), names.end());
+        paths.insert(paths.end(), names.begin(), names.end());
+    }
+    if (paths.empty() || reps < 1) {
+        fprintf(stderr, "usage: snap_bench <file | dir> ... [--reps n]\n"
+                        "       snap_bench --make <dir> [count]\n");
+        return 2;
+    }
+
+    printf("%-28s %-14s %6s  %8s %8s %7s  %6s\n", "file", "format", "size", "MB/s", "ref MB/s", "speedup",
+           "scr us");
+    Totals t = {};
+    for (const std::string &p : paths)
+        bench_file(p.c_str(), reps, t);
+    if (t.files == 0) {
+        fprintf(stderr, "no .z80 or .sna files\n");
+        return 1;
+    }
+    if (t.bytes > 0)
+        printf("\n%u files: %.0f MB/s against %.0f MB/s for the reference (%.1fx), screen alone %.1f us a file\n",
+               t.files, t.bytes / t.seconds / 1e6, t.bytes / t.refSeconds / 1e6, t.refSeconds / t.seconds,
+               t.screenSeconds / t.files * 1e6);
+    if (t.failed)
+        printf("%u FAILED\n", t.failed);
+    return t.failed ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * tap2wav - host side renderer for the tape pulse streams used by the firmware.
+ *
+ * Runs the exact same TAP/TZX conversion as the device and writes the result as a WAV file,
+ * so the pulse stream can be compared sample by sample with other tools' output.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/tape/tape_pulses.cpp tools/tap2wav.cpp -o tap2wav
+ *
+ * Usage:
+ *   tap2wav <input.tap|input.tzx> <output.wav> [sample rate, default 44100]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "tape/tape_pulses.h"
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = (uint8_t *)malloc(*len ? *len : 1);
+    if (data != NULL && fread(data, 1, *len, f) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <input.tap|input.tzx> <output.wav> [sample rate]\n", argv[0]);
+        return 2;
+    }
+    uint32_t rate = argc > 3 ? (uint32_t)atoi(argv[3]) : 44100;
+
+    size_t len;
+    uint8_t *image = read_file(argv[1], &len);
+    if (image == NULL) {
+        fprintf(stderr, "can't read %s\n", argv[1]);
+        return 1;
+    }
+
+    TapePulseBuffer pulses;
+    tape_pulses_init(&pulses);
+    TapeResult result = tape_build_pulses(image, len, &pulses);
+    free(image);
+    if (result != TAPE_OK) {
+        fprintf(stderr, "can't convert %s (error %d)\n", argv[1], result);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL || !tape_render_wav(&pulses, out, rate)) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    uint64_t duration = tape_pulses_duration(&pulses);
+    printf("%u blocks, %u runs (%u bytes), %.2f s\n", pulses.blockCount, pulses.count,
+           (unsigned)(pulses.count * sizeof(TapePulse)), duration / (double)TAPE_TSTATES_PER_SECOND);
+    tape_pulses_free(&pulses);
+    return 0;
+}
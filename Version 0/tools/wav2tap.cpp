@@ -0,0 +1,120 @@
+/*
+ * wav2tap - decodes a tape recording into a .tap file with the firmware's streaming decoder.
+ *
+ * The WAV is fed in small buffers, the same way the ADC DMA feeds the decoder on the device,
+ * and the decoding throughput is reported in samples per second.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/tape/tape_decoder.cpp tools/wav2tap.cpp -o wav2tap
+ *
+ * Usage:
+ *   wav2tap <input.wav> <output.tap>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "tape/tape_decoder.h"
+
+static const size_t FEED_SAMPLES = 1024;   // Same order of size as a DMA buffer on the device
+
+struct Wav {
+    uint16_t channels;
+    uint16_t bits;
+    uint32_t rate;
+    int16_t *samples;           // Mono, signed 16-bit
+    size_t count;
+};
+
+static bool load_wav(const char *path, Wav *wav)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, f) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+        fclose(f);
+        return false;
+    }
+
+    bool haveFormat = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, f) == 8) {
+        uint32_t size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, f) != 16)
+                break;
+            wav->channels = fmt[2] | (fmt[3] << 8);
+            wav->rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            wav->bits = fmt[14] | (fmt[15] << 8);
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+            haveFormat = (fmt[0] | (fmt[1] << 8)) == 1 && (wav->bits == 8 || wav->bits == 16) && wav->channels > 0;
+        } else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+            uint8_t *raw = (uint8_t *)malloc(size ? size : 1);
+            size = fread(raw, 1, size, f);
+            size_t frame = wav->channels * wav->bits / 8;
+            wav->count = size / frame;
+            wav->samples = (int16_t *)malloc((wav->count ? wav->count : 1) * sizeof(int16_t));
+            for (size_t i = 0; i < wav->count; i++) {
+                const uint8_t *p = raw + i * frame;         // First channel only
+                wav->samples[i] = wav->bits == 8 ? (int16_t)((p[0] - 128) << 8) : (int16_t)(p[0] | (p[1] << 8));
+            }
+            free(raw);
+            fclose(f);
+            return true;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return false;
+}
+
+static void on_block(const uint8_t *data, uint16_t len, bool checksumOk, void *ctx)
+{
+    FILE *out = (FILE *)ctx;
+    printf("block: flag 0x%02X, %u bytes, checksum %s\n", data[0], len, checksumOk ? "ok" : "BAD");
+    tape_write_tap_block(out, data, len);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <input.wav> <output.tap>\n", argv[0]);
+        return 2;
+    }
+
+    Wav wav = {};
+    if (!load_wav(argv[1], &wav)) {
+        fprintf(stderr, "can't read %s (PCM 8/16-bit WAV expected)\n", argv[1]);
+        return 1;
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        return 1;
+    }
+
+    static uint8_t block[65536];
+    TapeDecoder dec;
+    tape_decoder_init(&dec, wav.rate, block, sizeof(block), on_block, out);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < wav.count; pos += FEED_SAMPLES) {
+        size_t n = wav.count - pos < FEED_SAMPLES ? wav.count - pos : FEED_SAMPLES;
+        tape_decoder_feed(&dec, wav.samples + pos, n);
+    }
+    tape_decoder_finish(&dec);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fclose(out);
+    printf("%u samples at %u Hz, %u edges, %u good / %u bad blocks\n", dec.stats.samples, wav.rate,
+           dec.stats.edges, dec.stats.blocksOk, dec.stats.blocksBad);
+    printf("throughput: %.1f Msamples/s (%.0fx real time)\n", dec.stats.samples / seconds / 1e6,
+           dec.stats.samples / seconds / wav.rate);
+    free(wav.samples);
+    return dec.stats.blocksBad ? 1 : 0;
+}
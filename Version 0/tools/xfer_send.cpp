@@ -0,0 +1,427 @@
+/*
+ * xfer_send - sends files to the device's SD card over the USB serial link, with the protocol in
+ * src/storage/serial_xfer.h: a window of CRC-checked frames in flight, go-back-N on a gap or a
+ * timeout, and resume of a transfer that was cut off (just send the same file again).
+ *
+ * --rig runs the firmware's receiver on this machine instead, at the other end of a pseudo-terminal,
+ * with its storage writing into a temporary directory from a second thread as on the device. It
+ * sends a file of random data, checks what arrived and reports the sustained rate. --corrupt damages
+ * one frame in n on the way, --cut stops the first attempt after that many bytes and sends again to
+ * resume, --card limits the storage writes to a card speed in KB/s.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -pthread -Isrc tools/xfer_send.cpp src/storage/serial_xfer.cpp src/storage/serial_xfer_file.cpp \
+ *       src/system/crc32.cpp -o xfer_send
+ *
+ * Usage:
+ *   xfer_send /dev/ttyACM0 file ...
+ *   xfer_send --rig <MB> [--corrupt <n>] [--cut <bytes>] [--card <KB/s>]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "storage/serial_xfer.h"
+#include "system/crc32.h"
+
+static const int REPLY_WAIT_MS      = 50;       // Longest wait for a reply between sends
+static const int RESEND_AFTER_MS    = 300;      // No ACK progress for this long: go back to the last ACK
+static const int GIVE_UP_MS         = 10000;
+static const int HANDSHAKE_TRIES    = 10;       // OPEN and CLOSE, every 500 ms
+
+static double now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool make_raw(int fd)
+{
+    termios t;
+    if (tcgetattr(fd, &t) != 0)
+        return false;
+    cfmakeraw(&t);
+    cfsetspeed(&t, B921600);        // Ignored by USB CDC, which runs at USB speed
+    return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+// The sending end of the link, with the damage --corrupt asks for
+struct Link {
+    int fd;
+    uint32_t corruptOneIn;
+    uint32_t rng;
+    uint32_t corrupted;
+    uint8_t in[4096];
+    size_t inPos, inLen;
+    XferParser parser;
+};
+
+static void link_send(Link &l, uint8_t type, uint32_t offset, const uint8_t *payload, uint16_t length)
+{
+    uint8_t frame[XFER_MAX_FRAME];
+    size_t n = xfer_encode(frame, type, 0, offset, payload, length);
+    if (l.corruptOneIn) {
+        l.rng = l.rng * 1664525 + 1013904223;
+        if ((l.rng >> 8) % l.corruptOneIn == 0) {
+            frame[(l.rng >> 4) % n] ^= 0x10;
+            l.corrupted++;
+        }
+    }
+    if (!write_all(l.fd, frame, n)) {
+        perror("write");
+        exit(1);
+    }
+}
+
+// Next reply frame, or false after waiting timeoutMs
+static bool link_reply(Link &l, XferFrame *frame, int timeoutMs)
+{
+    double until = now_ms() + timeoutMs;
+    for (;;) {
+        while (l.inPos < l.inLen) {
+            l.inPos += xfer_parse(&l.parser, l.in + l.inPos, l.inLen - l.inPos, frame);
+            if (frame->type)
+                return true;
+        }
+        int wait = (int)(until - now_ms());
+        pollfd p = {l.fd, POLLIN, 0};
+        if (wait < 0 || poll(&p, 1, wait) <= 0)
+            return false;
+        ssize_t n = read(l.fd, l.in, sizeof(l.in));
+        if (n <= 0)
+            return false;
+        l.inPos = 0;
+        l.inLen = n;
+    }
+}
+
+struct SendResult {
+    bool ok;
+    uint32_t resumedFrom;
+    uint64_t resent;            // Bytes sent more than once
+    uint32_t gaps, timeouts;
+    double ms;
+};
+
+// Sends data as name. Stops quietly after cutAt bytes (0: no cut), like a cable being pulled.
+static SendResult send_file(Link &l, const std::vector<uint8_t> &data, const char *name, uint32_t cutAt)
+{
+    SendResult res;
+    memset(&res, 0, sizeof(res));
+    uint32_t size = (uint32_t)data.size();
+    uint32_t crc = crc32_update(0, data.data(), size);
+    double start = now_ms();
+    XferFrame f;
+
+reopen:
+    uint32_t acked = 0, next = 0, windowEnd = 0, highest = 0;
+    bool ready = false;
+    for (int i = 0; i < HANDSHAKE_TRIES && !ready; i++) {
+        link_send(l, XFER_OPEN, size, (const uint8_t *)name, (uint16_t)strlen(name));
+        double until = now_ms() + 500;
+        while (!ready && link_reply(l, &f, (int)(until - now_ms()) + 1)) {
+            if (f.type == XFER_READY && f.length == 4) {
+                acked = next = highest = res.resumedFrom = f.offset;
+                windowEnd = f.offset + get32(f.payload);
+                ready = true;
+            } else if (f.type == XFER_ERROR && f.length == 1 && f.payload[0] != XFER_ERR_STATE) {
+                fprintf(stderr, "%s: receiver refused it (error %u)\n", name, f.payload[0]);
+                return res;
+            }
+        }
+    }
+    if (!ready) {
+        fprintf(stderr, "%s: no answer to OPEN\n", name);
+        return res;
+    }
+
+    double lastProgress = now_ms();
+    for (;;) {
+        while (acked < size) {
+            while (next < size && next < windowEnd) {
+                uint32_t n = size - next < XFER_MAX_PAYLOAD ? size - next : XFER_MAX_PAYLOAD;
+                if (n > windowEnd - next)
+                    n = windowEnd - next;
+                if (cutAt && next + n > cutAt)
+                    return res;
+                link_send(l, XFER_DATA, next, data.data() + next, (uint16_t)n);
+                if (next < highest)
+                    res.resent += n;
+                next += n;
+                if (next > highest)
+                    highest = next;
+            }
+
+            if (link_reply(l, &f, REPLY_WAIT_MS)) {
+                if (f.type == XFER_ACK && f.length == 4) {
+                    if (f.offset > acked) {
+                        acked = f.offset;
+                        lastProgress = now_ms();
+                    }
+                    windowEnd = f.offset + get32(f.payload);
+                    if (f.flags & XFER_FLAG_GAP) {
+                        next = f.offset;
+                        res.gaps++;
+                    }
+                    if (next < acked)
+                        next = acked;
+                } else if (f.type == XFER_ERROR && f.length == 1) {
+                    if (f.payload[0] == XFER_ERR_STATE)
+                        goto reopen;          // The receiver restarted: open again and resume
+                    fprintf(stderr, "%s: receiver error %u\n", name, f.payload[0]);
+                    return res;
+                }
+            }
+
+            double idle = now_ms() - lastProgress;
+            if (idle > GIVE_UP_MS) {
+                fprintf(stderr, "%s: stalled at %u\n", name, acked);
+                return res;
+            }
+            if (idle > RESEND_AFTER_MS && next > acked) {
+                next = acked;
+                res.timeouts++;
+                lastProgress = now_ms();
+            }
+        }
+
+        uint8_t payload[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+        bool backToData = false;
+        for (int i = 0; i < HANDSHAKE_TRIES && !backToData; i++) {
+            link_send(l, XFER_CLOSE, size, payload, 4);
+            double until = now_ms() + 500;
+            while (link_reply(l, &f, (int)(until - now_ms()) + 1)) {
+                if (f.type == XFER_DONE && f.offset == size) {
+                    res.ok = true;
+                    res.ms = now_ms() - start;
+                    return res;
+                }
+                if (f.type == XFER_ACK && (f.flags & XFER_FLAG_GAP) && f.offset < size && f.length == 4) {
+                    acked = next = f.offset;
+                    windowEnd = f.offset + get32(f.payload);
+                    backToData = true;
+                    break;
+                }
+                if (f.type == XFER_ERROR && f.length == 1) {
+                    if (f.payload[0] == XFER_ERR_STATE)
+                        goto reopen;
+                    fprintf(stderr, "%s: receiver error %u at close\n", name, f.payload[0]);
+                    return res;
+                }
+            }
+        }
+        if (!backToData) {
+            fprintf(stderr, "%s: no answer to CLOSE\n", name);
+            return res;
+        }
+        lastProgress = now_ms();
+    }
+}
+
+static void report(const char *name, uint32_t size, const SendResult &r)
+{
+    double mb = (size - r.resumedFrom) / 1048576.0;
+    printf("%-24s %10u bytes  %7.2f MB/s", name, size, r.ms > 0 ? mb / (r.ms / 1e3) : 0.0);
+    if (r.resumedFrom)
+        printf("  resumed at %u", r.resumedFrom);
+    if (r.resent)
+        printf("  resent %llu bytes (%u gaps, %u timeouts)", (unsigned long long)r.resent, r.gaps, r.timeouts);
+    printf("\n");
+}
+
+// Receiver side of the rig: the firmware's code, fed from the pty on one thread, storage on another
+static XferReceiver receiver;
+static std::atomic<bool> rigRunning(true);
+static uint32_t cardKBs = 0;
+
+static XferStorage fileStorage;
+static bool (*fileWrite)(const uint8_t *data, size_t len, void *ctx);
+
+// The file write, taking as long as the card would
+static bool card_write(const uint8_t *data, size_t len, void *ctx)
+{
+    if (cardKBs)
+        usleep((useconds_t)((uint64_t)len * 1000000 / (cardKBs * 1024ull)));
+    return fileWrite(data, len, ctx);
+}
+
+static void rig_send(const uint8_t *data, size_t len, void *ctx)
+{
+    write_all(*(int *)ctx, data, len);
+}
+
+static int rig(uint32_t megabytes, uint32_t corruptOneIn, uint32_t cutAt)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0 || !make_raw(master) || !make_raw(slave)) {
+        perror("pty");
+        return 1;
+    }
+    char dir[] = "/tmp/xfer_rig_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    static XferFileStorage files;
+    xfer_file_storage(&fileStorage, &files, dir);
+    fileWrite = fileStorage.write;
+    fileStorage.write = card_write;
+    xfer_rx_init(&receiver, &fileStorage, rig_send, &slave);
+
+    std::thread io([] {
+        while (rigRunning) {
+            if (!xfer_rx_storage_work(&receiver))
+                usleep(100);
+        }
+    });
+    std::thread rx([slave] {
+        uint8_t buf[4096];
+        while (rigRunning) {
+            pollfd p = {slave, POLLIN, 0};
+            ssize_t n = poll(&p, 1, 2) > 0 ? read(slave, buf, sizeof(buf)) : 0;
+            xfer_rx_feed(&receiver, buf, n > 0 ? n : 0);
+        }
+    });
+
+    std::vector<uint8_t> data((size_t)megabytes << 20);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < data.size(); i++) {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+
+    static Link link;
+    link.fd = master;
+    link.corruptOneIn = corruptOneIn;
+    link.rng = 12345;
+    xfer_parser_init(&link.parser);
+
+    const char *name = "rig.bin";
+    SendResult r = send_file(link, data, name, cutAt);
+    if (cutAt) {
+        printf("cut after %u bytes, sending again\n", cutAt);
+        r = send_file(link, data, name, 0);
+    }
+    rigRunning = false;
+    rx.join();
+    io.join();
+
+    int failures = 0;
+    std::string path = std::string(dir) + "/" + name;
+    if (r.ok) {
+        report(name, (uint32_t)data.size(), r);
+        FILE *f = fopen(path.c_str(), "rb");
+        std::vector<uint8_t> got(data.size() + 1);
+        size_t n = f ? fread(got.data(), 1, got.size(), f) : 0;
+        if (f)
+            fclose(f);
+        if (n != data.size() || memcmp(got.data(), data.data(), n) != 0) {
+            printf("received file differs\n");
+            failures++;
+        }
+    } else {
+        failures++;
+    }
+    const XferStats &s = receiver.stats;
+    printf("receiver: %u frames, %u gaps, %u waits on storage, %u CRC errors, %u resumed; sender corrupted %u\n",
+           s.frames, s.gaps, s.storageWaits, receiver.parser.crcErrors, s.resumed, link.corrupted);
+
+    remove(path.c_str());
+    remove((path + ".part").c_str());
+    rmdir(dir);
+    close(slave);
+    close(master);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "--rig") == 0) {
+        uint32_t corrupt = 0, cut = 0;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--corrupt") == 0)
+                corrupt = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--cut") == 0)
+                cut = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--card") == 0)
+                cardKBs = atoi(argv[i + 1]);
+        }
+        return rig(atoi(argv[2]), corrupt, cut);
+    }
+    if (argc < 3 || argv[1][0] == '-') {
+        fprintf(stderr, "usage: xfer_send <port> file ...\n"
+                        "       xfer_send --rig <MB> [--corrupt <n>] [--cut <bytes>] [--card <KB/s>]\n");
+        return 2;
+    }
+
+    int fd = open(argv[1], O_RDWR | O_NOCTTY);
+    if (fd < 0 || !make_raw(fd)) {
+        fprintf(stderr, "%s: can't open\n", argv[1]);
+        return 1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    static Link link;
+    link.fd = fd;
+    xfer_parser_init(&link.parser);
+
+    int failures = 0;
+    for (int i = 2; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            fprintf(stderr, "%s: can't open\n", argv[i]);
+            failures++;
+            continue;
+        }
+        std::vector<uint8_t> data;
+        uint8_t buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            data.insert(data.end(), buf, buf + n);
+        fclose(f);
+
+        const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        SendResult r = send_file(link, data, name, 0);
+        if (r.ok)
+            report(name, (uint32_t)data.size(), r);
+        else
+            failures++;
+    }
+    close(fd);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * zxscr_bench - checks the SCREEN$ decoder against a straightforward per-pixel reference and
+ * measures its throughput.
+ *
+ * Every view (1:1 crop, 2x, thumbnails, odd scales) is rendered in both flash phases, landscape and
+ * panel-native, and compared pixel for pixel with the reference. A render can also be saved as a
+ * PPM golden image, or checked against one saved earlier.
+ *
+ * Build (from the "Version 0" folder):
+ *   g++ -O2 -Isrc src/gfx/zx_screen.cpp tools/zxscr_bench.cpp -o zxscr_bench
+ *
+ * Usage:
+ *   zxscr_bench [screen.scr] [--save golden.ppm | --check golden.ppm]
+ *   (without a .scr file a pseudo-random screen with FLASH attributes is used)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "gfx/zx_screen.h"
+
+// The obvious decoder, no tables: the reference everything else is checked against
+static uint16_t reference_pixel(const uint8_t *scr, int x, int y, bool phase)
+{
+    int addr = ((y & 0xC0) << 5) | ((y & 0x07) << 8) | ((y & 0x38) << 2) | (x >> 3);
+    bool set = (scr[addr] >> (7 - (x & 7))) & 1;
+    uint8_t attr = scr[6144 + (y / 8) * 32 + x / 8];
+    if ((attr & 0x80) && phase)
+        set = !set;
+    int colour = set ? (attr & 7) : ((attr >> 3) & 7);
+    int v = (attr & 0x40) ? 0xFF : 0xD7;
+    int r = (colour & 2) ? v : 0, g = (colour & 4) ? v : 0, b = (colour & 1) ? v : 0;
+    uint16_t rgb = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    return (rgb >> 8) | (rgb << 8);
+}
+
+static uint16_t reference_view_pixel(const uint8_t *scr, const ZxScreenView &v, int c, int r, bool phase)
+{
+    return reference_pixel(scr, v.srcX + c * v.srcW / v.dstW, v.srcY + r * v.srcH / v.dstH, phase);
+}
+
+static int check_view(const uint8_t *scr, const ZxScreenView &v, const char *name)
+{
+    int errors = 0;
+    std::vector<uint16_t> land(v.dstW * v.dstH), native(v.dstW * v.dstH);
+    for (int phase = 0; phase < 2; phase++) {
+        zx_screen_render(scr, v, phase, land.data(), v.dstW);
+        // Native output in uneven column chunks, like the chunked panel push does
+        for (int col = 0; col < v.dstW; col += 37) {
+            int cols = v.dstW - col < 37 ? v.dstW - col : 37;
+            zx_screen_render_native(scr, v, phase, native.data() + col * v.dstH, col, cols);
+        }
+        for (int r = 0; r < v.dstH; r++) {
+            for (int c = 0; c < v.dstW; c++) {
+                uint16_t want = reference_view_pixel(scr, v, c, r, phase);
+                if (land[r * v.dstW + c] != want || native[c * v.dstH + (v.dstH - 1 - r)] != want)
+                    errors++;
+            }
+        }
+    }
+    printf("%-22s %3dx%-3d %s\n", name, v.dstW, v.dstH, errors ? "MISMATCH" : "ok");
+    return errors;
+}
+
+static double bench(const uint8_t *scr, const ZxScreenView &v, bool native)
+{
+    std::vector<uint16_t> buf(v.dstW * v.dstH);
+    const int frames = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        if (native)
+            zx_screen_render_native(scr, v, i & 16, buf.data(), 0, v.dstW);
+        else
+            zx_screen_render(scr, v, i & 16, buf.data(), v.dstW);
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)v.dstW * v.dstH * frames / s / 1e6;
+}
+
+static double bench_reference(const uint8_t *scr, const ZxScreenView &v)
+{
+    std::vector<uint16_t> buf(v.dstW * v.dstH);
+    const int frames = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+        for (int r = 0; r < v.dstH; r++)
+            for (int c = 0; c < v.dstW; c++)
+                buf[r * v.dstW + c] = reference_view_pixel(scr, v, c, r, i & 16);
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    volatile uint16_t sink = buf[0];
+    (void)sink;
+    return (double)v.dstW * v.dstH * frames / s / 1e6;
+}
+
+// PPM (binary RGB) of a landscape render, for golden images
+static std::vector<uint8_t> to_ppm(const uint16_t *px, int w, int h)
+{
+    char header[32];
+    int n = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", w, h);
+    std::vector<uint8_t> out(header, header + n);
+    for (int i = 0; i < w * h; i++) {
+        uint16_t c = (px[i] >> 8) | (px[i] << 8);
+        out.push_back(((c >> 11) & 0x1F) << 3);
+        out.push_back(((c >> 5) & 0x3F) << 2);
+        out.push_back((c & 0x1F) << 3);
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t scr[ZX_SCREEN_SIZE];
+    const char *save = NULL, *check = NULL;
+    bool loaded = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            check = argv[++i];
+        } else {
+            FILE *f = fopen(argv[i], "rb");
+            if (f == NULL || fread(scr, 1, ZX_SCREEN_SIZE, f) != (size_t)ZX_SCREEN_SIZE) {
+                fprintf(stderr, "can't read a 6912-byte screen from %s\n", argv[i]);
+                return 1;
+            }
+            fclose(f);
+            loaded = true;
+        }
+    }
+    if (!loaded) {
+        uint32_t seed = 12345;
+        for (int i = 0; i < ZX_SCREEN_SIZE; i++) {
+            seed = seed * 1103515245 + 12345;
+            scr[i] = seed >> 16;
+        }
+    }
+
+    zx_screen_init(true);
+
+    int errors = 0;
+    errors += check_view(scr, zx_screen_view_fit(640, 180), "fit 640x180 (1:1 crop)");
+    errors += check_view(scr, zx_screen_view_fit(640, 192), "full 1:1");
+    errors += check_view(scr, ZxScreenView{0, 6, 256, 180, 512, 180}, "2x wide, cropped");
+    errors += check_view(scr, zx_screen_view_scaled(128, 96), "thumbnail 1/2");
+    errors += check_view(scr, zx_screen_view_scaled(200, 150), "scaled 200x150");
+    errors += check_view(scr, ZxScreenView{13, 7, 101, 77, 301, 59}, "odd crop and scale");
+
+    ZxScreenView fit = zx_screen_view_fit(640, 180);
+    std::vector<uint16_t> frame(fit.dstW * fit.dstH);
+    zx_screen_render(scr, fit, false, frame.data(), fit.dstW);
+    std::vector<uint8_t> ppm = to_ppm(frame.data(), fit.dstW, fit.dstH);
+    if (save) {
+        FILE *f = fopen(save, "wb");
+        fwrite(ppm.data(), 1, ppm.size(), f);
+        fclose(f);
+        printf("golden image written to %s\n", save);
+    }
+    if (check) {
+        std::vector<uint8_t> golden(ppm.size() + 1);
+        FILE *f = fopen(check, "rb");
+        size_t n = f ? fread(golden.data(), 1, golden.size(), f) : 0;
+        if (f)
+            fclose(f);
+        bool same = n == ppm.size() && memcmp(golden.data(), ppm.data(), n) == 0;
+        printf("golden image %s: %s\n", check, same ? "ok" : "DIFFERENT");
+        errors += same ? 0 : 1;
+    }
+
+    printf("\nthroughput (Mpixels/s):\n");
+    printf("  1:1 landscape (LUT, 4 words/byte)  %8.1f\n", bench(scr, fit, false));
+    printf("  2x landscape                       %8.1f\n", bench(scr, ZxScreenView{0, 6, 256, 180, 512, 180}, false));
+    printf("  1:1 panel-native                   %8.1f\n", bench(scr, fit, true));
+    printf("  thumbnail 128x96                   %8.1f\n", bench(scr, zx_screen_view_scaled(128, 96), false));
+    printf("  per-pixel reference                %8.1f\n", bench_reference(scr, fit));
+
+    return errors ? 1 : 0;
+}